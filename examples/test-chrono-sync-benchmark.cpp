@@ -0,0 +1,675 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+/**
+ * This runs N ChronoSync2013 participants in one process, each with its own
+ * Face, connected by an in-memory forwarder which stands in for NFD. The
+ * forwarder broadcasts each interest to the other faces, aggregates interests
+ * with the same name in a PIT, and adds the given latency and packet loss to
+ * each delivery. After the participants join one at a time, random
+ * participants publish a new sequence number, and this prints the time until
+ * every participant has the new sequence number, the packets and CPU time per
+ * update, and the memory per participant. The join time is until every
+ * participant has the newcomer.
+ * Usage: test-chrono-sync-benchmark [-compact] [latencyMs [lossPercent [N ...]]]
+ * where -compact uses ChronoSync2013.setUseCompactEncoding(true).
+ * The default is 5 ms latency, no loss and N of 10 and 100. Every participant
+ * answers each newcomer with its whole state, so the join phase is O(N^2).
+ * The whole state must fit in one data packet, which limits N to a few
+ * hundred, depending on the length of the data prefixes.
+ */
+
+// Only compile if ndn-cpp-config.h defines NDN_CPP_HAVE_PROTOBUF = 1.
+#include <ndn-cpp/ndn-cpp-config.h>
+#if NDN_CPP_HAVE_PROTOBUF
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <deque>
+#include <vector>
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <ndn-cpp/face.hpp>
+#include <ndn-cpp/control-response.hpp>
+#include <ndn-cpp/transport/transport.hpp>
+#include <ndn-cpp/security/key-chain.hpp>
+#include <ndn-cpp/security/identity/memory-identity-storage.hpp>
+#include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
+#include <ndn-cpp/security/policy/no-verify-policy-manager.hpp>
+#include <ndn-cpp/sync/chrono-sync2013.hpp>
+#include "../src/c/encoding/tlv/tlv.h"
+#include "../src/encoding/element-listener.hpp"
+
+using namespace std;
+using namespace ndn;
+using namespace ndn::func_lib;
+
+static double
+getNowSeconds()
+{
+  struct timeval t;
+  gettimeofday(&t, 0);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/**
+ * Get the resident set size of this process from /proc/self/statm.
+ * @return The resident bytes, or 0 if not available.
+ */
+static size_t
+getResidentBytes()
+{
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (!file)
+    return 0;
+
+  unsigned long size, resident;
+  int nValues = fscanf(file, "%lu %lu", &size, &resident);
+  fclose(file);
+  if (nValues != 2)
+    return 0;
+
+  return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+class InMemoryTransport;
+
+/**
+ * An InMemoryForwarder connects the InMemoryTransport of each participant.
+ * It answers prefix registration commands, forwards each interest to the other
+ * faces once per interest lifetime, and returns each data packet to the faces
+ * in the PIT entries of the data name and its prefixes.
+ */
+class InMemoryForwarder {
+public:
+  /**
+   * Create an InMemoryForwarder.
+   * @param latencySeconds The delay of each delivery.
+   * @param lossRate The probability from 0 to 1 of dropping each delivery,
+   * except for the responses to prefix registration.
+   */
+  InMemoryForwarder(double latencySeconds, double lossRate)
+  : latencySeconds_(latencySeconds), lossRate_(lossRate), nDelivered_(0),
+    nextSweepTime_(0),
+    ribRegisterPrefix_("/localhost/nfd/rib/register"),
+    localPrefix_("/local")
+  {
+  }
+
+  /**
+   * Add the transport as a new face.
+   * @return The face ID.
+   */
+  int
+  addFace(InMemoryTransport* transport)
+  {
+    faces_.push_back(transport);
+    return faces_.size() - 1;
+  }
+
+  /**
+   * Process an interest or data packet which the face sent.
+   */
+  void
+  receive(int faceId, const uint8_t* element, size_t elementLength);
+
+  /**
+   * Deliver the packets whose latency has passed to their transports.
+   * @return True if a packet was delivered.
+   */
+  bool
+  processEvents();
+
+  /**
+   * Get the number of packets delivered to a face, not counting the responses
+   * to prefix registration.
+   */
+  uint64_t
+  getNDelivered() const { return nDelivered_; }
+
+private:
+  class PitEntry {
+  public:
+    PitEntry()
+    : nForwarded_(0), forwardExpireTime_(0)
+    {
+    }
+
+    // The key is the face ID. The value is the expire time of the in-record.
+    map<int, double> inRecords_;
+    // isForwarded_[faceId] is true if the interest is pending at the face.
+    vector<bool> isForwarded_;
+    size_t nForwarded_;
+    double forwardExpireTime_;
+  };
+
+  void
+  schedule(int faceId, const Blob& element, bool mayDrop);
+
+  void
+  receiveInterest(int faceId, const Blob& element);
+
+  void
+  receiveData(int faceId, const Blob& element);
+
+  /**
+   * Remove the PIT entries whose in-records and forwarded interests expired.
+   */
+  void
+  sweep(double now);
+
+  double latencySeconds_;
+  double lossRate_;
+  uint64_t nDelivered_;
+  double nextSweepTime_;
+  Name ribRegisterPrefix_;
+  Name localPrefix_;
+  vector<InMemoryTransport*> faces_;
+  map<Name, PitEntry> pit_;
+  // The key is the delivery time. The value is the face ID and the element.
+  multimap<double, pair<int, Blob> > queue_;
+};
+
+/**
+ * An InMemoryTransport is the transport of a Face which is connected to an
+ * InMemoryForwarder.
+ */
+class InMemoryTransport : public Transport {
+public:
+  InMemoryTransport(InMemoryForwarder& forwarder)
+  : forwarder_(forwarder), elementListener_(0), faceId_(-1)
+  {
+  }
+
+  virtual bool
+  isLocal(const Transport::ConnectionInfo& connectionInfo) { return true; }
+
+  virtual bool
+  isAsync() { return false; }
+
+  virtual void
+  connect
+    (const Transport::ConnectionInfo& connectionInfo,
+     ElementListener& elementListener, const OnConnected& onConnected)
+  {
+    elementListener_ = &elementListener;
+    faceId_ = forwarder_.addFace(this);
+    if (onConnected)
+      onConnected();
+  }
+
+  virtual void
+  send(const uint8_t *data, size_t dataLength)
+  {
+    forwarder_.receive(faceId_, data, dataLength);
+  }
+
+  virtual void
+  processEvents()
+  {
+    // onReceivedElement can call send, which can add to received_.
+    deque<Blob> received;
+    received.swap(received_);
+    for (size_t i = 0; i < received.size(); ++i)
+      elementListener_->onReceivedElement
+        (received[i].buf(), received[i].size());
+  }
+
+  virtual bool
+  getIsConnected() { return elementListener_ != 0; }
+
+  virtual void
+  close() {}
+
+  /**
+   * Queue the element to give to the Face in the next processEvents().
+   */
+  void
+  deliver(const Blob& element) { received_.push_back(element); }
+
+private:
+  InMemoryForwarder& forwarder_;
+  ElementListener* elementListener_;
+  int faceId_;
+  deque<Blob> received_;
+};
+
+void
+InMemoryForwarder::receive
+  (int faceId, const uint8_t* element, size_t elementLength)
+{
+  Blob elementCopy(element, elementLength);
+  if (element[0] == ndn_Tlv_Interest)
+    receiveInterest(faceId, elementCopy);
+  else if (element[0] == ndn_Tlv_Data)
+    receiveData(faceId, elementCopy);
+}
+
+void
+InMemoryForwarder::receiveInterest(int faceId, const Blob& element)
+{
+  Interest interest;
+  interest.wireDecode(element);
+  const Name& name = interest.getName();
+
+  if (ribRegisterPrefix_.match(name)) {
+    // Accept the registration. Node does not check the response signature.
+    ControlResponse response;
+    response.setStatusCode(200);
+    response.setStatusText("OK");
+    Data data(name);
+    data.setContent(response.wireEncode());
+    schedule(faceId, data.wireEncode(), false);
+    return;
+  }
+  if (localPrefix_.match(name))
+    // ChronoSync2013 uses /local/timeout as a timer.
+    return;
+
+  double now = getNowSeconds();
+  double lifetimeSeconds = interest.getInterestLifetimeMilliseconds() >= 0 ?
+    interest.getInterestLifetimeMilliseconds() / 1000.0 : 4.0;
+
+  PitEntry& entry = pit_[name];
+  entry.inRecords_[faceId] = now + lifetimeSeconds;
+  if (now >= entry.forwardExpireTime_ ||
+      entry.isForwarded_.size() != faces_.size()) {
+    // The forwarded interests expired, so forward again.
+    entry.isForwarded_.assign(faces_.size(), false);
+    entry.nForwarded_ = 0;
+    entry.forwardExpireTime_ = now + lifetimeSeconds;
+  }
+
+  if (entry.nForwarded_ + 1 < faces_.size()) {
+    // Forward to each other face which doesn't have the interest, including a
+    // face which sent the same interest, since it may answer it later.
+    for (size_t i = 0; i < faces_.size(); ++i) {
+      if ((int)i == faceId || entry.isForwarded_[i])
+        continue;
+
+      entry.isForwarded_[i] = true;
+      ++entry.nForwarded_;
+      schedule(i, element, true);
+    }
+  }
+
+  if (now >= nextSweepTime_) {
+    sweep(now);
+    nextSweepTime_ = now + 1.0;
+  }
+}
+
+void
+InMemoryForwarder::receiveData(int faceId, const Blob& element)
+{
+  Data data;
+  data.wireDecode(element);
+  const Name& name = data.getName();
+
+  double now = getNowSeconds();
+  for (size_t i = 0; i <= name.size(); ++i) {
+    map<Name, PitEntry>::iterator entry = pit_.find(name.getPrefix(i));
+    if (entry == pit_.end())
+      continue;
+
+    for (map<int, double>::iterator inRecord = entry->second.inRecords_.begin();
+         inRecord != entry->second.inRecords_.end(); ++inRecord) {
+      if (inRecord->first != faceId && inRecord->second >= now)
+        schedule(inRecord->first, element, true);
+    }
+    pit_.erase(entry);
+  }
+}
+
+void
+InMemoryForwarder::schedule(int faceId, const Blob& element, bool mayDrop)
+{
+  if (mayDrop) {
+    if (lossRate_ > 0 && (double)rand() / RAND_MAX < lossRate_)
+      return;
+    ++nDelivered_;
+  }
+
+  queue_.insert(make_pair
+    (getNowSeconds() + latencySeconds_, make_pair(faceId, element)));
+}
+
+bool
+InMemoryForwarder::processEvents()
+{
+  double now = getNowSeconds();
+  bool didDeliver = false;
+  while (!queue_.empty() && queue_.begin()->first <= now) {
+    faces_[queue_.begin()->second.first]->deliver(queue_.begin()->second.second);
+    queue_.erase(queue_.begin());
+    didDeliver = true;
+  }
+
+  return didDeliver;
+}
+
+void
+InMemoryForwarder::sweep(double now)
+{
+  map<Name, PitEntry>::iterator entry = pit_.begin();
+  while (entry != pit_.end()) {
+    bool isPending = now < entry->second.forwardExpireTime_;
+    for (map<int, double>::iterator inRecord = entry->second.inRecords_.begin();
+         inRecord != entry->second.inRecords_.end() && !isPending; ++inRecord) {
+      if (inRecord->second >= now)
+        isPending = true;
+    }
+
+    if (isPending)
+      ++entry;
+    else
+      pit_.erase(entry++);
+  }
+}
+
+/**
+ * A Participant has a Face on the InMemoryForwarder and a ChronoSync2013.
+ */
+class Participant {
+public:
+  Participant(InMemoryForwarder& forwarder)
+  : transport_(new InMemoryTransport(forwarder)),
+    face_(new Face
+      (transport_, ptr_lib::make_shared<Transport::ConnectionInfo>())),
+    isInitialized_(false)
+  {
+  }
+
+  static void
+  onReceivedSyncState
+    (const vector<ChronoSync2013::SyncState>& syncStates, bool isRecovery)
+  {
+    // A real application would fetch the application data.
+  }
+
+  void
+  onInitialized() { isInitialized_ = true; }
+
+  static void
+  onRegisterFailed(const ptr_lib::shared_ptr<const Name>& prefix)
+  {
+    throw runtime_error("Register failed for prefix " + prefix->toUri());
+  }
+
+  ptr_lib::shared_ptr<InMemoryTransport> transport_;
+  ptr_lib::shared_ptr<Face> face_;
+  ptr_lib::shared_ptr<ChronoSync2013> sync_;
+  string dataPrefixUri_;
+  bool isInitialized_;
+};
+
+/**
+ * Process events of the forwarder and all faces until isDone returns true.
+ * @param forwarder The InMemoryForwarder.
+ * @param participants The participants.
+ * @param isDone This is called every 10 milliseconds.
+ * @param timeoutSeconds Stop after this many seconds.
+ * @return True if isDone returned true, false for timeout.
+ */
+static bool
+runUntil
+  (InMemoryForwarder& forwarder,
+   vector<ptr_lib::shared_ptr<Participant> >& participants,
+   const function<bool()>& isDone, double timeoutSeconds)
+{
+  double startTime = getNowSeconds();
+  double nextCheckTime = 0;
+  while (true) {
+    double now = getNowSeconds();
+    if (now >= nextCheckTime) {
+      if (isDone())
+        return true;
+      if (now - startTime >= timeoutSeconds)
+        return false;
+      nextCheckTime = now + 0.01;
+    }
+
+    bool didDeliver = forwarder.processEvents();
+    for (size_t i = 0; i < participants.size(); ++i)
+      participants[i]->face_->processEvents();
+
+    if (!didDeliver)
+      usleep(1000);
+  }
+}
+
+static bool
+isNever() { return false; }
+
+/**
+ * Check if the participant is initialized and knows nProducers producers.
+ */
+static bool
+hasProducers(const Participant* participant, size_t nProducers)
+{
+  if (!participant->isInitialized_)
+    return false;
+
+  vector<ChronoSync2013::PrefixAndSessionNo> prefixes;
+  participant->sync_->getProducerPrefixes(prefixes);
+  return prefixes.size() >= nProducers;
+}
+
+/**
+ * Check if each participant has the sequence number of the publisher.
+ */
+static bool
+haveSequenceNo
+  (const vector<ptr_lib::shared_ptr<Participant> >* participants,
+   const string* dataPrefixUri, int sessionNo, int sequenceNo,
+   size_t* nConvergedParticipants)
+{
+  while (*nConvergedParticipants < participants->size()) {
+    if ((*participants)[*nConvergedParticipants]->sync_->getProducerSequenceNo
+        (*dataPrefixUri, sessionNo) < sequenceNo)
+      return false;
+    ++(*nConvergedParticipants);
+  }
+
+  return true;
+}
+
+/**
+ * Join nParticipants one at a time, then publish from random participants and
+ * print the results to cout.
+ */
+static void
+benchmarkChronoSync
+  (int nParticipants, double latencySeconds, double lossRate,
+   bool useCompactEncoding, int nUpdates, KeyChain& keyChain,
+   const Name& certificateName)
+{
+  const double timeoutSeconds = 60;
+  const Milliseconds syncLifetime = 1000;
+  const int sessionNo = 1;
+  Name broadcastPrefix("/ndn/broadcast/benchmark-chrono-sync");
+
+  size_t startBytes = getResidentBytes();
+  InMemoryForwarder forwarder(latencySeconds, lossRate);
+  vector<ptr_lib::shared_ptr<Participant> > participants;
+
+  // The first participant waits for the initial interest to time out, so
+  // don't count it.
+  double totalJoinSeconds = 0;
+  for (int i = 0; i < nParticipants; ++i) {
+    ptr_lib::shared_ptr<Participant> participant
+      (new Participant(forwarder));
+    participant->face_->setCommandSigningInfo(keyChain, certificateName);
+    ostringstream dataPrefix;
+    dataPrefix << "/benchmark/participant" << i;
+    participant->dataPrefixUri_ = Name(dataPrefix.str()).toUri();
+    participants.push_back(participant);
+
+    double joinStartTime = getNowSeconds();
+    participant->sync_.reset(new ChronoSync2013
+      (&Participant::onReceivedSyncState,
+       bind(&Participant::onInitialized, participant.get()),
+       Name(dataPrefix.str()), broadcastPrefix, sessionNo,
+       *participant->face_, keyChain, certificateName, syncLifetime,
+       &Participant::onRegisterFailed));
+    participant->sync_->setUseCompactEncoding(useCompactEncoding);
+
+    // Wait until the newcomer has all the producers and every participant has
+    // the first sequence number of the newcomer. If the whole state in the
+    // reply to the newcomer is bigger than Face::getMaxNdnPacketSize(), the
+    // newcomer initializes as the only producer and does not join.
+    size_t nConvergedParticipants = 0;
+    if (!runUntil
+        (forwarder, participants,
+         bind(&hasProducers, participant.get(), participants.size()),
+         timeoutSeconds) ||
+        !runUntil
+        (forwarder, participants,
+         bind(&haveSequenceNo, &participants, &participant->dataPrefixUri_,
+              sessionNo, 0, &nConvergedParticipants),
+         timeoutSeconds)) {
+      cout << "N " << nParticipants << ": participant " << i <<
+        " did not join" << endl;
+      return;
+    }
+    if (i > 0)
+      totalJoinSeconds += getNowSeconds() - joinStartTime;
+  }
+  size_t joinedBytes = getResidentBytes();
+
+  // Let the recovery timers from the join phase expire before timing updates.
+  runUntil(forwarder, participants, &isNever, 3.0);
+
+  double totalConvergeSeconds = 0;
+  double maxConvergeSeconds = 0;
+  uint64_t totalPackets = 0;
+  clock_t totalClocks = 0;
+  int nConvergedUpdates = 0;
+  for (int i = 0; i < nUpdates; ++i) {
+    Participant& publisher = *participants[rand() % participants.size()];
+
+    uint64_t startPackets = forwarder.getNDelivered();
+    clock_t startClock = clock();
+    double updateStartTime = getNowSeconds();
+    publisher.sync_->publishNextSequenceNo();
+    int sequenceNo = publisher.sync_->getSequenceNo();
+
+    size_t nConvergedParticipants = 0;
+    if (!runUntil
+        (forwarder, participants,
+         bind(&haveSequenceNo, &participants, &publisher.dataPrefixUri_,
+              sessionNo, sequenceNo, &nConvergedParticipants),
+         timeoutSeconds))
+      continue;
+
+    double convergeSeconds = getNowSeconds() - updateStartTime;
+    totalConvergeSeconds += convergeSeconds;
+    if (convergeSeconds > maxConvergeSeconds)
+      maxConvergeSeconds = convergeSeconds;
+    totalPackets += forwarder.getNDelivered() - startPackets;
+    totalClocks += clock() - startClock;
+    ++nConvergedUpdates;
+  }
+
+  cout << "N " << nParticipants << ": join " <<
+    (nParticipants > 1 ? totalJoinSeconds / (nParticipants - 1) * 1000 : 0) <<
+    " ms, ";
+  if (nConvergedUpdates == 0) {
+    cout << "no updates converged" << endl;
+    return;
+  }
+  cout << "update convergence " <<
+    totalConvergeSeconds / nConvergedUpdates * 1000 << " ms (max " <<
+    maxConvergeSeconds * 1000 << " ms), " <<
+    (double)totalPackets / nConvergedUpdates << " packets/update, " <<
+    (double)totalClocks / CLOCKS_PER_SEC / nConvergedUpdates * 1000 <<
+    " ms CPU/update, " <<
+    (joinedBytes - startBytes) / 1024.0 / nParticipants <<
+    " KB/participant";
+  if (nConvergedUpdates < nUpdates)
+    cout << ", " << (nUpdates - nConvergedUpdates) << " updates did not converge";
+  cout << endl;
+
+  // Stop the callbacks before destroying the faces.
+  for (size_t i = 0; i < participants.size(); ++i)
+    participants[i]->sync_->shutdown();
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    int iArg = 1;
+    bool useCompactEncoding = false;
+    if (iArg < argc && string(argv[iArg]) == "-compact") {
+      useCompactEncoding = true;
+      ++iArg;
+    }
+    double latencyMilliseconds = iArg < argc ? atof(argv[iArg++]) : 5;
+    double lossPercent = iArg < argc ? atof(argv[iArg++]) : 0;
+    vector<int> nParticipantsList;
+    for (; iArg < argc; ++iArg)
+      nParticipantsList.push_back(atoi(argv[iArg]));
+    if (nParticipantsList.empty()) {
+      nParticipantsList.push_back(10);
+      nParticipantsList.push_back(100);
+    }
+
+    // All participants share one ECDSA identity, which is fast to sign with.
+    KeyChain keyChain
+      (ptr_lib::make_shared<IdentityManager>
+         (ptr_lib::make_shared<MemoryIdentityStorage>(),
+          ptr_lib::make_shared<MemoryPrivateKeyStorage>()),
+       ptr_lib::make_shared<NoVerifyPolicyManager>());
+    Name certificateName = keyChain.createIdentityAndCertificate
+      (Name("/benchmark/chrono-sync"), EcdsaKeyParams());
+
+    cout << "Latency " << latencyMilliseconds << " ms, loss " << lossPercent <<
+      "%" << (useCompactEncoding ? ", compact encoding" : "") << endl;
+    srand(1);
+    for (size_t i = 0; i < nParticipantsList.size(); ++i)
+      benchmarkChronoSync
+        (nParticipantsList[i], latencyMilliseconds / 1000.0,
+         lossPercent / 100.0, useCompactEncoding, 20, keyChain,
+         certificateName);
+  } catch (const std::exception& e) {
+    cout << "exception: " << e.what() << endl;
+  }
+  return 0;
+}
+
+#else // NDN_CPP_HAVE_PROTOBUF
+
+#include <iostream>
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+  cout <<
+    "This program uses Protobuf but it is not installed. Install it and ./configure again." << endl;
+}
+
+#endif // NDN_CPP_HAVE_PROTOBUF
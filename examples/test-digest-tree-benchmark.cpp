@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+/**
+ * This measures the time for the DigestTree operations which ChronoSync2013
+ * does for each sync message, with 10 to 100000 producers: add a producer,
+ * update the sequence number of a producer and get the new root, and find a
+ * producer.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <time.h>
+#include <sys/time.h>
+#include <stdexcept>
+#include <vector>
+#include "../src/sync/digest-tree.hpp"
+
+using namespace std;
+using namespace ndn;
+
+static double
+getNowSeconds()
+{
+  struct timeval t;
+  gettimeofday(&t, 0);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/**
+ * Add nProducers to a DigestTree in random order, then update and find random
+ * producers, and print the microseconds per operation to cout.
+ * @param nProducers The number of producers.
+ * @param nOperations The number of updates and finds to time.
+ */
+static void
+benchmarkDigestTree(int nProducers, int nOperations)
+{
+  vector<string> prefixes;
+  for (int i = 0; i < nProducers; ++i) {
+    ostringstream prefix;
+    prefix << "/ndn/edu/ucla/producer" << i;
+    prefixes.push_back(prefix.str());
+  }
+  for (int i = nProducers - 1; i > 0; --i)
+    swap(prefixes[i], prefixes[rand() % (i + 1)]);
+
+  DigestTree tree;
+  double start = getNowSeconds();
+  for (int i = 0; i < nProducers; ++i)
+    tree.update(prefixes[i], 1, 0);
+  tree.getRoot();
+  double addDuration = getNowSeconds() - start;
+
+  // ChronoSync2013 gets the root after each update.
+  start = getNowSeconds();
+  for (int i = 0; i < nOperations; ++i) {
+    tree.update(prefixes[rand() % nProducers], 1, i + 1);
+    tree.getRoot();
+  }
+  double updateDuration = getNowSeconds() - start;
+
+  int nFound = 0;
+  start = getNowSeconds();
+  for (int i = 0; i < nOperations; ++i) {
+    if (tree.find(prefixes[rand() % nProducers], 1) >= 0)
+      ++nFound;
+  }
+  double findDuration = getNowSeconds() - start;
+  if (nFound != nOperations)
+    throw runtime_error("DigestTree.find did not find a producer");
+
+  cout << "Producers: " << nProducers <<
+    ", add usec: " << addDuration * 1e6 / nProducers <<
+    ", update and getRoot usec: " << updateDuration * 1e6 / nOperations <<
+    ", find usec: " << findDuration * 1e6 / nOperations << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    srand(1);
+    for (int nProducers = 10; nProducers <= 100000; nProducers *= 10)
+      benchmarkDigestTree(nProducers, 2000);
+  } catch (std::exception& e) {
+    cout << "exception: " << e.what() << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+/**
+ * This measures the time for GroupManager.getGroupKey to make the E-KEY and
+ * the D-KEY of each member for one time slot, with 100 to 10000 members, using
+ * one thread and then the number of hardware threads. Each call also generates
+ * the group's RSA key pair. Then it measures getGroupKey for the same time
+ * slot when the Data packets are cached.
+ * Usage: test-group-manager-benchmark [nMembers ...]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/time.h>
+#include <ndn-cpp/security/identity/memory-identity-storage.hpp>
+#include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
+#include <ndn-cpp/security/policy/no-verify-policy-manager.hpp>
+#include <ndn-cpp/security/key-chain.hpp>
+#include <ndn-cpp/encrypt/schedule.hpp>
+#include <ndn-cpp/encrypt/algo/rsa-algorithm.hpp>
+#include <ndn-cpp/encrypt/sqlite3-group-manager-db.hpp>
+#include <ndn-cpp/encrypt/group-manager.hpp>
+
+using namespace std;
+using namespace ndn;
+
+static double
+getNowSeconds()
+{
+  struct timeval t;
+  gettimeofday(&t, 0);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/**
+ * Make a group manager with nMembers in a schedule for the whole day, then
+ * time getGroupKey for each thread count and print the results to cout.
+ * The members share one RSA key and have different certificate names.
+ * @param keyChain The KeyChain for signing.
+ * @param nMembers The number of members.
+ */
+static void
+benchmarkGetGroupKey(KeyChain& keyChain, int nMembers)
+{
+  GroupManager manager
+    (Name("/ndn/Alice"), Name("data_type"),
+     ptr_lib::make_shared<Sqlite3GroupManagerDb>(":memory:"), 2048, 1,
+     &keyChain);
+
+  Schedule schedule;
+  schedule.addWhiteInterval(ptr_lib::make_shared<RepetitiveInterval>
+    (Schedule::fromIsoString("20170801T000000"),
+     Schedule::fromIsoString("20170831T000000"), 0, 24, 1,
+     RepetitiveInterval::RepeatUnit::DAY));
+  manager.addSchedule("schedule", schedule);
+
+  RsaKeyParams params;
+  Blob memberDecryptKey = RsaAlgorithm::generateKey(params).getKeyBits();
+  Blob memberEncryptKey = RsaAlgorithm::deriveEncryptKey(memberDecryptKey)
+    .getKeyBits();
+  IdentityCertificate certificate;
+  certificate.setPublicKeyInfo(PublicKey(memberEncryptKey));
+  certificate.setNotBefore(0);
+  certificate.setNotAfter(0);
+  certificate.encode();
+  for (int i = 0; i < nMembers; ++i) {
+    ostringstream memberName;
+    memberName << "/ndn/member" << i << "/KEY/ksk-123/ID-CERT/123";
+    certificate.setName(Name(memberName.str()));
+    keyChain.sign(certificate);
+    manager.addMember("schedule", certificate);
+  }
+
+  MillisecondsSince1970 timeSlot = Schedule::fromIsoString("20170815T093000");
+  vector<ptr_lib::shared_ptr<Data> > result;
+  manager.setMaxCachedGroupKeys(0);
+  size_t threadCounts[] = { 1, 0 };
+  for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); ++i) {
+    manager.setThreadCount(threadCounts[i]);
+
+    double start = getNowSeconds();
+    manager.getGroupKey(timeSlot, result);
+    double duration = getNowSeconds() - start;
+    if (result.size() != (size_t)nMembers + 1)
+      throw runtime_error("getGroupKey did not return a D-KEY for each member");
+
+    cout << "Members: " << nMembers << ", threads: " <<
+      (threadCounts[i] == 0 ? "hardware" : "1") <<
+      ", getGroupKey sec: " << duration <<
+      ", usec per member: " << duration * 1e6 / nMembers << endl;
+  }
+
+  manager.setMaxCachedGroupKeys(GroupManager::DEFAULT_MAX_CACHED_GROUP_KEYS);
+  manager.getGroupKey(timeSlot, result);
+  double start = getNowSeconds();
+  manager.getGroupKey(timeSlot, result);
+  double duration = getNowSeconds() - start;
+  cout << "Members: " << nMembers << ", cached getGroupKey sec: " << duration <<
+    endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    ptr_lib::shared_ptr<MemoryIdentityStorage> identityStorage
+      (new MemoryIdentityStorage());
+    ptr_lib::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage
+      (new MemoryPrivateKeyStorage());
+    KeyChain keyChain
+      (ptr_lib::make_shared<IdentityManager>(identityStorage, privateKeyStorage),
+       ptr_lib::make_shared<NoVerifyPolicyManager>());
+    Name identityName("/ndn/Alice");
+    keyChain.createIdentityAndCertificate(identityName);
+    keyChain.getIdentityManager()->setDefaultIdentity(identityName);
+
+    if (argc > 1) {
+      for (int i = 1; i < argc; ++i)
+        benchmarkGetGroupKey(keyChain, atoi(argv[i]));
+    }
+    else {
+      for (int nMembers = 100; nMembers <= 10000; nMembers *= 10)
+        benchmarkGetGroupKey(keyChain, nMembers);
+    }
+  } catch (std::exception& e) {
+    cout << "exception: " << e.what() << endl;
+  }
+  return 0;
+}
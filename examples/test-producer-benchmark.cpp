@@ -0,0 +1,214 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+/**
+ * This measures the throughput in MB/s to encrypt content in AES 128 CBC with
+ * a new cipher context for each segment (as in AesAlgorithm::encrypt) and
+ * with one AesCbcEncryptorLite, then the throughput of Producer.produce for
+ * each segment and of Producer.produceSegments with one thread and then the
+ * number of hardware threads. Each Data packet is signed with an RSA key.
+ * Usage: test-producer-benchmark [contentMegabytes [segmentSize]]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <sys/time.h>
+#include <ndn-cpp/security/identity/memory-identity-storage.hpp>
+#include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
+#include <ndn-cpp/security/policy/no-verify-policy-manager.hpp>
+#include <ndn-cpp/security/key-chain.hpp>
+#include <ndn-cpp/lite/encrypt/algo/aes-cbc-encryptor-lite.hpp>
+#include <ndn-cpp/encrypt/algo/aes-algorithm.hpp>
+#include <ndn-cpp/encrypt/schedule.hpp>
+#include <ndn-cpp/encrypt/sqlite3-producer-db.hpp>
+#include <ndn-cpp/encrypt/producer.hpp>
+
+using namespace std;
+using namespace ndn;
+using namespace ndn::func_lib;
+
+static double
+getNowSeconds()
+{
+  struct timeval t;
+  gettimeofday(&t, 0);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void
+printThroughput(const string& label, size_t nBytes, double duration)
+{
+  cout << label << ": " << nBytes / 1e6 / duration << " MB/s" << endl;
+}
+
+/**
+ * Time encrypting each segment of the content with AesAlgorithm::encrypt and
+ * with one AesCbcEncryptorLite.
+ */
+static void
+benchmarkEncrypt(const Blob& content, size_t segmentSize)
+{
+  Blob key = AesAlgorithm::generateKey(AesKeyParams(128)).getKeyBits();
+  uint8_t initialVector[AesAlgorithm::BLOCK_SIZE] = { 0 };
+  EncryptParams params(ndn_EncryptAlgorithmType_AesCbc);
+  params.setInitialVector(Blob(initialVector, sizeof(initialVector)));
+
+  double start = getNowSeconds();
+  for (size_t offset = 0; offset < content.size(); offset += segmentSize) {
+    size_t length = min(segmentSize, content.size() - offset);
+    AesAlgorithm::encrypt(key, Blob(content.buf() + offset, length), params);
+  }
+  printThroughput
+    ("Encrypt, new context per segment", content.size(),
+     getNowSeconds() - start);
+
+  AesCbcEncryptorLite encryptor;
+  if (encryptor.setKey(key) != NDN_ERROR_success)
+    throw runtime_error("Error setting the AesCbcEncryptorLite key");
+  vector<uint8_t> encrypted(segmentSize + AesAlgorithm::BLOCK_SIZE);
+  start = getNowSeconds();
+  for (size_t offset = 0; offset < content.size(); offset += segmentSize) {
+    size_t length = min(segmentSize, content.size() - offset);
+    size_t encryptedLength;
+    if (encryptor.encrypt
+        (initialVector, sizeof(initialVector), content.buf() + offset, length,
+         &encrypted[0], encryptedLength) != NDN_ERROR_success)
+      throw runtime_error("Error in AesCbcEncryptorLite encrypt");
+  }
+  printThroughput
+    ("Encrypt, reused AesCbcEncryptorLite", content.size(),
+     getNowSeconds() - start);
+}
+
+/**
+ * A Face which does not send interests, since the Producer doesn't need to
+ * fetch E-KEYs for this benchmark.
+ */
+class SilentFace : public Face {
+public:
+  SilentFace()
+  : Face("localhost")
+  {}
+
+  virtual uint64_t
+  expressInterest
+    (const Interest& interest, const OnData& onData,
+     const OnTimeout& onTimeout, const OnNetworkNack& onNetworkNack,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+  {
+    return 0;
+  }
+};
+
+static void
+countSegments
+  (const vector<ptr_lib::shared_ptr<Data> >& segments, size_t* segmentCount)
+{
+  *segmentCount += segments.size();
+}
+
+static void
+onError(EncryptError::ErrorCode errorCode, const string& message)
+{
+  throw runtime_error("Producer error: " + message);
+}
+
+/**
+ * Time Producer.produce for each segment of the content, then
+ * Producer.produceSegments for each thread count.
+ */
+static void
+benchmarkProducer(KeyChain& keyChain, const Blob& content, size_t segmentSize)
+{
+  SilentFace face;
+  Producer producer
+    (Name("/prefix"), Name("/data_type"), &face, &keyChain,
+     ptr_lib::make_shared<Sqlite3ProducerDb>(":memory:"));
+  MillisecondsSince1970 timeSlot = Schedule::fromIsoString("20170815T093000");
+  // Create the content key before timing.
+  producer.createContentKey(timeSlot, Producer::OnEncryptedKeys());
+
+  double start = getNowSeconds();
+  for (size_t offset = 0; offset < content.size(); offset += segmentSize) {
+    size_t length = min(segmentSize, content.size() - offset);
+    Data data;
+    producer.produce
+      (data, timeSlot, Blob(content.buf() + offset, length), onError);
+  }
+  printThroughput
+    ("Producer.produce per segment", content.size(), getNowSeconds() - start);
+
+  size_t threadCounts[] = { 1, 0 };
+  for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); ++i) {
+    producer.setThreadCount(threadCounts[i]);
+    size_t segmentCount = 0;
+
+    start = getNowSeconds();
+    producer.produceSegments
+      (timeSlot, content, segmentSize, bind(&countSegments, _1, &segmentCount),
+       onError);
+    double duration = getNowSeconds() - start;
+    if (segmentCount != (content.size() + segmentSize - 1) / segmentSize)
+      throw runtime_error("produceSegments did not make each segment");
+
+    printThroughput
+      (string("Producer.produceSegments, threads: ") +
+       (threadCounts[i] == 0 ? "hardware" : "1"), content.size(), duration);
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    size_t contentMegabytes = (argc > 1 ? atoi(argv[1]) : 8);
+    size_t segmentSize = (argc > 2 ? atoi(argv[2]) : 8192);
+    if (contentMegabytes == 0 || segmentSize == 0)
+      throw runtime_error
+        ("Usage: test-producer-benchmark [contentMegabytes [segmentSize]]");
+
+    vector<uint8_t> contentBuffer(contentMegabytes * 1000000);
+    for (size_t i = 0; i < contentBuffer.size(); ++i)
+      contentBuffer[i] = i;
+    Blob content(contentBuffer);
+    cout << "Content MB: " << contentMegabytes << ", segment size: " <<
+      segmentSize << endl;
+
+    benchmarkEncrypt(content, segmentSize);
+
+    ptr_lib::shared_ptr<MemoryIdentityStorage> identityStorage
+      (new MemoryIdentityStorage());
+    ptr_lib::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage
+      (new MemoryPrivateKeyStorage());
+    KeyChain keyChain
+      (ptr_lib::make_shared<IdentityManager>(identityStorage, privateKeyStorage),
+       ptr_lib::make_shared<NoVerifyPolicyManager>());
+    Name identityName("/ndn/Alice");
+    keyChain.createIdentityAndCertificate(identityName);
+    keyChain.getIdentityManager()->setDefaultIdentity(identityName);
+
+    benchmarkProducer(keyChain, content, segmentSize);
+  } catch (std::exception& e) {
+    cout << "exception: " << e.what() << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+/**
+ * This measures the names per second which NdnRegexTopMatcher matches with the
+ * compiled NdnRegexAutomaton and with only the backtracking matchers, for the
+ * expressions in the regex unit tests and for an expression which needs
+ * exponential time to backtrack.
+ */
+
+#include <iostream>
+#include <time.h>
+#include <sys/time.h>
+#include <stdexcept>
+#include <vector>
+#include "../src/util/regex/ndn-regex-top-matcher.hpp"
+
+using namespace std;
+using namespace ndn;
+
+#if NDN_CPP_HAVE_REGEX_LIB
+
+static double
+getNowSeconds()
+{
+  struct timeval t;
+  gettimeofday(&t, 0);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/**
+ * Loop to match each name with the matcher nIterations times.
+ * @param matcher The NdnRegexTopMatcher.
+ * @param names The names to match.
+ * @param nIterations The number of iterations.
+ * @param nMatched Set this to the number of names matched in one iteration.
+ * @return The number of seconds for all iterations.
+ */
+static double
+benchmarkMatchSeconds
+  (NdnRegexTopMatcher& matcher, const vector<Name>& names, int nIterations,
+   int& nMatched)
+{
+  double start = getNowSeconds();
+  for (int i = 0; i < nIterations; ++i) {
+    nMatched = 0;
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (matcher.match(names[j]))
+        ++nMatched;
+    }
+  }
+  double finish = getNowSeconds();
+
+  return finish - start;
+}
+
+/**
+ * Match the names with the expression, with and without the automaton, and
+ * print the results to cout.
+ * @param expr The NDN regex expression.
+ * @param names The names to match.
+ * @param nIterations The number of iterations.
+ */
+static void
+benchmarkMatch(const string& expr, const vector<Name>& names, int nIterations)
+{
+  NdnRegexTopMatcher automatonMatcher(expr, "", true);
+  NdnRegexTopMatcher backtrackingMatcher(expr, "", false);
+
+  int nAutomatonMatched, nBacktrackingMatched;
+  double automatonDuration = benchmarkMatchSeconds
+    (automatonMatcher, names, nIterations, nAutomatonMatched);
+  double backtrackingDuration = benchmarkMatchSeconds
+    (backtrackingMatcher, names, nIterations, nBacktrackingMatched);
+  if (nAutomatonMatched != nBacktrackingMatched)
+    throw runtime_error("The automaton and backtracking results differ for " + expr);
+
+  double nNames = (double)nIterations * names.size();
+  cout << expr << ", matched " << nAutomatonMatched << "/" << names.size() <<
+    ", Automaton names/sec: " << nNames / automatonDuration <<
+    ", Backtracking names/sec: " << nNames / backtrackingDuration << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    // Make names like the ones in the regex unit tests.
+    vector<Name> names;
+    names.push_back(Name("/a/b/c"));
+    names.push_back(Name("/a/b/c/d"));
+    names.push_back(Name("/a/b/c/d/e"));
+    names.push_back(Name("/a/b/d"));
+    names.push_back(Name("/n/a/b/c"));
+    names.push_back(Name("/x/a/b/c/d"));
+    names.push_back(Name("/ndn/ucla.edu/DNS/yingdi/mac/ksk-1"));
+    names.push_back(Name("/ndn/edu/ucla/KEY/yingdi/ksk-1/ID-CERT/1"));
+    names.push_back(Name("/ndn/edu/ucla/yingdi/app/data/1/2/3/4"));
+
+    const char* expressions[] = {
+      "^<a><b><c>",
+      "<b><c><d>$",
+      "^<a><b><c><d>$",
+      "<a><b><c><d>",
+      "<b><c>",
+      "^(<.*>*)<.*>",
+      "^(<.*>*)<.*><c>(<.*>)<.*>",
+      "<.*>(<.*>*)<.*>$",
+      "<a>(<>*)<>$",
+      "^<ndn><(.*)\\.(.*)><DNS>(<>*)<>",
+      "^<ndn><edu><ucla><KEY><>*<ID-CERT><>$",
+      "^<ndn>[^<KEY>]*<app><data><>*$"
+    };
+    for (size_t i = 0; i < sizeof(expressions) / sizeof(expressions[0]); ++i)
+      benchmarkMatch(expressions[i], names, 2000);
+
+    // Backtracking tries every way to split the components among the <>*.
+    vector<Name> longNames;
+    Name longName;
+    for (int i = 0; i < 16; ++i)
+      longName.append("a");
+    longNames.push_back(longName);
+    benchmarkMatch("^<>*<>*<>*<>*<>*<>*<b>$", longNames, 2);
+  } catch (std::exception& e) {
+    cout << "exception: " << e.what() << endl;
+  }
+  return 0;
+}
+
+#else // NDN_CPP_HAVE_REGEX_LIB
+
+int
+main(int argc, char** argv)
+{
+  cout <<
+    "This program needs std::regex or Boost regex but neither is available." << endl;
+}
+
+#endif // NDN_CPP_HAVE_REGEX_LIB
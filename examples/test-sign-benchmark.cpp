@@ -0,0 +1,191 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+/**
+ * This measures the signatures per second of FilePrivateKeyStorage when each
+ * signature must read and decode the private key file ("cold") and when the
+ * decoded private key is already in memory ("warm"). This creates a temporary
+ * key pair in the default key store (~/.ndn/ndnsec-tpm-file) and deletes it
+ * when finished. It also measures the Data packets per second of
+ * KeyChain::signBatch for an increasing number of signing threads.
+ */
+
+#include <iostream>
+#include <time.h>
+#include <sys/time.h>
+#include <stdexcept>
+#include <vector>
+#include <ndn-cpp/security/identity/file-private-key-storage.hpp>
+#include <ndn-cpp/security/identity/memory-identity-storage.hpp>
+#include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
+#include <ndn-cpp/security/policy/no-verify-policy-manager.hpp>
+#include <ndn-cpp/security/key-chain.hpp>
+#if __cplusplus >= 201103L
+#include <thread>
+#endif
+
+using namespace std;
+using namespace ndn;
+
+static double
+getNowSeconds()
+{
+  struct timeval t;
+  gettimeofday(&t, 0);
+  return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+/**
+ * Loop to sign with the key nIterations times.
+ * @param storage The FilePrivateKeyStorage with the key.
+ * @param keyName The name of the key.
+ * @param nIterations The number of iterations.
+ * @param isCold If true, clear the private key cache before each signature.
+ * @return The number of seconds for all iterations.
+ */
+static double
+benchmarkSignSeconds
+  (FilePrivateKeyStorage& storage, const Name& keyName, int nIterations,
+   bool isCold)
+{
+  uint8_t data[100];
+  for (size_t i = 0; i < sizeof(data); ++i)
+    data[i] = (uint8_t)i;
+
+  double start = getNowSeconds();
+  for (int i = 0; i < nIterations; ++i) {
+    if (isCold)
+      storage.clearPrivateKeyCache();
+    data[0] = (uint8_t)i;
+    storage.sign(data, sizeof(data), keyName);
+  }
+  double finish = getNowSeconds();
+
+  return finish - start;
+}
+
+/**
+ * Create a key pair of the given type, call benchmarkSignSeconds for cold and
+ * warm signing and print the results to cout. Then delete the key pair.
+ * @param keyType KEY_TYPE_RSA or KEY_TYPE_ECDSA.
+ * @param nIterations The number of iterations.
+ */
+static void
+benchmarkSign(KeyType keyType, int nIterations)
+{
+  FilePrivateKeyStorage storage;
+  Name keyName("/test-sign-benchmark");
+  keyName.appendVersion((uint64_t)(getNowSeconds() * 1000.0))
+    .append(keyType == KEY_TYPE_ECDSA ? "ksk-ec" : "ksk-rsa");
+  if (keyType == KEY_TYPE_ECDSA)
+    storage.generateKeyPair(keyName, EcdsaKeyParams());
+  else
+    storage.generateKeyPair(keyName, RsaKeyParams());
+
+  try {
+    // Sign once so that the warm loop starts with the key in the cache.
+    benchmarkSignSeconds(storage, keyName, 1, false);
+
+    const char* keyTypeString = (keyType == KEY_TYPE_ECDSA ? "EC " : "RSA");
+    double duration = benchmarkSignSeconds(storage, keyName, nIterations, true);
+    cout << "Sign cold " << keyTypeString << ", Duration sec, Hz: " << duration
+         << ", " << (nIterations / duration) << endl;
+    duration = benchmarkSignSeconds(storage, keyName, nIterations, false);
+    cout << "Sign warm " << keyTypeString << ", Duration sec, Hz: " << duration
+         << ", " << (nIterations / duration) << endl;
+  } catch (...) {
+    storage.deleteKeyPair(keyName);
+    throw;
+  }
+
+  storage.deleteKeyPair(keyName);
+}
+
+/**
+ * Create an identity with a key of the given type in memory, then call
+ * KeyChain::signBatch on nData Data packets with 1, 2, 4, ... signing threads
+ * up to maxThreads and print the results to cout.
+ * @param keyType KEY_TYPE_RSA or KEY_TYPE_ECDSA.
+ * @param nData The number of Data packets in each batch.
+ * @param maxThreads The maximum number of signing threads.
+ */
+static void
+benchmarkSignBatch(KeyType keyType, int nData, size_t maxThreads)
+{
+  ptr_lib::shared_ptr<MemoryIdentityStorage> identityStorage
+    (new MemoryIdentityStorage());
+  ptr_lib::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage
+    (new MemoryPrivateKeyStorage());
+  KeyChain keyChain
+    (ptr_lib::make_shared<IdentityManager>(identityStorage, privateKeyStorage),
+     ptr_lib::make_shared<NoVerifyPolicyManager>());
+  Name certificateName;
+  if (keyType == KEY_TYPE_ECDSA)
+    certificateName = keyChain.createIdentityAndCertificate
+      (Name("/test-sign-benchmark/ec"), EcdsaKeyParams());
+  else
+    certificateName = keyChain.createIdentityAndCertificate
+      (Name("/test-sign-benchmark/rsa"), RsaKeyParams());
+
+  vector<Data> dataList(nData);
+  vector<Data*> dataPointers;
+  uint8_t content[100];
+  for (size_t i = 0; i < sizeof(content); ++i)
+    content[i] = (uint8_t)i;
+  for (int i = 0; i < nData; ++i) {
+    dataList[i].setName(Name("/test-sign-benchmark/data").appendSegment(i));
+    dataList[i].setContent(Blob(content, sizeof(content)));
+    dataPointers.push_back(&dataList[i]);
+  }
+
+  const char* keyTypeString = (keyType == KEY_TYPE_ECDSA ? "EC " : "RSA");
+  for (size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+    keyChain.setSigningThreadCount(nThreads);
+    // Sign once to start the threads.
+    keyChain.signBatch(dataPointers, certificateName);
+
+    double start = getNowSeconds();
+    keyChain.signBatch(dataPointers, certificateName);
+    double duration = getNowSeconds() - start;
+    cout << "Sign batch " << keyTypeString << ", threads " << nThreads <<
+      ", Duration sec, Hz: " << duration << ", " << (nData / duration) << endl;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    benchmarkSign(KEY_TYPE_ECDSA, 5000);
+    benchmarkSign(KEY_TYPE_RSA, 2000);
+
+    size_t maxThreads = 4;
+#if __cplusplus >= 201103L
+    if (std::thread::hardware_concurrency() > maxThreads)
+      maxThreads = std::thread::hardware_concurrency();
+#endif
+    benchmarkSignBatch(KEY_TYPE_ECDSA, 5000, maxThreads);
+    benchmarkSignBatch(KEY_TYPE_RSA, 2000, maxThreads);
+  } catch (std::exception& e) {
+    cout << "exception: " << e.what() << endl;
+  }
+  return 0;
+}
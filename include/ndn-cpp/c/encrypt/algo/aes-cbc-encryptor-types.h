@@ -0,0 +1,43 @@
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_AES_CBC_ENCRYPTOR_TYPES_H
+#define NDN_AES_CBC_ENCRYPTOR_TYPES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct evp_cipher_ctx_st;
+
+/**
+ * A struct ndn_AesCbcEncryptor holds a cipher context with an AES 128 key
+ * schedule so that it can encrypt many buffers in CBC mode without setting up
+ * the key each time.
+ */
+struct ndn_AesCbcEncryptor {
+  struct evp_cipher_ctx_st *context;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,9 +33,19 @@
 namespace ndn {
 
 class LpPacket;
+class LazyDataFields;
 
 class Data {
 public:
+  /**
+   * A ComputeSignature function object is used to pass a callback to
+   * wireEncodeWithSignature. It returns the signature bits for the signed
+   * portion of the encoding.
+   */
+  typedef func_lib::function<Blob
+    (const uint8_t* signedPortion, size_t signedPortionLength)>
+    ComputeSignature;
+
   /**
    * Create a new Data object with default values and where the signature is a blank Sha256WithRsaSignature.
    */
@@ -75,6 +85,28 @@ public:
   SignedBlob
   wireEncode(WireFormat& wireFormat = *WireFormat::getDefaultWireFormat()) const;
 
+  /**
+   * Encode this Data with signature bits from computeSignature, encoding the
+   * fields only once. This sets the signature bits of getSignature() to
+   * reservedLength placeholder bytes, encodes, calls computeSignature with the
+   * signed portion and writes the returned bits over the placeholder. If the
+   * returned bits are shorter than reservedLength (such as a DER-encoded ECDSA
+   * signature), the encoding is trimmed. If they are longer, or the wire format
+   * is not NDN-TLV, this encodes again. Like wireEncode, if wireFormat is the
+   * default wire format, also set the defaultWireEncoding.
+   * @param computeSignature The function which returns the signature bits for
+   * the signed portion. This updates getSignature() with the bits.
+   * @param reservedLength The length of the signature bits, or the maximum
+   * length if it can vary.
+   * @param wireFormat A WireFormat object used to encode. If omitted, use
+   * WireFormat getDefaultWireFormat().
+   * @return The encoding with the signature bits.
+   */
+  SignedBlob
+  wireEncodeWithSignature
+    (const ComputeSignature& computeSignature, size_t reservedLength,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat());
+
   /**
    * Decode the input using a particular wire format and update this Data. If wireFormat is the default wire format, also
    * set the defaultWireEncoding to another pointer to the input Blob.
@@ -111,6 +143,29 @@ public:
     wireDecode(&input[0], input.size(), wireFormat);
   }
 
+  /**
+   * Decode the input like wireDecode, but only scan the outer TLVs to find the
+   * fields. Each field (the name, MetaInfo, content or signature) is decoded
+   * when it is first accessed, so that a field which is not used is never
+   * decoded. If wireFormat is the default wire format, also set the
+   * defaultWireEncoding to another pointer to the input Blob, as in wireDecode.
+   * Since a field is decoded later, an error in the value of a field is thrown
+   * by the method which first accesses it, such as getName(). A const getter
+   * decodes a pending field while holding a lock which is shared with the
+   * copies of this Data, so that multiple threads can call the const getters
+   * without racing to decode the same field.
+   * @param input The input byte array to be decoded as an immutable Blob. This
+   * keeps a pointer to the Blob until all the fields are decoded.
+   * @param wireFormat A WireFormat object used to decode the input. If omitted,
+   * use WireFormat getDefaultWireFormat(). If this is not an NDN-TLV wire
+   * format, then this decodes all the fields now by calling wireDecode.
+   * @throws runtime_error for an error decoding the outer TLVs.
+   */
+  void
+  wireDecodeLazy
+    (const Blob& input,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat());
+
   /**
    * Set dataLite to point to the values in this Data object, without copying
    * any memory.
@@ -130,24 +185,52 @@ public:
   set(const DataLite& dataLite);
 
   const Signature*
-  getSignature() const { return signature_.get(); }
+  getSignature() const
+  {
+    decodePendingFields(PENDING_SIGNATURE);
+    return signature_.get();
+  }
 
   Signature*
-  getSignature() { return signature_.get(); }
+  getSignature()
+  {
+    decodePendingFields(PENDING_SIGNATURE);
+    return signature_.get();
+  }
 
   const Name&
-  getName() const { return name_.get(); }
+  getName() const
+  {
+    decodePendingFields(PENDING_NAME);
+    return name_.get();
+  }
 
   Name&
-  getName() { return name_.get(); }
+  getName()
+  {
+    decodePendingFields(PENDING_NAME);
+    return name_.get();
+  }
 
   const MetaInfo&
-  getMetaInfo() const { return metaInfo_.get(); }
+  getMetaInfo() const
+  {
+    decodePendingFields(PENDING_META_INFO);
+    return metaInfo_.get();
+  }
 
-  MetaInfo& getMetaInfo() { return metaInfo_.get(); }
+  MetaInfo& getMetaInfo()
+  {
+    decodePendingFields(PENDING_META_INFO);
+    return metaInfo_.get();
+  }
 
   const Blob&
-  getContent() const { return content_; }
+  getContent() const
+  {
+    decodePendingFields(PENDING_CONTENT);
+    return content_;
+  }
 
   /**
    * Get the incoming face ID according to the incoming packet header.
@@ -203,6 +286,7 @@ public:
   setSignature(const Signature& signature)
   {
     signature_.set(signature.clone());
+    pendingFields_ &= ~PENDING_SIGNATURE;
     ++changeCount_;
     return *this;
   }
@@ -224,6 +308,7 @@ public:
   setMetaInfo(const MetaInfo& metaInfo)
   {
     metaInfo_.set(metaInfo);
+    pendingFields_ &= ~PENDING_META_INFO;
     ++changeCount_;
     return *this;
   }
@@ -249,6 +334,7 @@ public:
   setContent(const Blob& content)
   {
     content_ = content;
+    pendingFields_ &= ~PENDING_CONTENT;
     ++changeCount_;
     return *this;
   }
@@ -288,6 +374,67 @@ public:
   }
 
 private:
+  /** Flags for the fields which wireDecodeLazy has not decoded yet. */
+  enum {
+    PENDING_NAME =      1,
+    PENDING_META_INFO = 2,
+    PENDING_CONTENT =   4,
+    PENDING_SIGNATURE = 8,
+    PENDING_ALL =       15
+  };
+
+  /**
+   * If any of the fields are still pending from wireDecodeLazy, decode them.
+   * This only reads lazyFields_ (which a const method never changes) before
+   * decodeLazyFields locks, so that multiple threads can call the const getters.
+   * @param fields The PENDING_ flags of the fields to decode.
+   */
+  void
+  decodePendingFields(int fields) const
+  {
+    if (lazyFields_)
+      // This method can be called on a const object, but we want to be able to
+      // update the fields.
+      const_cast<Data*>(this)->decodeLazyFields(fields);
+  }
+
+  /**
+   * If any of the fields are still pending from wireDecodeLazy, decode them.
+   * The caller of a non-const method has exclusive access to this object, so
+   * also release lazyFields_ when all the fields are decoded.
+   * @param fields The PENDING_ flags of the fields to decode.
+   */
+  void
+  decodePendingFields(int fields)
+  {
+    if (lazyFields_) {
+      decodeLazyFields(fields);
+      if (pendingFields_ == 0)
+        // We don't need the wire encoding anymore.
+        lazyFields_.reset();
+    }
+  }
+
+  /**
+   * Lock the mutex in lazyFields_, then decode the given fields which are still
+   * pending and clear their flags. Decoding a field does not change the change
+   * count, since the field has the value from the wire encoding. This does not
+   * release lazyFields_ since another thread may be reading it.
+   * @param fields The PENDING_ flags of the fields to decode.
+   */
+  void
+  decodeLazyFields(int fields);
+
+  /**
+   * Clear the pending fields from wireDecodeLazy.
+   */
+  void
+  clearLazyFields()
+  {
+    lazyFields_.reset();
+    pendingFields_ = 0;
+  }
+
   void
   setDefaultWireEncoding
     (const SignedBlob& defaultWireEncoding,
@@ -309,6 +456,8 @@ private:
   ptr_lib::shared_ptr<Name> defaultFullName_;
   uint64_t getDefaultWireEncodingChangeCount_;
   ptr_lib::shared_ptr<LpPacket> lpPacket_;
+  ptr_lib::shared_ptr<const LazyDataFields> lazyFields_;
+  int pendingFields_; /**< The PENDING_ flags of fields not yet decoded. */
   uint64_t changeCount_;
 };
 
@@ -24,6 +24,7 @@
 #define NDN_CONSUMER_HPP
 
 #include <map>
+#include <deque>
 #include "../data.hpp"
 #include "../face.hpp"
 #include "../security/key-chain.hpp"
@@ -146,6 +147,24 @@ public:
     impl_-> decryptContent(data, onPlainText, onError);
   }
 
+  /**
+   * Set the maximum number of decrypted C-KEYs, and the maximum number of
+   * decrypted D-KEYs, to keep so that consuming more content for the same
+   * time slot does not fetch and decrypt the keys again. When a cache is full,
+   * this removes the key which was added first. While a key is being fetched,
+   * other content which needs the same key waits for it instead of fetching it
+   * again, even if the maximum is 0.
+   * @param maxCachedKeys The maximum number of keys in each cache. If 0, don't
+   * cache keys. The default is DEFAULT_MAX_CACHED_KEYS.
+   */
+  void
+  setMaxCachedKeys(size_t maxCachedKeys)
+  {
+    impl_->setMaxCachedKeys(maxCachedKeys);
+  }
+
+  static const size_t DEFAULT_MAX_CACHED_KEYS = 100;
+
 private:
   // Give friend access to the tests.
   friend TestConsumer_DecryptContent_Test;
@@ -181,10 +200,74 @@ private:
       (const Data& data, const OnPlainText& onPlainText,
        const EncryptError::OnError& onError);
 
+    void
+    setMaxCachedKeys(size_t maxCachedKeys);
+
   private:
     // Give friend access to the tests.
     friend TestConsumer_DecryptContent_Test;
 
+    /**
+     * A KeyCache holds decrypted keys by key name, up to a maximum number. When
+     * it is full, adding a key removes the key which was added first.
+     */
+    class KeyCache {
+    public:
+      KeyCache() : maxSize_(DEFAULT_MAX_CACHED_KEYS) {}
+
+      /**
+       * Find the key with the keyName.
+       * @param keyName The key name.
+       * @param keyBits If found, set keyBits to the encoded key.
+       * @return True if found.
+       */
+      bool
+      find(const Name& keyName, Blob& keyBits) const;
+
+      /**
+       * Add the key, replacing a key with the same name.
+       * @param keyName The key name.
+       * @param keyBits The encoded key.
+       */
+      void
+      add(const Name& keyName, const Blob& keyBits);
+
+      /**
+       * Set the maximum number of keys, removing the first added keys if
+       * needed.
+       * @param maxSize The maximum number of keys. If 0, don't cache keys.
+       */
+      void
+      setMaxSize(size_t maxSize);
+
+    private:
+      std::map<Name, Blob> keys_;
+      // The key names in the order they were added.
+      std::deque<Name> keyNames_;
+      size_t maxSize_;
+    };
+
+    /**
+     * A PendingDecryption has the values to decrypt an EncryptedContent when
+     * its key is fetched.
+     */
+    class PendingDecryption {
+    public:
+      PendingDecryption
+        (const ptr_lib::shared_ptr<EncryptedContent>& encryptedContent,
+         const OnPlainText& onPlainText, const EncryptError::OnError& onError)
+      : encryptedContent_(encryptedContent), onPlainText_(onPlainText),
+        onError_(onError)
+      {}
+
+      ptr_lib::shared_ptr<EncryptedContent> encryptedContent_;
+      OnPlainText onPlainText_;
+      EncryptError::OnError onError_;
+    };
+
+    // The map key is the name of the key being fetched.
+    typedef std::map<Name, std::vector<PendingDecryption> > PendingMap;
+
     /**
      * Decode encryptedBlob as an EncryptedContent and decrypt using keyBits.
      * @param encryptedBlob The encoded EncryptedContent to decrypt.
@@ -235,6 +318,47 @@ private:
       (const Data& dKeyData, const OnPlainText& onPlainText,
        const EncryptError::OnError& onError);
 
+    /**
+     * Add a PendingDecryption to wait for the key with keyName.
+     * @param pending The PendingMap for the type of key.
+     * @param keyName The name of the key.
+     * @param encryptedContent The EncryptedContent to decrypt with the key.
+     * @param onPlainText On success, this calls onPlainText(decryptedBlob).
+     * @param onError This calls onError(errorCode, message) for an error.
+     * @return True if this is the first PendingDecryption for keyName, so the
+     * caller should fetch the key. False if the key is already being fetched.
+     */
+    static bool
+    addPendingDecryption
+      (PendingMap& pending, const Name& keyName,
+       const ptr_lib::shared_ptr<EncryptedContent>& encryptedContent,
+       const OnPlainText& onPlainText, const EncryptError::OnError& onError);
+
+    /**
+     * Add the fetched key to the keyCache, then decrypt each PendingDecryption
+     * for keyName and remove them.
+     * @param keyCache The KeyCache for the type of key.
+     * @param pending The PendingMap for the type of key.
+     * @param keyName The name of the key.
+     * @param keyBits The decrypted key.
+     */
+    static void
+    onKeyPlainText
+      (KeyCache& keyCache, PendingMap& pending, const Name& keyName,
+       const Blob& keyBits);
+
+    /**
+     * Call onError for each PendingDecryption for keyName and remove them.
+     * @param pending The PendingMap for the type of key.
+     * @param keyName The name of the key which could not be fetched.
+     * @param errorCode The error code for onError.
+     * @param message The message for onError.
+     */
+    static void
+    onKeyError
+      (PendingMap& pending, const Name& keyName,
+       EncryptError::ErrorCode errorCode, const std::string& message);
+
     /**
      * Get the encoded blob of the decryption key with decryptionKeyName from the
      * database.
@@ -287,11 +411,15 @@ private:
     Name consumerName_;
 
     const ptr_lib::shared_ptr<Link> cKeyLink_;
-    // The map key is the C-KEY name. The value is the encoded key Blob.
-    std::map<Name, Blob> cKeyMap_;
+    // The decrypted C-KEYs by C-KEY name.
+    KeyCache cKeyCache_;
+    // The content waiting for a C-KEY which is being fetched.
+    PendingMap pendingCKeys_;
     const ptr_lib::shared_ptr<Link> dKeyLink_;
-    // The map key is the D-KEY name. The value is the encoded key Blob.
-    std::map<Name, Blob> dKeyMap_;
+    // The decrypted D-KEYs by D-KEY name.
+    KeyCache dKeyCache_;
+    // The C-KEYs waiting for a D-KEY which is being fetched.
+    PendingMap pendingDKeys_;
   };
 
   /**
@@ -30,10 +30,13 @@
 class TestGroupManager_CreateDKeyData_Test;
 class TestGroupManager_CreateEKeyData_Test;
 class TestGroupManager_CalculateInterval_Test;
+class TestGroupManager_GetGroupKeyFromKeyPairPool_Test;
 
 namespace ndn {
 
 class KeyChain;
+class ThreadPool;
+class RsaKeyPairPool;
 
 /**
  * A GroupManager manages keys and schedules for group members in a particular
@@ -64,12 +67,15 @@ public:
   /**
    * Create a group key for the interval into which timeSlot falls. This creates
    * a group key if it doesn't exist, and encrypts the key using the public key
-   * of each eligible member.
+   * of each eligible member. If a previous call made the group key for the same
+   * interval and the same members, this returns the cached Data packets (see
+   * setMaxCachedGroupKeys).
    * @param timeSlot The time slot to cover as milliseconds since Jan 1, 1970 UTC.
    * @param result This clears result and sets it to a List of Data packets
    * where the first is the E-KEY data packet with the group's public key and
    * the rest are the D-KEY data packets with the group's private key encrypted
-   * with the public key of each eligible member.
+   * with the public key of each eligible member. The Data packets may be shared
+   * with the cache, so the caller should not modify them.
    * @throws GroupManagerDb::Error for a database error.
    * @throws SecurityException for an error using the security KeyChain.
    */
@@ -78,6 +84,46 @@ public:
     (MillisecondsSince1970 timeSlot, 
      std::vector<ptr_lib::shared_ptr<Data> >& result);
 
+  /**
+   * Set the number of threads that getGroupKey uses to encrypt the group
+   * private key for the members. Each thread makes the D-KEY Data packets for
+   * a contiguous part of the members, so the result has the same order as with
+   * one thread. Then getGroupKey signs them with KeyChain::signBatch, which
+   * uses the threads set by KeyChain::setSigningThreadCount. If the crypto
+   * library can't be used from multiple threads (for example OpenSSL 1.0
+   * without locking callbacks), getGroupKey uses the calling thread.
+   * @param nThreads The number of threads. If 1 (the default), getGroupKey
+   * makes and signs each D-KEY Data packet in the calling thread. If 0, use the
+   * number of hardware threads.
+   */
+  void
+  setThreadCount(size_t nThreads);
+
+  /**
+   * Set the number of intervals for which getGroupKey keeps the E-KEY and
+   * D-KEY Data packets. If the cache is full, remove the interval with the
+   * earliest start time. The cache is cleared when a schedule or member is
+   * changed through this GroupManager, and getGroupKey also checks that the
+   * members for the interval have not changed in the database.
+   * @param maxCachedGroupKeys The maximum number of cached intervals. If 0,
+   * getGroupKey always makes a new group key. The default is
+   * DEFAULT_MAX_CACHED_GROUP_KEYS.
+   */
+  void
+  setMaxCachedGroupKeys(size_t maxCachedGroupKeys);
+
+  /**
+   * Keep poolSize RSA key pairs of keySize bits ready, which a background thread
+   * generates, so that getGroupKey usually does not wait for key generation.
+   * This starts generating the key pairs now.
+   * @param poolSize The number of key pairs to keep ready. If 0 (the default),
+   * getGroupKey generates the key pair when it needs it.
+   */
+  void
+  setKeyPairPoolSize(size_t poolSize);
+
+  static const size_t DEFAULT_MAX_CACHED_GROUP_KEYS = 4;
+
   /**
    * Add a schedule with the given scheduleName.
    * @param scheduleName The name of the schedule. The name cannot be empty.
@@ -89,6 +135,7 @@ public:
   addSchedule(const std::string& scheduleName, const Schedule& schedule)
   {
     database_->addSchedule(scheduleName, schedule);
+    groupKeyCache_.clear();
   }
 
   /**
@@ -101,6 +148,7 @@ public:
   deleteSchedule(const std::string& scheduleName)
   {
     database_->deleteSchedule(scheduleName);
+    groupKeyCache_.clear();
   }
 
   /**
@@ -115,6 +163,7 @@ public:
   updateSchedule(const std::string& scheduleName, const Schedule& schedule)
   {
     database_->updateSchedule(scheduleName, schedule);
+    groupKeyCache_.clear();
   }
 
   /**
@@ -134,6 +183,7 @@ public:
     IdentityCertificate cert(memberCertificate);
     database_->addMember
       (scheduleName, cert.getPublicKeyName(), cert.getPublicKeyInfo().getKeyDer());
+    groupKeyCache_.clear();
   }
 
   /**
@@ -146,6 +196,7 @@ public:
   removeMember(const Name& identity)
   {
     database_->deleteMember(identity);
+    groupKeyCache_.clear();
   }
 
   /**
@@ -159,6 +210,7 @@ public:
   updateMemberSchedule(const Name& identity, const std::string& scheduleName)
   {
     database_->updateMemberSchedule(identity, scheduleName);
+    groupKeyCache_.clear();
   }
 
 private:
@@ -166,6 +218,7 @@ private:
   friend TestGroupManager_CreateDKeyData_Test;
   friend TestGroupManager_CreateEKeyData_Test;
   friend TestGroupManager_CalculateInterval_Test;
+  friend TestGroupManager_GetGroupKeyFromKeyPairPool_Test;
 
   /**
    * Calculate an Interval that covers the timeSlot.
@@ -181,7 +234,40 @@ private:
     (MillisecondsSince1970 timeSlot, std::map<Name, Blob>& memberKeys);
 
   /**
-   * Generate an RSA key pair according to keySize_.
+   * A GroupKeyCacheEntry has the members and the Data packets from getGroupKey
+   * for one interval.
+   */
+  class GroupKeyCacheEntry {
+  public:
+    std::map<Name, Blob> memberKeys_;
+    std::vector<ptr_lib::shared_ptr<Data> > result_;
+  };
+
+  /**
+   * Find the cached Data packets for the interval, and check that they were
+   * made for the same memberKeys.
+   * @param result If found, set result to the cached Data packets.
+   * @return True if found, false if not.
+   */
+  bool
+  findCachedGroupKey
+    (const std::string& startTimeStamp, const std::string& endTimeStamp,
+     const std::map<Name, Blob>& memberKeys,
+     std::vector<ptr_lib::shared_ptr<Data> >& result);
+
+  /**
+   * Add the Data packets for the interval to groupKeyCache_, removing the
+   * earliest interval if the cache is full.
+   */
+  void
+  cacheGroupKey
+    (const std::string& startTimeStamp, const std::string& endTimeStamp,
+     const std::map<Name, Blob>& memberKeys,
+     const std::vector<ptr_lib::shared_ptr<Data> >& result);
+
+  /**
+   * Generate an RSA key pair according to keySize_, or take one from
+   * keyPairPool_ if it is set.
    * @param privateKeyBlob Set privateKeyBlob to the encoding Blob of the
    * private key.
    * @param publicKeyBlob Set publicKeyBlob to the encoding Blob of the
@@ -221,11 +307,62 @@ private:
     (const std::string& startTimeStamp, const std::string& endTimeStamp,
      const Name& keyName, const Blob& privateKeyBlob, const Blob& certificateKey);
 
+  /**
+   * Create an unsigned D-KEY Data packet as in createDKeyData. This only reads
+   * the fields of this GroupManager, so the threads can call it at the same
+   * time.
+   */
+  ptr_lib::shared_ptr<Data>
+  encryptDKeyData
+    (const std::string& startTimeStamp, const std::string& endTimeStamp,
+     const Name& keyName, const Blob& privateKeyBlob,
+     const Blob& certificateKey) const;
+
+  /**
+   * Create the D-KEY Data packets for all the members on the thread pool, then
+   * sign them with KeyChain::signBatch and append them to result in the order
+   * of memberKeys.
+   * @throws SecurityException for an error encrypting or signing.
+   */
+  void
+  createDKeyDataList
+    (const std::string& startTimeStamp, const std::string& endTimeStamp,
+     const Blob& privateKeyBlob, const std::map<Name, Blob>& memberKeys,
+     std::vector<ptr_lib::shared_ptr<Data> >& result);
+
+  /**
+   * This is the task for one thread in createDKeyDataList. Create the
+   * unsigned D-KEY Data packets for nMembers members, setting dataList[i] for
+   * members[i].
+   * @param error If there is an error, set error to the message.
+   */
+  void
+  encryptDKeyDataPart
+    (const std::string* startTimeStamp, const std::string* endTimeStamp,
+     const Blob* privateKeyBlob,
+     const std::map<Name, Blob>::const_iterator* members, size_t nMembers,
+     ptr_lib::shared_ptr<Data>* dataList, std::string* error) const;
+
+  /**
+   * Get the thread pool for createDKeyDataList, creating it if needed.
+   * @return The ThreadPool with threadCount_ threads.
+   */
+  ThreadPool&
+  getThreadPool();
+
   Name namespace_;
   ptr_lib::shared_ptr<GroupManagerDb> database_;
   uint32_t keySize_;
   int freshnessHours_;
   KeyChain* keyChain_;
+  size_t threadCount_;
+  ptr_lib::shared_ptr<ThreadPool> threadPool_;
+  size_t maxCachedGroupKeys_;
+  // The key is the pair of start and end time stamps of the interval, so that
+  // the earliest interval is first.
+  std::map<std::pair<std::string, std::string>, GroupKeyCacheEntry>
+    groupKeyCache_;
+  ptr_lib::shared_ptr<RsaKeyPairPool> keyPairPool_;
   static const uint64_t MILLISECONDS_IN_HOUR = 3600 * 1000;
 };
 
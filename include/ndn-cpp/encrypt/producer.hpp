@@ -25,6 +25,7 @@
 #define NDN_PRODUCER_HPP
 
 #include <map>
+#include <istream>
 #include "../face.hpp"
 #include "../security/key-chain.hpp"
 #include "encrypt-error.hpp"
@@ -32,6 +33,8 @@
 
 namespace ndn {
 
+class ThreadPool;
+
 /**
  * A Producer manages content keys used to encrypt a data packet in the
  * group-based encryption protocol.
@@ -42,6 +45,9 @@ public:
   typedef func_lib::function<
     void(const std::vector<ptr_lib::shared_ptr<Data> >& keys)> OnEncryptedKeys;
 
+  typedef func_lib::function<
+    void(const std::vector<ptr_lib::shared_ptr<Data> >& segments)> OnSegments;
+
   /**
    * Create a Producer to use the given ProducerDb, Face and other values.
    *
@@ -130,6 +136,93 @@ public:
     impl_->produce(data, timeSlot, content, onError);
   }
 
+  /**
+   * Read the content from the stream, split it into segments of segmentSize
+   * bytes and encrypt each segment with the content key that covers timeSlot,
+   * each with its own initial vector. The name of each segment Data packet is
+   *   /{prefix}/SAMPLE/{dataType}/[timestamp]/[segment]/FOR/[content-key-name]
+   * so that a Consumer can fetch each segment with the name up to and
+   * including the segment component. The last segment has the FinalBlockId.
+   * This sets up the content key once for all segments, and works on a fixed
+   * number of segments at a time so that the memory use does not depend on the
+   * content size. Each batch is encrypted with the threads set by
+   * setThreadCount and signed with KeyChain::signBatch.
+   * @param timeSlot The time slot as milliseconds since Jan 1, 1970 UTC.
+   * @param content The stream of content to encrypt. This reads until the end
+   * of the stream. If the stream is empty, this makes one empty segment.
+   * @param segmentSize The maximum number of content bytes in each segment.
+   * @param onSegments For each batch of segments, this calls
+   * onSegments(segments) where segments is the list of signed segment Data
+   * packets in order. The list is not kept after onSegments returns.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions.
+   * @param onError (optional) This calls onError(errorCode, message) for an
+   * encryption error or an error reading the stream, and does not make more
+   * segments. If omitted, use a default callback which does nothing.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions.
+   * @throws SecurityException for an error using the security KeyChain.
+   * @throws runtime_error if segmentSize is zero or so large that a batch of
+   * segments does not fit in memory.
+   */
+  void
+  produceSegments
+    (MillisecondsSince1970 timeSlot, std::istream& content, size_t segmentSize,
+     const OnSegments& onSegments,
+     const EncryptError::OnError& onError = defaultOnError)
+  {
+    impl_->produceSegments
+      (timeSlot, content, segmentSize, onSegments, onError);
+  }
+
+  /**
+   * Split the content into segments of segmentSize bytes and encrypt each
+   * segment with the content key that covers timeSlot. This is the same as
+   * produceSegments with a stream, except that this reads from the content
+   * Blob without copying it.
+   * @param timeSlot The time slot as milliseconds since Jan 1, 1970 UTC.
+   * @param content The content to encrypt. If it is empty, this makes one
+   * empty segment.
+   * @param segmentSize The maximum number of content bytes in each segment.
+   * @param onSegments For each batch of segments, this calls
+   * onSegments(segments) where segments is the list of signed segment Data
+   * packets in order.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions.
+   * @param onError (optional) This calls onError(errorCode, message) for an
+   * encryption error, and does not make more segments. If omitted, use a
+   * default callback which does nothing.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions.
+   * @throws SecurityException for an error using the security KeyChain.
+   * @throws runtime_error if segmentSize is zero or so large that a batch of
+   * segments does not fit in memory.
+   */
+  void
+  produceSegments
+    (MillisecondsSince1970 timeSlot, const Blob& content, size_t segmentSize,
+     const OnSegments& onSegments,
+     const EncryptError::OnError& onError = defaultOnError)
+  {
+    impl_->produceSegments
+      (timeSlot, content, segmentSize, onSegments, onError);
+  }
+
+  /**
+   * Set the number of threads that produceSegments uses to encrypt segments.
+   * Each thread encrypts a contiguous part of each batch of segments, so the
+   * segments have the same order as with one thread.
+   * @param nThreads The number of threads. If 1 (the default), produceSegments
+   * encrypts each segment in the calling thread. If 0, use the number of
+   * hardware threads.
+   */
+  void
+  setThreadCount(size_t nThreads) { impl_->setThreadCount(nThreads); }
+
   /**
    * The default OnError callback which does nothing.
    */
@@ -162,6 +255,20 @@ private:
       (Data& data, MillisecondsSince1970 timeSlot, const Blob& content,
        const EncryptError::OnError& onError);
 
+    void
+    produceSegments
+      (MillisecondsSince1970 timeSlot, std::istream& content,
+       size_t segmentSize, const OnSegments& onSegments,
+       const EncryptError::OnError& onError);
+
+    void
+    produceSegments
+      (MillisecondsSince1970 timeSlot, const Blob& content, size_t segmentSize,
+       const OnSegments& onSegments, const EncryptError::OnError& onError);
+
+    void
+    setThreadCount(size_t nThreads);
+
   private:
     class KeyInfo {
     public:
@@ -280,6 +387,48 @@ private:
        const OnEncryptedKeys& onEncryptedKeys,
        const EncryptError::OnError& onError);
 
+    /**
+     * Check if there is a content key for the hour covering timeSlot, first in
+     * contentKeyCache_ and then in the database_. If the database_ has it, add
+     * it to contentKeyCache_.
+     * @param timeSlot The time slot as milliseconds since Jan 1, 1970 UTC.
+     * @return True if there is a content key for timeSlot.
+     * @throws ProducerDb::Error for a database error.
+     */
+    bool
+    hasContentKey(MillisecondsSince1970 timeSlot);
+
+    /**
+     * Get the content key for the hour covering timeSlot from
+     * contentKeyCache_, or from the database_ and add it to contentKeyCache_.
+     * @param timeSlot The time slot as milliseconds since Jan 1, 1970 UTC.
+     * @return A Blob with the encoded key.
+     * @throws ProducerDb::Error if there is no key covering timeSlot or other
+     * database error.
+     */
+    Blob
+    getContentKey(MillisecondsSince1970 timeSlot);
+
+    /**
+     * Add the content key for the hour covering timeSlot to the database_ and
+     * to contentKeyCache_.
+     * @param timeSlot The time slot as milliseconds since Jan 1, 1970 UTC.
+     * @param key The encoded key.
+     * @throws ProducerDb::Error if a key for the same hour already exists in
+     * the database, or other database error.
+     */
+    void
+    addContentKey(MillisecondsSince1970 timeSlot, const Blob& key);
+
+    /**
+     * Add the key to contentKeyCache_, removing the earliest hour if the cache
+     * has more than MAX_CACHED_CONTENT_KEYS.
+     * @param hourSlot The hour from getRoundedTimeSlot.
+     * @param key The encoded key.
+     */
+    void
+    cacheContentKey(MillisecondsSince1970 hourSlot, const Blob& key);
+
     /**
      * Get the content key from the database_ and encrypt it for the timeSlot
      * using encryptionKey.
@@ -298,6 +447,75 @@ private:
        MillisecondsSince1970 timeSlot, const OnEncryptedKeys& onEncryptedKeys,
        const EncryptError::OnError& onError);
 
+    /**
+     * Check the segmentSize for produceSegments.
+     * @param segmentSize The maximum number of content bytes in each segment.
+     * @throws runtime_error if segmentSize is zero or if SEGMENTS_PER_BATCH
+     * segments would overflow a size_t.
+     */
+    static void
+    checkSegmentSize(size_t segmentSize);
+
+    /**
+     * SegmentPart has the values for one encryptSegmentPart task.
+     */
+    class SegmentPart {
+    public:
+      const Name* dataPrefix;
+      const Name* contentKeyName;
+      const Blob* contentKey;
+      const uint8_t* content;
+      size_t contentLength;
+      size_t segmentSize;
+      uint64_t firstSegment;
+      size_t nSegments;
+      bool hasFinalSegment;
+      const uint8_t* initialVectors;
+      ptr_lib::shared_ptr<Data>* dataList;
+      std::string error;
+    };
+
+    /**
+     * Encrypt one batch of segments for produceSegments, sign them and call
+     * onSegments.
+     * @param dataPrefix The segment name prefix up to the time stamp.
+     * @param contentKeyName The content key name.
+     * @param contentKey The content key value.
+     * @param content A pointer to the content of the batch.
+     * @param contentLength The length of content. If 0, make one empty segment.
+     * @param segmentSize The maximum number of content bytes in each segment.
+     * @param firstSegment The segment number of the first segment in the batch.
+     * @param isFinal True if the last segment in the batch is the final
+     * segment, so it gets the FinalBlockId.
+     * @param onSegments This calls onSegments(segments).
+     * @param onError This calls onError(errorCode, message) for an error.
+     * @return True for success, false if this called onError.
+     */
+    bool
+    produceSegmentBatch
+      (const Name& dataPrefix, const Name& contentKeyName,
+       const Blob& contentKey, const uint8_t* content, size_t contentLength,
+       size_t segmentSize, uint64_t firstSegment, bool isFinal,
+       const OnSegments& onSegments, const EncryptError::OnError& onError);
+
+    /**
+     * This is the task for one thread in produceSegmentBatch. Create the
+     * unsigned segment Data packets for part->nSegments segments, setting
+     * part->dataList[i] for each. This uses its own AesCbcEncryptorLite so
+     * that the tasks don't share a cipher context.
+     * @param part The SegmentPart. If there is an error, set part->error to
+     * the message.
+     */
+    static void
+    encryptSegmentPart(SegmentPart* part);
+
+    /**
+     * Get the thread pool for produceSegmentBatch, creating it if needed.
+     * @return The ThreadPool with threadCount_ threads.
+     */
+    ThreadPool&
+    getThreadPool();
+
     // TODO: Move this to be the main representation inside the Exclude object.
     class ExcludeEntry {
     public:
@@ -373,12 +591,22 @@ private:
     std::map<Name, ptr_lib::shared_ptr<KeyInfo> > eKeyInfo_;
     std::map<MillisecondsSince1970, ptr_lib::shared_ptr<KeyRequest> > keyRequests_;
     ptr_lib::shared_ptr<ProducerDb> database_;
+    // The content keys which are in the database_, so that produce does not
+    // query the database_ for each Data packet. The key is the hour from
+    // getRoundedTimeSlot. This assumes that only this Producer changes the
+    // content keys in the database_.
+    std::map<MillisecondsSince1970, Blob> contentKeyCache_;
     int maxRepeatAttempts_;
+    size_t threadCount_;
+    ptr_lib::shared_ptr<ThreadPool> threadPool_;
 
     Link keyRetrievalLink_;
 
     static const int START_TIME_STAMP_INDEX = -2;
     static const int END_TIME_STAMP_INDEX = -1;
+    static const size_t MAX_CACHED_CONTENT_KEYS = 24;
+    // The number of segments that produceSegments encrypts at a time.
+    static const size_t SEGMENTS_PER_BATCH = 64;
   };
 
   /**
@@ -35,6 +35,7 @@ namespace ndn {
 
 class LpPacket;
 class Data;
+class LazyInterestSelectors;
 
 /**
  * An Interest holds a Name and other fields for an interest.
@@ -63,25 +64,7 @@ public:
     construct();
   }
 
-  Interest(const Interest& interest)
-  : name_(interest.name_), minSuffixComponents_(interest.minSuffixComponents_),
-    maxSuffixComponents_(interest.maxSuffixComponents_),
-    keyLocator_(interest.keyLocator_), exclude_(interest.exclude_),
-    childSelector_(interest.childSelector_),
-    mustBeFresh_(interest.mustBeFresh_),
-    interestLifetimeMilliseconds_(interest.interestLifetimeMilliseconds_),
-    nonce_(interest.nonce_), getNonceChangeCount_(0),
-    linkWireEncoding_(interest.linkWireEncoding_),
-    linkWireEncodingFormat_(interest.linkWireEncodingFormat_),
-    selectedDelegationIndex_(interest.selectedDelegationIndex_),
-    changeCount_(0)
-  {
-    if (interest.link_.get())
-      link_.set(ptr_lib::make_shared<Link>(*interest.link_.get()));
-
-    setDefaultWireEncoding
-      (interest.getDefaultWireEncoding(), interest.defaultWireEncodingFormat_);
-  }
+  Interest(const Interest& interest);
 
   /**
    * Create a new Interest with an empty name and "none" for all values.
@@ -147,6 +130,30 @@ public:
     wireDecode(&input[0], input.size(), wireFormat);
   }
 
+  /**
+   * Decode the input like wireDecode, except that the Selectors are decoded
+   * when one of them is first accessed, so that a forwarder or application
+   * which only uses the name and nonce doesn't decode the Selectors. (The
+   * Selectors hold the KeyLocator and Exclude, which are the most costly to
+   * decode after the name.) If wireFormat is the default wire format, also set
+   * the defaultWireEncoding to another pointer to the input Blob, as in
+   * wireDecode. Since the Selectors are decoded later, an error in their value
+   * is thrown by the method which first accesses them, such as getExclude().
+   * A const getter decodes the pending Selectors while holding a lock which is
+   * shared with the copies of this Interest, so that multiple threads can call
+   * the const getters without racing to decode the Selectors.
+   * @param input The input byte array to be decoded as an immutable Blob. This
+   * keeps a pointer to the Blob until the Selectors are decoded.
+   * @param wireFormat (optional) A WireFormat object used to decode the input.
+   * If omitted, use WireFormat::getDefaultWireFormat(). If this is not an
+   * NDN-TLV wire format, then this decodes all the fields now by calling
+   * wireDecode.
+   */
+  void
+  wireDecodeLazy
+    (const Blob& input,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat());
+
   /**
    * Encode the name according to the "NDN URI Scheme".  If there are interest
    * selectors, append "?" and add the selectors as a query string.  For example
@@ -187,32 +194,64 @@ public:
   getName() const { return name_.get(); }
 
   int
-  getMinSuffixComponents() const { return minSuffixComponents_; }
+  getMinSuffixComponents() const
+  {
+    decodePendingSelectors();
+    return minSuffixComponents_;
+  }
 
   int
-  getMaxSuffixComponents() const { return maxSuffixComponents_; }
+  getMaxSuffixComponents() const
+  {
+    decodePendingSelectors();
+    return maxSuffixComponents_;
+  }
 
   const KeyLocator&
-  getKeyLocator() const { return keyLocator_.get(); }
+  getKeyLocator() const
+  {
+    decodePendingSelectors();
+    return keyLocator_.get();
+  }
 
   KeyLocator&
-  getKeyLocator() { return keyLocator_.get(); }
+  getKeyLocator()
+  {
+    decodePendingSelectors();
+    return keyLocator_.get();
+  }
 
   Exclude&
-  getExclude() { return exclude_.get(); }
+  getExclude()
+  {
+    decodePendingSelectors();
+    return exclude_.get();
+  }
 
   const Exclude&
-  getExclude() const { return exclude_.get(); }
+  getExclude() const
+  {
+    decodePendingSelectors();
+    return exclude_.get();
+  }
 
   int
-  getChildSelector() const { return childSelector_; }
+  getChildSelector() const
+  {
+    decodePendingSelectors();
+    return childSelector_;
+  }
 
   /**
    * Return true if the content must be fresh. The default is true.
    * @return true if must be fresh, otherwise false.
    */
   bool
-  getMustBeFresh() const { return mustBeFresh_; }
+  getMustBeFresh() const
+  {
+    decodePendingSelectors();
+    return mustBeFresh_;
+  }
 
   Milliseconds
   getInterestLifetimeMilliseconds() const { return interestLifetimeMilliseconds_; }
@@ -309,6 +348,8 @@ public:
   Interest&
   setMinSuffixComponents(int minSuffixComponents)
   {
+    // Decode the other Selectors so that they don't overwrite this later.
+    decodePendingSelectors();
     minSuffixComponents_ = minSuffixComponents;
     ++changeCount_;
     return *this;
@@ -323,6 +364,7 @@ public:
   Interest&
   setMaxSuffixComponents(int maxSuffixComponents)
   {
+    decodePendingSelectors();
     maxSuffixComponents_ = maxSuffixComponents;
     ++changeCount_;
     return *this;
@@ -336,6 +378,7 @@ public:
   Interest&
   setChildSelector(int childSelector)
   {
+    decodePendingSelectors();
     childSelector_ = childSelector;
     ++changeCount_;
     return *this;
@@ -350,6 +393,7 @@ public:
   Interest&
   setMustBeFresh(bool mustBeFresh)
   {
+    decodePendingSelectors();
     mustBeFresh_ = mustBeFresh;
     ++changeCount_;
     return *this;
@@ -393,6 +437,7 @@ public:
   Interest&
   setKeyLocator(const KeyLocator& keyLocator)
   {
+    decodePendingSelectors();
     keyLocator_ = keyLocator;
     ++changeCount_;
     return *this;
@@ -409,6 +454,7 @@ public:
   Interest&
   setExclude(const Exclude& exclude)
   {
+    decodePendingSelectors();
     exclude_ = exclude;
     ++changeCount_;
     return *this;
@@ -560,6 +606,59 @@ public:
   }
 
 private:
+  /**
+   * If the Selectors are still pending from wireDecodeLazy, decode them. This
+   * only reads lazySelectors_ (which a const method never changes) before
+   * decodeLazySelectors locks, so that multiple threads can call the const
+   * getters.
+   */
+  void
+  decodePendingSelectors() const
+  {
+    if (lazySelectors_)
+      // This method can be called on a const object, but we want to be able to
+      // update the Selectors.
+      const_cast<Interest*>(this)->decodeLazySelectors();
+  }
+
+  /**
+   * If the Selectors are still pending from wireDecodeLazy, decode them. The
+   * caller of a non-const method has exclusive access to this object, so also
+   * release lazySelectors_.
+   */
+  void
+  decodePendingSelectors()
+  {
+    if (lazySelectors_) {
+      decodeLazySelectors();
+      lazySelectors_.reset();
+    }
+  }
+
+  /**
+   * Lock the mutex in lazySelectors_ and, if the Selectors are still pending,
+   * decode them and clear pendingSelectors_. Decoding the Selectors does not
+   * change the change count, since they have the values from the wire
+   * encoding. This does not release lazySelectors_ since another thread may be
+   * reading it.
+   */
+  void
+  decodeLazySelectors();
+
+  /**
+   * Update the local change counts of the child objects and set changeCount_
+   * so that changes since getChangeCount() returned changeCount are not
+   * counted.
+   * @param changeCount The value of getChangeCount() to restore.
+   */
+  void
+  restoreChangeCount(uint64_t changeCount)
+  {
+    keyLocator_.checkChanged();
+    exclude_.checkChanged();
+    changeCount_ = changeCount;
+  }
+
   void
   construct()
   {
@@ -570,6 +669,7 @@ private:
     interestLifetimeMilliseconds_ = -1.0;
     linkWireEncodingFormat_ = 0;
     selectedDelegationIndex_ = -1;
+    pendingSelectors_ = false;
   }
 
   void
@@ -602,6 +702,8 @@ private:
   WireFormat *defaultWireEncodingFormat_;
   uint64_t getDefaultWireEncodingChangeCount_;
   ptr_lib::shared_ptr<LpPacket> lpPacket_;
+  ptr_lib::shared_ptr<const LazyInterestSelectors> lazySelectors_;
+  bool pendingSelectors_; /**< True if lazySelectors_ is not decoded yet. */
   uint64_t changeCount_;
 };
 
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_AES_CBC_ENCRYPTOR_LITE_HPP
+#define NDN_AES_CBC_ENCRYPTOR_LITE_HPP
+
+#include "../../util/blob-lite.hpp"
+#include "../../../c/errors.h"
+#include "../../../c/encrypt/algo/aes-cbc-encryptor-types.h"
+
+namespace ndn {
+
+/**
+ * An AesCbcEncryptorLite holds an AES 128 key schedule which is set up once by
+ * setKey so that encrypt can use it for many buffers in CBC mode, each with
+ * its own initial vector. An AesCbcEncryptorLite is not thread safe, so each
+ * thread should use its own.
+ * @note This class is an experimental feature. The API may change.
+ */
+class AesCbcEncryptorLite : private ndn_AesCbcEncryptor {
+public:
+  /**
+   * Create an AesCbcEncryptorLite with no key. You must call setKey before
+   * encrypt.
+   */
+  AesCbcEncryptorLite();
+
+  ~AesCbcEncryptorLite();
+
+  /**
+   * Set the AES 128 key and set up its key schedule.
+   * @param key A pointer to the key byte array.
+   * @param keyLength The length of key. It is an error if this is not
+   * ndn_AES_128_BLOCK_SIZE.
+   * @return 0 for success, else NDN_ERROR_Incorrect_key_size for incorrect
+   * keyLength or NDN_ERROR_Error_in_encrypt_operation if the cipher context
+   * can't be created.
+   */
+  ndn_Error
+  setKey(const uint8_t* key, size_t keyLength);
+
+  /**
+   * Set the AES 128 key and set up its key schedule.
+   * @param key The key byte array. It is an error if its size is not
+   * ndn_AES_128_BLOCK_SIZE.
+   * @return 0 for success, else NDN_ERROR_Incorrect_key_size for incorrect
+   * key size or NDN_ERROR_Error_in_encrypt_operation if the cipher context
+   * can't be created.
+   */
+  ndn_Error
+  setKey(const BlobLite& key)
+  {
+    return setKey(key.buf(), key.size());
+  }
+
+  /**
+   * Encrypt plainData using AES 128 in CBC mode with the key from setKey and
+   * the given initial vector. The result is the same as
+   * AesAlgorithmLite::encrypt128Cbc with the same key.
+   * @param initialVector A pointer to the initial vector byte array.
+   * @param initialVectorLength The length of initialVector. It is an error if
+   * this is not ndn_AES_128_BLOCK_SIZE.
+   * @param plainData A pointer to the input byte array to encrypt.
+   * @param plainDataLength The length of plainData.
+   * @param encryptedData A pointer to the encrypted output buffer. The caller
+   * must provide a large enough buffer, which should be at least
+   * plainDataLength + ndn_AES_128_BLOCK_SIZE bytes.
+   * @param encryptedDataLength This sets encryptedDataLength to the number of
+   * bytes placed in the encryptedData buffer.
+   * @return 0 for success, else NDN_ERROR_Incorrect_initial_vector_size for
+   * incorrect initialVectorLength or NDN_ERROR_Error_in_encrypt_operation if
+   * the key is not set.
+   */
+  ndn_Error
+  encrypt
+    (const uint8_t* initialVector, size_t initialVectorLength,
+     const uint8_t* plainData, size_t plainDataLength, uint8_t* encryptedData,
+     size_t& encryptedDataLength);
+
+  /**
+   * Encrypt plainData using AES 128 in CBC mode with the key from setKey and
+   * the given initial vector. The result is the same as
+   * AesAlgorithmLite::encrypt128Cbc with the same key.
+   * @param initialVector The initial vector byte array. It is an error if its
+   * size is not ndn_AES_128_BLOCK_SIZE.
+   * @param plainData The input byte array to encrypt.
+   * @param encryptedData A pointer to the encrypted output buffer. The caller
+   * must provide a large enough buffer, which should be at least
+   * plainData.size() + ndn_AES_128_BLOCK_SIZE bytes.
+   * @param encryptedDataLength This sets encryptedDataLength to the number of
+   * bytes placed in the encryptedData buffer.
+   * @return 0 for success, else NDN_ERROR_Incorrect_initial_vector_size for
+   * incorrect initialVector size or NDN_ERROR_Error_in_encrypt_operation if
+   * the key is not set.
+   */
+  ndn_Error
+  encrypt
+    (const BlobLite& initialVector, const BlobLite& plainData,
+     uint8_t* encryptedData, size_t& encryptedDataLength)
+  {
+    return encrypt
+      (initialVector.buf(), initialVector.size(), plainData.buf(),
+       plainData.size(), encryptedData, encryptedDataLength);
+  }
+
+private:
+  // Don't allow copying since we don't reference count the allocated value.
+  AesCbcEncryptorLite(const AesCbcEncryptorLite& other);
+  AesCbcEncryptorLite& operator=(const AesCbcEncryptorLite& other);
+};
+
+}
+
+#endif
@@ -72,7 +72,7 @@ public:
 
   /**
    * Set the the private key from the given curveId, using the value to create a
-   * BIGNUM, allocating memory as needed.
+   * BIGNUM, allocating memory as needed. This also computes the public key.
    * @param curveId The OpenSSL curve ID such as NID_secp384r1.
    * @param value A pointer to the value array for the BIGNUM.
    * @param valueLength The length of value.
@@ -27,6 +27,7 @@
 #include "../../ndn-cpp-config.h"
 #ifdef NDN_CPP_HAVE_SQLITE3
 
+#include <map>
 #include <sqlite3.h>
 #include "../../common.hpp"
 #include "identity-storage.hpp"
@@ -36,7 +37,10 @@ namespace ndn
 
 /**
  * BasicIdentityStorage extends IdentityStorage to implement a basic storage of identity, public keys and certificates
- * using SQLite.
+ * using SQLite. The database uses write-ahead logging, each SQL statement is
+ * prepared once and reused, and the default identity, key and certificate names
+ * and the public keys are cached in memory until they are changed through this
+ * object or another connection changes the database.
  */
 class BasicIdentityStorage : public IdentityStorage {
 public:
@@ -269,7 +273,39 @@ private:
   void
   updateKeyStatus(const Name& keyName, bool isActive);
 
+  /**
+   * Get the prepared statement for the SQL, preparing it on the first call.
+   * The statement is reset and its bindings are cleared. The caller should
+   * call sqlite3_reset when finished so that a read transaction is not held.
+   * @param sql The SQL statement, which is also the key for the cache.
+   * @return The statement, or 0 if it can't be prepared.
+   */
+  sqlite3_stmt*
+  getStatement(const char* sql);
+
+  /**
+   * If another connection changed the database since the last check, clear
+   * the cached lookups.
+   */
+  void
+  checkDataVersion();
+
+  /**
+   * Clear the cached lookups. Each method which changes a default or deletes
+   * from the database calls this.
+   */
+  void
+  clearCache();
+
   sqlite3 *database_;
+  std::map<std::string, sqlite3_stmt*> statements_;
+  // The following cache the results of lookups.
+  int dataVersion_;
+  bool haveDefaultIdentity_;
+  Name defaultIdentity_;
+  std::map<Name, Name> defaultKeyNames_;
+  std::map<Name, Name> defaultCertificateNames_;
+  std::map<Name, Blob> keys_;
 };
 
 }
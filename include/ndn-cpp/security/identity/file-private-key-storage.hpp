@@ -24,6 +24,7 @@
 #define NDN_FILE_PRIVATE_KEY_STORAGE_HPP
 
 #include <string>
+#include <map>
 #include "private-key-storage.hpp"
 
 namespace ndn {
@@ -120,7 +121,46 @@ public:
   virtual bool
   doesKeyExist(const Name& keyName, KeyClass keyClass);
 
+  /**
+   * Remove all decoded private keys which sign() keeps in memory, freeing and
+   * clearing their key values. The next call to sign() for each key reads and
+   * decodes its file again.
+   */
+  void
+  clearPrivateKeyCache();
+
+  /**
+   * The maximum number of decoded private keys which sign() keeps in memory.
+   */
+  static const size_t MAX_CACHED_PRIVATE_KEYS = 64;
+
 private:
+  /**
+   * A CachedPrivateKey holds a decoded RSA or EC private key and the
+   * modification time and size of the .pri file it was read from. It is
+   * defined in file-private-key-storage.cpp.
+   */
+  class CachedPrivateKey;
+
+  /**
+   * A PrivateKeyCache holds the CachedPrivateKey objects in least recently used
+   * order, and the mutex which guards them. It is defined in
+   * file-private-key-storage.cpp.
+   */
+  class PrivateKeyCache;
+
+  /**
+   * Get the decoded private key for keyUri from privateKeyCache_. If it is not
+   * in the cache or the .pri file has changed since it was cached, read and
+   * decode the file and update the cache.
+   * @param keyUri The URI of the key name.
+   * @return The decoded private key.
+   * @throws SecurityException if the private key file doesn't exist or can't be
+   * decoded.
+   */
+  ptr_lib::shared_ptr<CachedPrivateKey>
+  getPrivateKey(const std::string& keyUri);
+
   std::string
   nameTransform(const std::string& keyName, const std::string& extension);
 
@@ -134,6 +174,7 @@ private:
   maintainMapping(const std::string& keyName);
 
   std::string keyStorePath_;
+  ptr_lib::shared_ptr<PrivateKeyCache> privateKeyCache_;
 };
 
 }
@@ -23,6 +23,7 @@
 #ifndef NDN_IDENTITY_MANAGER_HPP
 #define NDN_IDENTITY_MANAGER_HPP
 
+#include <map>
 #include "../certificate/identity-certificate.hpp"
 #include "../../interest.hpp"
 #include "identity-storage.hpp"
@@ -32,6 +33,22 @@
 namespace ndn {
 
 class ConfigFile;
+class ThreadPool;
+
+/**
+ * An OnDataListSigned function object is called by
+ * IdentityManager::signByCertificateAsync when all the Data packets are signed.
+ */
+typedef func_lib::function<void
+  (const std::vector<ptr_lib::shared_ptr<Data> >& dataList)> OnDataListSigned;
+
+/**
+ * An OnDataListSignFailed function object is called by
+ * IdentityManager::signByCertificateAsync if signing a Data packet fails.
+ */
+typedef func_lib::function<void
+  (const std::vector<ptr_lib::shared_ptr<Data> >& dataList,
+   const std::string& reason)> OnDataListSignFailed;
 
 /**
  * An IdentityManager is the interface of operations related to identity, keys, and certificates.
@@ -441,6 +458,71 @@ public:
   void
   signByCertificate(Data& data, const Name& certificateName, WireFormat& wireFormat = *WireFormat::getDefaultWireFormat());
 
+  /**
+   * Sign the Data packets based on the certificate name, spreading the
+   * encoding and signing across the signing thread pool (see
+   * setSigningThreadCount), and wait until all are signed. The result for each
+   * Data packet is the same as signByCertificate(data, certificateName). The
+   * PrivateKeyStorage sign method must be safe to call from multiple threads,
+   * which is true for MemoryPrivateKeyStorage and FilePrivateKeyStorage.
+   * @param dataList The Data objects to sign. This updates the signature and
+   * wireEncoding of each.
+   * @param certificateName The Name identifying the certificate which
+   * identifies the signing key.
+   * @param wireFormat The WireFormat for calling encodeData, or
+   * WireFormat::getDefaultWireFormat() if omitted.
+   * @throws SecurityException if signing fails for a Data packet. The other
+   * Data packets are still signed.
+   */
+  void
+  signByCertificate
+    (const std::vector<Data*>& dataList, const Name& certificateName,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat());
+
+  /**
+   * Queue the Data packets to be signed on the signing thread pool as in
+   * signByCertificate(dataList, certificateName) and return immediately.
+   * @param dataList The Data objects to sign. This keeps a copy of the
+   * shared_ptr for each until they are signed, and the caller should not
+   * modify them until then.
+   * @param certificateName The Name identifying the certificate which
+   * identifies the signing key.
+   * @param onSigned When all the Data packets are signed, this calls
+   * onSigned(dataList) with dataList in the same order. This is called on a
+   * thread of the signing thread pool, or before returning if there is nothing
+   * for the pool to do.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions. The callback must not destroy this IdentityManager.
+   * @param onFailed If signing a Data packet fails, this calls
+   * onFailed(dataList, reason) on a thread of the signing thread pool instead
+   * of onSigned. If the signing key for certificateName can't be found, or
+   * signing the first packet fails, this calls onFailed before returning.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions. The callback must not destroy this IdentityManager.
+   * @param wireFormat The WireFormat for calling encodeData, or
+   * WireFormat::getDefaultWireFormat() if omitted. This must remain valid
+   * until the callback is called.
+   */
+  void
+  signByCertificateAsync
+    (const std::vector<ptr_lib::shared_ptr<Data> >& dataList,
+     const Name& certificateName, const OnDataListSigned& onSigned,
+     const OnDataListSignFailed& onFailed,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat());
+
+  /**
+   * Set the number of threads for signing a list of Data packets. This takes
+   * effect for the next call to signByCertificate(dataList, ...) or
+   * signByCertificateAsync. This should not be called while an asynchronous
+   * signing is in progress.
+   * @param nThreads The number of threads. If 0 (the default), use the number
+   * of hardware threads.
+   */
+  void
+  setSigningThreadCount(size_t nThreads);
+
   /**
    * Append a SignatureInfo to the Interest name, sign the name components and
    * append a final name component with the signature bits.
@@ -514,6 +596,57 @@ private:
   makeSignatureByCertificate
     (const Name& certificateName, DigestAlgorithm& digestAlgorithm);
 
+  /**
+   * Sign the signed portion with the private key for keyName. This is the
+   * Data::ComputeSignature callback for signByCertificate.
+   */
+  Blob
+  signSignedPortion
+    (const uint8_t* signedPortion, size_t signedPortionLength,
+     const Name& keyName, DigestAlgorithm digestAlgorithm);
+
+  /**
+   * Get the signing thread pool, creating it if needed.
+   * @return The ThreadPool with signingThreadCount_ threads.
+   */
+  ThreadPool&
+  getSigningThreadPool();
+
+  /**
+   * Prepare to sign the Data packets in dataList: set the signature of each to
+   * the signature for certificateName and make tasks which each sign one part
+   * of the list on the signing thread pool. If the signature length for the key
+   * is not known yet, sign the first Data packet now in this thread.
+   * @param dataList The Data packets to sign.
+   * @param certificateName The certificate name.
+   * @param wireFormat The WireFormat for calling encodeData.
+   * @param tasks Append the tasks to tasks.
+   * @param errors This resizes errors to the number of tasks. If signing fails,
+   * a task sets its entry to the error message.
+   */
+  void
+  makeSignDataListTasks
+    (const std::vector<Data*>& dataList, const Name& certificateName,
+     WireFormat& wireFormat, std::vector<func_lib::function<void()> >& tasks,
+     std::vector<std::string>& errors);
+
+  /**
+   * Sign the Data packets with the private key for keyName. This is a signing
+   * thread pool task for prepareSignDataList.
+   */
+  void
+  signDataListPart
+    (Data* const* dataList, size_t nData, const Name& keyName,
+     DigestAlgorithm digestAlgorithm, size_t reservedLength,
+     WireFormat* wireFormat, std::string* error);
+
+  /**
+   * Return the SHA-256 digest of the signed portion. This is the
+   * Data::ComputeSignature callback for signWithSha256.
+   */
+  static Blob
+  digestSignedPortion(const uint8_t* signedPortion, size_t signedPortionLength);
+
   /**
    * Get the IdentityStorage from the pib value in the configuration file if
    * supplied. Otherwise, get the default for this platform.
@@ -547,6 +680,13 @@ private:
 
   ptr_lib::shared_ptr<IdentityStorage> identityStorage_;
   ptr_lib::shared_ptr<PrivateKeyStorage> privateKeyStorage_;
+  // The key is the key name URI. The value is the length of the signature bits
+  // to reserve when signing with the key.
+  std::map<std::string, size_t> signatureLengths_;
+  size_t signingThreadCount_;
+  // This is created when first needed. It is declared last so that it is
+  // destroyed first, after its threads finish the queued tasks.
+  ptr_lib::shared_ptr<ThreadPool> signingThreadPool_;
 };
 
 }
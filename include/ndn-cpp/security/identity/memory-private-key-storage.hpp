@@ -29,6 +29,8 @@
 
 namespace ndn {
 
+class PrivateKeySigner;
+
 /**
  * MemoryPrivateKeyStorage extends PrivateKeyStorage to implement a simple in-memory private key store.  You should
  * initialize by calling setKeyPairForKeyName.
@@ -195,7 +197,8 @@ public:
 
 private:
   /**
-   * PrivateKey is a simple class to hold an RSA or EC private key.
+   * PrivateKey is a simple class to hold an RSA or EC private key. It signs
+   * through a PrivateKeySigner so that threads don't share a key object.
    */
   class PrivateKey {
   public:
@@ -203,14 +206,11 @@ private:
 
     KeyType getKeyType() const { return keyType_; }
 
-    const RsaPrivateKeyLite& getRsaPrivateKey() const { return rsaPrivateKey_; }
-
-    const EcPrivateKeyLite& getEcPrivateKey() const { return ecPrivateKey_; }
+    PrivateKeySigner& getSigner() { return *signer_; }
 
   private:
     KeyType keyType_;
-    RsaPrivateKeyLite rsaPrivateKey_;
-    EcPrivateKeyLite ecPrivateKey_;
+    ptr_lib::shared_ptr<PrivateKeySigner> signer_;
   };
 
   std::map<std::string, ptr_lib::shared_ptr<PublicKey> > publicKeyStore_;   /**< The map key is the keyName.toUri() */
@@ -23,6 +23,7 @@
 #ifndef NDN_KEY_CHAIN_HPP
 #define NDN_KEY_CHAIN_HPP
 
+#include <map>
 #include "../data.hpp"
 #include "../interest.hpp"
 #include "../face.hpp"
@@ -322,6 +323,67 @@ public:
     identityManager_->signByCertificate(data, certificateName, wireFormat);
   }
 
+  /**
+   * Wire encode and sign each Data object in dataList, spreading the work
+   * across the signing thread pool, and wait until all are signed. The result
+   * for each is the same as sign(data, certificateName).
+   * @param dataList The Data objects to be signed. This updates the signature,
+   * key locator field and wireEncoding of each.
+   * @param certificateName The certificate name of the key to use for signing.
+   * @param wireFormat (optional) A WireFormat object used to encode the input.
+   * If omitted, use WireFormat getDefaultWireFormat().
+   * @throws SecurityException if signing fails for a Data object.
+   */
+  void
+  signBatch
+    (const std::vector<Data*>& dataList, const Name& certificateName,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+  {
+    identityManager_->signByCertificate(dataList, certificateName, wireFormat);
+  }
+
+  /**
+   * Queue each Data object in dataList to be signed on the signing thread pool
+   * as in signBatch and return immediately. See
+   * IdentityManager::signByCertificateAsync for details.
+   * @param dataList The Data objects to be signed. The caller should not modify
+   * them until a callback is called.
+   * @param certificateName The certificate name of the key to use for signing.
+   * @param onSigned When all are signed, this calls onSigned(dataList) with
+   * dataList in the same order, usually on a thread of the signing thread pool.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions.
+   * @param onFailed If signing fails for a Data object, this calls
+   * onFailed(dataList, reason) instead of onSigned.
+   * NOTE: The library will log any exceptions thrown by this callback, but for
+   * better error handling the callback should catch and properly handle any
+   * exceptions.
+   * @param wireFormat (optional) A WireFormat object used to encode the input.
+   * If omitted, use WireFormat getDefaultWireFormat().
+   */
+  void
+  signBatchAsync
+    (const std::vector<ptr_lib::shared_ptr<Data> >& dataList,
+     const Name& certificateName, const OnDataListSigned& onSigned,
+     const OnDataListSignFailed& onFailed,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+  {
+    identityManager_->signByCertificateAsync
+      (dataList, certificateName, onSigned, onFailed, wireFormat);
+  }
+
+  /**
+   * Set the number of threads that signBatch and signBatchAsync use.
+   * @param nThreads The number of threads. If 0 (the default), use the number
+   * of hardware threads.
+   */
+  void
+  setSigningThreadCount(size_t nThreads)
+  {
+    identityManager_->setSigningThreadCount(nThreads);
+  }
+
   /**
    * Wire encode the Data object, sign it with the default identity and set its
    * signature.
@@ -465,6 +527,8 @@ public:
    * Check the signature on the Data object and call either onVerify or
    * onValidationFailed.
    * We use callback functions because verify may fetch information to check the signature.
+   * If a certificate is needed which is already being fetched for another
+   * packet, this waits for the same Interest instead of sending another one.
    * @param data The Data object with the signature to check.
    * @param onVerified If the signature is verified, this calls onVerified(data).
    * NOTE: The library will log any exceptions thrown by this callback, but for
@@ -505,7 +569,9 @@ public:
   /**
    * Check the signature on the signed interest and call either onVerify or
    * onValidationFailed. We use callback functions because verify may fetch
-   * information to check the signature.
+   * information to check the signature. If a certificate is needed which is
+   * already being fetched for another packet, this waits for the same Interest
+   * instead of sending another one.
    * @param interest The interest with the signature to check.
    * @param onVerified If the signature is verified, this calls onVerified(interest).
    * NOTE: The library will log any exceptions thrown by this callback, but for
@@ -620,27 +686,35 @@ public:
   static const RsaKeyParams DEFAULT_KEY_PARAMS;
 
 private:
-  void
-  onCertificateData
-    (const ptr_lib::shared_ptr<const Interest> &interest, const ptr_lib::shared_ptr<Data> &data, ptr_lib::shared_ptr<ValidationRequest> nextStep);
+  /**
+   * OnCertificateFetchFailed is called with the reason if the certificate for
+   * a ValidationRequest can't be fetched.
+   */
+  typedef func_lib::function<void(const std::string& reason)>
+    OnCertificateFetchFailed;
 
-  void
-  onCertificateInterestTimeout
-    (const ptr_lib::shared_ptr<const Interest> &interest, int retry, 
-     const OnDataValidationFailed& onValidationFailed,
-     const ptr_lib::shared_ptr<Data> &data,
-     ptr_lib::shared_ptr<ValidationRequest> nextStep);
+  class PendingCertificateFetch;
 
   /**
-   * This is the same as onCertificateInterestTimeout, but we call
-   * onValidationFailed(originalInterest, reason) if we have too many retries.
+   * Fetch the certificate for the nextStep. If a fetch with the same Interest
+   * name is already pending, just add nextStep to its waiters so that only one
+   * Interest is sent.
+   * @param nextStep The ValidationRequest with the certificate Interest.
+   * @param onFetchFailed This calls onFetchFailed(reason) if the retries for
+   * the Interest time out.
    */
   void
-  onCertificateInterestTimeoutForVerifyInterest
-    (const ptr_lib::shared_ptr<const Interest> &interest, int retry,
-     const OnInterestValidationFailed& onValidationFailed,
-     const ptr_lib::shared_ptr<Interest>& originalInterest,
-     ptr_lib::shared_ptr<ValidationRequest> nextStep);
+  fetchCertificate
+    (const ptr_lib::shared_ptr<ValidationRequest>& nextStep,
+     const OnCertificateFetchFailed& onFetchFailed);
+
+  void
+  onCertificateData
+    (const ptr_lib::shared_ptr<const Interest> &interest, const ptr_lib::shared_ptr<Data> &data);
+
+  void
+  onCertificateInterestTimeout
+    (const ptr_lib::shared_ptr<const Interest> &interest, int retry);
 
   /**
    * Get the default certificate from the identity storage and return its name.
@@ -660,6 +734,9 @@ private:
   ptr_lib::shared_ptr<IdentityManager> identityManager_;
   ptr_lib::shared_ptr<PolicyManager> policyManager_;
   Face* face_;
+  // The key is the name of the certificate Interest.
+  std::map<Name, ptr_lib::shared_ptr<PendingCertificateFetch> >
+    pendingCertificateFetches_;
 };
 
 }
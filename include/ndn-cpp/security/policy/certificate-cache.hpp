@@ -24,6 +24,7 @@
 #ifndef NDN_CERTIFICATE_CACHE_HPP
 #define NDN_CERTIFICATE_CACHE_HPP
 
+#include <list>
 #include <map>
 #include "../certificate/identity-certificate.hpp"
 
@@ -31,69 +32,127 @@ namespace ndn {
 
 /**
  * A CertificateCache is used to save other users' certificate during
- * verification.
+ * verification. The cache is keyed by the certificate name without the
+ * timestamp (the name in a KeyLocator) and holds each certificate already
+ * decoded. When the total size of the certificate encodings is more than the
+ * maximum, the least recently used certificates are removed. Unless disabled,
+ * a certificate is not returned after its NotAfter time.
  */
 class CertificateCache {
 public:
   /**
-   * Insert the certificate into the cache. Assumes the timestamp is not yet
-   * removed from the name.
-   * @param certificate The certificate to copy and insert.
+   * Create a CertificateCache.
+   * @param maxBytes (optional) The maximum total size of the certificate
+   * encodings. If 0, the size is not limited. If omitted, use
+   * DEFAULT_MAX_BYTES.
+   * @param checkNotAfter (optional) If true or omitted, don't return a
+   * certificate after its NotAfter time. If false, keep returning it, which is
+   * needed for trust anchors.
    */
-  void
-  insertCertificate(const IdentityCertificate& certificate)
+  CertificateCache
+    (size_t maxBytes = DEFAULT_MAX_BYTES, bool checkNotAfter = true)
+  : maxBytes_(maxBytes), checkNotAfter_(checkNotAfter), nBytes_(0)
   {
-    Name certName = certificate.getName().getPrefix(-1);
-    cache_[certName.toUri()] = certificate.wireEncode();
   }
 
+  /**
+   * Insert the certificate into the cache. Assumes the timestamp is not yet
+   * removed from the name. If checking the NotAfter time and the certificate
+   * is already expired, this removes the existing certificate with the name.
+   * @param certificate The certificate to copy and insert.
+   * @return True if the certificate was inserted, or false if it was not
+   * inserted because it is past its NotAfter time.
+   */
+  bool
+  insertCertificate(const IdentityCertificate& certificate);
+
   /**
    * Remove a certificate from the cache. This does nothing if it is not present.
    * @param certificateName The name of the certificate to remove. This assumes
    * there is no timestamp in the name.
    */
   void
-  deleteCertificate(const Name& certificateName)
-  {
-    std::map<std::string, Blob>::iterator entry
-      (cache_.find(certificateName.toUri()));
-    if (entry != cache_.end())
-      cache_.erase(entry);
-  }
+  deleteCertificate(const Name& certificateName);
 
   /**
    * Fetch a certificate from the cache.
    * @param certificateName The name of the certificate to remove. Assumes there
    * is no timestamp in the name.
    * @return A new copy of the IdentityCertificate, or a null shared_ptr if not
-   * found.
+   * found or expired.
    */
   ptr_lib::shared_ptr<IdentityCertificate>
-  getCertificate(const Name& certificateName) const
-  {
-    std::map<std::string, Blob>::const_iterator entry
-      (cache_.find(certificateName.toUri()));
-    if (entry == cache_.end())
-      return ptr_lib::shared_ptr<IdentityCertificate>();
-
-    ptr_lib::shared_ptr<IdentityCertificate> cert(new IdentityCertificate());
-    Blob certData = entry->second;
-    cert->wireDecode(certData);
-    return cert;
-  }
+  getCertificate(const Name& certificateName) const;
+
+  /**
+   * Fetch the wire encoding of a certificate from the cache without decoding
+   * it.
+   * @param certificateName The name of the certificate. Assumes there is no
+   * timestamp in the name.
+   * @return The certificate encoding, or an isNull() Blob if not found or
+   * expired.
+   */
+  Blob
+  getCertificateEncoding(const Name& certificateName) const;
+
+  /**
+   * Fetch the public key of a certificate from the cache without copying the
+   * certificate.
+   * @param certificateName The name of the certificate. Assumes there is no
+   * timestamp in the name.
+   * @return The public key DER, or an isNull() Blob if not found or expired.
+   */
+  Blob
+  getPublicKeyDer(const Name& certificateName) const;
 
   /**
    * Clear all certificates from the store.
    */
   void
-  reset()
-  {
-    cache_.clear();
-  }
+  reset();
+
+  /**
+   * Get the number of certificates in the cache, including expired
+   * certificates which are not yet removed.
+   * @return The number of certificates.
+   */
+  size_t
+  size() const { return cache_.size(); }
+
+  /**
+   * Get the total size of the certificate encodings in the cache.
+   * @return The number of bytes.
+   */
+  size_t
+  getByteCount() const { return nBytes_; }
+
+  static const size_t DEFAULT_MAX_BYTES = 4 * 1024 * 1024;
 
 private:
-  // The key is the certificate name URI. The value is the wire encoding.
-  std::map<std::string, Blob> cache_;
+  class Entry {
+  public:
+    ptr_lib::shared_ptr<IdentityCertificate> certificate_;
+    Blob encoding_;
+    MillisecondsSince1970 notAfter_;
+    std::list<Name>::iterator lruPosition_;
+  };
+
+  /**
+   * Find the certificate and mark it as the most recently used.
+   * @return The entry, or 0 if not found or expired.
+   */
+  const Entry*
+  find(const Name& certificateName) const;
+
+  void
+  erase(std::map<Name, Entry>::iterator entry);
+
+  std::map<Name, Entry> cache_;
+  // The certificate names with the most recently used at the front.
+  mutable std::list<Name> lruList_;
+  size_t maxBytes_;
+  bool checkNotAfter_;
+  size_t nBytes_;
 };
 
 }
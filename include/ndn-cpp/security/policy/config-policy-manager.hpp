@@ -27,6 +27,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <list>
 #include "certificate-cache.hpp"
 #include "policy-manager.hpp"
 
@@ -35,6 +36,8 @@ class TestVerificationRules_NameRelation_Test;
 class TestVerificationRules_SimpleRegex_Test;
 class TestVerificationRules_Hierarchical_Test;
 class TestVerificationRules_HyperRelation_Test;
+class TestVerificationRules_RepeatedMatch_Test;
+class TestConfigPolicyManager_ValidationCache_Test;
 
 namespace ndn {
 
@@ -54,6 +57,16 @@ class IdentityCertificate;
  * of certificates will be followed to a maximum depth.
  * If the new certificate is accepted, it is used to complete the verification.
  *
+ * The rules are compiled when the configuration is loaded, so that matching a
+ * packet to a rule doesn't parse names or compile regular expressions.
+ *
+ * To avoid decoding a known certificate for every packet, the public key of
+ * each certificate which is used is kept until the certificate's NotAfter time
+ * or the validated certificate TTL, as long as the certificate cache still has
+ * the same certificate. A packet which fails verification is remembered for
+ * the failed packet TTL so that it is rejected again without checking the
+ * signature.
+ *
  * The KeyLocators of data packets and signed interests MUST contain a name for
  * verification to succeed.
  */
@@ -102,6 +115,7 @@ public:
    * Call reset() and load the configuration rules from the file.
    * @param configFileName The path to the configuration file containing the
    * verification rules.
+   * @throws NdnRegexMatcherBase::Error if a rule has a bad regular expression.
    */
   void
   load(const std::string& configFileName);
@@ -111,10 +125,54 @@ public:
    * @param input The contents of the configuration rules, with lines separated
    * by "\n" or "\r\n".
    * @param inputName Used for log messages, etc.
+   * @throws NdnRegexMatcherBase::Error if a rule has a bad regular expression.
    */
   void
   load(const std::string& input, const std::string& inputName);
 
+  /**
+   * Set the maximum time to keep the public key of a certificate which was
+   * used to verify a packet, so that a later packet signed by the same
+   * certificate needs only the signature check. The public key is also
+   * dropped at the certificate's NotAfter time, or if the certificate cache
+   * gets a different certificate with the same name.
+   * @param validatedCertificateTtl The time in milliseconds. If 0, decode the
+   * certificate for each packet. If you don't call this, the TTL is one hour.
+   */
+  void
+  setValidatedCertificateTtl(Milliseconds validatedCertificateTtl)
+  {
+    validatedCertificateTtl_ = validatedCertificateTtl;
+    validatedCertificates_.clear();
+  }
+
+  /**
+   * Set the time to remember a packet which failed verification, so that the
+   * same packet received again is rejected with the same reason without
+   * checking its signature. This does not remember failures to fetch a
+   * certificate.
+   * @param failedPacketTtl The time in milliseconds. If 0, don't remember
+   * failed packets. If you don't call this, the TTL is one minute.
+   */
+  void
+  setFailedPacketTtl(Milliseconds failedPacketTtl)
+  {
+    failedPacketTtl_ = failedPacketTtl;
+    failedPackets_.clear();
+    failedPacketOrder_.clear();
+  }
+
+  /**
+   * The maximum number of certificate public keys kept for
+   * setValidatedCertificateTtl.
+   */
+  static const size_t MAX_VALIDATED_CERTIFICATES = 1000;
+
+  /**
+   * The maximum number of failed packets remembered for setFailedPacketTtl.
+   */
+  static const size_t MAX_FAILED_PACKETS = 1000;
+
   /**
    * Check if the received data packet can escape from verification and be
    * trusted as valid. If the configuration file contains the trust anchor
@@ -233,6 +291,8 @@ private:
   friend TestVerificationRules_SimpleRegex_Test;
   friend TestVerificationRules_Hierarchical_Test;
   friend TestVerificationRules_HyperRelation_Test;
+  friend TestVerificationRules_RepeatedMatch_Test;
+  friend TestConfigPolicyManager_ValidationCache_Test;
 
   /**
    * TrustAnchorRefreshManager manages the trust-anchor certificates, including
@@ -241,6 +301,8 @@ private:
   class TrustAnchorRefreshManager {
   public:
     TrustAnchorRefreshManager()
+    // Don't remove trust anchors to limit the size or when they expire.
+    : certificateCache_(0, false)
     {
     }
 
@@ -254,10 +316,21 @@ private:
       return certificateCache_.getCertificate(certificateName);
     }
 
+    Blob
+    getCertificateEncoding(const Name& certificateName) const
+    {
+      // Assume the timestamp is already removed.
+      return certificateCache_.getCertificateEncoding(certificateName);
+    }
+
     void
     addDirectory(const std::string& directoryName, Milliseconds refreshPeriod);
 
-    void
+    /**
+     * Reload the certificates of each directory whose refresh time has passed.
+     * @return True if any directory was reloaded.
+     */
+    bool
     refreshAnchors();
 
   private:
@@ -282,6 +355,51 @@ private:
     std::map<std::string, ptr_lib::shared_ptr<DirectoryInfo> > refreshDirectories_;
   };
 
+  /**
+   * A CompiledRule holds a rule from the configuration with its names parsed
+   * and its regular expressions compiled. It is defined in the source file.
+   */
+  class CompiledRule;
+
+  /**
+   * A ValidatedCertificate holds the public key of a certificate which was
+   * found for a verification, and the certificate encoding to check that the
+   * certificate cache still has the same certificate.
+   */
+  class ValidatedCertificate {
+  public:
+    ValidatedCertificate
+      (const Blob& certificateEncoding, const Blob& publicKeyDer,
+       MillisecondsSince1970 expirationTime)
+    : certificateEncoding_(certificateEncoding), publicKeyDer_(publicKeyDer),
+      expirationTime_(expirationTime)
+    {
+    }
+
+    Blob certificateEncoding_;
+    Blob publicKeyDer_;
+    MillisecondsSince1970 expirationTime_;
+  };
+
+  /**
+   * A FailedPacket holds the failure reason of a packet which failed
+   * verification, when to forget it, and its position in failedPacketOrder_.
+   */
+  class FailedPacket {
+  public:
+    FailedPacket
+      (const std::string& failureReason, MillisecondsSince1970 expirationTime,
+       std::list<std::string>::iterator orderPosition)
+    : failureReason_(failureReason), expirationTime_(expirationTime),
+      orderPosition_(orderPosition)
+    {
+    }
+
+    std::string failureReason_;
+    MillisecondsSince1970 expirationTime_;
+    std::list<std::string>::iterator orderPosition_;
+  };
+
   /**
    * The configuration file allows 'trust anchor' certificates to be preloaded.
    * The certificates may also be loaded from a directory, and if the 'refresh'
@@ -299,8 +417,23 @@ private:
    * @param objectName The name of the data packet or interest. In the case of
    * signed interests, this excludes the timestamp, nonce and signature
    * components.
-   * @param rule The rule from the configuration file that matches the data or
-   * interest.
+   * @param rule The CompiledRule that matches the data or interest. This is
+   * not const because matching uses the state of its regular expressions.
+   * @param failureReason If verification fails, set failureReason to the
+   * failure reason.
+   * @return True if matches.
+   */
+  bool
+  checkSignatureMatch
+    (const Name& signatureName, const Name& objectName,
+     CompiledRule& rule, std::string& failureReason);
+
+  /**
+   * Find the CompiledRule for the rule and call checkSignatureMatch. This is
+   * for the tests, which get the rule from findMatchingRule.
+   * @param signatureName The certificate name from the KeyLocator.
+   * @param objectName The name of the data packet or interest.
+   * @param rule The rule from findMatchingRule.
    * @param failureReason If verification fails, set failureReason to the
    * failure reason.
    * @return True if matches.
@@ -310,10 +443,16 @@ private:
     (const Name& signatureName, const Name& objectName, 
      const BoostInfoTree& rule, std::string& failureReason);
 
+  /**
+   * Compile the rules in config_ into compiledRules_. This is called by load.
+   */
+  void
+  compileRules();
+
   /**
    * This looks up certificates specified as base64-encoded data or file names.
    * These are cached by filename or encoding to avoid repeated reading of files
-   * or decoding.
+   * or decoding, including a certificate which is past its NotAfter time.
    * @param certID
    * @param isPath
    * @return
@@ -327,6 +466,18 @@ private:
    * exclude the timestamp, nonce, and signature components.
    * @param objName The name to be matched.
    * @param matchType The rule type to match, "data" or "interest".
+   * @return A pointer to the CompiledRule for the matching rule, or 0 if not
+   *   found.
+   */
+  CompiledRule*
+  findMatchingCompiledRule
+    (const Name& objName, const std::string& matchType) const;
+
+  /**
+   * Call findMatchingCompiledRule and return the rule from the configuration.
+   * This is for the tests.
+   * @param objName The name to be matched.
+   * @param matchType The rule type to match, "data" or "interest".
    * @return A pointer to the BoostInfoTree for the matching rule, or 0
    *   if not found.
    */
@@ -405,7 +556,52 @@ private:
   bool
   verify
     (const Signature* signatureInfo, const SignedBlob& signedBlob,
-     std::string& failureReason) const;
+     std::string& failureReason);
+
+  /**
+   * Find the certificate in the trust anchors or the certificate cache and get
+   * its public key. If validatedCertificates_ has the public key for the same
+   * certificate encoding, then use it. Otherwise decode the certificate and
+   * save its public key in validatedCertificates_.
+   * @param certificateName The certificate name from the KeyLocator, without
+   * the timestamp.
+   * @param publicKeyDer Set this to the public key DER. If the certificate
+   * doesn't have a public key, this is set to an isNull() Blob.
+   * @return True if the certificate is found, false if not.
+   */
+  bool
+  getCertificatePublicKey(const Name& certificateName, Blob& publicKeyDer);
+
+  /**
+   * Check if the packet with the encoding failed verification within the
+   * failed packet TTL.
+   * @param encoding The wire encoding of the Data packet, or of the signed
+   * Interest name.
+   * @param failureReason If the packet failed, set failureReason to the
+   * saved failure reason.
+   * @return True if the packet failed, false if not.
+   */
+  bool
+  isFailedPacket(const Blob& encoding, std::string& failureReason);
+
+  /**
+   * Remember that the packet with the encoding failed verification. If there
+   * are already MAX_FAILED_PACKETS, this erases the expired entries, or the
+   * oldest entry if none are expired.
+   * @param encoding The wire encoding of the Data packet, or of the signed
+   * Interest name.
+   * @param failureReason The failure reason.
+   */
+  void
+  addFailedPacket(const Blob& encoding, const std::string& failureReason);
+
+  /**
+   * Erase the entry in failedPackets_ and failedPacketOrder_ for the key, if
+   * it exists.
+   * @param key The digest key of the failed packet.
+   */
+  void
+  eraseFailedPacket(const std::string& key);
 
   /**
    * This is a helper for checkVerificationPolicy to verify the rule and return
@@ -472,16 +668,32 @@ private:
   Milliseconds keyGraceInterval_;
   Milliseconds keyTimestampTtl_;
   int maxTrackedKeys_;
-  // fixedCertificateCache_ stores the fixed-signer certificate name associated with
-  //    validation rules so we don't keep loading from files.
-  std::map<std::string, std::string> fixedCertificateCache_;
+  // fixedCertificateCache_ stores the fixed-signer certificate associated with
+  //    validation rules so we don't keep loading from files. The key is the
+  //    file name or base64 encoding. This keeps an expired certificate which
+  //    certificateCache_ does not store.
+  std::map<std::string, ptr_lib::shared_ptr<IdentityCertificate> >
+    fixedCertificateCache_;
   // keyTimestamps_ stores the timestamps for each public key used in command
   //   interests to avoid replay attacks.
   // key is the public key name, value is the last timestamp.
   std::map<std::string, MillisecondsSince1970> keyTimestamps_;
   ptr_lib::shared_ptr<BoostInfoParser> config_;
+  // compiledRules_ has the rules from config_ in order. The key is the rule's
+  //   "for" type such as "data" or "interest".
+  std::map<std::string, std::vector<ptr_lib::shared_ptr<CompiledRule> > >
+    compiledRules_;
   bool requiresVerification_;
   ptr_lib::shared_ptr<TrustAnchorRefreshManager> refreshManager_;
+  Milliseconds validatedCertificateTtl_;
+  // The key is the certificate name URI without the timestamp.
+  std::map<std::string, ValidatedCertificate> validatedCertificates_;
+  Milliseconds failedPacketTtl_;
+  // The key is the SHA-256 digest of the packet encoding.
+  std::map<std::string, FailedPacket> failedPackets_;
+  // The keys of failedPackets_, oldest first. Since all entries have the same
+  // TTL, this is also the order in which they expire.
+  std::list<std::string> failedPacketOrder_;
 };
 
 }
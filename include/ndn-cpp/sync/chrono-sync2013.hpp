@@ -24,6 +24,7 @@
 #define NDN_CHRONO_SYNC_HPP
 
 #include <vector>
+#include <set>
 #include "../face.hpp"
 #include "../security/key-chain.hpp"
 #include "../util/memory-content-cache.hpp"
@@ -35,6 +36,7 @@ namespace Sync { class SyncState; }
 namespace ndn {
 
 class DigestTree;
+class DigestLog;
 
 /**
  * ChronoSync2013 implements the NDN ChronoSync protocol as described in the
@@ -268,6 +270,52 @@ public:
     return impl_->getSequenceNo();
   }
 
+  /**
+   * Set the window for coalescing published sequence numbers. If the window is
+   * greater than zero, publishNextSequenceNo() increments the sequence number
+   * right away, but the sync message is sent when the window expires, with the
+   * latest sequence number and applicationInfo. This way a producer which
+   * publishes quickly signs and sends one sync data packet per window.
+   * Receivers still get every sequence number since ChronoSync reports the
+   * latest sequence number for each producer.
+   * @param publishWindow The window in milliseconds, or 0 to send a sync
+   * message for each call to publishNextSequenceNo() (the default).
+   */
+  void
+  setPublishWindow(Milliseconds publishWindow)
+  {
+    impl_->setPublishWindow(publishWindow);
+  }
+
+  /**
+   * Get the window for coalescing published sequence numbers.
+   * @return The window in milliseconds, or 0 for no coalescing.
+   */
+  Milliseconds
+  getPublishWindow() const { return impl_->getPublishWindow(); }
+
+  /**
+   * Set whether to encode the sync messages which this sends in a compact
+   * binary format with a table of data prefixes and varint deltas of the
+   * session and sequence numbers, instead of Protobuf. Received sync messages
+   * are decoded in either format. Only use the compact format if all
+   * participants use a version of this library which can decode it.
+   * @param useCompactEncoding True to use the compact format, false to use
+   * Protobuf (the default).
+   */
+  void
+  setUseCompactEncoding(bool useCompactEncoding)
+  {
+    impl_->setUseCompactEncoding(useCompactEncoding);
+  }
+
+  /**
+   * Check if sync messages are sent in the compact format.
+   * @return True if using the compact format, false if using Protobuf.
+   */
+  bool
+  getUseCompactEncoding() const { return impl_->getUseCompactEncoding(); }
+
   /**
    * Unregister callbacks so that this does not respond to interests anymore.
    * If you will delete this ChronoSync2013 object while your application is
@@ -285,23 +333,6 @@ public:
   }
 
 private:
-  class DigestLogEntry {
-  public:
-    DigestLogEntry
-      (const std::string& digest,
-       const google::protobuf::RepeatedPtrField<Sync::SyncState>& data);
-
-    const std::string&
-    getDigest() const { return digest_; }
-
-    const google::protobuf::RepeatedPtrField<Sync::SyncState>&
-    getData() const { return *data_; }
-
-  private:
-    std::string digest_;
-    ptr_lib::shared_ptr<google::protobuf::RepeatedPtrField<Sync::SyncState> > data_;
-  };
-
   /**
    * ChronoSync2013::Impl does the work of ChronoSync2013. It is a separate
    * class so that ChronoSync2013 can create an instance in a shared_ptr to
@@ -357,6 +388,36 @@ private:
     int
     getSequenceNo() const { return sequenceNo_; }
 
+    /**
+     * See ChronoSync2013::setPublishWindow.
+     */
+    void
+    setPublishWindow(Milliseconds publishWindow)
+    {
+      publishWindow_ = publishWindow;
+    }
+
+    /**
+     * See ChronoSync2013::getPublishWindow.
+     */
+    Milliseconds
+    getPublishWindow() const { return publishWindow_; }
+
+    /**
+     * See ChronoSync2013::setUseCompactEncoding.
+     */
+    void
+    setUseCompactEncoding(bool useCompactEncoding)
+    {
+      useCompactEncoding_ = useCompactEncoding;
+    }
+
+    /**
+     * See ChronoSync2013::getUseCompactEncoding.
+     */
+    bool
+    getUseCompactEncoding() const { return useCompactEncoding_; }
+
     /**
      * See ChronoSync2013::shutdown.
      */
@@ -368,6 +429,35 @@ private:
     }
 
   private:
+    /**
+     * Create a sync message with sequenceNo_, broadcast it, update the digest
+     * tree and express an interest for the new root digest.
+     * @param applicationInfo The application info for the sync message.
+     */
+    void
+    publishSequenceNo(const Blob& applicationInfo);
+
+    /**
+     * This is called after the publish window to publish the latest sequence
+     * number.
+     */
+    void
+    flushPublish();
+
+    /**
+     * Encode the sync message in the compact format or as Protobuf, based on
+     * useCompactEncoding_.
+     */
+    Blob
+    encodeSyncStateMsg(const Sync::SyncStateMsg& syncMessage) const;
+
+    /**
+     * Decode the sync message from the compact format or Protobuf.
+     * @return True for success, false if the encoding is not valid.
+     */
+    static bool
+    decodeSyncStateMsg(const Blob& encoding, Sync::SyncStateMsg& syncMessage);
+
     /**
      * Make a data packet with the syncMessage and with name
      * applicationBroadcastPrefix_ + digest. Sign and send.
@@ -381,7 +471,8 @@ private:
 
     /**
      * Update the digest tree with the messages in content. If the digest tree
-     * root is not in the digest log, also add a log entry with the content.
+     * root is not in the digest log, also add a log entry and update the
+     * producers in the log with the content.
      * @param content The sync state messages.
      * @return True if added a digest log entry (because the updated digest
      * tree root was not in the log), false if didn't add a log entry.
@@ -389,10 +480,6 @@ private:
     bool
     update(const google::protobuf::RepeatedPtrField<Sync::SyncState >& content);
 
-    // Search the digest log by digest.
-    int
-    logFind(const std::string& digest) const;
-
     /**
      * Process the sync interest from the applicationBroadcastPrefix. If we can't
      * satisfy the interest, add it to the pending interest table in the
@@ -420,9 +507,9 @@ private:
       (const Interest& interest, const std::string& syncDigest, Face& face);
 
     /**
-     * Common interest processing, using digest log to find the difference after
-     * syncDigest. Return true if sent a data packet to satisfy the interest,
-     * otherwise false.
+     * Common interest processing, using digest log to find the producers which
+     * changed after the log entry at index. Return true if sent a data packet
+     * to satisfy the interest, otherwise false.
      */
     bool
     processSyncInterest(int index, const std::string& syncDigest, Face& face);
@@ -446,6 +533,21 @@ private:
     void
     syncTimeout(const ptr_lib::shared_ptr<const Interest>& interest);
 
+    /**
+     * Express the sync interest for the current root, unless it is already
+     * pending. One data packet satisfies every pending interest with its name,
+     * and each onData would express another sync interest, so duplicates would
+     * multiply.
+     */
+    void
+    expressSyncInterest();
+
+    /**
+     * Remove the digest of the sync interest from pendingSyncDigests_.
+     */
+    void
+    removePendingSyncDigest(const Interest& interest);
+
     // Process initial data which usually includes all other publisher's info, and send back the new comer's own info.
     void
     initialOndata(const google::protobuf::RepeatedPtrField<Sync::SyncState >& content);
@@ -465,7 +567,7 @@ private:
     Milliseconds syncLifetime_;
     OnReceivedSyncState onReceivedSyncState_;
     OnInitialized onInitialized_;
-    std::vector<ptr_lib::shared_ptr<DigestLogEntry> > digestLog_;
+    ptr_lib::shared_ptr<DigestLog> digestLog_;
     ptr_lib::shared_ptr<DigestTree> digestTree_;
     std::string applicationDataPrefixUri_;
     const Name applicationBroadcastPrefix_;
@@ -474,6 +576,13 @@ private:
     int sequenceNo_;
     MemoryContentCache contentCache_;
     bool enabled_;
+    Milliseconds publishWindow_;
+    bool useCompactEncoding_;
+    bool isFlushScheduled_;
+    Blob pendingApplicationInfo_;
+    // The root digests of the sync interests from expressSyncInterest which
+    // are pending.
+    std::set<std::string> pendingSyncDigests_;
   };
 
   ptr_lib::shared_ptr<Impl> impl_;
@@ -34,6 +34,98 @@ ndn_TlvStructureDecoder_reset(struct ndn_TlvStructureDecoder *self)
   self->nBytesToRead = 0;
 }
 
+/**
+ * Read the VAR-NUMBER at input[*offset] if all of its bytes are in the input.
+ * This does not use an ndn_TlvDecoder so that it doesn't need to check for
+ * errors on each byte.
+ * @param input The input buffer.
+ * @param inputLength The number of bytes in input.
+ * @param offset A pointer to the offset of the VAR-NUMBER. If this returns 1,
+ * update *offset to just past the VAR-NUMBER.
+ * @param varNumber Set varNumber to the VAR-NUMBER.
+ * @return 1 if the VAR-NUMBER was read, or 0 if it extends past the end of
+ * the input.
+ */
+static __inline int
+readVarNumberIfAvailable
+  (const uint8_t *input, size_t inputLength, size_t *offset,
+   uint64_t *varNumber)
+{
+  const uint8_t *p = input + *offset;
+  unsigned int firstOctet = (unsigned int)*p;
+  size_t nBytes;
+
+  if (firstOctet < 253) {
+    *varNumber = firstOctet;
+    *offset += 1;
+    return 1;
+  }
+
+  if (firstOctet == 253)
+    nBytes = 2;
+  else if (firstOctet == 254)
+    nBytes = 4;
+  else
+    // value == 255.
+    nBytes = 8;
+
+  if (inputLength - *offset < 1 + nBytes)
+    return 0;
+
+  *varNumber = 0;
+  for (++p; nBytes > 0; --nBytes)
+    *varNumber = (*varNumber << 8) | (uint64_t)*(p++);
+  *offset = p - input;
+  return 1;
+}
+
+/**
+ * When the state is READ_TYPE and the entire type and length are in the input,
+ * read them directly and jump to the end of the value without stepping through
+ * the states for each header byte. Each element in a buffer of back-to-back
+ * complete elements is found with one call.
+ * @param self A pointer to the ndn_TlvStructureDecoder struct.
+ * @param input The input buffer.
+ * @param inputLength The number of bytes in input, which must be greater than
+ * self->offset.
+ * @return 1 if this updated self, or 0 if the header is split across inputs
+ * and the caller must use the state machine.
+ */
+static int
+findElementEndFromHeader
+  (struct ndn_TlvStructureDecoder *self, const uint8_t *input,
+   size_t inputLength)
+{
+  size_t offset = self->offset;
+  uint64_t type;
+  uint64_t lengthVarNumber;
+  size_t valueLength;
+  size_t nRemainingBytes;
+
+  if (!readVarNumberIfAvailable(input, inputLength, &offset, &type))
+    return 0;
+  if (offset >= inputLength ||
+      !readVarNumberIfAvailable(input, inputLength, &offset, &lengthVarNumber))
+    return 0;
+
+  // Silently ignore if the length is larger than size_t.
+  valueLength = (size_t)lengthVarNumber;
+  nRemainingBytes = inputLength - offset;
+  if (nRemainingBytes >= valueLength) {
+    // The whole element is in the input.
+    self->offset = offset + valueLength;
+    self->gotElementEnd = 1;
+  }
+  else {
+    // Skip the available value bytes and wait for the rest.
+    self->offset = inputLength;
+    self->nBytesToRead = valueLength - nRemainingBytes;
+    self->state = ndn_TlvStructureDecoder_READ_VALUE_BYTES;
+  }
+
+  return 1;
+}
+
 ndn_Error
 ndn_TlvStructureDecoder_findElementEnd(struct ndn_TlvStructureDecoder *self, const uint8_t *input, size_t inputLength)
 {
@@ -43,6 +135,11 @@ ndn_TlvStructureDecoder_findElementEnd(struct ndn_TlvStructureDecoder *self, con
     // Someone is calling when we already got the end.
     return NDN_ERROR_success;
 
+  if (self->state == ndn_TlvStructureDecoder_READ_TYPE &&
+      self->offset < inputLength &&
+      findElementEndFromHeader(self, input, inputLength))
+    return NDN_ERROR_success;
+
   ndn_TlvDecoder_initialize(&decoder, input, inputLength);
 
   while (1) {
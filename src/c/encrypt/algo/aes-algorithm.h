@@ -23,6 +23,7 @@
 
 #include <ndn-cpp/c/common.h>
 #include <ndn-cpp/c/errors.h>
+#include <ndn-cpp/c/encrypt/algo/aes-cbc-encryptor-types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -124,6 +125,64 @@ ndn_AesAlgorithm_encrypt128Ecb
   (const uint8_t *key, size_t keyLength, const uint8_t *plainData,
    size_t plainDataLength, uint8_t *encryptedData, size_t *encryptedDataLength);
 
+/**
+ * Initialize the ndn_AesCbcEncryptor struct with a null value.
+ * @param self A pointer to the ndn_AesCbcEncryptor struct.
+ */
+static __inline void
+ndn_AesCbcEncryptor_initialize(struct ndn_AesCbcEncryptor *self)
+{
+  self->context = 0;
+}
+
+/**
+ * Finalize the ndn_AesCbcEncryptor struct, freeing memory if needed.
+ * @param self A pointer to the ndn_AesCbcEncryptor struct.
+ */
+void
+ndn_AesCbcEncryptor_finalize(struct ndn_AesCbcEncryptor *self);
+
+/**
+ * Set the AES 128 key of the ndn_AesCbcEncryptor struct, allocating memory as
+ * needed. You must call ndn_AesCbcEncryptor_finalize to free it.
+ * @param self A pointer to the ndn_AesCbcEncryptor struct.
+ * @param key A pointer to the key byte array.
+ * @param keyLength The length of key. It is an error if this is not
+ * ndn_AES_128_BLOCK_SIZE.
+ * @return 0 for success, else NDN_ERROR_Incorrect_key_size for incorrect
+ * keyLength or NDN_ERROR_Error_in_encrypt_operation if the cipher context
+ * can't be created.
+ */
+ndn_Error
+ndn_AesCbcEncryptor_setKey
+  (struct ndn_AesCbcEncryptor *self, const uint8_t *key, size_t keyLength);
+
+/**
+ * Encrypt plainData using AES 128 in CBC mode with the key from
+ * ndn_AesCbcEncryptor_setKey and the given initial vector. This reuses the
+ * key schedule in the cipher context. The result is the same as
+ * ndn_AesAlgorithm_encrypt128Cbc.
+ * @param self A pointer to the ndn_AesCbcEncryptor struct.
+ * @param initialVector A pointer to the initial vector byte array.
+ * @param initialVectorLength The length of initialVector. It is an error if
+ * this is not ndn_AES_128_BLOCK_SIZE.
+ * @param plainData A pointer to the input byte array to encrypt.
+ * @param plainDataLength The length of plainData.
+ * @param encryptedData A pointer to the encrypted output buffer. The caller
+ * must provide a large enough buffer, which should be at least
+ * plainDataLength + ndn_AES_128_BLOCK_SIZE bytes.
+ * @param encryptedDataLength This sets encryptedDataLength to the number of
+ * bytes placed in the encryptedData buffer.
+ * @return 0 for success, else NDN_ERROR_Incorrect_initial_vector_size for
+ * incorrect initialVectorLength or NDN_ERROR_Error_in_encrypt_operation if
+ * the key is not set.
+ */
+ndn_Error
+ndn_AesCbcEncryptor_encrypt
+  (struct ndn_AesCbcEncryptor *self, const uint8_t *initialVector,
+   size_t initialVectorLength, const uint8_t *plainData,
+   size_t plainDataLength, uint8_t *encryptedData, size_t *encryptedDataLength);
+
 #ifdef __cplusplus
 }
 #endif
@@ -135,4 +135,65 @@ ndn_AesAlgorithm_encrypt128Ecb
   return NDN_ERROR_success;
 }
 
+void
+ndn_AesCbcEncryptor_finalize(struct ndn_AesCbcEncryptor *self)
+{
+  if (self->context) {
+    EVP_CIPHER_CTX_free(self->context);
+    self->context = 0;
+  }
+}
+
+ndn_Error
+ndn_AesCbcEncryptor_setKey
+  (struct ndn_AesCbcEncryptor *self, const uint8_t *key, size_t keyLength)
+{
+  if (keyLength != ndn_AES_128_BLOCK_SIZE)
+    return NDN_ERROR_Incorrect_key_size;
+
+  if (!self->context) {
+    self->context = EVP_CIPHER_CTX_new();
+    if (!self->context)
+      return NDN_ERROR_Error_in_encrypt_operation;
+  }
+
+  // Set up the key schedule now. ndn_AesCbcEncryptor_encrypt sets the IV.
+  if (!EVP_EncryptInit_ex
+      (self->context, EVP_aes_128_cbc(), 0, (const unsigned char*)key, 0)) {
+    ndn_AesCbcEncryptor_finalize(self);
+    return NDN_ERROR_Error_in_encrypt_operation;
+  }
+
+  return NDN_ERROR_success;
+}
+
+ndn_Error
+ndn_AesCbcEncryptor_encrypt
+  (struct ndn_AesCbcEncryptor *self, const uint8_t *initialVector,
+   size_t initialVectorLength, const uint8_t *plainData,
+   size_t plainDataLength, uint8_t *encryptedData, size_t *encryptedDataLength)
+{
+  int outLength1, outLength2;
+
+  if (initialVectorLength != ndn_AES_128_BLOCK_SIZE)
+    return NDN_ERROR_Incorrect_initial_vector_size;
+  if (!self->context)
+    return NDN_ERROR_Error_in_encrypt_operation;
+
+  // Keep the cipher and key schedule, and only reset the IV.
+  if (!EVP_EncryptInit_ex
+      (self->context, 0, 0, 0, (const unsigned char*)initialVector))
+    return NDN_ERROR_Error_in_encrypt_operation;
+  if (!EVP_EncryptUpdate
+      (self->context, (unsigned char*)encryptedData, &outLength1,
+       (const unsigned char*)plainData, plainDataLength))
+    return NDN_ERROR_Error_in_encrypt_operation;
+  if (!EVP_EncryptFinal_ex
+      (self->context, (unsigned char*)encryptedData + outLength1, &outLength2))
+    return NDN_ERROR_Error_in_encrypt_operation;
+
+  *encryptedDataLength = outLength1 + outLength2;
+  return NDN_ERROR_success;
+}
+
 #endif // NDN_CPP_HAVE_LIBCRYPTO
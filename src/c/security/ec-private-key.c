@@ -70,7 +70,22 @@ ndn_EcPrivateKey_setByCurve
   }
   
   EC_KEY_set_private_key(self->privateKey, keyBignum);
-  BN_free(keyBignum);
+
+  // Also set the public key so that encodePrivateKey can include it.
+  const EC_GROUP *group = EC_KEY_get0_group(self->privateKey);
+  EC_POINT *publicKey = EC_POINT_new(group);
+  if (!publicKey ||
+      !EC_POINT_mul(group, publicKey, keyBignum, NULL, NULL, NULL) ||
+      !EC_KEY_set_public_key(self->privateKey, publicKey)) {
+    EC_POINT_free(publicKey);
+    BN_clear_free(keyBignum);
+    EC_KEY_free(self->privateKey);
+    self->privateKey = 0;
+    return NDN_ERROR_Error_decoding_key;
+  }
+
+  EC_POINT_free(publicKey);
+  BN_clear_free(keyBignum);
   return NDN_ERROR_success;
 }
 
@@ -126,7 +141,7 @@ ndn_EcPrivateKey_encodePrivateKey
       (self->privateKey, EC_PKEY_NO_PARAMETERS | EC_PKEY_NO_PUBKEY);
 
   int result = i2d_ECPrivateKey(self->privateKey, encoding ? &encoding : 0);
-  if (result < 0)
+  if (result <= 0)
     return NDN_ERROR_Error_encoding_key;
 
   *encodingLength = result;
@@ -62,8 +62,8 @@ ndn_EcPrivateKey_decode
 
 /**
  * Set the the private key from the given curveId, using the value to create a
- * BIGNUM, allocating memory as needed. You must call ndn_EcPrivateKey_finalize
- * to free it.
+ * BIGNUM, allocating memory as needed. This also computes the public key. You
+ * must call ndn_EcPrivateKey_finalize to free it.
  * @param self A pointer to the ndn_EcPrivateKey struct.
  * @param curveId The OpenSSL curve ID such as NID_secp384r1.
  * @param value A pointer to the value array for the BIGNUM.
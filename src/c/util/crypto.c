@@ -34,6 +34,13 @@ ndn_generateRandomBytes(uint8_t *buffer, size_t bufferLength)
   return NDN_ERROR_success;
 }
 
+int
+ndn_makeCryptoThreadSafe
+  (void (*lockFunction)(int isLock, int lockIndex), size_t nLocks)
+{
+  return 0;
+}
+
 #elif NDN_CPP_HAVE_LIBCRYPTO
 
 #include <openssl/ssl.h>
@@ -70,6 +77,35 @@ ndn_generateRandomBytes(uint8_t *buffer, size_t bufferLength)
   return NDN_ERROR_success;
 }
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static void (*cryptoLockFunction)(int isLock, int lockIndex) = 0;
+
+static void
+cryptoLockingCallback(int mode, int type, const char *file, int line)
+{
+  cryptoLockFunction(mode & CRYPTO_LOCK, type);
+}
+#endif
+
+int
+ndn_makeCryptoThreadSafe
+  (void (*lockFunction)(int isLock, int lockIndex), size_t nLocks)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  if (CRYPTO_get_locking_callback())
+    // The application already set the locking callback.
+    return 1;
+  if ((size_t)CRYPTO_num_locks() > nLocks)
+    return 0;
+
+  // The default thread ID callback uses the address of errno, which is
+  // different for each thread.
+  cryptoLockFunction = lockFunction;
+  CRYPTO_set_locking_callback(cryptoLockingCallback);
+#endif
+  return 1;
+}
+
 void
 ndn_computeHmacWithSha256
   (const uint8_t *key, size_t keyLength, const uint8_t *data, size_t dataLength,
@@ -135,6 +171,14 @@ ndn_generateRandomBytes(uint8_t *buffer, size_t bufferLength)
   return NDN_ERROR_success;
 }
 
+int
+ndn_makeCryptoThreadSafe
+  (void (*lockFunction)(int isLock, int lockIndex), size_t nLocks)
+{
+  // The fallback random number generator uses rand() which is not thread safe.
+  return 0;
+}
+
 size_t
 ndn_getEcKeyInfoCount() { return 0; }
 
@@ -57,6 +57,22 @@ void ndn_digestSha256(const uint8_t *data, size_t dataLength, uint8_t *digest);
 ndn_Error
 ndn_generateRandomBytes(uint8_t *buffer, size_t bufferLength);
 
+/**
+ * Make sure that the crypto library can be called from multiple threads. With
+ * OpenSSL 1.1 and later this is always true. OpenSSL 1.0 needs a locking
+ * callback, so if the application has not already set one then this sets one
+ * which calls lockFunction.
+ * @param lockFunction This calls lockFunction(isLock, lockIndex) to lock (if
+ * isLock is nonzero) or unlock the mutex with index lockIndex.
+ * @param nLocks The number of mutexes which lockFunction can use. If the crypto
+ * library needs more than this, don't set the callback.
+ * @return 1 if the crypto library is thread safe, or 0 if not (including if
+ * there is no crypto library or it needs more than nLocks mutexes).
+ */
+int
+ndn_makeCryptoThreadSafe
+  (void (*lockFunction)(int isLock, int lockIndex), size_t nLocks);
+
 /**
  * Compute the HMAC with sha-256 of data, as defined in
  * http://tools.ietf.org/html/rfc2104#section-2 .
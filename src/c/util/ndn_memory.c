@@ -61,3 +61,12 @@ void ndn_memset(uint8_t *dest, int val, size_t len)
 #else
 int ndn_memset_stub_to_avoid_empty_file_warning = 0;
 #endif
+
+void ndn_memzero(uint8_t *dest, size_t len)
+{
+  // Use a volatile pointer so that the compiler doesn't remove the writes.
+  volatile uint8_t *p = dest;
+
+  while (len--)
+    *p++ = 0;
+}
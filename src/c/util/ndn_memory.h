@@ -21,7 +21,7 @@
 /*
  * Based on NDN_CPP_HAVE_MEMCMP, NDN_CPP_HAVE_MEMCPY and NDN_CPP_HAVE_MEMSET in
  * ndn-cpp-config.h, use the library version or a local implementation of
- * memcmp, memcpy and memset.
+ * memcmp, memcpy and memset. Also define ndn_memzero.
  */
 
 #ifndef NDN_MEMORY_H
@@ -87,6 +87,14 @@ static __inline void ndn_memset(uint8_t *dest, int val, size_t len) { memset(des
 void ndn_memset(uint8_t *dest, int val, size_t len);
 #endif
 
+/**
+ * Overwrite the bytes in dest with zeros. Unlike ndn_memset, this writes
+ * through a volatile pointer so that the compiler doesn't remove the writes
+ * when dest is not read again. This is used to clear copies of private key
+ * material.
+ */
+void ndn_memzero(uint8_t *dest, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
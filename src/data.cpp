@@ -19,6 +19,7 @@
  * A copy of the GNU Lesser General Public License is in the file COPYING.
  */
 
+#include <string.h>
 #include <stdexcept>
 #include <ndn-cpp/common.hpp>
 #include <ndn-cpp/digest-sha256-signature.hpp>
@@ -27,8 +28,11 @@
 #include <ndn-cpp/hmac-with-sha256-signature.hpp>
 #include <ndn-cpp/generic-signature.hpp>
 #include "c/data.h"
+#include "c/encoding/tlv/tlv-encoder.h"
 #include "lp/incoming-face-id.hpp"
+#include "encoding/lazy-fields.hpp"
 #include "ndn-cpp/lite/util/crypto-lite.hpp"
+#include <ndn-cpp/encoding/tlv-0_2-wire-format.hpp>
 #include <ndn-cpp/data.hpp>
 
 using namespace std;
@@ -39,7 +43,8 @@ Data::Data()
 : signature_(new Sha256WithRsaSignature()),
   changeCount_(0),
   defaultFullName_(new Name()),
-  getDefaultWireEncodingChangeCount_(0)
+  getDefaultWireEncodingChangeCount_(0),
+  pendingFields_(0)
 {
 }
 
@@ -48,17 +53,23 @@ Data::Data(const Name& name)
   signature_(new Sha256WithRsaSignature()),
   changeCount_(0),
   defaultFullName_(new Name()),
-  getDefaultWireEncodingChangeCount_(0)
+  getDefaultWireEncodingChangeCount_(0),
+  pendingFields_(0)
 {
 }
 
 Data::Data(const Data& data)
-: name_(data.name_),
-  metaInfo_(data.metaInfo_),
-  content_(data.content_),
-  defaultFullName_(new Name(*data.defaultFullName_)),
+: defaultFullName_(new Name(*data.defaultFullName_)),
+  lazyFields_(data.lazyFields_),
   changeCount_(0)
 {
+  // Another thread may be decoding a pending field of data through a const
+  // getter, so lock while copying the fields and the pending flags.
+  LazyDecoder::Lock lock(data.lazyFields_);
+  name_.set(data.name_.get());
+  metaInfo_.set(data.metaInfo_.get());
+  content_ = data.content_;
+  pendingFields_ = data.pendingFields_;
   if (data.signature_.get()) {
     signature_.set(data.signature_.get()->clone());
     ++changeCount_;
@@ -73,14 +84,16 @@ Data::~Data()
 
 Data& Data::operator=(const Data& data)
 {
-  if (data.signature_.get())
-    signature_.set(data.signature_.get()->clone());
+  // Use the getters to decode any fields which are pending in data.
+  if (data.getSignature())
+    signature_.set(data.getSignature()->clone());
   else
     signature_.set(ptr_lib::shared_ptr<Signature>());
 
-  setName(data.name_.get());
-  setMetaInfo(data.metaInfo_.get());
-  setContent(data.content_);
+  setName(data.getName());
+  setMetaInfo(data.getMetaInfo());
+  setContent(data.getContent());
+  clearLazyFields();
   setDefaultWireEncoding
     (data.defaultWireEncoding_, data.defaultWireEncodingFormat_);
 
@@ -125,6 +138,7 @@ Data::getFullName(WireFormat& wireFormat) const
 void
 Data::get(DataLite& dataLite) const
 {
+  decodePendingFields(PENDING_ALL);
   signature_.get()->get(dataLite.getSignature());
   name_.get().get(dataLite.getName());
   metaInfo_.get().get(dataLite.getMetaInfo());
@@ -134,6 +148,7 @@ Data::get(DataLite& dataLite) const
 void
 Data::set(const DataLite& dataLite)
 {
+  clearLazyFields();
   if (dataLite.getSignature().getType() == ndn_SignatureType_Sha256WithRsaSignature)
     signature_.set(ptr_lib::shared_ptr<Signature>(new Sha256WithRsaSignature()));
   else if (dataLite.getSignature().getType() == ndn_SignatureType_Sha256WithEcdsaSignature)
@@ -159,6 +174,7 @@ Data&
 Data::setName(const Name& name)
 {
   name_.set(name);
+  pendingFields_ &= ~PENDING_NAME;
   ++changeCount_;
   return *this;
 }
@@ -182,9 +198,136 @@ Data::wireEncode(WireFormat& wireFormat) const
   return wireEncoding;
 }
 
+/**
+ * Get the number of bytes in the VAR-NUMBER encoding which starts with
+ * firstOctet.
+ */
+static size_t
+getVarNumberEncodingLength(uint8_t firstOctet)
+{
+  if (firstOctet < 253)
+    return 1;
+  else if (firstOctet == 253)
+    return 3;
+  else if (firstOctet == 254)
+    return 5;
+  else
+    return 9;
+}
+
+/**
+ * Overwrite the VAR-NUMBER at output, keeping its encoding length.
+ * @param output The existing VAR-NUMBER encoding.
+ * @param encodingLength The length of the existing encoding, which must be
+ * the length of the minimal encoding of varNumber.
+ * @param varNumber The new number.
+ */
+static void
+replaceVarNumber(uint8_t* output, size_t encodingLength, uint64_t varNumber)
+{
+  if (encodingLength == 1) {
+    *output = (uint8_t)varNumber;
+    return;
+  }
+
+  // Keep the first octet and write the number in big endian order after it.
+  for (uint8_t* p = output + encodingLength; p != output + 1; varNumber >>= 8)
+    *(--p) = (uint8_t)(varNumber & 0xff);
+}
+
+/**
+ * Write the signature bits over the SignatureValue of an NDN-TLV Data
+ * encoding, trimming the encoding if the bits are shorter than the existing
+ * value. This only updates lengths in place, so it fails if a TLV length would
+ * need a different number of bytes.
+ * @param encoding The Data encoding, which must not be shared since it is
+ * modified.
+ * @param signatureValueOffset The offset of the SignatureValue TLV, which is
+ * the end of the signed portion.
+ * @param signatureBits The new signature bits.
+ * @return True for success, or false if the caller must encode again.
+ */
+static bool
+replaceSignatureValue
+  (const Blob& encoding, size_t signatureValueOffset, const Blob& signatureBits)
+{
+  // The encoding was just created and is not shared, so we can modify it.
+  vector<uint8_t>& buffer = const_cast<vector<uint8_t>&>(*encoding);
+  if (buffer.size() < 2 || buffer[0] != ndn_Tlv_Data ||
+      signatureValueOffset + 1 >= buffer.size() ||
+      buffer[signatureValueOffset] != ndn_Tlv_SignatureValue)
+    return false;
+
+  size_t dataLengthSize = getVarNumberEncodingLength(buffer[1]);
+  size_t signatureLengthSize = getVarNumberEncodingLength
+    (buffer[signatureValueOffset + 1]);
+  size_t signatureBitsOffset = signatureValueOffset + 1 + signatureLengthSize;
+  if (signatureBitsOffset > buffer.size() ||
+      signatureBits.size() > buffer.size() - signatureBitsOffset)
+    return false;
+
+  // The SignatureValue is the last TLV in the Data packet.
+  size_t trimLength =
+    buffer.size() - signatureBitsOffset - signatureBits.size();
+  size_t newDataLength = buffer.size() - trimLength - 1 - dataLengthSize;
+  if (ndn_TlvEncoder_sizeOfVarNumber(newDataLength) != dataLengthSize ||
+      ndn_TlvEncoder_sizeOfVarNumber(signatureBits.size()) !=
+        signatureLengthSize)
+    return false;
+
+  if (trimLength > 0) {
+    replaceVarNumber(&buffer[1], dataLengthSize, newDataLength);
+    replaceVarNumber
+      (&buffer[signatureValueOffset + 1], signatureLengthSize,
+       signatureBits.size());
+  }
+  if (signatureBits.size() > 0)
+    ::memcpy(&buffer[signatureBitsOffset], signatureBits.buf(),
+             signatureBits.size());
+  // Shrinking doesn't reallocate, so pointers to the signed portion are valid.
+  buffer.resize(buffer.size() - trimLength);
+
+  return true;
+}
+
+SignedBlob
+Data::wireEncodeWithSignature
+  (const ComputeSignature& computeSignature, size_t reservedLength,
+   WireFormat& wireFormat)
+{
+  // Encode with placeholder bits to reserve the SignatureValue.
+  getSignature()->setSignature
+    (Blob(ptr_lib::make_shared<vector<uint8_t> >(reservedLength), false));
+  size_t signedPortionBeginOffset, signedPortionEndOffset;
+  Blob encoding = wireFormat.encodeData
+    (*this, &signedPortionBeginOffset, &signedPortionEndOffset);
+
+  Blob signatureBits = computeSignature
+    (encoding.buf() + signedPortionBeginOffset,
+     signedPortionEndOffset - signedPortionBeginOffset);
+  getSignature()->setSignature(signatureBits);
+
+  if (!(dynamic_cast<Tlv0_2WireFormat*>(&wireFormat) &&
+        replaceSignatureValue(encoding, signedPortionEndOffset, signatureBits)))
+    // Encode again with the signature bits.
+    encoding = wireFormat.encodeData
+      (*this, &signedPortionBeginOffset, &signedPortionEndOffset);
+
+  SignedBlob wireEncoding = SignedBlob
+    (encoding, signedPortionBeginOffset, signedPortionEndOffset);
+  if (&wireFormat == WireFormat::getDefaultWireFormat())
+    // This is the default wire encoding.
+    setDefaultWireEncoding(wireEncoding, WireFormat::getDefaultWireFormat());
+
+  return wireEncoding;
+}
+
 void
 Data::wireDecode(const Blob& input, WireFormat& wireFormat)
 {
+  // All the fields are decoded now, so don't decode previous pending fields.
+  clearLazyFields();
+
   size_t signedPortionBeginOffset, signedPortionEndOffset;
   wireFormat.decodeData(*this, input.buf(), input.size(), &signedPortionBeginOffset, &signedPortionEndOffset);
 
@@ -198,4 +341,63 @@ Data::wireDecode(const Blob& input, WireFormat& wireFormat)
     setDefaultWireEncoding(SignedBlob(), 0);
 }
 
+void
+Data::wireDecodeLazy(const Blob& input, WireFormat& wireFormat)
+{
+  if (!dynamic_cast<Tlv0_2WireFormat*>(&wireFormat)) {
+    // We only know how to find the fields in NDN-TLV, so decode everything now.
+    wireDecode(input, wireFormat);
+    return;
+  }
+
+  size_t signedPortionBeginOffset, signedPortionEndOffset;
+  lazyFields_.reset(new LazyDataFields
+    (input, &signedPortionBeginOffset, &signedPortionEndOffset));
+  pendingFields_ = PENDING_ALL;
+  // The fields will have new values, so this is a change.
+  ++changeCount_;
+
+  if (&wireFormat == WireFormat::getDefaultWireFormat())
+    // This is the default wire encoding.
+    // Take a pointer to the input Blob without copying.
+    setDefaultWireEncoding
+      (SignedBlob(input, signedPortionBeginOffset, signedPortionEndOffset),
+       WireFormat::getDefaultWireFormat());
+  else
+    setDefaultWireEncoding(SignedBlob(), 0);
+}
+
+void
+Data::decodeLazyFields(int fields)
+{
+  // Another thread may have decoded some of the fields since the caller
+  // checked, so check the flags again while locked.
+  LazyDecoder::Lock lock(lazyFields_);
+  fields &= pendingFields_;
+
+  // Clear each flag after decoding so that the field is still pending if the
+  // decoder throws an exception.
+  if (fields & PENDING_NAME) {
+    lazyFields_->decodeName(name_.get());
+    // Update the local change count of name_ so that this is not a change.
+    name_.checkChanged();
+    pendingFields_ &= ~PENDING_NAME;
+  }
+  if (fields & PENDING_META_INFO) {
+    // Decode into a new MetaInfo so that fields not used by NDN-TLV are none.
+    MetaInfo metaInfo;
+    lazyFields_->decodeMetaInfo(metaInfo);
+    metaInfo_.set(metaInfo);
+    pendingFields_ &= ~PENDING_META_INFO;
+  }
+  if (fields & PENDING_CONTENT) {
+    content_ = lazyFields_->decodeContent();
+    pendingFields_ &= ~PENDING_CONTENT;
+  }
+  if (fields & PENDING_SIGNATURE) {
+    signature_.set(lazyFields_->decodeSignature());
+    pendingFields_ &= ~PENDING_SIGNATURE;
+  }
+}
+
 }
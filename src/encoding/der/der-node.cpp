@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include "../../c/util/time.h"
+#include "../../c/util/ndn_memory.h"
 #include "der-exception.hpp"
 #include "der-node.hpp"
 
@@ -93,6 +94,13 @@ DerNode::getChildren()
   throw DerDecodingException("getChildren: This DerNode is not DerSequence");
 }
 
+void
+DerNode::zeroizePayload()
+{
+  if (payloadPosition_ > 0)
+    ndn_memzero(&payload_[0], payloadPosition_);
+}
+
 DerNode::DerSequence&
 DerNode::getSequence
   (const std::vector<ptr_lib::shared_ptr<DerNode> >&children, size_t index)
@@ -206,6 +214,14 @@ DerNode::DerStructure::getChildren()
   return nodeList_;
 }
 
+void
+DerNode::DerStructure::zeroizePayload()
+{
+  DerNode::zeroizePayload();
+  for (size_t i = 0; i < nodeList_.size(); ++i)
+    nodeList_[i]->zeroizePayload();
+}
+
 Blob
 DerNode::DerStructure::encode()
 {
@@ -82,6 +82,14 @@ public:
   virtual const std::vector<ptr_lib::shared_ptr<DerNode> >&
   getChildren();
 
+  /**
+   * Overwrite the payload bytes with zeros. A DerStructure also zeroizes the
+   * payload of its children. This is used to clear a parsed private key after
+   * it is decoded.
+   */
+  virtual void
+  zeroizePayload();
+
   class DerStructure;
 
   ////////
@@ -190,6 +198,12 @@ public:
   virtual const std::vector<ptr_lib::shared_ptr<DerNode> >&
   getChildren();
 
+  /**
+   * Override to zeroize the payload of this node and its children.
+   */
+  virtual void
+  zeroizePayload();
+
   void
   addChild(const ptr_lib::shared_ptr<DerNode>& node, bool notifyParent = false)
   {
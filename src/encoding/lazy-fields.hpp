@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_LAZY_FIELDS_HPP
+#define NDN_LAZY_FIELDS_HPP
+
+#if __cplusplus >= 201103L
+#include <mutex>
+#endif
+#include <ndn-cpp/interest.hpp>
+#include <ndn-cpp/data.hpp>
+
+namespace ndn {
+
+/**
+ * LazyDecoder is the base class of LazyDataFields and LazyInterestSelectors. It
+ * holds the mutex which serializes decoding the pending fields, so that the
+ * const getters of a Data or Interest which was decoded with wireDecodeLazy can
+ * be called from multiple threads. Copies of the Data or Interest share the
+ * LazyDecoder and its mutex.
+ */
+class LazyDecoder {
+public:
+  /**
+   * A LazyDecoder::Lock locks the mutex of a LazyDecoder for the lifetime of
+   * the Lock. If the LazyDecoder is null, or if C++11 is not available, this
+   * does nothing.
+   */
+  class Lock {
+  public:
+    Lock(const ptr_lib::shared_ptr<const LazyDecoder>& lazyDecoder)
+    : lazyDecoder_(lazyDecoder)
+    {
+#if __cplusplus >= 201103L
+      if (lazyDecoder_)
+        lazyDecoder_->mutex_.lock();
+#endif
+    }
+
+    ~Lock()
+    {
+#if __cplusplus >= 201103L
+      if (lazyDecoder_)
+        lazyDecoder_->mutex_.unlock();
+#endif
+    }
+
+  private:
+    // Don't allow copying.
+    Lock(const Lock&);
+    Lock& operator=(const Lock&);
+
+    // Keep a pointer so that the mutex is not destroyed while it is locked.
+    ptr_lib::shared_ptr<const LazyDecoder> lazyDecoder_;
+  };
+
+private:
+#if __cplusplus >= 201103L
+  mutable std::mutex mutex_;
+#endif
+};
+
+/**
+ * A LazyDataFields holds the NDN-TLV wire encoding of a Data packet and the
+ * offsets of its fields, which were found with one scan of the outer TLVs.
+ * Data::wireDecodeLazy uses this to decode each field only when it is first
+ * needed. The methods are implemented in tlv-0_2-wire-format.cpp to use the
+ * same decoding functions as Tlv0_2WireFormat::decodeData.
+ */
+class LazyDataFields : public LazyDecoder {
+public:
+  /**
+   * Scan the Data packet in input and save the offsets of its fields. This
+   * checks the type and length of each field, but does not decode the values.
+   * @param input The Data packet wire encoding. This keeps a pointer to the
+   * Blob without copying.
+   * @param signedPortionBeginOffset Return the offset in the encoding of the
+   * beginning of the signed portion.
+   * @param signedPortionEndOffset Return the offset in the encoding of the end
+   * of the signed portion.
+   * @throws runtime_error for an error decoding the outer TLVs.
+   */
+  LazyDataFields
+    (const Blob& input, size_t *signedPortionBeginOffset,
+     size_t *signedPortionEndOffset);
+
+  /**
+   * Decode the Name field into name.
+   * @param name The Name which is cleared and receives the components.
+   * @throws runtime_error for a decoding error.
+   */
+  void
+  decodeName(Name& name) const;
+
+  /**
+   * Decode the MetaInfo field.
+   * @param metaInfo The MetaInfo to set. Fields not used by NDN-TLV should
+   * already be none.
+   * @throws runtime_error for a decoding error.
+   */
+  void
+  decodeMetaInfo(MetaInfo& metaInfo) const;
+
+  /**
+   * Get a copy of the Content value.
+   * @return A new Blob with the content.
+   */
+  Blob
+  decodeContent() const;
+
+  /**
+   * Decode the SignatureInfo and SignatureValue fields.
+   * @return A new signature object of the class for the decoded signature type.
+   * @throws runtime_error for a decoding error.
+   */
+  ptr_lib::shared_ptr<Signature>
+  decodeSignature() const;
+
+private:
+  Blob input_;
+  size_t nameBeginOffset_;
+  size_t metaInfoBeginOffset_;
+  size_t contentValueBeginOffset_;
+  size_t contentValueEndOffset_;
+  size_t signatureInfoBeginOffset_;
+  size_t signatureValueBeginOffset_;
+};
+
+/**
+ * A LazyInterestSelectors holds the NDN-TLV wire encoding of an Interest packet
+ * and the offset of its Selectors. Interest::wireDecodeLazy uses this to
+ * decode the Selectors only when one of them is first needed. The methods are
+ * implemented in tlv-0_2-wire-format.cpp to use the same decoding functions as
+ * Tlv0_2WireFormat::decodeInterest.
+ */
+class LazyInterestSelectors : public LazyDecoder {
+public:
+  /**
+   * Decode the Interest packet in input, except for the Selectors. If the
+   * Interest has Selectors, return a LazyInterestSelectors to decode them
+   * later. Otherwise set the selectors in interest to none and return null.
+   * @param interest The Interest to update.
+   * @param input The Interest packet wire encoding. This keeps a pointer to the
+   * Blob without copying.
+   * @param signedPortionBeginOffset Return the offset in the encoding of the
+   * beginning of the signed portion.
+   * @param signedPortionEndOffset Return the offset in the encoding of the end
+   * of the signed portion.
+   * @param wireFormat The wire format for the Link wire encoding.
+   * @return A new LazyInterestSelectors, or null if there are no Selectors.
+   * @throws runtime_error for a decoding error.
+   */
+  static ptr_lib::shared_ptr<LazyInterestSelectors>
+  decodeInterest
+    (Interest& interest, const Blob& input, size_t *signedPortionBeginOffset,
+     size_t *signedPortionEndOffset, WireFormat& wireFormat);
+
+  /**
+   * Decode the Selectors and set them in interest with its setters.
+   * @param interest The Interest to update.
+   * @throws runtime_error for a decoding error.
+   */
+  void
+  decodeSelectors(Interest& interest) const;
+
+private:
+  LazyInterestSelectors(const Blob& input, size_t selectorsBeginOffset)
+  : input_(input), selectorsBeginOffset_(selectorsBeginOffset)
+  {
+  }
+
+  Blob input_;
+  size_t selectorsBeginOffset_;
+};
+
+}
+
+#endif
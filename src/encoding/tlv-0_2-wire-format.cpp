@@ -32,47 +32,672 @@
 #include <ndn-cpp/delegation-set.hpp>
 #include <ndn-cpp/encrypt/encrypted-content.hpp>
 #include <ndn-cpp/lite/encoding/tlv-0_2-wire-format-lite.hpp>
-#include "tlv-encoder.hpp"
+#include <ndn-cpp/lite/util/crypto-lite.hpp>
+#include "../c/util/time.h"
+#include "../util/dynamic-uint8-vector.hpp"
+#include "tlv-prepend-encoder.hpp"
+#include "tlv-decoder.hpp"
+#include "lazy-fields.hpp"
 #include <ndn-cpp/encoding/tlv-0_2-wire-format.hpp>
 
 using namespace std;
 
 namespace ndn {
 
-Blob
-Tlv0_2WireFormat::encodeName(const Name& name)
+// The following private functions encode and decode the C++ objects directly
+// with the TlvPrependEncoder and TlvDecoder, without copying to an intermediate
+// Lite object. They throw runtime_error for an encoding or decoding error.
+
+/**
+ * Return a new Blob with a copy of the bytes in the ndn_Blob. This uses
+ * make_shared so that the vector and the shared_ptr reference count are made
+ * with one allocation, since the decoder makes many small Blobs.
+ * @param blob The ndn_Blob with the bytes to copy.
+ * @return The new Blob.
+ */
+static Blob
+copyBlob(const struct ndn_Blob& blob)
 {
-  struct ndn_NameComponent nameComponents[100];
-  NameLite nameLite
-    (nameComponents, sizeof(nameComponents) / sizeof(nameComponents[0]));
-  name.get(nameLite);
+  return Blob(ptr_lib::make_shared<vector<uint8_t> >
+    (blob.value, blob.value + blob.length), false);
+}
 
-  DynamicUInt8Vector output(256);
+static Name::Component
+decodeNameComponent(TlvDecoder& decoder)
+{
+  size_t saveOffset = decoder.offset;
+  uint64_t type = decoder.readVarNumber();
+  // Restore the position.
+  decoder.seek(saveOffset);
+
+  Blob value(copyBlob(decoder.readBlobTlv(type)));
+  if (type == ndn_Tlv_ImplicitSha256DigestComponent)
+    return Name::Component::fromImplicitSha256Digest(value);
+  else
+    return Name::Component(value);
+}
+
+static void
+decodeName
+  (Name& name, size_t *signedPortionBeginOffset, size_t *signedPortionEndOffset,
+   TlvDecoder& decoder)
+{
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_Name);
+
+  *signedPortionBeginOffset = decoder.offset;
+  // In case there are no components, set signedPortionEndOffset arbitrarily.
+  *signedPortionEndOffset = *signedPortionBeginOffset;
+
+  name.clear();
+  while (decoder.offset < endOffset) {
+    *signedPortionEndOffset = decoder.offset;
+    name.append(decodeNameComponent(decoder));
+  }
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+static void
+decodeKeyLocator
+  (unsigned int expectedType, KeyLocator& keyLocator, TlvDecoder& decoder)
+{
+  size_t endOffset = decoder.readNestedTlvsStart(expectedType);
+
+  keyLocator.clear();
+
+  if (decoder.offset == endOffset)
+    // The KeyLocator is omitted, so leave the fields as none.
+    return;
+
+  if (decoder.peekType(ndn_Tlv_Name, endOffset)) {
+    // KeyLocator is a Name.
+    size_t dummyBeginOffset, dummyEndOffset;
+    decodeName
+      (keyLocator.getKeyName(), &dummyBeginOffset, &dummyEndOffset, decoder);
+    keyLocator.setType(ndn_KeyLocatorType_KEYNAME);
+  }
+  else if (decoder.peekType(ndn_Tlv_KeyLocatorDigest, endOffset)) {
+    // KeyLocator is a KeyLocatorDigest.
+    keyLocator.setType(ndn_KeyLocatorType_KEY_LOCATOR_DIGEST);
+    keyLocator.setKeyData(copyBlob(decoder.readBlobTlv(ndn_Tlv_KeyLocatorDigest)));
+  }
+  else
+    throw runtime_error(ndn_getErrorString
+      (NDN_ERROR_decodeKeyLocator_unrecognized_key_locator_type));
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+static MillisecondsSince1970
+readIsoStringTlv(unsigned int expectedType, TlvDecoder& decoder)
+{
+  // Expect a 15-character ISO string like "20131018T184139".
+  const size_t isoStringMaxLength = 15;
+  struct ndn_Blob isoStringBlob = decoder.readBlobTlv(expectedType);
+  if (isoStringBlob.length > isoStringMaxLength)
+    throw runtime_error
+      (ndn_getErrorString(NDN_ERROR_Calendar_time_value_out_of_range));
+
+  string isoString((const char *)isoStringBlob.value, isoStringBlob.length);
+  ndn_MillisecondsSince1970 milliseconds;
   ndn_Error error;
-  size_t dummyBeginOffset, dummyEndOffset, encodingLength;
-  if ((error = Tlv0_2WireFormatLite::encodeName
-       (nameLite, &dummyBeginOffset, &dummyEndOffset,
-        DynamicUInt8ArrayLite::downCast(output), &encodingLength)))
+  if ((error = ndn_fromIsoString(isoString.c_str(), &milliseconds)))
     throw runtime_error(ndn_getErrorString(error));
 
-  return output.finish(encodingLength);
+  return milliseconds;
 }
 
-void
-Tlv0_2WireFormat::decodeName
-  (Name& name, const uint8_t *input, size_t inputLength)
+static void
+decodeValidityPeriod(ValidityPeriod& validityPeriod, TlvDecoder& decoder)
 {
-  struct ndn_NameComponent nameComponents[100];
-  NameLite nameLite
-    (nameComponents, sizeof(nameComponents) / sizeof(nameComponents[0]));
+  size_t endOffset = decoder.readNestedTlvsStart
+    (ndn_Tlv_ValidityPeriod_ValidityPeriod);
+
+  MillisecondsSince1970 notBefore = readIsoStringTlv
+    (ndn_Tlv_ValidityPeriod_NotBefore, decoder);
+  MillisecondsSince1970 notAfter = readIsoStringTlv
+    (ndn_Tlv_ValidityPeriod_NotAfter, decoder);
+  validityPeriod.setPeriod(notBefore, notAfter);
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+/**
+ * Get the Data packet's signature to decode into. If it is already a T, then
+ * clear and reuse it. Otherwise replace it with a new T.
+ */
+template<class T> static T&
+resetSignature(Data& data)
+{
+  T* signature = dynamic_cast<T*>(data.getSignature());
+  if (signature)
+    signature->clear();
+  else {
+    data.setSignature(T());
+    signature = (T*)data.getSignature();
+  }
+
+  return *signature;
+}
+
+/**
+ * Set the signature to a new T to decode into.
+ */
+template<class T> static T&
+resetSignature(ptr_lib::shared_ptr<Signature>& signature)
+{
+  T* result = new T();
+  signature.reset(result);
+  return *result;
+}
+
+/**
+ * Decode the SignatureInfo into a signature object of the class for the
+ * decoded signature type.
+ * @param holder The Data packet or shared_ptr<Signature> which receives the
+ * signature object. See resetSignature.
+ * @param decoder The TlvDecoder positioned at the SignatureInfo.
+ */
+template<class Holder> static void
+decodeSignatureInfo(Holder& holder, TlvDecoder& decoder)
+{
+  size_t beginOffset = decoder.offset;
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_SignatureInfo);
+  uint64_t signatureType = decoder.readNonNegativeIntegerTlv
+    (ndn_Tlv_SignatureType);
+
+  if (signatureType == ndn_Tlv_SignatureType_SignatureSha256WithRsa ||
+      signatureType == ndn_Tlv_SignatureType_SignatureSha256WithEcdsa) {
+    KeyLocator* keyLocator;
+    ValidityPeriod* validityPeriod;
+    if (signatureType == ndn_Tlv_SignatureType_SignatureSha256WithRsa) {
+      Sha256WithRsaSignature& signature =
+        resetSignature<Sha256WithRsaSignature>(holder);
+      keyLocator = &signature.getKeyLocator();
+      validityPeriod = &signature.getValidityPeriod();
+    }
+    else {
+      Sha256WithEcdsaSignature& signature =
+        resetSignature<Sha256WithEcdsaSignature>(holder);
+      keyLocator = &signature.getKeyLocator();
+      validityPeriod = &signature.getValidityPeriod();
+    }
+
+    decodeKeyLocator(ndn_Tlv_KeyLocator, *keyLocator, decoder);
+    if (decoder.peekType(ndn_Tlv_ValidityPeriod_ValidityPeriod, endOffset))
+      decodeValidityPeriod(*validityPeriod, decoder);
+  }
+  else if (signatureType == ndn_Tlv_SignatureType_SignatureHmacWithSha256) {
+    HmacWithSha256Signature& signature =
+      resetSignature<HmacWithSha256Signature>(holder);
+    // HmacWithSha256Signature doesn't keep a ValidityPeriod, so
+    // finishNestedTlvs will skip it.
+    decodeKeyLocator(ndn_Tlv_KeyLocator, signature.getKeyLocator(), decoder);
+  }
+  else if (signatureType == ndn_Tlv_SignatureType_DigestSha256)
+    resetSignature<DigestSha256Signature>(holder);
+  else {
+    // Get the bytes of the SignatureInfo TLV.
+    resetSignature<GenericSignature>(holder).setSignatureInfoEncoding
+      (copyBlob(decoder.getSlice(beginOffset, endOffset)), (int)signatureType);
+  }
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+static void
+decodeMetaInfo(MetaInfo& metaInfo, TlvDecoder& decoder)
+{
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_MetaInfo);
+
+  int type = decoder.readOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_ContentType, endOffset);
+  if (type < 0 || type == ndn_ContentType_BLOB)
+    // Default to BLOB if the value is omitted.
+    metaInfo.setType(ndn_ContentType_BLOB);
+  else if (type == ndn_ContentType_LINK ||
+           type == ndn_ContentType_KEY ||
+           type == ndn_ContentType_NACK)
+    // The ContentType enum is set up with the correct integer for each
+    // NDN-TLV ContentType.
+    metaInfo.setType((ndn_ContentType)type);
+  else {
+    // Unrecognized content type.
+    metaInfo.setType(ndn_ContentType_OTHER_CODE);
+    metaInfo.setOtherTypeCode(type);
+  }
+
+  metaInfo.setFreshnessPeriod(decoder.readOptionalNonNegativeIntegerTlvAsDouble
+    (ndn_Tlv_FreshnessPeriod, endOffset));
+
+  if (decoder.peekType(ndn_Tlv_FinalBlockId, endOffset)) {
+    size_t finalBlockIdEndOffset = decoder.readNestedTlvsStart
+      (ndn_Tlv_FinalBlockId);
+    metaInfo.setFinalBlockId(decodeNameComponent(decoder));
+    decoder.finishNestedTlvs(finalBlockIdEndOffset);
+  }
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+static void
+decodeExclude(Exclude& exclude, TlvDecoder& decoder)
+{
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_Exclude);
+
+  exclude.clear();
+  while (decoder.offset < endOffset) {
+    if (decoder.peekType(ndn_Tlv_Any, endOffset)) {
+      // Read past the Any TLV.
+      decoder.readBooleanTlv(ndn_Tlv_Any, endOffset);
+      exclude.appendAny();
+    }
+    else
+      exclude.appendComponent(decodeNameComponent(decoder));
+  }
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+static void
+decodeSelectors(Interest& interest, TlvDecoder& decoder)
+{
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_Selectors);
+
+  interest.setMinSuffixComponents(decoder.readOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_MinSuffixComponents, endOffset));
+  interest.setMaxSuffixComponents(decoder.readOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_MaxSuffixComponents, endOffset));
+
+  if (decoder.peekType(ndn_Tlv_PublisherPublicKeyLocator, endOffset))
+    decodeKeyLocator
+      (ndn_Tlv_PublisherPublicKeyLocator, interest.getKeyLocator(), decoder);
+  else
+    interest.getKeyLocator().clear();
+
+  if (decoder.peekType(ndn_Tlv_Exclude, endOffset))
+    decodeExclude(interest.getExclude(), decoder);
+  else
+    interest.getExclude().clear();
+
+  interest.setChildSelector(decoder.readOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_ChildSelector, endOffset));
+  interest.setMustBeFresh(decoder.readBooleanTlv(ndn_Tlv_MustBeFresh, endOffset));
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+/**
+ * Decode the Interest packet fields. This is shared by
+ * Tlv0_2WireFormat::decodeInterest and LazyInterestSelectors::decodeInterest.
+ * @param interest The Interest to update.
+ * @param signedPortionBeginOffset Return the offset in the encoding of the
+ * beginning of the signed portion.
+ * @param signedPortionEndOffset Return the offset in the encoding of the end
+ * of the signed portion.
+ * @param selectorsBeginOffset If not null and the Interest has Selectors, then
+ * don't decode them but set *selectorsBeginOffset to the offset of the
+ * Selectors TLV. Otherwise set it to (size_t)-1.
+ * @param decoder The TlvDecoder positioned at the Interest.
+ * @param wireFormat The wire format for the Link wire encoding.
+ */
+static void
+decodeInterestFields
+  (Interest& interest, size_t *signedPortionBeginOffset,
+   size_t *signedPortionEndOffset, size_t *selectorsBeginOffset,
+   TlvDecoder& decoder, WireFormat& wireFormat)
+{
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_Interest);
+  decodeName
+    (interest.getName(), signedPortionBeginOffset, signedPortionEndOffset,
+     decoder);
+  if (selectorsBeginOffset)
+    *selectorsBeginOffset = (size_t)-1;
+  if (decoder.peekType(ndn_Tlv_Selectors, endOffset)) {
+    if (selectorsBeginOffset) {
+      // Skip the Selectors to decode later.
+      *selectorsBeginOffset = decoder.offset;
+      decoder.seek(decoder.readNestedTlvsStart(ndn_Tlv_Selectors));
+    }
+    else
+      decodeSelectors(interest, decoder);
+  }
+  else {
+    // Set selectors to none.
+    interest.setMinSuffixComponents(-1);
+    interest.setMaxSuffixComponents(-1);
+    interest.getKeyLocator().clear();
+    interest.getExclude().clear();
+    interest.setChildSelector(-1);
+    interest.setMustBeFresh(true);
+  }
+
+  // Require a Nonce, but don't force it to be 4 bytes.
+  Blob nonce(copyBlob(decoder.readBlobTlv(ndn_Tlv_Nonce)));
+  interest.setInterestLifetimeMilliseconds
+    (decoder.readOptionalNonNegativeIntegerTlvAsDouble
+     (ndn_Tlv_InterestLifetime, endOffset));
+
+  if (decoder.peekType(ndn_Tlv_Data, endOffset)) {
+    // Get the bytes of the Link TLV.
+    size_t linkBeginOffset = decoder.offset;
+    size_t linkEndOffset = decoder.readNestedTlvsStart(ndn_Tlv_Data);
+    decoder.seek(linkEndOffset);
+
+    interest.setLinkWireEncoding
+      (copyBlob(decoder.getSlice(linkBeginOffset, linkEndOffset)), wireFormat);
+  }
+  else
+    interest.unsetLink();
+
+  int selectedDelegationIndex = decoder.readOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_SelectedDelegation, endOffset);
+  if (selectedDelegationIndex >= 0 && !interest.hasLink())
+    throw runtime_error(ndn_getErrorString
+      (NDN_ERROR_Interest_has_a_selected_delegation_but_no_link_object));
+  interest.setSelectedDelegationIndex(selectedDelegationIndex);
+
+  // Set the nonce last because setting other interest fields clears it.
+  interest.setNonce(nonce);
+
+  decoder.finishNestedTlvs(endOffset);
+}
 
+static void
+prependNameComponent
+  (const Name::Component& component, TlvPrependEncoder& encoder)
+{
+  encoder.prependBlobTlv
+    (component.isImplicitSha256Digest() ?
+       ndn_Tlv_ImplicitSha256DigestComponent : ndn_Tlv_NameComponent,
+     component.getValue());
+}
+
+/**
+ * Prepend the NDN-TLV encoding of the name.
+ * @param name The Name to encode.
+ * @param signedPortionBeginMark Set to the encoder length at the beginning of
+ * the signed portion. The signed portion starts from the first name component
+ * and ends just before the final name component (which is assumed to be a
+ * signature for a signed interest). To get the offset in the final encoding,
+ * subtract this from the final encoding length.
+ * @param signedPortionEndMark Set to the encoder length at the end of the
+ * signed portion.
+ * @param encoder The TlvPrependEncoder to receive the encoding.
+ */
+static void
+prependName
+  (const Name& name, size_t *signedPortionBeginMark,
+   size_t *signedPortionEndMark, TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  // Prepend the components in reverse order.
+  for (int i = (int)name.size() - 1; i >= 0; --i) {
+    prependNameComponent(name.get(i), encoder);
+    if (i == (int)name.size() - 1)
+      // We just prepended the final component.
+      *signedPortionEndMark = encoder.getLength();
+  }
+
+  *signedPortionBeginMark = encoder.getLength();
+  if (name.size() == 0)
+    // There is no "final component", so set signedPortionEndMark arbitrarily.
+    *signedPortionEndMark = *signedPortionBeginMark;
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_Name, mark);
+}
+
+/**
+ * Estimate the length of the NDN-TLV encoding of the name, allowing for the
+ * type and length of each component. This is used as a size hint so that the
+ * encoder allocates its buffer only once.
+ * @param name The Name.
+ * @return The estimated length, which is at least the encoding length unless a
+ * component is longer than 0xffff bytes.
+ */
+static size_t
+estimateNameEncodingLength(const Name& name)
+{
+  size_t length = 4;
+  for (size_t i = 0; i < name.size(); ++i)
+    length += name.get(i).getValue().size() + 4;
+
+  return length;
+}
+
+/**
+ * Prepend the KeyLocator TLV.
+ * @param type The TLV type, e.g. ndn_Tlv_KeyLocator.
+ * @param keyLocator The KeyLocator to encode.
+ * @param omitZeroLength If true and the KeyLocator type is none, don't prepend
+ * anything.
+ * @param encoder The TlvPrependEncoder to receive the encoding.
+ */
+static void
+prependKeyLocator
+  (unsigned int type, const KeyLocator& keyLocator, bool omitZeroLength,
+   TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  if ((int)keyLocator.getType() >= 0) {
+    if (keyLocator.getType() == ndn_KeyLocatorType_KEYNAME) {
+      size_t dummyBeginMark, dummyEndMark;
+      prependName
+        (keyLocator.getKeyName(), &dummyBeginMark, &dummyEndMark, encoder);
+    }
+    else if (keyLocator.getType() == ndn_KeyLocatorType_KEY_LOCATOR_DIGEST &&
+             keyLocator.getKeyData().size() > 0)
+      encoder.prependBlobTlv(ndn_Tlv_KeyLocatorDigest, keyLocator.getKeyData());
+    else
+      throw runtime_error
+        (ndn_getErrorString(NDN_ERROR_unrecognized_ndn_KeyLocatorType));
+  }
+
+  encoder.prependNestedTlvHeader(type, mark, omitZeroLength);
+}
+
+static void
+prependIsoStringTlv
+  (unsigned int type, MillisecondsSince1970 milliseconds,
+   TlvPrependEncoder& encoder)
+{
+  char isoString[23];
   ndn_Error error;
-  size_t dummyBeginOffset, dummyEndOffset;
-  if ((error = Tlv0_2WireFormatLite::decodeName
-       (nameLite, input, inputLength, &dummyBeginOffset, &dummyEndOffset)))
+  if ((error = ndn_toIsoString(milliseconds, 0, isoString)))
     throw runtime_error(ndn_getErrorString(error));
 
-  name.set(nameLite);
+  size_t isoStringLength = ::strlen(isoString);
+  if (isoStringLength > 0)
+    encoder.prependBlobTlv(type, (const uint8_t *)isoString, isoStringLength);
+}
+
+static void
+prependValidityPeriod
+  (const ValidityPeriod& validityPeriod, TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  prependIsoStringTlv
+    (ndn_Tlv_ValidityPeriod_NotAfter, validityPeriod.getNotAfter(), encoder);
+  prependIsoStringTlv
+    (ndn_Tlv_ValidityPeriod_NotBefore, validityPeriod.getNotBefore(), encoder);
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_ValidityPeriod_ValidityPeriod, mark);
+}
+
+/**
+ * Prepend the SignatureInfo for a signature type which has a KeyLocator and
+ * optional ValidityPeriod, e.g. SignatureSha256WithRsa.
+ * @param signatureType The NDN-TLV signature type.
+ * @param keyLocator The signature's KeyLocator.
+ * @param validityPeriod The signature's ValidityPeriod, or 0 if the signature
+ * type doesn't have a ValidityPeriod.
+ * @param encoder The TlvPrependEncoder to receive the encoding.
+ */
+static void
+prependSignatureInfoWithKeyLocator
+  (unsigned int signatureType, const KeyLocator& keyLocator,
+   const ValidityPeriod* validityPeriod, TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  if (validityPeriod && validityPeriod->hasPeriod())
+    prependValidityPeriod(*validityPeriod, encoder);
+  prependKeyLocator(ndn_Tlv_KeyLocator, keyLocator, false, encoder);
+  encoder.prependNonNegativeIntegerTlv(ndn_Tlv_SignatureType, signatureType);
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_SignatureInfo, mark);
+}
+
+static void
+prependSignatureInfo(const Signature& signature, TlvPrependEncoder& encoder)
+{
+  if (const GenericSignature* genericSignature =
+      dynamic_cast<const GenericSignature*>(&signature)) {
+    // Handle a Generic signature separately since it has the entire encoding.
+    const Blob& encoding = genericSignature->getSignatureInfoEncoding();
+
+    // Do a test decoding to sanity check that it is valid TLV.
+    try {
+      TlvDecoder decoder(encoding.buf(), encoding.size());
+      size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_SignatureInfo);
+      decoder.readNonNegativeIntegerTlv(ndn_Tlv_SignatureType);
+      decoder.finishNestedTlvs(endOffset);
+    } catch (const runtime_error&) {
+      throw runtime_error(ndn_getErrorString
+        (NDN_ERROR_The_Generic_signature_encoding_is_not_a_valid_NDN_TLV_SignatureInfo));
+    }
+
+    encoder.prependArray(encoding.buf(), encoding.size());
+  }
+  else if (const Sha256WithRsaSignature* rsaSignature =
+           dynamic_cast<const Sha256WithRsaSignature*>(&signature))
+    prependSignatureInfoWithKeyLocator
+      (ndn_Tlv_SignatureType_SignatureSha256WithRsa,
+       rsaSignature->getKeyLocator(), &rsaSignature->getValidityPeriod(),
+       encoder);
+  else if (const Sha256WithEcdsaSignature* ecdsaSignature =
+           dynamic_cast<const Sha256WithEcdsaSignature*>(&signature))
+    prependSignatureInfoWithKeyLocator
+      (ndn_Tlv_SignatureType_SignatureSha256WithEcdsa,
+       ecdsaSignature->getKeyLocator(), &ecdsaSignature->getValidityPeriod(),
+       encoder);
+  else if (const HmacWithSha256Signature* hmacSignature =
+           dynamic_cast<const HmacWithSha256Signature*>(&signature))
+    prependSignatureInfoWithKeyLocator
+      (ndn_Tlv_SignatureType_SignatureHmacWithSha256,
+       hmacSignature->getKeyLocator(), 0, encoder);
+  else if (dynamic_cast<const DigestSha256Signature*>(&signature)) {
+    size_t mark = encoder.getLength();
+    encoder.prependNonNegativeIntegerTlv
+      (ndn_Tlv_SignatureType, ndn_Tlv_SignatureType_DigestSha256);
+    encoder.prependNestedTlvHeader(ndn_Tlv_SignatureInfo, mark);
+  }
+  else
+    throw runtime_error(ndn_getErrorString
+      (NDN_ERROR_encodeSignatureInfo_unrecognized_SignatureType));
+}
+
+static void
+prependMetaInfo(const MetaInfo& metaInfo, TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  if (metaInfo.getFinalBlockId().getValue().size() > 0) {
+    // The FinalBlockId has an inner NameComponent.
+    size_t finalBlockIdMark = encoder.getLength();
+    prependNameComponent(metaInfo.getFinalBlockId(), encoder);
+    encoder.prependNestedTlvHeader(ndn_Tlv_FinalBlockId, finalBlockIdMark);
+  }
+  encoder.prependOptionalNonNegativeIntegerTlvFromDouble
+    (ndn_Tlv_FreshnessPeriod, metaInfo.getFreshnessPeriod());
+
+  if (!((int)metaInfo.getType() < 0 ||
+        metaInfo.getType() == ndn_ContentType_BLOB)) {
+    // Not the default, so we need to encode the type.
+    if (metaInfo.getType() == ndn_ContentType_LINK ||
+        metaInfo.getType() == ndn_ContentType_KEY ||
+        metaInfo.getType() == ndn_ContentType_NACK)
+      // The ContentType enum is set up with the correct integer for each
+      // NDN-TLV ContentType.
+      encoder.prependNonNegativeIntegerTlv
+        (ndn_Tlv_ContentType, metaInfo.getType());
+    else if (metaInfo.getType() == ndn_ContentType_OTHER_CODE)
+      encoder.prependNonNegativeIntegerTlv
+        (ndn_Tlv_ContentType, metaInfo.getOtherTypeCode());
+    else
+      // We don't expect this to happen.
+      throw runtime_error
+        (ndn_getErrorString(NDN_ERROR_unrecognized_ndn_ContentType));
+  }
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_MetaInfo, mark);
+}
+
+static void
+prependExclude(const Exclude& exclude, TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  // Prepend the entries in reverse order.
+  for (int i = (int)exclude.size() - 1; i >= 0; --i) {
+    const Exclude::Entry& entry = exclude.get(i);
+
+    if (entry.getType() == ndn_Exclude_COMPONENT)
+      prependNameComponent(entry.getComponent(), encoder);
+    else if (entry.getType() == ndn_Exclude_ANY)
+      encoder.prependTypeAndLength(ndn_Tlv_Any, 0);
+    else
+      throw runtime_error
+        (ndn_getErrorString(NDN_ERROR_unrecognized_ndn_ExcludeType));
+  }
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_Exclude, mark);
+}
+
+static void
+prependSelectors(const Interest& interest, TlvPrependEncoder& encoder)
+{
+  size_t mark = encoder.getLength();
+
+  if (interest.getMustBeFresh())
+    encoder.prependTypeAndLength(ndn_Tlv_MustBeFresh, 0);
+  // else MustBeFresh == false, so nothing to encode.
+  encoder.prependOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_ChildSelector, interest.getChildSelector());
+  if (interest.getExclude().size() > 0)
+    prependExclude(interest.getExclude(), encoder);
+  prependKeyLocator
+    (ndn_Tlv_PublisherPublicKeyLocator, interest.getKeyLocator(), true,
+     encoder);
+  encoder.prependOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_MaxSuffixComponents, interest.getMaxSuffixComponents());
+  encoder.prependOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_MinSuffixComponents, interest.getMinSuffixComponents());
+
+  // Omit the Selectors if there are none.
+  encoder.prependNestedTlvHeader(ndn_Tlv_Selectors, mark, true);
+}
+
+Blob
+Tlv0_2WireFormat::encodeName(const Name& name)
+{
+  TlvPrependEncoder encoder(estimateNameEncodingLength(name));
+  size_t dummyBeginMark, dummyEndMark;
+  prependName(name, &dummyBeginMark, &dummyEndMark, encoder);
+
+  return encoder.finish();
+}
+
+void
+Tlv0_2WireFormat::decodeName
+  (Name& name, const uint8_t *input, size_t inputLength)
+{
+  TlvDecoder decoder(input, inputLength);
+  size_t dummyBeginOffset, dummyEndOffset;
+  ::ndn::decodeName(name, &dummyBeginOffset, &dummyEndOffset, decoder);
 }
 
 Blob
@@ -80,24 +705,54 @@ Tlv0_2WireFormat::encodeInterest
   (const Interest& interest, size_t *signedPortionBeginOffset,
    size_t *signedPortionEndOffset)
 {
-  struct ndn_NameComponent nameComponents[100];
-  struct ndn_ExcludeEntry excludeEntries[100];
-  struct ndn_NameComponent keyNameComponents[100];
-  InterestLite interestLite
-    (nameComponents, sizeof(nameComponents) / sizeof(nameComponents[0]),
-     excludeEntries, sizeof(excludeEntries) / sizeof(excludeEntries[0]),
-     keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
-  interest.get(interestLite, *this);
+  // Allow for the Selectors, Nonce and InterestLifetime. A large Exclude or a
+  // Link will grow the buffer.
+  TlvPrependEncoder encoder
+    (estimateNameEncodingLength(interest.getName()) + 64);
 
-  DynamicUInt8Vector output(256);
-  ndn_Error error;
-  size_t encodingLength;
-  if ((error = Tlv0_2WireFormatLite::encodeInterest
-       (interestLite, signedPortionBeginOffset, signedPortionEndOffset,
-        DynamicUInt8ArrayLite::downCast(output), &encodingLength)))
-    throw runtime_error(ndn_getErrorString(error));
+  // Prepend the fields in reverse order.
+  encoder.prependOptionalNonNegativeIntegerTlv
+    (ndn_Tlv_SelectedDelegation, interest.getSelectedDelegationIndex());
+  Blob linkWireEncoding;
+  try {
+    linkWireEncoding = interest.getLinkWireEncoding(*this);
+  } catch (...) {
+    // Can't encode the link object.
+  }
+  if (linkWireEncoding.buf())
+    // Encode the entire link as is.
+    encoder.prependArray(linkWireEncoding.buf(), linkWireEncoding.size());
 
-  return output.finish(encodingLength);
+  encoder.prependOptionalNonNegativeIntegerTlvFromDouble
+    (ndn_Tlv_InterestLifetime, interest.getInterestLifetimeMilliseconds());
+
+  // The Nonce must be exactly 4 bytes. If it is shorter (or empty), fill the
+  // remaining bytes with random values. If it is longer, truncate it.
+  uint8_t nonce[4];
+  const Blob& interestNonce = interest.getNonce();
+  size_t nonceLength = interestNonce.size() < sizeof(nonce) ?
+    interestNonce.size() : sizeof(nonce);
+  if (nonceLength > 0)
+    ::memcpy(nonce, interestNonce.buf(), nonceLength);
+  if (nonceLength < sizeof(nonce)) {
+    ndn_Error error;
+    if ((error = CryptoLite::generateRandomBytes
+         (nonce + nonceLength, sizeof(nonce) - nonceLength)))
+      throw runtime_error(ndn_getErrorString(error));
+  }
+  encoder.prependBlobTlv(ndn_Tlv_Nonce, nonce, sizeof(nonce));
+
+  prependSelectors(interest, encoder);
+  size_t signedPortionBeginMark, signedPortionEndMark;
+  prependName
+    (interest.getName(), &signedPortionBeginMark, &signedPortionEndMark,
+     encoder);
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_Interest, 0);
+
+  *signedPortionBeginOffset = encoder.getLength() - signedPortionBeginMark;
+  *signedPortionEndOffset = encoder.getLength() - signedPortionEndMark;
+  return encoder.finish();
 }
 
 void
@@ -105,61 +760,67 @@ Tlv0_2WireFormat::decodeInterest
   (Interest& interest, const uint8_t *input, size_t inputLength,
    size_t *signedPortionBeginOffset, size_t *signedPortionEndOffset)
 {
-  struct ndn_NameComponent nameComponents[100];
-  struct ndn_ExcludeEntry excludeEntries[100];
-  struct ndn_NameComponent keyNameComponents[100];
-  InterestLite interestLite
-    (nameComponents, sizeof(nameComponents) / sizeof(nameComponents[0]),
-     excludeEntries, sizeof(excludeEntries) / sizeof(excludeEntries[0]),
-     keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
-
-  ndn_Error error;
-  if ((error = Tlv0_2WireFormatLite::decodeInterest
-       (interestLite, input, inputLength, signedPortionBeginOffset,
-        signedPortionEndOffset)))
-    throw runtime_error(ndn_getErrorString(error));
-
-  interest.set(interestLite, *this);
+  TlvDecoder decoder(input, inputLength);
+  decodeInterestFields
+    (interest, signedPortionBeginOffset, signedPortionEndOffset, 0, decoder,
+     *this);
 }
 
 Blob
-Tlv0_2WireFormat::encodeData(const Data& data, size_t *signedPortionBeginOffset, size_t *signedPortionEndOffset)
+Tlv0_2WireFormat::encodeData
+  (const Data& data, size_t *signedPortionBeginOffset,
+   size_t *signedPortionEndOffset)
 {
-  struct ndn_NameComponent nameComponents[100];
-  struct ndn_NameComponent keyNameComponents[100];
-  DataLite dataLite
-    (nameComponents, sizeof(nameComponents) / sizeof(nameComponents[0]),
-     keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
-  data.get(dataLite);
+  // Allow 256 bytes for the SignatureInfo with its KeyLocator name, the
+  // MetaInfo and the TLV headers.
+  TlvPrependEncoder encoder
+    (estimateNameEncodingLength(data.getName()) + data.getContent().size() +
+     data.getSignature()->getSignature().size() + 256);
 
-  DynamicUInt8Vector output(1500);
-  ndn_Error error;
-  size_t encodingLength;
-  if ((error = Tlv0_2WireFormatLite::encodeData
-       (dataLite, signedPortionBeginOffset, signedPortionEndOffset,
-        DynamicUInt8ArrayLite::downCast(output), &encodingLength)))
-    throw runtime_error(ndn_getErrorString(error));
+  // Prepend the fields in reverse order.
+  encoder.prependBlobTlv
+    (ndn_Tlv_SignatureValue, data.getSignature()->getSignature());
+  size_t signedPortionEndMark = encoder.getLength();
 
-  return output.finish(encodingLength);
+  prependSignatureInfo(*data.getSignature(), encoder);
+  encoder.prependBlobTlv(ndn_Tlv_Content, data.getContent());
+  prependMetaInfo(data.getMetaInfo(), encoder);
+  size_t dummyBeginMark, dummyEndMark;
+  prependName(data.getName(), &dummyBeginMark, &dummyEndMark, encoder);
+  size_t signedPortionBeginMark = encoder.getLength();
+
+  encoder.prependNestedTlvHeader(ndn_Tlv_Data, 0);
+
+  *signedPortionBeginOffset = encoder.getLength() - signedPortionBeginMark;
+  *signedPortionEndOffset = encoder.getLength() - signedPortionEndMark;
+  return encoder.finish();
 }
 
 void
 Tlv0_2WireFormat::decodeData
-  (Data& data, const uint8_t *input, size_t inputLength, size_t *signedPortionBeginOffset, size_t *signedPortionEndOffset)
+  (Data& data, const uint8_t *input, size_t inputLength,
+   size_t *signedPortionBeginOffset, size_t *signedPortionEndOffset)
 {
-  struct ndn_NameComponent nameComponents[100];
-  struct ndn_NameComponent keyNameComponents[100];
-  DataLite dataLite
-    (nameComponents, sizeof(nameComponents) / sizeof(nameComponents[0]),
-     keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
+  TlvDecoder decoder(input, inputLength);
 
-  ndn_Error error;
-  if ((error = Tlv0_2WireFormatLite::decodeData
-       (dataLite, input, inputLength, signedPortionBeginOffset,
-        signedPortionEndOffset)))
-    throw runtime_error(ndn_getErrorString(error));
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_Data);
+  *signedPortionBeginOffset = decoder.offset;
+
+  size_t dummyBeginOffset, dummyEndOffset;
+  ::ndn::decodeName(data.getName(), &dummyBeginOffset, &dummyEndOffset, decoder);
+  // Decode into a new MetaInfo so that fields not used by NDN-TLV are none.
+  MetaInfo metaInfo;
+  decodeMetaInfo(metaInfo, decoder);
+  data.setMetaInfo(metaInfo);
+  data.setContent(copyBlob(decoder.readBlobTlv(ndn_Tlv_Content)));
+  decodeSignatureInfo(data, decoder);
+
+  *signedPortionEndOffset = decoder.offset;
 
-  data.set(dataLite);
+  data.getSignature()->setSignature
+    (copyBlob(decoder.readBlobTlv(ndn_Tlv_SignatureValue)));
+
+  decoder.finishNestedTlvs(endOffset);
 }
 
 Blob
@@ -250,37 +911,19 @@ Tlv0_2WireFormat::decodeControlResponse
 Blob
 Tlv0_2WireFormat::encodeSignatureInfo(const Signature& signature)
 {
-  struct ndn_NameComponent keyNameComponents[100];
-  SignatureLite signatureLite
-    (keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
-  signature.get(signatureLite);
+  TlvPrependEncoder encoder(256);
+  prependSignatureInfo(signature, encoder);
 
-  DynamicUInt8Vector output(256);
-  ndn_Error error;
-  size_t encodingLength;
-  if ((error = Tlv0_2WireFormatLite::encodeSignatureInfo
-       (signatureLite, DynamicUInt8ArrayLite::downCast(output), &encodingLength)))
-    throw runtime_error(ndn_getErrorString(error));
-
-  return output.finish(encodingLength);
+  return encoder.finish();
 }
 
 Blob
 Tlv0_2WireFormat::encodeSignatureValue(const Signature& signature)
 {
-  struct ndn_NameComponent keyNameComponents[100];
-  SignatureLite signatureLite
-    (keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
-  signature.get(signatureLite);
+  TlvPrependEncoder encoder(signature.getSignature().size() + 8);
+  encoder.prependBlobTlv(ndn_Tlv_SignatureValue, signature.getSignature());
 
-  DynamicUInt8Vector output(300);
-  ndn_Error error;
-  size_t encodingLength;
-  if ((error = Tlv0_2WireFormatLite::encodeSignatureValue
-       (signatureLite, DynamicUInt8ArrayLite::downCast(output), &encodingLength)))
-    throw runtime_error(ndn_getErrorString(error));
-
-  return output.finish(encodingLength);
+  return encoder.finish();
 }
 
 ptr_lib::shared_ptr<Signature>
@@ -288,32 +931,14 @@ Tlv0_2WireFormat::decodeSignatureInfoAndValue
   (const uint8_t *signatureInfo, size_t signatureInfoLength,
    const uint8_t *signatureValue, size_t signatureValueLength)
 {
-  struct ndn_NameComponent keyNameComponents[100];
-  SignatureLite signatureLite
-    (keyNameComponents, sizeof(keyNameComponents) / sizeof(keyNameComponents[0]));
-
-  ndn_Error error;
-  if ((error = Tlv0_2WireFormatLite::decodeSignatureInfoAndValue
-       (signatureLite, signatureInfo, signatureInfoLength, signatureValue,
-        signatureValueLength)))
-    throw runtime_error(ndn_getErrorString(error));
-
   ptr_lib::shared_ptr<Signature> result;
-  if (signatureLite.getType() == ndn_SignatureType_Sha256WithRsaSignature)
-    result.reset(new Sha256WithRsaSignature());
-  else if (signatureLite.getType() == ndn_SignatureType_Sha256WithEcdsaSignature)
-    result.reset(new Sha256WithEcdsaSignature());
-  else if (signatureLite.getType() == ndn_SignatureType_HmacWithSha256Signature)
-    result.reset(new HmacWithSha256Signature());
-  else if (signatureLite.getType() == ndn_SignatureType_DigestSha256Signature)
-    result.reset(new DigestSha256Signature());
-  else if (signatureLite.getType() == ndn_SignatureType_Generic)
-    result.reset(new GenericSignature());
-  else
-    // We don't expect this to happen.
-    throw runtime_error("signatureStruct.type has an unrecognized value");
+  TlvDecoder signatureInfoDecoder(signatureInfo, signatureInfoLength);
+  decodeSignatureInfo(result, signatureInfoDecoder);
+
+  TlvDecoder signatureValueDecoder(signatureValue, signatureValueLength);
+  result->setSignature
+    (copyBlob(signatureValueDecoder.readBlobTlv(ndn_Tlv_SignatureValue)));
 
-  result->set(signatureLite);
   return result;
 }
 
@@ -407,6 +1032,101 @@ Tlv0_2WireFormat::decodeEncryptedContent
   encryptedContent.set(encryptedContentLite);
 }
 
+LazyDataFields::LazyDataFields
+  (const Blob& input, size_t *signedPortionBeginOffset,
+   size_t *signedPortionEndOffset)
+: input_(input)
+{
+  TlvDecoder decoder(input.buf(), input.size());
+
+  size_t endOffset = decoder.readNestedTlvsStart(ndn_Tlv_Data);
+  *signedPortionBeginOffset = decoder.offset;
+
+  // Check the type and length of each field and skip its value.
+  nameBeginOffset_ = decoder.offset;
+  decoder.seek(decoder.readNestedTlvsStart(ndn_Tlv_Name));
+  metaInfoBeginOffset_ = decoder.offset;
+  decoder.seek(decoder.readNestedTlvsStart(ndn_Tlv_MetaInfo));
+  contentValueEndOffset_ = decoder.readNestedTlvsStart(ndn_Tlv_Content);
+  contentValueBeginOffset_ = decoder.offset;
+  decoder.seek(contentValueEndOffset_);
+  signatureInfoBeginOffset_ = decoder.offset;
+  decoder.seek(decoder.readNestedTlvsStart(ndn_Tlv_SignatureInfo));
+
+  *signedPortionEndOffset = decoder.offset;
+
+  signatureValueBeginOffset_ = decoder.offset;
+  decoder.seek(decoder.readNestedTlvsStart(ndn_Tlv_SignatureValue));
+
+  decoder.finishNestedTlvs(endOffset);
+}
+
+void
+LazyDataFields::decodeName(Name& name) const
+{
+  TlvDecoder decoder(input_.buf(), input_.size());
+  decoder.seek(nameBeginOffset_);
+  size_t dummyBeginOffset, dummyEndOffset;
+  ::ndn::decodeName(name, &dummyBeginOffset, &dummyEndOffset, decoder);
+}
+
+void
+LazyDataFields::decodeMetaInfo(MetaInfo& metaInfo) const
+{
+  TlvDecoder decoder(input_.buf(), input_.size());
+  decoder.seek(metaInfoBeginOffset_);
+  ::ndn::decodeMetaInfo(metaInfo, decoder);
+}
+
+Blob
+LazyDataFields::decodeContent() const
+{
+  return Blob(ptr_lib::make_shared<vector<uint8_t> >
+    (input_.buf() + contentValueBeginOffset_,
+     input_.buf() + contentValueEndOffset_), false);
+}
+
+ptr_lib::shared_ptr<Signature>
+LazyDataFields::decodeSignature() const
+{
+  ptr_lib::shared_ptr<Signature> result;
+  TlvDecoder decoder(input_.buf(), input_.size());
+  decoder.seek(signatureInfoBeginOffset_);
+  decodeSignatureInfo(result, decoder);
+
+  decoder.seek(signatureValueBeginOffset_);
+  result->setSignature(copyBlob(decoder.readBlobTlv(ndn_Tlv_SignatureValue)));
+
+  return result;
+}
+
+ptr_lib::shared_ptr<LazyInterestSelectors>
+LazyInterestSelectors::decodeInterest
+  (Interest& interest, const Blob& input, size_t *signedPortionBeginOffset,
+   size_t *signedPortionEndOffset, WireFormat& wireFormat)
+{
+  TlvDecoder decoder(input.buf(), input.size());
+  size_t selectorsBeginOffset;
+  decodeInterestFields
+    (interest, signedPortionBeginOffset, signedPortionEndOffset,
+     &selectorsBeginOffset, decoder, wireFormat);
+
+  if (selectorsBeginOffset == (size_t)-1)
+    return ptr_lib::shared_ptr<LazyInterestSelectors>();
+  else
+    return ptr_lib::shared_ptr<LazyInterestSelectors>
+      (new LazyInterestSelectors(input, selectorsBeginOffset));
+}
+
+void
+LazyInterestSelectors::decodeSelectors(Interest& interest) const
+{
+  TlvDecoder decoder(input_.buf(), input_.size());
+  decoder.seek(selectorsBeginOffset_);
+  ::ndn::decodeSelectors(interest, decoder);
+}
+
 Tlv0_2WireFormat* Tlv0_2WireFormat::instance_ = 0;
 
 }
+
@@ -74,6 +74,17 @@ public:
     return gotExpectedType != 0 ? true : false;
   }
 
+  uint64_t
+  readVarNumber()
+  {
+    uint64_t varNumber;
+    ndn_Error error;
+    if ((error = ndn_TlvDecoder_readVarNumber(this, &varNumber)))
+      throw runtime_error(ndn_getErrorString(error));
+
+    return varNumber;
+  }
+
   uint64_t
   readNonNegativeIntegerTlv(unsigned int expectedType)
   {
@@ -86,6 +97,46 @@ public:
     return value;
   }
 
+  /**
+   * Peek at the next TLV, and if it has the expectedType then call
+   * readNonNegativeIntegerTlv and return the integer. Otherwise, return -1.
+   * @param expectedType The expected type.
+   * @param endOffset The offset of the end of the parent TLV.
+   * @return The integer, or -1 if the next TLV doesn't have the expected type.
+   */
+  int
+  readOptionalNonNegativeIntegerTlv(unsigned int expectedType, size_t endOffset)
+  {
+    int value;
+    ndn_Error error;
+    if ((error = ndn_TlvDecoder_readOptionalNonNegativeIntegerTlv
+         (this, expectedType, endOffset, &value)))
+      throw runtime_error(ndn_getErrorString(error));
+
+    return value;
+  }
+
+  /**
+   * Peek at the next TLV, and if it has the expectedType then call
+   * readNonNegativeIntegerTlv and return the integer as a double. Otherwise,
+   * return -1.0.
+   * @param expectedType The expected type.
+   * @param endOffset The offset of the end of the parent TLV.
+   * @return The integer, or -1.0 if the next TLV doesn't have the expected type.
+   */
+  double
+  readOptionalNonNegativeIntegerTlvAsDouble
+    (unsigned int expectedType, size_t endOffset)
+  {
+    double value;
+    ndn_Error error;
+    if ((error = ndn_TlvDecoder_readOptionalNonNegativeIntegerTlvAsDouble
+         (this, expectedType, endOffset, &value)))
+      throw runtime_error(ndn_getErrorString(error));
+
+    return value;
+  }
+
   struct ndn_Blob
   readBlobTlv(unsigned int expectedType)
   {
@@ -108,6 +159,26 @@ public:
 
     return value != 0;
   }
+
+  void
+  seek(size_t offset) { ndn_TlvDecoder_seek(this, offset); }
+
+  /**
+   * Get a slice of the input for the given offset range.
+   * @param beginOffset The offset in the input of the beginning of the slice.
+   * @param endOffset The offset in the input of the end of the slice.
+   * @return The ndn_Blob with a pointer into the input buffer (not a copy).
+   */
+  struct ndn_Blob
+  getSlice(size_t beginOffset, size_t endOffset)
+  {
+    struct ndn_Blob slice;
+    ndn_Error error;
+    if ((error = ndn_TlvDecoder_getSlice(this, beginOffset, endOffset, &slice)))
+      throw runtime_error(ndn_getErrorString(error));
+
+    return slice;
+  }
 };
 
 }
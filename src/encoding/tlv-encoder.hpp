@@ -93,6 +93,46 @@ public:
     writeBlobTlv(type, &valueBlob);
   }
 
+  /**
+   * Call writeBlobTlv using the bytes of the Blob.
+   * @param type The type of the TLV.
+   * @param value The Blob with the value. If value.isNull(), write a
+   * zero-length TLV.
+   */
+  void
+  writeBlobTlv(unsigned int type, const Blob& value)
+  {
+    struct ndn_Blob valueBlob;
+    ndn_Blob_initialize(&valueBlob, value.buf(), value.size());
+    writeBlobTlv(type, &valueBlob);
+  }
+
+  /**
+   * If the value is null or empty then do nothing, otherwise call writeBlobTlv.
+   * @param type The type of the TLV.
+   * @param value The Blob with the value.
+   */
+  void
+  writeOptionalBlobTlv(unsigned int type, const Blob& value)
+  {
+    if (value.size() > 0)
+      writeBlobTlv(type, value);
+  }
+
+  /**
+   * Copy the array to the output. Note that this does not encode a type and
+   * length. For that see writeBlobTlv.
+   * @param array The array to copy.
+   * @param arrayLength The length of the array.
+   */
+  void
+  writeArray(const uint8_t *array, size_t arrayLength)
+  {
+    ndn_Error error;
+    if ((error = ndn_TlvEncoder_writeArray(this, array, arrayLength)))
+      throw std::runtime_error(ndn_getErrorString(error));
+  }
+
   void
   writeNonNegativeIntegerTlv(unsigned int type, uint64_t value)
   {
@@ -101,6 +141,24 @@ public:
       throw std::runtime_error(ndn_getErrorString(error));
   }
 
+  void
+  writeOptionalNonNegativeIntegerTlv(unsigned int type, int value)
+  {
+    ndn_Error error;
+    if ((error = ndn_TlvEncoder_writeOptionalNonNegativeIntegerTlv
+         (this, type, value)))
+      throw std::runtime_error(ndn_getErrorString(error));
+  }
+
+  void
+  writeOptionalNonNegativeIntegerTlvFromDouble(unsigned int type, double value)
+  {
+    ndn_Error error;
+    if ((error = ndn_TlvEncoder_writeOptionalNonNegativeIntegerTlvFromDouble
+         (this, type, value)))
+      throw std::runtime_error(ndn_getErrorString(error));
+  }
+
   void
   writeNestedTlv
   (unsigned int type,
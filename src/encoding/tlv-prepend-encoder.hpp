@@ -0,0 +1,325 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_TLV_PREPEND_ENCODER_HPP
+#define NDN_TLV_PREPEND_ENCODER_HPP
+
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <stdexcept>
+#include <ndn-cpp/common.hpp>
+#include <ndn-cpp/util/blob.hpp>
+#include "../c/encoding/tlv/tlv-encoder.h"
+#include "../util/buffer-pool.hpp"
+
+namespace ndn {
+
+/**
+ * A TlvPrependEncoder encodes TLVs from the back of its buffer toward the
+ * front. To encode a TLV with nested TLVs, call getLength() to get a mark,
+ * prepend the nested TLVs in reverse order, then call prependNestedTlvHeader
+ * with the mark. Since the value is already written when the type and length
+ * are prepended, each field is written exactly once no matter how deeply the
+ * TLVs are nested. (In contrast, TlvEncoder::writeNestedTlv calls writeValue
+ * twice at every level of nesting to find the length.)
+ */
+class TlvPrependEncoder {
+public:
+  /**
+   * Create a TlvPrependEncoder with the initial buffer size. The buffer comes
+   * from the BufferPool, so pass an estimate of the final encoding length to
+   * allocate only once. When the buffer is full, it is doubled and the encoded
+   * bytes are copied once to the back of the new buffer.
+   * @param initialLength (optional) The initial size of the buffer. If
+   * omitted, use 16.
+   */
+  TlvPrependEncoder(size_t initialLength = 16)
+  : buffer_(allocateBuffer(initialLength > 0 ? initialLength : 1)),
+    offset_(buffer_->size())
+  {
+  }
+
+  /**
+   * Get the number of bytes encoded so far. This is also used as a mark for
+   * prependNestedTlvHeader and to compute offsets in the final encoding, since
+   * the final offset of a position is finish().size() minus the length at the
+   * time it was written.
+   * @return The number of bytes encoded so far.
+   */
+  size_t
+  getLength() const { return buffer_->size() - offset_; }
+
+  /**
+   * Copy the array to the front of the output. Note that this does not encode
+   * a type and length. For that see prependBlobTlv.
+   * @param array The array to copy.
+   * @param arrayLength The length of the array.
+   */
+  void
+  prependArray(const uint8_t *array, size_t arrayLength)
+  {
+    if (arrayLength > 0)
+      ::memcpy(reserveFront(arrayLength), array, arrayLength);
+  }
+
+  /**
+   * Prepend the VAR-NUMBER encoding of varNumber.
+   * @param varNumber The number to encode.
+   */
+  void
+  prependVarNumber(uint64_t varNumber)
+  {
+    if (varNumber < 253) {
+      *reserveFront(1) = (uint8_t)varNumber;
+      return;
+    }
+
+    size_t valueLength;
+    uint8_t firstOctet;
+    if (varNumber <= 0xffff) {
+      valueLength = 2;
+      firstOctet = 253;
+    }
+    else if (varNumber <= 0xffffffff) {
+      valueLength = 4;
+      firstOctet = 254;
+    }
+    else {
+      valueLength = 8;
+      firstOctet = 255;
+    }
+
+    uint8_t* front = reserveFront(1 + valueLength);
+    *front = firstOctet;
+    writeBigEndian(front + 1, valueLength, varNumber);
+  }
+
+  /**
+   * Prepend the type and length. Since the bytes are prepended, call this
+   * after prepending the value.
+   * @param type The type of the TLV.
+   * @param length The length of the TLV value.
+   */
+  void
+  prependTypeAndLength(unsigned int type, size_t length)
+  {
+    prependVarNumber((uint64_t)length);
+    prependVarNumber((uint64_t)type);
+  }
+
+  /**
+   * Prepend the type and the length of all the bytes that were prepended since
+   * getLength() returned mark. This finishes a TLV whose nested TLVs have
+   * already been prepended.
+   * @param type The type of the TLV.
+   * @param mark The value of getLength() before prepending the nested TLVs.
+   * @param omitZeroLength (optional) If true and nothing was prepended since
+   * the mark, then don't prepend anything. If omitted, use false.
+   */
+  void
+  prependNestedTlvHeader
+    (unsigned int type, size_t mark, bool omitZeroLength = false)
+  {
+    size_t valueLength = getLength() - mark;
+    if (omitZeroLength && valueLength == 0)
+      return;
+
+    prependTypeAndLength(type, valueLength);
+  }
+
+  /**
+   * Prepend the encoding of the non-negative integer, using the fewest bytes.
+   * This does not prepend a type and length.
+   * @param value The integer to encode.
+   */
+  void
+  prependNonNegativeInteger(uint64_t value)
+  {
+    size_t valueLength = ndn_TlvEncoder_sizeOfNonNegativeInteger(value);
+    writeBigEndian(reserveFront(valueLength), valueLength, value);
+  }
+
+  void
+  prependNonNegativeIntegerTlv(unsigned int type, uint64_t value)
+  {
+    size_t mark = getLength();
+    prependNonNegativeInteger(value);
+    prependNestedTlvHeader(type, mark);
+  }
+
+  /**
+   * If value is negative then do nothing, otherwise call
+   * prependNonNegativeIntegerTlv.
+   * @param type The type of the TLV.
+   * @param value Negative for none, otherwise use (uint64_t)value.
+   */
+  void
+  prependOptionalNonNegativeIntegerTlv(unsigned int type, int value)
+  {
+    if (value >= 0)
+      prependNonNegativeIntegerTlv(type, (uint64_t)value);
+  }
+
+  /**
+   * If value is negative then do nothing, otherwise round value to uint64_t
+   * and call prependNonNegativeIntegerTlv.
+   * @param type The type of the TLV.
+   * @param value Negative for none, otherwise use (uint64_t)round(value).
+   */
+  void
+  prependOptionalNonNegativeIntegerTlvFromDouble(unsigned int type, double value)
+  {
+    if (value >= 0.0)
+      prependNonNegativeIntegerTlv(type, (uint64_t)round(value));
+  }
+
+  void
+  prependBlobTlv(unsigned int type, const uint8_t *value, size_t valueLength)
+  {
+    prependArray(value, valueLength);
+    prependTypeAndLength(type, valueLength);
+  }
+
+  /**
+   * Prepend the type, the length of the Blob and the Blob bytes.
+   * @param type The type of the TLV.
+   * @param value The Blob with the value. If value.isNull(), prepend a
+   * zero-length TLV.
+   */
+  void
+  prependBlobTlv(unsigned int type, const Blob& value)
+  {
+    prependBlobTlv(type, value.buf(), value.size());
+  }
+
+  /**
+   * If the value is null or empty then do nothing, otherwise call
+   * prependBlobTlv.
+   * @param type The type of the TLV.
+   * @param value The Blob with the value.
+   */
+  void
+  prependOptionalBlobTlv(unsigned int type, const Blob& value)
+  {
+    if (value.size() > 0)
+      prependBlobTlv(type, value);
+  }
+
+  /**
+   * Move the encoded bytes to the front of the buffer, resize it to the
+   * encoding length, transfer it to a Blob and return the Blob. Further calls
+   * to prepend will throw an exception.
+   * @return A new Blob with the encoding.
+   */
+  Blob
+  finish()
+  {
+    size_t length = getLength();
+    if (offset_ > 0 && length > 0)
+      ::memmove(&(*buffer_)[0], &(*buffer_)[offset_], length);
+    buffer_->resize(length);
+
+    Blob result(buffer_, false);
+    buffer_.reset();
+    return result;
+  }
+
+private:
+  /**
+   * Make room for length more bytes at the front of the encoding and return a
+   * pointer to where they should be written.
+   * @param length The number of bytes to reserve.
+   * @return A pointer to the front of the reserved bytes.
+   */
+  uint8_t*
+  reserveFront(size_t length)
+  {
+    if (!buffer_)
+      throw std::runtime_error
+        ("TlvPrependEncoder: Cannot prepend after calling finish()");
+    if (length > offset_)
+      grow(length);
+
+    offset_ -= length;
+    return &(*buffer_)[offset_];
+  }
+
+  /**
+   * Allocate a bigger buffer with room for at least length more bytes and copy
+   * the encoded bytes to the back of it. The buffer size is doubled (or more)
+   * so that the total copying is linear in the final encoding length.
+   * @param length The number of bytes that must fit at the front.
+   */
+  void
+  grow(size_t length)
+  {
+    size_t encodingLength = getLength();
+    size_t newSize = buffer_->size() * 2;
+    if (newSize < encodingLength + length)
+      newSize = encodingLength + length;
+
+    ptr_lib::shared_ptr<std::vector<uint8_t> > newBuffer =
+      allocateBuffer(newSize);
+    newSize = newBuffer->size();
+    size_t newOffset = newSize - encodingLength;
+    if (encodingLength > 0)
+      ::memcpy(&(*newBuffer)[newOffset], &(*buffer_)[offset_], encodingLength);
+
+    buffer_ = newBuffer;
+    offset_ = newOffset;
+  }
+
+  /**
+   * Get a buffer from the BufferPool and enlarge it to its capacity, which is
+   * rounded up to the size class, so that the extra room is used before
+   * growing.
+   * @param length The minimum size of the buffer.
+   * @return The new buffer.
+   */
+  static ptr_lib::shared_ptr<std::vector<uint8_t> >
+  allocateBuffer(size_t length)
+  {
+    ptr_lib::shared_ptr<std::vector<uint8_t> > buffer =
+      BufferPool::allocate(length);
+    // This doesn't reallocate.
+    buffer->resize(buffer->capacity());
+    return buffer;
+  }
+
+  /**
+   * Write the low valueLength bytes of value in big endian order.
+   */
+  static void
+  writeBigEndian(uint8_t* output, size_t valueLength, uint64_t value)
+  {
+    for (uint8_t* p = output + valueLength; p != output; value >>= 8)
+      *(--p) = (uint8_t)(value & 0xff);
+  }
+
+  ptr_lib::shared_ptr<std::vector<uint8_t> > buffer_;
+  // The encoding is the bytes from offset_ to the end of buffer_.
+  size_t offset_;
+};
+
+}
+
+#endif
@@ -231,59 +231,62 @@ Consumer::Impl::decryptContent
   }
   const Name& cKeyName = dataEncryptedContent->getKeyLocator().getKeyName();
 
-  // Check if the content key is already in the store.
-  if (dKeyMap_.find(cKeyName) != dKeyMap_.end())
+  // Check if the content key is already in the cache.
+  Blob cKeyBits;
+  if (cKeyCache_.find(cKeyName, cKeyBits)) {
     decryptEncryptedContent
-      (*dataEncryptedContent, dKeyMap_[cKeyName], onPlainText, onError);
-  else {
-    // Retrieve the C-KEY Data from the network.
-    Name interestName(cKeyName);
-    interestName.append(Encryptor::getNAME_COMPONENT_FOR()).append(groupName_);
-    ptr_lib::shared_ptr<const Interest> interest(new Interest(interestName));
-
-    // Prepare the callbacks. We make a shared_ptr object since it needs to
-    // exist after we call expressInterest and return.
-    class Callbacks : public ptr_lib::enable_shared_from_this<Callbacks> {
-    public:
-      Callbacks
-        (Consumer::Impl* parent,
-         const ptr_lib::shared_ptr<EncryptedContent>& dataEncryptedContent,
-         const Name& cKeyName, const OnPlainText& onPlainText,
-         const EncryptError::OnError& onError)
-      : parent_(parent), dataEncryptedContent_(dataEncryptedContent),
-        cKeyName_(cKeyName), onPlainText_(onPlainText), onError_(onError)
-      {}
-
-      void
-      onCKeyVerified(const ptr_lib::shared_ptr<Data>& validCKeyData)
-      {
-        parent_->decryptCKey
-          (*validCKeyData,
-           bind(&Callbacks::onCKeyPlainText, shared_from_this(), _1),
-           onError_);
-      }
+      (*dataEncryptedContent, cKeyBits, onPlainText, onError);
+    return;
+  }
 
-      void
-      onCKeyPlainText(const Blob& cKeyBits)
-      {
-        parent_->cKeyMap_[cKeyName_] = cKeyBits;
-        parent_->decryptEncryptedContent
-          (*dataEncryptedContent_, cKeyBits, onPlainText_, onError_);
-      }
+  if (!addPendingDecryption
+      (pendingCKeys_, cKeyName, dataEncryptedContent, onPlainText, onError))
+    // The C-KEY is already being fetched, and this will be decrypted with it.
+    return;
 
-      Consumer::Impl* parent_;
-      ptr_lib::shared_ptr<EncryptedContent> dataEncryptedContent_;
-      Name cKeyName_;
-      OnPlainText onPlainText_;
-      EncryptError::OnError onError_;
-    };
-
-    ptr_lib::shared_ptr<Callbacks> callbacks(new Callbacks
-      (this, dataEncryptedContent, cKeyName, onPlainText, onError));
-    sendInterest
-      (interest, 1, cKeyLink_, bind(&Callbacks::onCKeyVerified, callbacks, _1),
-       onError);
-  }
+  // Retrieve the C-KEY Data from the network.
+  Name interestName(cKeyName);
+  interestName.append(Encryptor::getNAME_COMPONENT_FOR()).append(groupName_);
+  ptr_lib::shared_ptr<const Interest> interest(new Interest(interestName));
+
+  // Prepare the callbacks. We make a shared_ptr object since it needs to
+  // exist after we call expressInterest and return.
+  class Callbacks : public ptr_lib::enable_shared_from_this<Callbacks> {
+  public:
+    Callbacks(Consumer::Impl* parent, const Name& cKeyName)
+    : parent_(parent), cKeyName_(cKeyName)
+    {}
+
+    void
+    onCKeyVerified(const ptr_lib::shared_ptr<Data>& validCKeyData)
+    {
+      parent_->decryptCKey
+        (*validCKeyData,
+         bind(&Callbacks::onCKeyPlainText, shared_from_this(), _1),
+         bind(&Callbacks::onCKeyError, shared_from_this(), _1, _2));
+    }
+
+    void
+    onCKeyPlainText(const Blob& cKeyBits)
+    {
+      onKeyPlainText
+        (parent_->cKeyCache_, parent_->pendingCKeys_, cKeyName_, cKeyBits);
+    }
+
+    void
+    onCKeyError(EncryptError::ErrorCode errorCode, const string& message)
+    {
+      onKeyError(parent_->pendingCKeys_, cKeyName_, errorCode, message);
+    }
+
+    Consumer::Impl* parent_;
+    Name cKeyName_;
+  };
+
+  ptr_lib::shared_ptr<Callbacks> callbacks(new Callbacks(this, cKeyName));
+  sendInterest
+    (interest, 1, cKeyLink_, bind(&Callbacks::onCKeyVerified, callbacks, _1),
+     bind(&Callbacks::onCKeyError, callbacks, _1, _2));
 }
 
 void
@@ -313,59 +316,62 @@ Consumer::Impl::decryptCKey
   dKeyName.append(Encryptor::getNAME_COMPONENT_D_KEY())
     .append(eKeyName.getSubName(-2));
 
-  // Check if the decryption key is already in the store.
-  if (dKeyMap_.find(dKeyName) != dKeyMap_.end())
+  // Check if the decryption key is already in the cache.
+  Blob dKeyBits;
+  if (dKeyCache_.find(dKeyName, dKeyBits)) {
     decryptEncryptedContent
-      (*cKeyEncryptedContent, dKeyMap_[dKeyName], onPlainText, onError);
-  else {
-    // Get the D-Key Data.
-    Name interestName(dKeyName);
-    interestName.append(Encryptor::getNAME_COMPONENT_FOR()).append(consumerName_);
-    ptr_lib::shared_ptr<const Interest> interest(new Interest(interestName));
-
-    // Prepare the callbacks. We make a shared_ptr object since it needs to
-    // exist after we call expressInterest and return.
-    class Callbacks : public ptr_lib::enable_shared_from_this<Callbacks> {
-    public:
-      Callbacks
-        (Consumer::Impl* parent, 
-         const ptr_lib::shared_ptr<EncryptedContent>& cKeyEncryptedContent,
-         const Name& dKeyName, const OnPlainText& onPlainText,
-         const EncryptError::OnError& onError)
-      : parent_(parent), cKeyEncryptedContent_(cKeyEncryptedContent),
-        dKeyName_(dKeyName), onPlainText_(onPlainText), onError_(onError)
-      {}
-
-      void
-      onDKeyVerified(const ptr_lib::shared_ptr<Data>& validDKeyData)
-      {
-        parent_->decryptDKey
-          (*validDKeyData,
-           bind(&Callbacks::onDKeyPlainText, shared_from_this(), _1),
-           onError_);
-      }
+      (*cKeyEncryptedContent, dKeyBits, onPlainText, onError);
+    return;
+  }
 
-      void
-      onDKeyPlainText(const Blob& dKeyBits)
-      {
-        parent_->dKeyMap_[dKeyName_] = dKeyBits;
-        parent_->decryptEncryptedContent
-          (*cKeyEncryptedContent_, dKeyBits, onPlainText_, onError_);
-      }
+  if (!addPendingDecryption
+      (pendingDKeys_, dKeyName, cKeyEncryptedContent, onPlainText, onError))
+    // The D-KEY is already being fetched, and this will be decrypted with it.
+    return;
 
-      Consumer::Impl* parent_;
-      ptr_lib::shared_ptr<EncryptedContent> cKeyEncryptedContent_;
-      Name dKeyName_;
-      OnPlainText onPlainText_;
-      EncryptError::OnError onError_;
-    };
-
-    ptr_lib::shared_ptr<Callbacks> callbacks(new Callbacks
-      (this, cKeyEncryptedContent, dKeyName, onPlainText, onError));
-    sendInterest
-      (interest, 1, dKeyLink_, bind(&Callbacks::onDKeyVerified, callbacks, _1),
-       onError);
-  }
+  // Get the D-Key Data.
+  Name interestName(dKeyName);
+  interestName.append(Encryptor::getNAME_COMPONENT_FOR()).append(consumerName_);
+  ptr_lib::shared_ptr<const Interest> interest(new Interest(interestName));
+
+  // Prepare the callbacks. We make a shared_ptr object since it needs to
+  // exist after we call expressInterest and return.
+  class Callbacks : public ptr_lib::enable_shared_from_this<Callbacks> {
+  public:
+    Callbacks(Consumer::Impl* parent, const Name& dKeyName)
+    : parent_(parent), dKeyName_(dKeyName)
+    {}
+
+    void
+    onDKeyVerified(const ptr_lib::shared_ptr<Data>& validDKeyData)
+    {
+      parent_->decryptDKey
+        (*validDKeyData,
+         bind(&Callbacks::onDKeyPlainText, shared_from_this(), _1),
+         bind(&Callbacks::onDKeyError, shared_from_this(), _1, _2));
+    }
+
+    void
+    onDKeyPlainText(const Blob& dKeyBits)
+    {
+      onKeyPlainText
+        (parent_->dKeyCache_, parent_->pendingDKeys_, dKeyName_, dKeyBits);
+    }
+
+    void
+    onDKeyError(EncryptError::ErrorCode errorCode, const string& message)
+    {
+      onKeyError(parent_->pendingDKeys_, dKeyName_, errorCode, message);
+    }
+
+    Consumer::Impl* parent_;
+    Name dKeyName_;
+  };
+
+  ptr_lib::shared_ptr<Callbacks> callbacks(new Callbacks(this, dKeyName));
+  sendInterest
+    (interest, 1, dKeyLink_, bind(&Callbacks::onDKeyVerified, callbacks, _1),
+     bind(&Callbacks::onDKeyError, callbacks, _1, _2));
 }
 
 void
@@ -445,6 +451,107 @@ Consumer::Impl::decryptDKey
      onError);
 }
 
+void
+Consumer::Impl::setMaxCachedKeys(size_t maxCachedKeys)
+{
+  cKeyCache_.setMaxSize(maxCachedKeys);
+  dKeyCache_.setMaxSize(maxCachedKeys);
+}
+
+bool
+Consumer::Impl::addPendingDecryption
+  (PendingMap& pending, const Name& keyName,
+   const ptr_lib::shared_ptr<EncryptedContent>& encryptedContent,
+   const OnPlainText& onPlainText, const EncryptError::OnError& onError)
+{
+  vector<PendingDecryption>& decryptions = pending[keyName];
+  decryptions.push_back
+    (PendingDecryption(encryptedContent, onPlainText, onError));
+  return decryptions.size() == 1;
+}
+
+void
+Consumer::Impl::onKeyPlainText
+  (KeyCache& keyCache, PendingMap& pending, const Name& keyName,
+   const Blob& keyBits)
+{
+  keyCache.add(keyName, keyBits);
+
+  PendingMap::iterator found = pending.find(keyName);
+  if (found == pending.end())
+    return;
+  // Remove the entry first in case a callback fetches the key again.
+  vector<PendingDecryption> decryptions;
+  decryptions.swap(found->second);
+  pending.erase(found);
+
+  for (size_t i = 0; i < decryptions.size(); ++i)
+    decryptEncryptedContent
+      (*decryptions[i].encryptedContent_, keyBits, decryptions[i].onPlainText_,
+       decryptions[i].onError_);
+}
+
+void
+Consumer::Impl::onKeyError
+  (PendingMap& pending, const Name& keyName, EncryptError::ErrorCode errorCode,
+   const string& message)
+{
+  PendingMap::iterator found = pending.find(keyName);
+  if (found == pending.end())
+    return;
+  vector<PendingDecryption> decryptions;
+  decryptions.swap(found->second);
+  pending.erase(found);
+
+  for (size_t i = 0; i < decryptions.size(); ++i) {
+    try {
+      decryptions[i].onError_(errorCode, message);
+    } catch (const std::exception& ex) {
+      _LOG_ERROR("Error in onError: " << ex.what());
+    } catch (...) {
+      _LOG_ERROR("Error in onError.");
+    }
+  }
+}
+
+bool
+Consumer::Impl::KeyCache::find(const Name& keyName, Blob& keyBits) const
+{
+  map<Name, Blob>::const_iterator found = keys_.find(keyName);
+  if (found == keys_.end())
+    return false;
+
+  keyBits = found->second;
+  return true;
+}
+
+void
+Consumer::Impl::KeyCache::add(const Name& keyName, const Blob& keyBits)
+{
+  if (maxSize_ == 0)
+    return;
+
+  map<Name, Blob>::iterator found = keys_.find(keyName);
+  if (found != keys_.end()) {
+    found->second = keyBits;
+    return;
+  }
+
+  keys_[keyName] = keyBits;
+  keyNames_.push_back(keyName);
+  setMaxSize(maxSize_);
+}
+
+void
+Consumer::Impl::KeyCache::setMaxSize(size_t maxSize)
+{
+  maxSize_ = maxSize;
+  while (keyNames_.size() > maxSize_) {
+    keys_.erase(keyNames_.front());
+    keyNames_.pop_front();
+  }
+}
+
 void
 Consumer::Impl::sendInterest
   (const ptr_lib::shared_ptr<const Interest>& interest, int nRetrials,
@@ -20,11 +20,14 @@
  * A copy of the GNU Lesser General Public License is in the file COPYING.
  */
 
+#include <algorithm>
 #include <ndn-cpp/security/key-chain.hpp>
 #include <ndn-cpp/security/security-exception.hpp>
 #include <ndn-cpp/encrypt/algo/encryptor.hpp>
 #include <ndn-cpp/encrypt/algo/rsa-algorithm.hpp>
 #include <ndn-cpp/encrypt/group-manager.hpp>
+#include "../util/thread-pool.hpp"
+#include "rsa-key-pair-pool.hpp"
 
 using namespace std;
 
@@ -37,7 +40,9 @@ GroupManager::GroupManager
 : database_(database),
   keySize_(keySize),
   freshnessHours_(freshnessHours),
-  keyChain_(keyChain)
+  keyChain_(keyChain),
+  threadCount_(1),
+  maxCachedGroupKeys_(DEFAULT_MAX_CACHED_GROUP_KEYS)
 {
   namespace_ = Name(prefix).append(Encryptor::getNAME_COMPONENT_READ())
     .append(dataType);
@@ -58,6 +63,9 @@ GroupManager::getGroupKey
   string startTimeStamp = Schedule::toIsoString(finalInterval.getStartTime());
   string endTimeStamp = Schedule::toIsoString(finalInterval.getEndTime());
 
+  if (findCachedGroupKey(startTimeStamp, endTimeStamp, memberKeys, result))
+    return;
+
   // Generate the private and public keys.
   Blob privateKeyBlob;
   Blob publicKeyBlob;
@@ -70,20 +78,104 @@ GroupManager::getGroupKey
     (startTimeStamp, endTimeStamp, publicKeyBlob);
   result.push_back(data);
 
-  // Encrypt the private key with the public key from each member's certificate.
-  for (map<Name, Blob>::iterator i = memberKeys.begin(); i != memberKeys.end(); ++i) {
-    const Name& keyName = i->first;
-    Blob& certificateKey = i->second;
-
-    // Generate the name of the packet.
-    // The D-KEY (private key) data packet name convention is:
-    // /<data_type>/D-KEY/[start-ts]/[end-ts]/[member-name]
-    data = createDKeyData
-      (startTimeStamp, endTimeStamp, keyName, privateKeyBlob, certificateKey);
-    result.push_back(data);
+  // The tasks call OpenSSL for RAND_bytes and RSA-OAEP, so only use threads
+  // if it is thread safe.
+  if (threadCount_ != 1 && ThreadPool::isCryptoThreadSafe())
+    createDKeyDataList
+      (startTimeStamp, endTimeStamp, privateKeyBlob, memberKeys, result);
+  else {
+    // Encrypt the private key with the public key from each member's certificate.
+    for (map<Name, Blob>::iterator i = memberKeys.begin();
+         i != memberKeys.end(); ++i) {
+      const Name& keyName = i->first;
+      Blob& certificateKey = i->second;
+
+      // Generate the name of the packet.
+      // The D-KEY (private key) data packet name convention is:
+      // /<data_type>/D-KEY/[start-ts]/[end-ts]/[member-name]
+      data = createDKeyData
+        (startTimeStamp, endTimeStamp, keyName, privateKeyBlob, certificateKey);
+      result.push_back(data);
+    }
+  }
+
+  cacheGroupKey(startTimeStamp, endTimeStamp, memberKeys, result);
+}
+
+void
+GroupManager::setThreadCount(size_t nThreads)
+{
+  if (nThreads != threadCount_) {
+    threadCount_ = nThreads;
+    // getThreadPool() will create a pool with the new thread count.
+    threadPool_.reset();
   }
 }
 
+void
+GroupManager::setMaxCachedGroupKeys(size_t maxCachedGroupKeys)
+{
+  maxCachedGroupKeys_ = maxCachedGroupKeys;
+  while (groupKeyCache_.size() > maxCachedGroupKeys_)
+    groupKeyCache_.erase(groupKeyCache_.begin());
+}
+
+void
+GroupManager::setKeyPairPoolSize(size_t poolSize)
+{
+  if (poolSize == 0)
+    keyPairPool_.reset();
+  else
+    keyPairPool_.reset(new RsaKeyPairPool(keySize_, poolSize));
+}
+
+bool
+GroupManager::findCachedGroupKey
+  (const string& startTimeStamp, const string& endTimeStamp,
+   const map<Name, Blob>& memberKeys,
+   vector<ptr_lib::shared_ptr<Data> >& result)
+{
+  map<pair<string, string>, GroupKeyCacheEntry>::iterator entry =
+    groupKeyCache_.find(make_pair(startTimeStamp, endTimeStamp));
+  if (entry == groupKeyCache_.end())
+    return false;
+
+  // The database may have been changed without this GroupManager.
+  const map<Name, Blob>& cachedMemberKeys = entry->second.memberKeys_;
+  bool isSameMembers = (cachedMemberKeys.size() == memberKeys.size());
+  map<Name, Blob>::const_iterator cached = cachedMemberKeys.begin();
+  map<Name, Blob>::const_iterator member = memberKeys.begin();
+  for (; isSameMembers && member != memberKeys.end(); ++cached, ++member) {
+    if (!cached->first.equals(member->first) ||
+        !cached->second.equals(member->second))
+      isSameMembers = false;
+  }
+  if (!isSameMembers) {
+    groupKeyCache_.erase(entry);
+    return false;
+  }
+
+  result = entry->second.result_;
+  return true;
+}
+
+void
+GroupManager::cacheGroupKey
+  (const string& startTimeStamp, const string& endTimeStamp,
+   const map<Name, Blob>& memberKeys,
+   const vector<ptr_lib::shared_ptr<Data> >& result)
+{
+  if (maxCachedGroupKeys_ == 0)
+    return;
+
+  GroupKeyCacheEntry& entry =
+    groupKeyCache_[make_pair(startTimeStamp, endTimeStamp)];
+  entry.memberKeys_ = memberKeys;
+  entry.result_ = result;
+  while (groupKeyCache_.size() > maxCachedGroupKeys_)
+    groupKeyCache_.erase(groupKeyCache_.begin());
+}
+
 Interval
 GroupManager::calculateInterval
   (MillisecondsSince1970 timeSlot, map<Name, Blob>& memberKeys)
@@ -136,13 +228,10 @@ GroupManager::calculateInterval
 void
 GroupManager::generateKeyPair(Blob& privateKeyBlob, Blob& publicKeyBlob)
 {
-  RsaKeyParams params(keySize_);
-
-  DecryptKey privateKey = RsaAlgorithm::generateKey(params);
-  privateKeyBlob = privateKey.getKeyBits();
-
-  EncryptKey publicKey = RsaAlgorithm::deriveEncryptKey(privateKeyBlob);
-  publicKeyBlob = publicKey.getKeyBits();
+  if (keyPairPool_)
+    keyPairPool_->getKeyPair(privateKeyBlob, publicKeyBlob);
+  else
+    RsaKeyPairPool::generateKeyPair(keySize_, privateKeyBlob, publicKeyBlob);
 }
 
 ptr_lib::shared_ptr<Data>
@@ -165,6 +254,18 @@ ptr_lib::shared_ptr<Data>
 GroupManager::createDKeyData
   (const string& startTimeStamp, const string& endTimeStamp,
    const Name& keyName, const Blob& privateKeyBlob, const Blob& certificateKey)
+{
+  ptr_lib::shared_ptr<Data> data = encryptDKeyData
+    (startTimeStamp, endTimeStamp, keyName, privateKeyBlob, certificateKey);
+  keyChain_->sign(*data);
+  return data;
+}
+
+ptr_lib::shared_ptr<Data>
+GroupManager::encryptDKeyData
+  (const string& startTimeStamp, const string& endTimeStamp,
+   const Name& keyName, const Blob& privateKeyBlob,
+   const Blob& certificateKey) const
 {
   Name name(namespace_);
   name.append(Encryptor::getNAME_COMPONENT_D_KEY());
@@ -181,8 +282,81 @@ GroupManager::createDKeyData
       (string("createDKeyData: Error in encryptData: ") + ex.what());
   }
 
-  keyChain_->sign(*data);
   return data;
 }
 
+void
+GroupManager::createDKeyDataList
+  (const string& startTimeStamp, const string& endTimeStamp,
+   const Blob& privateKeyBlob, const map<Name, Blob>& memberKeys,
+   vector<ptr_lib::shared_ptr<Data> >& result)
+{
+  if (memberKeys.size() == 0)
+    return;
+
+  vector<map<Name, Blob>::const_iterator> members;
+  for (map<Name, Blob>::const_iterator i = memberKeys.begin();
+       i != memberKeys.end(); ++i)
+    members.push_back(i);
+
+  // Make one task for each thread, each with a contiguous part of the members
+  // so that the packets stay in order.
+  size_t iFirst = result.size();
+  result.resize(iFirst + members.size());
+  size_t nMembers = members.size();
+  size_t nTasks = min(getThreadPool().getThreadCount(), nMembers);
+  vector<string> errors(nTasks);
+  vector<ThreadPool::Task> tasks;
+  size_t begin = 0;
+  for (size_t i = 0; i < nTasks; ++i) {
+    size_t end = begin + nMembers / nTasks + (i < nMembers % nTasks ? 1 : 0);
+    tasks.push_back(func_lib::bind
+      (&GroupManager::encryptDKeyDataPart, this, &startTimeStamp,
+       &endTimeStamp, &privateKeyBlob, &members[begin], end - begin,
+       &result[iFirst + begin], &errors[i]));
+    begin = end;
+  }
+  getThreadPool().runAll(tasks);
+
+  for (size_t i = 0; i < errors.size(); ++i) {
+    if (errors[i] != "") {
+      result.resize(iFirst);
+      throw SecurityException(errors[i]);
+    }
+  }
+
+  // The E-KEY was signed with the default certificate, so it exists.
+  vector<Data*> dataList;
+  for (size_t i = iFirst; i < result.size(); ++i)
+    dataList.push_back(result[i].get());
+  keyChain_->signBatch(dataList, keyChain_->getDefaultCertificateName());
+}
+
+void
+GroupManager::encryptDKeyDataPart
+  (const string* startTimeStamp, const string* endTimeStamp,
+   const Blob* privateKeyBlob, const map<Name, Blob>::const_iterator* members,
+   size_t nMembers, ptr_lib::shared_ptr<Data>* dataList, string* error) const
+{
+  try {
+    for (size_t i = 0; i < nMembers; ++i)
+      dataList[i] = encryptDKeyData
+        (*startTimeStamp, *endTimeStamp, members[i]->first, *privateKeyBlob,
+         members[i]->second);
+  } catch (const std::exception& ex) {
+    *error = ex.what();
+  } catch (...) {
+    *error = "GroupManager: Unknown error creating a D-KEY Data packet";
+  }
+}
+
+ThreadPool&
+GroupManager::getThreadPool()
+{
+  if (!threadPool_)
+    threadPool_.reset(new ThreadPool(threadCount_));
+
+  return *threadPool_;
+}
+
 }
@@ -20,11 +20,19 @@
  */
 
 #include <math.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <ndn-cpp/util/logging.hpp>
+#include <ndn-cpp/encoding/tlv-wire-format.hpp>
+#include <ndn-cpp/encrypt/encrypted-content.hpp>
+#include <ndn-cpp/lite/util/crypto-lite.hpp>
+#include <ndn-cpp/lite/encrypt/algo/aes-cbc-encryptor-lite.hpp>
 #include <ndn-cpp/encrypt/algo/encryptor.hpp>
 #include <ndn-cpp/encrypt/algo/aes-algorithm.hpp>
 #include <ndn-cpp/encrypt/schedule.hpp>
 #include <ndn-cpp/encrypt/producer.hpp>
+#include "../util/thread-pool.hpp"
 
 using namespace std;
 using namespace ndn::func_lib;
@@ -47,6 +55,7 @@ Producer::Impl::Impl
     keyChain_(keyChain),
     database_(database),
     maxRepeatAttempts_(repeatAttempts),
+    threadCount_(1),
     keyRetrievalLink_(keyRetrievalLink)
 {
   Name fixedPrefix(prefix);
@@ -86,14 +95,14 @@ Producer::Impl::createContentKey
   Blob contentKeyBits;
 
   // Check if we have created the content key before.
-  if (database_->hasContentKey(timeSlot))
+  if (hasContentKey(timeSlot))
     // We have created the content key. Return its name directly.
     return contentKeyName;
 
   // We haven't created the content key. Create one and add it into the database.
   AesKeyParams aesParams(128);
   contentKeyBits = AesAlgorithm::generateKey(aesParams).getKeyBits();
-  database_->addContentKey(timeSlot, contentKeyBits);
+  addContentKey(timeSlot, contentKeyBits);
 
   // Now we need to retrieve the E-KEYs for content key encryption.
   MillisecondsSince1970 timeCount = ::round(timeSlot);
@@ -135,7 +144,7 @@ Producer::Impl::produce
 {
   // Get a content key.
   Name contentKeyName = createContentKey(timeSlot, OnEncryptedKeys(), onError);
-  Blob contentKey = database_->getContentKey(timeSlot);
+  Blob contentKey = getContentKey(timeSlot);
 
   // Produce data.
   Name dataName(namespace_);
@@ -147,12 +156,311 @@ Producer::Impl::produce
   keyChain_->sign(data);
 }
 
+void
+Producer::Impl::checkSegmentSize(size_t segmentSize)
+{
+  if (segmentSize == 0)
+    throw runtime_error("Producer::produceSegments: segmentSize is zero");
+  // Each batch holds SEGMENTS_PER_BATCH segments in one buffer.
+  if (segmentSize > numeric_limits<size_t>::max() / SEGMENTS_PER_BATCH)
+    throw runtime_error("Producer::produceSegments: segmentSize is too large");
+}
+
+void
+Producer::Impl::produceSegments
+  (MillisecondsSince1970 timeSlot, istream& content, size_t segmentSize,
+   const OnSegments& onSegments, const EncryptError::OnError& onError)
+{
+  checkSegmentSize(segmentSize);
+
+  // Get a content key.
+  Name contentKeyName = createContentKey(timeSlot, OnEncryptedKeys(), onError);
+  Blob contentKey = getContentKey(timeSlot);
+
+  Name dataPrefix(namespace_);
+  dataPrefix.append(Schedule::toIsoString(timeSlot));
+
+  // Reuse the buffer for each batch so that the memory use is constant.
+  vector<uint8_t> buffer(SEGMENTS_PER_BATCH * segmentSize);
+  uint64_t firstSegment = 0;
+  while (true) {
+    content.read((char*)&buffer[0], buffer.size());
+    // A short read at the end of the stream sets both eofbit and failbit.
+    if (content.bad() || (content.fail() && !content.eof())) {
+      try {
+        onError(EncryptError::ErrorCode::General,
+                "Producer::produceSegments: Error reading the content stream");
+      } catch (const std::exception& ex) {
+        _LOG_ERROR("Error in onError: " << ex.what());
+      } catch (...) {
+        _LOG_ERROR("Error in onError.");
+      }
+      return;
+    }
+    size_t contentLength = content.gcount();
+    // Peek so that a batch which ends exactly at the end of the stream is
+    // marked as final.
+    bool isFinal = (content.peek() == istream::traits_type::eof());
+
+    if (!produceSegmentBatch
+        (dataPrefix, contentKeyName, contentKey, &buffer[0], contentLength,
+         segmentSize, firstSegment, isFinal, onSegments, onError))
+      return;
+    if (isFinal)
+      break;
+
+    firstSegment += SEGMENTS_PER_BATCH;
+  }
+}
+
+void
+Producer::Impl::produceSegments
+  (MillisecondsSince1970 timeSlot, const Blob& content, size_t segmentSize,
+   const OnSegments& onSegments, const EncryptError::OnError& onError)
+{
+  checkSegmentSize(segmentSize);
+
+  // Get a content key.
+  Name contentKeyName = createContentKey(timeSlot, OnEncryptedKeys(), onError);
+  Blob contentKey = getContentKey(timeSlot);
+
+  Name dataPrefix(namespace_);
+  dataPrefix.append(Schedule::toIsoString(timeSlot));
+
+  const uint8_t* contentBuffer = (content.size() > 0 ? content.buf() : 0);
+  size_t batchSize = SEGMENTS_PER_BATCH * segmentSize;
+  size_t offset = 0;
+  uint64_t firstSegment = 0;
+  do {
+    size_t contentLength = min(batchSize, content.size() - offset);
+    bool isFinal = (offset + contentLength >= content.size());
+    if (!produceSegmentBatch
+        (dataPrefix, contentKeyName, contentKey, contentBuffer + offset,
+         contentLength, segmentSize, firstSegment, isFinal, onSegments,
+         onError))
+      return;
+
+    offset += contentLength;
+    firstSegment += SEGMENTS_PER_BATCH;
+  } while (offset < content.size());
+}
+
+void
+Producer::Impl::setThreadCount(size_t nThreads)
+{
+  if (nThreads != threadCount_) {
+    threadCount_ = nThreads;
+    // getThreadPool() will create a pool with the new thread count.
+    threadPool_.reset();
+  }
+}
+
+bool
+Producer::Impl::produceSegmentBatch
+  (const Name& dataPrefix, const Name& contentKeyName, const Blob& contentKey,
+   const uint8_t* content, size_t contentLength, size_t segmentSize,
+   uint64_t firstSegment, bool isFinal, const OnSegments& onSegments,
+   const EncryptError::OnError& onError)
+{
+  // Empty content still makes one empty segment.
+  size_t nSegments = max
+    ((size_t)1, (contentLength + segmentSize - 1) / segmentSize);
+
+  // Make all the initial vectors in this thread with one call.
+  vector<uint8_t> initialVectors(nSegments * AesAlgorithm::BLOCK_SIZE);
+  ndn_Error error;
+  if ((error = CryptoLite::generateRandomBytes
+       (&initialVectors[0], initialVectors.size()))) {
+    try {
+      onError(EncryptError::ErrorCode::EncryptionFailure,
+              ndn_getErrorString(error));
+    } catch (const std::exception& ex) {
+      _LOG_ERROR("Error in onError: " << ex.what());
+    } catch (...) {
+      _LOG_ERROR("Error in onError.");
+    }
+    return false;
+  }
+
+  // Make one task for each thread, each with a contiguous part of the segments
+  // so that the segments stay in order. Only the last part can have a short
+  // segment.
+  vector<ptr_lib::shared_ptr<Data> > segments(nSegments);
+  size_t nParts = min(threadCount_ == 1 ? 1 : getThreadPool().getThreadCount(),
+                      nSegments);
+  vector<SegmentPart> parts(nParts);
+  size_t begin = 0;
+  for (size_t i = 0; i < nParts; ++i) {
+    size_t end = begin + nSegments / nParts + (i < nSegments % nParts ? 1 : 0);
+    SegmentPart& part = parts[i];
+    part.dataPrefix = &dataPrefix;
+    part.contentKeyName = &contentKeyName;
+    part.contentKey = &contentKey;
+    part.content = content + begin * segmentSize;
+    part.contentLength = min(end * segmentSize, contentLength) -
+      min(begin * segmentSize, contentLength);
+    part.segmentSize = segmentSize;
+    part.firstSegment = firstSegment + begin;
+    part.nSegments = end - begin;
+    part.hasFinalSegment = (isFinal && end == nSegments);
+    part.initialVectors = &initialVectors[begin * AesAlgorithm::BLOCK_SIZE];
+    part.dataList = &segments[begin];
+    begin = end;
+  }
+
+  if (nParts == 1)
+    encryptSegmentPart(&parts[0]);
+  else {
+    vector<ThreadPool::Task> tasks;
+    for (size_t i = 0; i < nParts; ++i)
+      tasks.push_back(func_lib::bind(&Impl::encryptSegmentPart, &parts[i]));
+    getThreadPool().runAll(tasks);
+  }
+
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (parts[i].error != "") {
+      try {
+        onError(EncryptError::ErrorCode::EncryptionFailure, parts[i].error);
+      } catch (const std::exception& ex) {
+        _LOG_ERROR("Error in onError: " << ex.what());
+      } catch (...) {
+        _LOG_ERROR("Error in onError.");
+      }
+      return false;
+    }
+  }
+
+  // Sign the first segment with sign(data) which makes the default
+  // certificate if needed, as in produce.
+  keyChain_->sign(*segments[0]);
+  if (segments.size() > 1) {
+    vector<Data*> dataList;
+    for (size_t i = 1; i < segments.size(); ++i)
+      dataList.push_back(segments[i].get());
+    keyChain_->signBatch(dataList, keyChain_->getDefaultCertificateName());
+  }
+
+  try {
+    onSegments(segments);
+  } catch (const std::exception& ex) {
+    _LOG_ERROR("Producer::Impl::produceSegmentBatch: Error in onSegments: " <<
+               ex.what());
+  } catch (...) {
+    _LOG_ERROR("Producer::Impl::produceSegmentBatch: Error in onSegments.");
+  }
+  return true;
+}
+
+void
+Producer::Impl::encryptSegmentPart(SegmentPart* part)
+{
+  try {
+    AesCbcEncryptorLite encryptor;
+    ndn_Error error;
+    if ((error = encryptor.setKey(*part->contentKey)))
+      throw runtime_error(ndn_getErrorString(error));
+
+    for (size_t i = 0; i < part->nSegments; ++i) {
+      size_t offset = i * part->segmentSize;
+      size_t plainLength = min(part->segmentSize, part->contentLength - offset);
+      const uint8_t* initialVector =
+        part->initialVectors + i * AesAlgorithm::BLOCK_SIZE;
+
+      // Add room for the padding.
+      ptr_lib::shared_ptr<vector<uint8_t> > encrypted
+        (new vector<uint8_t>(plainLength + AesAlgorithm::BLOCK_SIZE));
+      size_t encryptedLength;
+      if ((error = encryptor.encrypt
+           (initialVector, AesAlgorithm::BLOCK_SIZE, part->content + offset,
+            plainLength, &encrypted->front(), encryptedLength)))
+        throw runtime_error(ndn_getErrorString(error));
+      encrypted->resize(encryptedLength);
+
+      EncryptedContent encryptedContent;
+      encryptedContent.setAlgorithmType(ndn_EncryptAlgorithmType_AesCbc);
+      encryptedContent.getKeyLocator().setType(ndn_KeyLocatorType_KEYNAME);
+      encryptedContent.getKeyLocator().setKeyName(*part->contentKeyName);
+      encryptedContent.setInitialVector
+        (Blob(initialVector, AesAlgorithm::BLOCK_SIZE));
+      encryptedContent.setPayload(Blob(encrypted, false));
+
+      uint64_t segment = part->firstSegment + i;
+      ptr_lib::shared_ptr<Data> data(new Data(Name(*part->dataPrefix)
+        .appendSegment(segment).append(Encryptor::getNAME_COMPONENT_FOR())
+        .append(*part->contentKeyName)));
+      data->setContent(encryptedContent.wireEncode(*TlvWireFormat::get()));
+      if (part->hasFinalSegment && i == part->nSegments - 1)
+        data->getMetaInfo().setFinalBlockId
+          (Name::Component::fromSegment(segment));
+
+      part->dataList[i] = data;
+    }
+  } catch (const std::exception& ex) {
+    part->error = ex.what();
+  } catch (...) {
+    part->error = "Producer: Unknown error encrypting a segment";
+  }
+}
+
+ThreadPool&
+Producer::Impl::getThreadPool()
+{
+  if (!threadPool_)
+    threadPool_.reset(new ThreadPool(threadCount_));
+
+  return *threadPool_;
+}
+
 MillisecondsSince1970
 Producer::Impl::getRoundedTimeSlot(MillisecondsSince1970 timeSlot)
 {
   return ::round(::floor(::round(timeSlot) / 3600000.0) * 3600000.0);
 }
 
+bool
+Producer::Impl::hasContentKey(MillisecondsSince1970 timeSlot)
+{
+  MillisecondsSince1970 hourSlot = getRoundedTimeSlot(timeSlot);
+  if (contentKeyCache_.find(hourSlot) != contentKeyCache_.end())
+    return true;
+
+  if (!database_->hasContentKey(timeSlot))
+    return false;
+  // The caller will usually get the key next.
+  cacheContentKey(hourSlot, database_->getContentKey(timeSlot));
+  return true;
+}
+
+Blob
+Producer::Impl::getContentKey(MillisecondsSince1970 timeSlot)
+{
+  MillisecondsSince1970 hourSlot = getRoundedTimeSlot(timeSlot);
+  map<MillisecondsSince1970, Blob>::iterator found =
+    contentKeyCache_.find(hourSlot);
+  if (found != contentKeyCache_.end())
+    return found->second;
+
+  Blob key = database_->getContentKey(timeSlot);
+  cacheContentKey(hourSlot, key);
+  return key;
+}
+
+void
+Producer::Impl::addContentKey(MillisecondsSince1970 timeSlot, const Blob& key)
+{
+  database_->addContentKey(timeSlot, key);
+  cacheContentKey(getRoundedTimeSlot(timeSlot), key);
+}
+
+void
+Producer::Impl::cacheContentKey
+  (MillisecondsSince1970 hourSlot, const Blob& key)
+{
+  contentKeyCache_[hourSlot] = key;
+  while (contentKeyCache_.size() > MAX_CACHED_CONTENT_KEYS)
+    contentKeyCache_.erase(contentKeyCache_.begin());
+}
+
 void
 Producer::Impl::sendKeyInterest
   (const Interest& interest, MillisecondsSince1970 timeSlot,
@@ -292,7 +600,7 @@ Producer::Impl::encryptContentKey
   keyName.append(Encryptor::getNAME_COMPONENT_C_KEY());
   keyName.append(Schedule::toIsoString(getRoundedTimeSlot(timeSlot)));
 
-  Blob contentKey = database_->getContentKey(timeSlot);
+  Blob contentKey = getContentKey(timeSlot);
 
   ptr_lib::shared_ptr<Data> cKeyData(new Data());
   cKeyData->setName(keyName);
@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include <ndn-cpp/encrypt/algo/rsa-algorithm.hpp>
+#include "rsa-key-pair-pool.hpp"
+
+using namespace std;
+
+namespace ndn {
+
+#if __cplusplus >= 201103L
+
+RsaKeyPairPool::RsaKeyPairPool(uint32_t keySize, size_t poolSize)
+: keySize_(keySize), isStopping_(false), threadPool_(1)
+{
+  if (!ThreadPool::isCryptoThreadSafe())
+    // The background thread would use OpenSSL at the same time as the caller.
+    // Leave the pool empty so that getKeyPair generates in the calling thread.
+    return;
+
+  for (size_t i = 0; i < poolSize; ++i)
+    threadPool_.submit(func_lib::bind(&RsaKeyPairPool::addKeyPair, this));
+}
+
+RsaKeyPairPool::~RsaKeyPairPool()
+{
+  lock_guard<mutex> lock(mutex_);
+  // The queued addKeyPair tasks will return without generating.
+  isStopping_ = true;
+}
+
+void
+RsaKeyPairPool::getKeyPair(Blob& privateKeyBlob, Blob& publicKeyBlob)
+{
+  bool isReady = false;
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (keyPairs_.size() > 0) {
+      privateKeyBlob = keyPairs_.front().first;
+      publicKeyBlob = keyPairs_.front().second;
+      keyPairs_.pop_front();
+      isReady = true;
+    }
+  }
+
+  if (isReady)
+    // Replace the key pair that was taken. If the pool was empty, the key pairs
+    // that it is waiting for are already queued.
+    threadPool_.submit(func_lib::bind(&RsaKeyPairPool::addKeyPair, this));
+  else
+    generateKeyPair(keySize_, privateKeyBlob, publicKeyBlob);
+}
+
+size_t
+RsaKeyPairPool::getReadyCount()
+{
+  lock_guard<mutex> lock(mutex_);
+  return keyPairs_.size();
+}
+
+void
+RsaKeyPairPool::addKeyPair()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (isStopping_)
+      return;
+  }
+
+  Blob privateKeyBlob;
+  Blob publicKeyBlob;
+  try {
+    generateKeyPair(keySize_, privateKeyBlob, publicKeyBlob);
+  } catch (...) {
+    // A task must not throw. getKeyPair will generate in the calling thread
+    // and report the error.
+    return;
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  keyPairs_.push_back(make_pair(privateKeyBlob, publicKeyBlob));
+}
+
+#else
+
+RsaKeyPairPool::RsaKeyPairPool(uint32_t keySize, size_t poolSize)
+: keySize_(keySize)
+{
+}
+
+RsaKeyPairPool::~RsaKeyPairPool()
+{
+}
+
+void
+RsaKeyPairPool::getKeyPair(Blob& privateKeyBlob, Blob& publicKeyBlob)
+{
+  generateKeyPair(keySize_, privateKeyBlob, publicKeyBlob);
+}
+
+size_t
+RsaKeyPairPool::getReadyCount() { return 0; }
+
+#endif
+
+void
+RsaKeyPairPool::generateKeyPair
+  (uint32_t keySize, Blob& privateKeyBlob, Blob& publicKeyBlob)
+{
+  RsaKeyParams params(keySize);
+
+  DecryptKey privateKey = RsaAlgorithm::generateKey(params);
+  privateKeyBlob = privateKey.getKeyBits();
+
+  EncryptKey publicKey = RsaAlgorithm::deriveEncryptKey(privateKeyBlob);
+  publicKeyBlob = publicKey.getKeyBits();
+}
+
+}
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_RSA_KEY_PAIR_POOL_HPP
+#define NDN_RSA_KEY_PAIR_POOL_HPP
+
+#include <deque>
+#include <utility>
+#include <ndn-cpp/util/blob.hpp>
+#include "../util/thread-pool.hpp"
+
+namespace ndn {
+
+/**
+ * An RsaKeyPairPool keeps a number of RSA key pairs ready which a background
+ * thread generates, so that getKeyPair usually does not wait for key
+ * generation. After getKeyPair takes a key pair, the background thread makes
+ * another, so the pool never holds more than poolSize key pairs. If the
+ * compiler does not support C++11 threads, or OpenSSL can't be used from
+ * multiple threads (see ThreadPool::isCryptoThreadSafe), there is no
+ * background generation and getKeyPair generates each key pair when it is
+ * called.
+ */
+class RsaKeyPairPool {
+public:
+  /**
+   * Create an RsaKeyPairPool and start generating poolSize key pairs.
+   * @param keySize The number of bits of each RSA key.
+   * @param poolSize The number of key pairs to keep ready.
+   */
+  RsaKeyPairPool(uint32_t keySize, size_t poolSize);
+
+  /**
+   * Stop generating key pairs and join the background thread after it
+   * finishes the key pair that it is generating.
+   */
+  ~RsaKeyPairPool();
+
+  /**
+   * Take a ready key pair from the pool and start generating another to
+   * replace it, or generate one in the calling thread if the pool is empty.
+   * @param privateKeyBlob Set privateKeyBlob to the encoding Blob of the
+   * private key.
+   * @param publicKeyBlob Set publicKeyBlob to the encoding Blob of the
+   * public key.
+   */
+  void
+  getKeyPair(Blob& privateKeyBlob, Blob& publicKeyBlob);
+
+  /**
+   * Get the number of key pairs which are ready.
+   * @return The number of ready key pairs.
+   */
+  size_t
+  getReadyCount();
+
+  /**
+   * Generate an RSA key pair.
+   * @param keySize The number of bits of the RSA key.
+   * @param privateKeyBlob Set privateKeyBlob to the encoding Blob of the
+   * private key.
+   * @param publicKeyBlob Set publicKeyBlob to the encoding Blob of the
+   * public key.
+   */
+  static void
+  generateKeyPair(uint32_t keySize, Blob& privateKeyBlob, Blob& publicKeyBlob);
+
+private:
+  // Don't allow copying.
+  RsaKeyPairPool(const RsaKeyPairPool& other);
+  RsaKeyPairPool& operator=(const RsaKeyPairPool& other);
+
+#if __cplusplus >= 201103L
+  /**
+   * This is the task for the background thread. Generate a key pair and add
+   * it to keyPairs_, unless the pool is stopping.
+   */
+  void
+  addKeyPair();
+
+  uint32_t keySize_;
+  std::deque<std::pair<Blob, Blob> > keyPairs_;
+  bool isStopping_;
+  std::mutex mutex_;
+  // Declare this last so that the destructor joins the background thread
+  // before the other members are destroyed.
+  ThreadPool threadPool_;
+#else
+  uint32_t keySize_;
+#endif
+};
+
+}
+
+#endif
@@ -23,7 +23,9 @@
 #include <stdexcept>
 #include <ndn-cpp/common.hpp>
 #include <ndn-cpp/lite/util/crypto-lite.hpp>
+#include <ndn-cpp/encoding/tlv-0_2-wire-format.hpp>
 #include "lp/incoming-face-id.hpp"
+#include "encoding/lazy-fields.hpp"
 #include <ndn-cpp/data.hpp>
 #include <ndn-cpp/interest.hpp>
 
@@ -31,8 +33,42 @@ using namespace std;
 
 namespace ndn {
 
+Interest::Interest(const Interest& interest)
+: name_(interest.name_),
+  interestLifetimeMilliseconds_(interest.interestLifetimeMilliseconds_),
+  nonce_(interest.nonce_), getNonceChangeCount_(0),
+  linkWireEncoding_(interest.linkWireEncoding_),
+  linkWireEncodingFormat_(interest.linkWireEncodingFormat_),
+  selectedDelegationIndex_(interest.selectedDelegationIndex_),
+  lazySelectors_(interest.lazySelectors_),
+  changeCount_(0)
+{
+  {
+    // Another thread may be decoding the pending Selectors of interest through
+    // a const getter, so lock while copying the Selectors.
+    LazyDecoder::Lock lock(interest.lazySelectors_);
+    minSuffixComponents_ = interest.minSuffixComponents_;
+    maxSuffixComponents_ = interest.maxSuffixComponents_;
+    keyLocator_.set(interest.keyLocator_.get());
+    exclude_.set(interest.exclude_.get());
+    childSelector_ = interest.childSelector_;
+    mustBeFresh_ = interest.mustBeFresh_;
+    pendingSelectors_ = interest.pendingSelectors_;
+  }
+
+  if (interest.link_.get())
+    link_.set(ptr_lib::make_shared<Link>(*interest.link_.get()));
+
+  setDefaultWireEncoding
+    (interest.getDefaultWireEncoding(), interest.defaultWireEncodingFormat_);
+}
+
 Interest& Interest::operator=(const Interest& interest)
 {
+  // Copy the Selectors below from the decoded values.
+  interest.decodePendingSelectors();
+  lazySelectors_.reset();
+
   setName(interest.name_.get());
   setMinSuffixComponents(interest.minSuffixComponents_);
   setMaxSuffixComponents(interest.maxSuffixComponents_);
@@ -68,6 +104,7 @@ Interest::getIncomingFaceId() const
 void
 Interest::get(InterestLite& interestLite, WireFormat& wireFormat) const
 {
+  decodePendingSelectors();
   name_.get().get(interestLite.getName());
   interestLite.setMinSuffixComponents(minSuffixComponents_);
   interestLite.setMaxSuffixComponents(maxSuffixComponents_);
@@ -89,6 +126,7 @@ Interest::get(InterestLite& interestLite, WireFormat& wireFormat) const
 void
 Interest::set(const InterestLite& interestLite, WireFormat& wireFormat)
 {
+  lazySelectors_.reset();
   name_.get().set(interestLite.getName());
   setMinSuffixComponents(interestLite.getMinSuffixComponents());
   setMaxSuffixComponents(interestLite.getMaxSuffixComponents());
@@ -135,6 +173,9 @@ Interest::wireEncode(WireFormat& wireFormat) const
 void
 Interest::wireDecode(const Blob& input, WireFormat& wireFormat)
 {
+  // All the fields are decoded now, so don't decode previous pending Selectors.
+  lazySelectors_.reset();
+
   size_t signedPortionBeginOffset, signedPortionEndOffset;
   wireFormat.decodeInterest
     (*this, input.buf(), input.size(), &signedPortionBeginOffset,
@@ -154,6 +195,8 @@ void
 Interest::wireDecode
   (const uint8_t *input, size_t inputLength, WireFormat& wireFormat)
 {
+  lazySelectors_.reset();
+
   size_t signedPortionBeginOffset, signedPortionEndOffset;
   wireFormat.decodeInterest(*this, input, inputLength, &signedPortionBeginOffset, &signedPortionEndOffset);
 
@@ -167,9 +210,66 @@ Interest::wireDecode
     setDefaultWireEncoding(SignedBlob(), 0);
 }
 
+void
+Interest::wireDecodeLazy(const Blob& input, WireFormat& wireFormat)
+{
+  if (!dynamic_cast<Tlv0_2WireFormat*>(&wireFormat)) {
+    // We only know how to find the Selectors in NDN-TLV, so decode everything
+    // now.
+    wireDecode(input, wireFormat);
+    return;
+  }
+
+  lazySelectors_.reset();
+  size_t signedPortionBeginOffset, signedPortionEndOffset;
+  ptr_lib::shared_ptr<LazyInterestSelectors> lazySelectors =
+    LazyInterestSelectors::decodeInterest
+      (*this, input, &signedPortionBeginOffset, &signedPortionEndOffset,
+       wireFormat);
+  lazySelectors_ = lazySelectors;
+  pendingSelectors_ = true;
+
+  if (&wireFormat == WireFormat::getDefaultWireFormat())
+    // This is the default wire encoding.
+    // Take a pointer to the input Blob without copying.
+    setDefaultWireEncoding
+      (SignedBlob(input, signedPortionBeginOffset, signedPortionEndOffset),
+       WireFormat::getDefaultWireFormat());
+  else
+    setDefaultWireEncoding(SignedBlob(), 0);
+}
+
+void
+Interest::decodeLazySelectors()
+{
+  // Another thread may have decoded the Selectors since the caller checked, so
+  // check again while locked.
+  LazyDecoder::Lock lock(lazySelectors_);
+  if (!pendingSelectors_)
+    return;
+
+  // The decoder uses the setters, which would decode again and increment the
+  // change count. Decode into a separate Interest and copy the Selectors. If
+  // the decoder throws an exception, the Selectors are still pending so that
+  // the next access throws again.
+  Interest selectors;
+  lazySelectors_->decodeSelectors(selectors);
+
+  uint64_t changeCount = getChangeCount();
+  minSuffixComponents_ = selectors.minSuffixComponents_;
+  maxSuffixComponents_ = selectors.maxSuffixComponents_;
+  keyLocator_.set(selectors.keyLocator_.get());
+  exclude_.set(selectors.exclude_.get());
+  childSelector_ = selectors.childSelector_;
+  mustBeFresh_ = selectors.mustBeFresh_;
+  restoreChangeCount(changeCount);
+  pendingSelectors_ = false;
+}
+
 string
 Interest::toUri() const
 {
+  decodePendingSelectors();
   ostringstream selectors;
 
   if (minSuffixComponents_ >= 0)
@@ -204,6 +304,7 @@ Interest::toUri() const
 bool
 Interest::matchesName(const Name& name) const
 {
+  decodePendingSelectors();
   if (!getName().match(name))
     return false;
 
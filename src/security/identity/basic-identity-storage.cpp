@@ -109,6 +109,7 @@ static int sqlite3_bind_text(sqlite3_stmt* statement, int index, const string& v
 }
 
 BasicIdentityStorage::BasicIdentityStorage(const std::string& databaseFilePath)
+: dataVersion_(-1), haveDefaultIdentity_(false)
 {
   int res;
   if (databaseFilePath == "") {
@@ -135,6 +136,18 @@ BasicIdentityStorage::BasicIdentityStorage(const std::string& databaseFilePath)
   if (res != SQLITE_OK)
     throw SecurityException("identity DB cannot be opened/created");
 
+  // With a write-ahead log, readers don't block the writer and a commit only
+  // needs to append to the log. NORMAL is safe in WAL mode: a power loss can
+  // roll back the last transactions but can't corrupt the database.
+  char *pragmaErrorMessage = 0;
+  res = sqlite3_exec
+    (database_, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", NULL,
+     NULL, &pragmaErrorMessage);
+  if (res != SQLITE_OK && pragmaErrorMessage != 0) {
+    _LOG_TRACE("Init \"error\" setting the journal mode: " << pragmaErrorMessage);
+    sqlite3_free(pragmaErrorMessage);
+  }
+
   // Check if TpmInfo table exists.
   sqlite3_stmt *statement;
   sqlite3_prepare_v2(database_, "SELECT name FROM sqlite_master WHERE type='table' And name='TpmInfo'", -1, &statement, 0);
@@ -219,6 +232,59 @@ BasicIdentityStorage::BasicIdentityStorage(const std::string& databaseFilePath)
 
 BasicIdentityStorage::~BasicIdentityStorage()
 {
+  for (map<string, sqlite3_stmt*>::iterator it = statements_.begin();
+       it != statements_.end(); ++it)
+    sqlite3_finalize(it->second);
+
+  // Closing also checkpoints and removes the write-ahead log.
+  sqlite3_close(database_);
+}
+
+sqlite3_stmt*
+BasicIdentityStorage::getStatement(const char* sql)
+{
+  map<string, sqlite3_stmt*>::iterator found = statements_.find(sql);
+  if (found != statements_.end()) {
+    sqlite3_reset(found->second);
+    sqlite3_clear_bindings(found->second);
+    return found->second;
+  }
+
+  sqlite3_stmt *statement = 0;
+  if (sqlite3_prepare_v2(database_, sql, -1, &statement, 0) != SQLITE_OK) {
+    _LOG_TRACE("Error preparing \"" << sql << "\": " << sqlite3_errmsg(database_));
+    // Like sqlite3_prepare_v2, return a null statement.
+    sqlite3_finalize(statement);
+    return 0;
+  }
+
+  statements_[sql] = statement;
+  return statement;
+}
+
+void
+BasicIdentityStorage::checkDataVersion()
+{
+  // The data version changes when another connection commits a change.
+  sqlite3_stmt *statement = getStatement("PRAGMA data_version");
+  int dataVersion = -1;
+  if (sqlite3_step(statement) == SQLITE_ROW)
+    dataVersion = sqlite3_column_int(statement, 0);
+  sqlite3_reset(statement);
+
+  if (dataVersion != dataVersion_ || dataVersion < 0) {
+    clearCache();
+    dataVersion_ = dataVersion;
+  }
+}
+
+void
+BasicIdentityStorage::clearCache()
+{
+  haveDefaultIdentity_ = false;
+  defaultKeyNames_.clear();
+  defaultCertificateNames_.clear();
+  keys_.clear();
 }
 
 bool
@@ -226,8 +292,7 @@ BasicIdentityStorage::doesIdentityExist(const Name& identityName)
 {
   bool result = false;
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT count(*) FROM Identity WHERE identity_name=?", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT count(*) FROM Identity WHERE identity_name=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   int res = sqlite3_step(statement);
@@ -238,7 +303,7 @@ BasicIdentityStorage::doesIdentityExist(const Name& identityName)
       result = true;
   }
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
   return result;
 }
@@ -249,15 +314,13 @@ BasicIdentityStorage::addIdentity(const Name& identityName)
   if (doesIdentityExist(identityName))
     return;
 
-  sqlite3_stmt *statement;
-
-  sqlite3_prepare_v2(database_, "INSERT INTO Identity (identity_name) values (?)", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("INSERT INTO Identity (identity_name) values (?)");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
 
   int res = sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 bool
@@ -270,11 +333,14 @@ BasicIdentityStorage::revokeIdentity()
 bool
 BasicIdentityStorage::doesKeyExist(const Name& keyName)
 {
+  checkDataVersion();
+  if (keys_.find(keyName) != keys_.end())
+    return true;
+
   string keyId = keyName.get(-1).toEscapedString();
   Name identityName = keyName.getPrefix(-1);
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT count(*) FROM Key WHERE identity_name=? AND key_identifier=?", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT count(*) FROM Key WHERE identity_name=? AND key_identifier=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
@@ -288,7 +354,7 @@ BasicIdentityStorage::doesKeyExist(const Name& keyName)
       keyIdExists = true;
   }
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
   return keyIdExists;
 }
@@ -307,8 +373,7 @@ BasicIdentityStorage::addKey(const Name& keyName, KeyType keyType, const Blob& p
 
   addIdentity(identityName);
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "INSERT INTO Key (identity_name, key_identifier, key_type, public_key) values (?, ?, ?, ?)", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("INSERT INTO Key (identity_name, key_identifier, key_type, public_key) values (?, ?, ?, ?)");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
@@ -317,7 +382,7 @@ BasicIdentityStorage::addKey(const Name& keyName, KeyType keyType, const Blob& p
 
   sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 Blob
@@ -326,11 +391,15 @@ BasicIdentityStorage::getKey(const Name& keyName)
   if (keyName.size() == 0)
     throw SecurityException("BasicIdentityStorage::getKey: Empty keyName");
 
+  checkDataVersion();
+  map<Name, Blob>::iterator cached = keys_.find(keyName);
+  if (cached != keys_.end())
+    return cached->second;
+
   string keyId = keyName.get(-1).toEscapedString();
   Name identityName = keyName.getPrefix(-1);
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT public_key FROM Key WHERE identity_name=? AND key_identifier=?", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT public_key FROM Key WHERE identity_name=? AND key_identifier=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
@@ -341,11 +410,14 @@ BasicIdentityStorage::getKey(const Name& keyName)
     Blob result = Blob
       (static_cast<const uint8_t*>(sqlite3_column_blob(statement, 0)),
        sqlite3_column_bytes(statement, 0));
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
+    keys_[keyName] = result;
     return result;
   }
-  else
+  else {
+    sqlite3_reset(statement);
     throw SecurityException("BasicIdentityStorage::getKey: The key does not exist");
+  }
 }
 
 void
@@ -366,8 +438,7 @@ BasicIdentityStorage::updateKeyStatus(const Name& keyName, bool isActive)
   string keyId = keyName.get(-1).toEscapedString();
   Name identityName = keyName.getPrefix(-1);
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "UPDATE Key SET active=? WHERE identity_name=? AND key_identifier=?", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("UPDATE Key SET active=? WHERE identity_name=? AND key_identifier=?");
 
   sqlite3_bind_int(statement, 1, (isActive ? 1 : 0));
   sqlite3_bind_text(statement, 2, identityName.toUri(), SQLITE_TRANSIENT);
@@ -375,14 +446,13 @@ BasicIdentityStorage::updateKeyStatus(const Name& keyName, bool isActive)
 
   int res = sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 bool
 BasicIdentityStorage::doesCertificateExist(const Name& certificateName)
 {
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT count(*) FROM Certificate WHERE cert_name=?", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT count(*) FROM Certificate WHERE cert_name=?");
 
   sqlite3_bind_text(statement, 1, certificateName.toUri(), SQLITE_TRANSIENT);
 
@@ -395,7 +465,7 @@ BasicIdentityStorage::doesCertificateExist(const Name& certificateName)
       certExists = true;
   }
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
   return certExists;
 }
@@ -416,11 +486,9 @@ BasicIdentityStorage::addCertificate(const IdentityCertificate& certificate)
   Name identity = keyName.getPrefix(-1);
 
   // Insert the certificate
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_,
-                      "INSERT INTO Certificate (cert_name, cert_issuer, identity_name, key_identifier, not_before, not_after, certificate_data)\
-                       values (?, ?, ?, ?, datetime(?, 'unixepoch'), datetime(?, 'unixepoch'), ?)",
-                      -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement
+    ("INSERT INTO Certificate (cert_name, cert_issuer, identity_name, key_identifier, not_before, not_after, certificate_data)\
+                       values (?, ?, ?, ?, datetime(?, 'unixepoch'), datetime(?, 'unixepoch'), ?)");
 
   sqlite3_bind_text(statement, 1, certificateName.toUri(), SQLITE_TRANSIENT);
 
@@ -439,15 +507,13 @@ BasicIdentityStorage::addCertificate(const IdentityCertificate& certificate)
 
   int res = sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 ptr_lib::shared_ptr<IdentityCertificate>
 BasicIdentityStorage::getCertificate(const Name &certificateName)
 {
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_,
-                      "SELECT certificate_data FROM Certificate WHERE cert_name=?", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT certificate_data FROM Certificate WHERE cert_name=?");
   sqlite3_bind_text(statement, 1, certificateName.toUri(), SQLITE_TRANSIENT);
 
   int res = sqlite3_step(statement);
@@ -459,16 +525,16 @@ BasicIdentityStorage::getCertificate(const Name &certificateName)
         (Blob((const uint8_t*)sqlite3_column_blob(statement, 0),
               sqlite3_column_bytes(statement, 0)));
     } catch (...) {
-      sqlite3_finalize(statement);
+      sqlite3_reset(statement);
       throw SecurityException
         ("BasicIdentityStorage::getCertificate: The certificate cannot be decoded");
     }
 
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     return certificate;
   }
   else {
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     throw SecurityException
       ("BasicIdentityStorage::getCertificate: The certificate does not exist");
   }
@@ -477,9 +543,7 @@ BasicIdentityStorage::getCertificate(const Name &certificateName)
 string
 BasicIdentityStorage::getTpmLocator()
 {
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2
-    (database_, "SELECT tpm_locator FROM TpmInfo", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT tpm_locator FROM TpmInfo");
 
   int res = sqlite3_step(statement);
 
@@ -487,11 +551,11 @@ BasicIdentityStorage::getTpmLocator()
     string tpmLocator
       (reinterpret_cast<const char *>(sqlite3_column_text(statement, 0)),
        sqlite3_column_bytes(statement, 0));
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     return tpmLocator;
   }
   else {
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     throw SecurityException
       ("BasicIdentityStorage::getTpmLocator: TPM info does not exist");
   }
@@ -500,8 +564,11 @@ BasicIdentityStorage::getTpmLocator()
 Name
 BasicIdentityStorage::getDefaultIdentity()
 {
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT identity_name FROM Identity WHERE default_identity=1", -1, &statement, 0);
+  checkDataVersion();
+  if (haveDefaultIdentity_)
+    return defaultIdentity_;
+
+  sqlite3_stmt *statement = getStatement("SELECT identity_name FROM Identity WHERE default_identity=1");
 
   int res = sqlite3_step(statement);
 
@@ -509,11 +576,13 @@ BasicIdentityStorage::getDefaultIdentity()
 
   if (res == SQLITE_ROW) {
     identity = Name(string(reinterpret_cast<const char *>(sqlite3_column_text(statement, 0)), sqlite3_column_bytes(statement, 0)));
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
+    defaultIdentity_ = identity;
+    haveDefaultIdentity_ = true;
     return identity;
   }
   else {
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     throw SecurityException
       ("BasicIdentityStorage::getDefaultIdentity: The default identity is not defined");
   }
@@ -522,8 +591,12 @@ BasicIdentityStorage::getDefaultIdentity()
 Name
 BasicIdentityStorage::getDefaultKeyNameForIdentity(const Name& identityName)
 {
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT key_identifier FROM Key WHERE identity_name=? AND default_key=1", -1, &statement, 0);
+  checkDataVersion();
+  map<Name, Name>::iterator cached = defaultKeyNames_.find(identityName);
+  if (cached != defaultKeyNames_.end())
+    return cached->second;
+
+  sqlite3_stmt *statement = getStatement("SELECT key_identifier FROM Key WHERE identity_name=? AND default_key=1");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
 
@@ -533,11 +606,12 @@ BasicIdentityStorage::getDefaultKeyNameForIdentity(const Name& identityName)
 
   if (res == SQLITE_ROW) {
     keyName = Name(identityName).append(string(reinterpret_cast<const char *>(sqlite3_column_text(statement, 0)), sqlite3_column_bytes(statement, 0)));
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
+    defaultKeyNames_[identityName] = keyName;
     return keyName;
   }
   else {
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     throw SecurityException
       ("BasicIdentityStorage::getDefaultKeyNameForIdentity: The default key for the identity is not defined");
   }
@@ -546,11 +620,15 @@ BasicIdentityStorage::getDefaultKeyNameForIdentity(const Name& identityName)
 Name
 BasicIdentityStorage::getDefaultCertificateNameForKey(const Name& keyName)
 {
+  checkDataVersion();
+  map<Name, Name>::iterator cached = defaultCertificateNames_.find(keyName);
+  if (cached != defaultCertificateNames_.end())
+    return cached->second;
+
   string keyId = keyName.get(-1).toEscapedString();
   Name identityName = keyName.getPrefix(-1);
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2(database_, "SELECT cert_name FROM Certificate WHERE identity_name=? AND key_identifier=? AND default_cert=1", -1, &statement, 0);
+  sqlite3_stmt *statement = getStatement("SELECT cert_name FROM Certificate WHERE identity_name=? AND key_identifier=? AND default_cert=1");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
@@ -561,11 +639,12 @@ BasicIdentityStorage::getDefaultCertificateNameForKey(const Name& keyName)
 
   if (res == SQLITE_ROW) {
     certName = Name(string(reinterpret_cast<const char *>(sqlite3_column_text(statement, 0)), sqlite3_column_bytes(statement, 0)));
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
+    defaultCertificateNames_[keyName] = certName;
     return certName;
   }
   else {
-    sqlite3_finalize(statement);
+    sqlite3_reset(statement);
     throw SecurityException
       ("BasicIdentityStorage::getDefaultCertificateNameForKey: The default certificate for the key name is not defined");
   }
@@ -577,15 +656,11 @@ BasicIdentityStorage::getAllIdentities(vector<Name>& nameList, bool isDefault)
   sqlite3_stmt* statement;
 
   if (isDefault)
-    sqlite3_prepare_v2
-      (database_,
-       "SELECT identity_name FROM Identity WHERE default_identity=1",
-       -1, &statement, 0);
+    statement = getStatement
+      ("SELECT identity_name FROM Identity WHERE default_identity=1");
   else
-    sqlite3_prepare_v2
-      (database_,
-       "SELECT identity_name FROM Identity WHERE default_identity=0",
-       -1, &statement, 0);
+    statement = getStatement
+      ("SELECT identity_name FROM Identity WHERE default_identity=0");
 
   while (sqlite3_step(statement) == SQLITE_ROW) {
     Name identityName
@@ -594,7 +669,7 @@ BasicIdentityStorage::getAllIdentities(vector<Name>& nameList, bool isDefault)
     nameList.push_back(identityName);
   }
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -604,15 +679,11 @@ BasicIdentityStorage::getAllKeyNamesOfIdentity
   sqlite3_stmt* statement;
 
   if (isDefault)
-    sqlite3_prepare_v2
-      (database_,
-       "SELECT key_identifier FROM Key WHERE default_key=1 and identity_name=?",
-       -1, &statement, 0);
+    statement = getStatement
+      ("SELECT key_identifier FROM Key WHERE default_key=1 and identity_name=?");
   else
-    sqlite3_prepare_v2
-      (database_,
-       "SELECT key_identifier FROM Key WHERE default_key=0 and identity_name=?",
-       -1, &statement, 0);
+    statement = getStatement
+      ("SELECT key_identifier FROM Key WHERE default_key=0 and identity_name=?");
 
   string identityUri = identityName.toUri();
   sqlite3_bind_text
@@ -626,7 +697,7 @@ BasicIdentityStorage::getAllKeyNamesOfIdentity
     nameList.push_back(keyName);
   }
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -639,17 +710,13 @@ BasicIdentityStorage::getAllCertificateNamesOfKey
   sqlite3_stmt* statement;
 
   if (isDefault)
-    sqlite3_prepare_v2
-      (database_,
-        "SELECT cert_name FROM Certificate \
-         WHERE default_cert=1 and identity_name=? and key_identifier=?",
-       -1, &statement, 0);
+    statement = getStatement
+      ("SELECT cert_name FROM Certificate \
+        WHERE default_cert=1 and identity_name=? and key_identifier=?");
   else
-    sqlite3_prepare_v2
-      (database_,
-       "SELECT cert_name FROM Certificate \
-        WHERE default_cert=0 and identity_name=? and key_identifier=?",
-       -1, &statement, 0);
+    statement = getStatement
+      ("SELECT cert_name FROM Certificate \
+        WHERE default_cert=0 and identity_name=? and key_identifier=?");
 
   string identityUri = keyName.getPrefix(-1).toUri();
   sqlite3_bind_text
@@ -666,30 +733,31 @@ BasicIdentityStorage::getAllCertificateNamesOfKey
     nameList.push_back(keyName);
   }
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
 BasicIdentityStorage::setDefaultIdentity(const Name& identityName)
 {
+  clearCache();
   sqlite3_stmt *statement;
 
   // Reset the previous default identity.
-  sqlite3_prepare_v2(database_, "UPDATE Identity SET default_identity=0 WHERE default_identity=1", -1, &statement, 0);
+  statement = getStatement("UPDATE Identity SET default_identity=0 WHERE default_identity=1");
 
   while (sqlite3_step(statement) == SQLITE_ROW)
     {}
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
   // Set the current default identity.
-  sqlite3_prepare_v2(database_, "UPDATE Identity SET default_identity=1 WHERE identity_name=?", -1, &statement, 0);
+  statement = getStatement("UPDATE Identity SET default_identity=1 WHERE identity_name=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
 
   sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -701,27 +769,28 @@ BasicIdentityStorage::setDefaultKeyNameForIdentity(const Name& keyName, const Na
   if (identityNameCheck.size() > 0 && !identityNameCheck.equals(identityName))
     throw SecurityException("Specified identity name does not match the key name");
 
+  clearCache();
   sqlite3_stmt *statement;
 
   // Reset the previous default Key.
-  sqlite3_prepare_v2(database_, "UPDATE Key SET default_key=0 WHERE default_key=1 and identity_name=?", -1, &statement, 0);
+  statement = getStatement("UPDATE Key SET default_key=0 WHERE default_key=1 and identity_name=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
 
   while (sqlite3_step(statement) == SQLITE_ROW)
     {}
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
   // Set the current default Key.
-  sqlite3_prepare_v2(database_, "UPDATE Key SET default_key=1 WHERE identity_name=? AND key_identifier=?", -1, &statement, 0);
+  statement = getStatement("UPDATE Key SET default_key=1 WHERE identity_name=? AND key_identifier=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
 
   sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -730,10 +799,11 @@ BasicIdentityStorage::setDefaultCertificateNameForKey(const Name& keyName, const
   string keyId = keyName.get(-1).toEscapedString();
   Name identityName = keyName.getPrefix(-1);
 
+  clearCache();
   sqlite3_stmt *statement;
 
   // Reset the previous default Certificate.
-  sqlite3_prepare_v2(database_, "UPDATE Certificate SET default_cert=0 WHERE default_cert=1 AND identity_name=? AND key_identifier=?", -1, &statement, 0);
+  statement = getStatement("UPDATE Certificate SET default_cert=0 WHERE default_cert=1 AND identity_name=? AND key_identifier=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
@@ -741,10 +811,10 @@ BasicIdentityStorage::setDefaultCertificateNameForKey(const Name& keyName, const
   while (sqlite3_step(statement) == SQLITE_ROW)
     {}
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
   // Set the current default Certificate.
-  sqlite3_prepare_v2(database_, "UPDATE Certificate SET default_cert=1 WHERE identity_name=? AND key_identifier=? AND cert_name=?", -1, &statement, 0);
+  statement = getStatement("UPDATE Certificate SET default_cert=1 WHERE identity_name=? AND key_identifier=? AND cert_name=?");
 
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
@@ -752,7 +822,7 @@ BasicIdentityStorage::setDefaultCertificateNameForKey(const Name& keyName, const
 
   sqlite3_step(statement);
 
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -761,12 +831,11 @@ BasicIdentityStorage::deleteCertificateInfo(const Name& certificateName)
   if (certificateName.size() == 0)
     return;
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2
-    (database_, "DELETE FROM Certificate WHERE cert_name=?", -1, &statement, 0);
+  clearCache();
+  sqlite3_stmt *statement = getStatement("DELETE FROM Certificate WHERE cert_name=?");
   sqlite3_bind_text(statement, 1, certificateName.toUri(), SQLITE_TRANSIENT);
   sqlite3_step(statement);
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -778,24 +847,18 @@ BasicIdentityStorage::deletePublicKeyInfo(const Name& keyName)
   string keyId = keyName.get(-1).toEscapedString();
   Name identityName = keyName.getPrefix(-1);
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2
-    (database_,
-     "DELETE FROM Certificate WHERE identity_name=? and key_identifier=?",
-     -1, &statement, 0);
+  clearCache();
+  sqlite3_stmt *statement = getStatement("DELETE FROM Certificate WHERE identity_name=? and key_identifier=?");
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
   sqlite3_step(statement);
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
-  sqlite3_prepare_v2
-    (database_,
-     "DELETE FROM Key WHERE identity_name=? and key_identifier=?",
-     -1, &statement, 0);
+  statement = getStatement("DELETE FROM Key WHERE identity_name=? and key_identifier=?");
   sqlite3_bind_text(statement, 1, identityName.toUri(), SQLITE_TRANSIENT);
   sqlite3_bind_text(statement, 2, keyId, SQLITE_TRANSIENT);
   sqlite3_step(statement);
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 void
@@ -803,24 +866,21 @@ BasicIdentityStorage::deleteIdentityInfo(const Name& identityName)
 {
   string identity = identityName.toUri();
 
-  sqlite3_stmt *statement;
-  sqlite3_prepare_v2
-    (database_, "DELETE FROM Certificate WHERE identity_name=?", -1, &statement, 0);
+  clearCache();
+  sqlite3_stmt *statement = getStatement("DELETE FROM Certificate WHERE identity_name=?");
   sqlite3_bind_text(statement, 1, identity, SQLITE_TRANSIENT);
   sqlite3_step(statement);
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
-  sqlite3_prepare_v2
-    (database_, "DELETE FROM Key WHERE identity_name=?", -1, &statement, 0);
+  statement = getStatement("DELETE FROM Key WHERE identity_name=?");
   sqlite3_bind_text(statement, 1, identity, SQLITE_TRANSIENT);
   sqlite3_step(statement);
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 
-  sqlite3_prepare_v2
-    (database_, "DELETE FROM Identity WHERE identity_name=?", -1, &statement, 0);
+  statement = getStatement("DELETE FROM Identity WHERE identity_name=?");
   sqlite3_bind_text(statement, 1, identity, SQLITE_TRANSIENT);
   sqlite3_step(statement);
-  sqlite3_finalize(statement);
+  sqlite3_reset(statement);
 }
 
 }
@@ -25,7 +25,12 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include <fstream>
+#include <list>
+#if __cplusplus >= 201103L
+#include <mutex>
+#endif
 #include "../../c/util/crypto.h"
+#include "../../c/util/ndn_memory.h"
 #include "../../encoding/base64.hpp"
 #include "../../encoding/der/der-node.hpp"
 #include <ndn-cpp/security/security-exception.hpp>
@@ -33,6 +38,7 @@
 #include <ndn-cpp/lite/security/ec-private-key-lite.hpp>
 #include <ndn-cpp/lite/security/rsa-private-key-lite.hpp>
 #include <ndn-cpp/security/identity/file-private-key-storage.hpp>
+#include "private-key-signer.hpp"
 
 using namespace std;
 
@@ -41,6 +47,125 @@ namespace ndn {
 static const char *RSA_ENCRYPTION_OID = "1.2.840.113549.1.1.1";
 static const char *EC_ENCRYPTION_OID = "1.2.840.10045.2.1";
 
+class FilePrivateKeyStorage::CachedPrivateKey {
+public:
+  CachedPrivateKey(const struct stat& fileStatus)
+  : modificationTime_(fileStatus.st_mtime),
+    fileSize_(fileStatus.st_size), inode_(fileStatus.st_ino)
+  {
+  }
+
+  /**
+   * Check if the .pri file is still the one which this key was decoded from.
+   * @param fileStatus The result of stat for the .pri file.
+   * @return True if the modification time, size and inode are the same.
+   */
+  bool
+  isCurrent(const struct stat& fileStatus) const
+  {
+    return fileStatus.st_mtime == modificationTime_ &&
+           fileStatus.st_size == fileSize_ && fileStatus.st_ino == inode_;
+  }
+
+  // The signer makes a copy of the key for each thread which signs at once.
+  ptr_lib::shared_ptr<PrivateKeySigner> signer_;
+
+private:
+  time_t modificationTime_;
+  off_t fileSize_;
+  ino_t inode_;
+};
+
+/**
+ * A PrivateKeyCache holds the decoded private keys which sign() keeps in memory,
+ * in the order of their last use.
+ */
+class FilePrivateKeyStorage::PrivateKeyCache {
+public:
+  /**
+   * Find the key and mark it as the most recently used.
+   * @param keyUri The URI of the key name.
+   * @return The key, or null if it is not in the cache.
+   */
+  ptr_lib::shared_ptr<CachedPrivateKey>
+  find(const string& keyUri)
+  {
+    map<string, Entry>::iterator entry = keys_.find(keyUri);
+    if (entry == keys_.end())
+      return ptr_lib::shared_ptr<CachedPrivateKey>();
+
+    lruList_.splice(lruList_.begin(), lruList_, entry->second.lruPosition_);
+    return entry->second.privateKey_;
+  }
+
+  /**
+   * Add the key as the most recently used, replacing any key with the same
+   * URI. If the cache is full, evict the least recently used key. Freeing the
+   * OpenSSL key clears its private values.
+   * @param keyUri The URI of the key name.
+   * @param privateKey The decoded private key.
+   */
+  void
+  insert(const string& keyUri, const ptr_lib::shared_ptr<CachedPrivateKey>& privateKey)
+  {
+    erase(keyUri);
+    if (keys_.size() >= MAX_CACHED_PRIVATE_KEYS) {
+      // Copy the URI since erase removes it from lruList_.
+      string leastRecentlyUsed = lruList_.back();
+      erase(leastRecentlyUsed);
+    }
+
+    Entry& entry = keys_[keyUri];
+    entry.privateKey_ = privateKey;
+    entry.lruPosition_ = lruList_.insert(lruList_.begin(), keyUri);
+  }
+
+  /**
+   * Remove the key from the cache. If it is not in the cache, do nothing.
+   * @param keyUri The URI of the key name.
+   */
+  void
+  erase(const string& keyUri)
+  {
+    map<string, Entry>::iterator entry = keys_.find(keyUri);
+    if (entry == keys_.end())
+      return;
+
+    lruList_.erase(entry->second.lruPosition_);
+    keys_.erase(entry);
+  }
+
+  void
+  clear()
+  {
+    keys_.clear();
+    lruList_.clear();
+  }
+
+#if __cplusplus >= 201103L
+  // This guards the cache so that sign can be called from multiple threads,
+  // for example by IdentityManager to sign a list of Data packets.
+  mutex mutex_;
+#endif
+
+private:
+  class Entry {
+  public:
+    ptr_lib::shared_ptr<CachedPrivateKey> privateKey_;
+    list<string>::iterator lruPosition_;
+  };
+
+  map<string, Entry> keys_; /**< The map key is the keyName.toUri() */
+  // The key URIs with the most recently used at the front.
+  list<string> lruList_;
+};
+
+#if __cplusplus >= 201103L
+#define LOCK_PRIVATE_KEY_CACHE lock_guard<mutex> lock(privateKeyCache_->mutex_)
+#else
+#define LOCK_PRIVATE_KEY_CACHE
+#endif
+
 FilePrivateKeyStorage::FilePrivateKeyStorage()
 {
   // Note: We don't use <filesystem> support because it is not "header-only" and
@@ -56,6 +181,7 @@ FilePrivateKeyStorage::FilePrivateKeyStorage()
     homeDir.erase(homeDir.size() - 1);
 
   keyStorePath_ = homeDir + '/' + ".ndn/ndnsec-tpm-file";
+  privateKeyCache_.reset(new PrivateKeyCache());
   // TODO: Handle non-unix file systems which don't have "mkdir -p".
   ::system(("mkdir -p " + keyStorePath_).c_str());
 }
@@ -195,6 +321,9 @@ FilePrivateKeyStorage::deleteKeyPair(const Name& keyName)
 
   remove(nameTransform(keyUri, ".pub").c_str());
   remove(nameTransform(keyUri, ".pri").c_str());
+
+  LOCK_PRIVATE_KEY_CACHE;
+  privateKeyCache_->erase(keyUri);
 }
 
 ptr_lib::shared_ptr<PublicKey>
@@ -222,68 +351,30 @@ FilePrivateKeyStorage::sign
   (const uint8_t *data, size_t dataLength, const Name& keyName,
    DigestAlgorithm digestAlgorithm)
 {
-  string keyURI = keyName.toUri();
-
-  if (!doesKeyExist(keyName, KEY_CLASS_PRIVATE))
-    throw SecurityException
-      ("FilePrivateKeyStorage::sign: private key doesn't exist");
-
   if (digestAlgorithm != DIGEST_ALGORITHM_SHA256)
     throw SecurityException
       ("FilePrivateKeyStorage::sign: Unsupported digest algorithm");
 
-  // Read the private key.
-  ifstream file(nameTransform(keyURI, ".pri").c_str());
-  stringstream base64;
-  base64 << file.rdbuf();
-  vector<uint8_t> pkcs8Der;
-  fromBase64(base64.str(), pkcs8Der);
-
-  // The private key is generated by NFD which stores as PKCS #8. Decode it
-  // to find the algorithm OID and the inner private key DER.
-  ptr_lib::shared_ptr<DerNode> parsedNode = DerNode::parse(&pkcs8Der[0], 0);
-  const std::vector<ptr_lib::shared_ptr<DerNode> >& pkcs8Children =
-    parsedNode->getChildren();
-  // Get the algorithm OID and parameters.
-  const std::vector<ptr_lib::shared_ptr<DerNode> >& algorithmIdChildren =
-    DerNode::getSequence(pkcs8Children, 1).getChildren();
-  string oidString
-    (dynamic_cast<DerNode::DerOid&>(*algorithmIdChildren[0]).toVal().toRawStr());
-  ptr_lib::shared_ptr<DerNode> algorithmParameters = algorithmIdChildren[1];
-  // Get the value of the 3rd child which is the octet string.
-  Blob privateKeyDer = pkcs8Children[2]->toVal();
+  ptr_lib::shared_ptr<CachedPrivateKey> privateKey =
+    getPrivateKey(keyName.toUri());
 
   // TODO: use RSA_size, etc. to get the proper size of the signature buffer.
   uint8_t signatureBits[1000];
   size_t signatureBitsLength;
   ndn_Error error;
 
-  // Decode the private key and sign.
 #if NDN_CPP_HAVE_LIBCRYPTO
-  if (oidString == RSA_ENCRYPTION_OID) {
-    RsaPrivateKeyLite privateKey;
-    if ((error = privateKey.decode(privateKeyDer)))
-      throw SecurityException
-        (string("FilePrivateKeyStorage::sign RSA: ") + ndn_getErrorString(error));
-
-    if ((error =  privateKey.signWithSha256
-         (data, dataLength, signatureBits, signatureBitsLength)))
-      throw SecurityException
-        (string("FilePrivateKeyStorage::sign RSA: ") + ndn_getErrorString(error));
-  }
-  else if (oidString == EC_ENCRYPTION_OID) {
-    EcPrivateKeyLite privateKey;
-    decodeEcPrivateKey(algorithmParameters, privateKeyDer, privateKey);
-
-    if ((error =  privateKey.signWithSha256
-         (data, dataLength, signatureBits, signatureBitsLength)))
-      throw SecurityException
-        (string("FilePrivateKeyStorage::sign ECDSA: ") + ndn_getErrorString(error));
-  }
-  else
-#endif
+  if ((error = privateKey->signer_->signWithSha256
+       (data, dataLength, signatureBits, signatureBitsLength)))
     throw SecurityException
-      ("FilePrivateKeyStorage::sign: Unrecognized private key OID");
+      (string(privateKey->signer_->getKeyType() == KEY_TYPE_RSA ?
+              "FilePrivateKeyStorage::sign RSA: " :
+              "FilePrivateKeyStorage::sign ECDSA: ") +
+       ndn_getErrorString(error));
+#else
+  throw SecurityException
+    ("FilePrivateKeyStorage::sign: Unrecognized private key type");
+#endif
 
   return Blob(signatureBits, signatureBitsLength);
 }
@@ -328,6 +419,95 @@ FilePrivateKeyStorage::doesKeyExist(const Name& keyName, KeyClass keyClass)
   return file.good();
 }
 
+void
+FilePrivateKeyStorage::clearPrivateKeyCache()
+{
+  LOCK_PRIVATE_KEY_CACHE;
+  privateKeyCache_->clear();
+}
+
+ptr_lib::shared_ptr<FilePrivateKeyStorage::CachedPrivateKey>
+FilePrivateKeyStorage::getPrivateKey(const string& keyUri)
+{
+  string filePath = nameTransform(keyUri, ".pri");
+  struct stat fileStatus;
+  if (::stat(filePath.c_str(), &fileStatus) != 0)
+    throw SecurityException
+      ("FilePrivateKeyStorage::sign: private key doesn't exist");
+
+  LOCK_PRIVATE_KEY_CACHE;
+
+  ptr_lib::shared_ptr<CachedPrivateKey> cached = privateKeyCache_->find(keyUri);
+  // If the file was replaced, decode it again.
+  if (cached && cached->isCurrent(fileStatus))
+    return cached;
+
+  // Read the private key.
+  ifstream file(filePath.c_str());
+  stringstream base64Stream;
+  base64Stream << file.rdbuf();
+  string base64 = base64Stream.str();
+  vector<uint8_t> pkcs8Der;
+  fromBase64(base64, pkcs8Der);
+  ndn_memzero((uint8_t*)&base64[0], base64.size());
+  if (pkcs8Der.size() == 0)
+    throw SecurityException
+      ("FilePrivateKeyStorage::sign: Can't read the private key file");
+
+  // The private key is generated by NFD which stores as PKCS #8. Decode it
+  // to find the algorithm OID and the inner private key DER.
+  ptr_lib::shared_ptr<DerNode> parsedNode = DerNode::parse(&pkcs8Der[0], 0);
+  ndn_memzero(&pkcs8Der[0], pkcs8Der.size());
+  ptr_lib::shared_ptr<CachedPrivateKey> privateKey
+    (new CachedPrivateKey(fileStatus));
+  Blob privateKeyDer;
+  try {
+    const std::vector<ptr_lib::shared_ptr<DerNode> >& pkcs8Children =
+      parsedNode->getChildren();
+    // Get the algorithm OID and parameters.
+    const std::vector<ptr_lib::shared_ptr<DerNode> >& algorithmIdChildren =
+      DerNode::getSequence(pkcs8Children, 1).getChildren();
+    string oidString
+      (dynamic_cast<DerNode::DerOid&>(*algorithmIdChildren[0]).toVal().toRawStr());
+    ptr_lib::shared_ptr<DerNode> algorithmParameters = algorithmIdChildren[1];
+    // Get the value of the 3rd child which is the octet string.
+    privateKeyDer = pkcs8Children[2]->toVal();
+    ndn_Error error;
+
+    // Decode the private key.
+#if NDN_CPP_HAVE_LIBCRYPTO
+    if (oidString == RSA_ENCRYPTION_OID) {
+      RsaPrivateKeyLite rsaPrivateKey;
+      if ((error = rsaPrivateKey.decode(privateKeyDer)))
+        throw SecurityException
+          (string("FilePrivateKeyStorage::sign RSA: ") + ndn_getErrorString(error));
+      privateKey->signer_.reset(new PrivateKeySigner(rsaPrivateKey));
+    }
+    else if (oidString == EC_ENCRYPTION_OID) {
+      EcPrivateKeyLite ecPrivateKey;
+      decodeEcPrivateKey(algorithmParameters, privateKeyDer, ecPrivateKey);
+      privateKey->signer_.reset(new PrivateKeySigner(ecPrivateKey));
+    }
+    else
+#endif
+      throw SecurityException
+        ("FilePrivateKeyStorage::sign: Unrecognized private key OID");
+  } catch (...) {
+    parsedNode->zeroizePayload();
+    ndn_memzero((uint8_t*)privateKeyDer.buf(), privateKeyDer.size());
+    throw;
+  }
+
+  // The parsed nodes and privateKeyDer are copies of the DER payload, so clear
+  // them.
+  parsedNode->zeroizePayload();
+  ndn_memzero((uint8_t*)privateKeyDer.buf(), privateKeyDer.size());
+
+  privateKeyCache_->insert(keyUri, privateKey);
+
+  return privateKey;
+}
+
 string
 FilePrivateKeyStorage::nameTransform
   (const string& keyName, const string& extension)
@@ -38,26 +38,32 @@
 #include <ndn-cpp/security/identity/basic-identity-storage.hpp>
 #include <ndn-cpp/security/identity/file-private-key-storage.hpp>
 #include <ndn-cpp/security/identity/osx-private-key-storage.hpp>
+#include <ndn-cpp/util/logging.hpp>
 #include "../../util/config-file.hpp"
+#include "../../util/thread-pool.hpp"
 #include "../../c/util/time.h"
 #include <ndn-cpp/lite/util/crypto-lite.hpp>
 #include <ndn-cpp/security/identity/identity-manager.hpp>
 
 using namespace std;
+using namespace ndn::func_lib;
+
+INIT_LOGGER("ndn.IdentityManager");
 
 namespace ndn {
 
 IdentityManager::IdentityManager
   (const ptr_lib::shared_ptr<IdentityStorage>& identityStorage,
    const ptr_lib::shared_ptr<PrivateKeyStorage>& privateKeyStorage)
-: identityStorage_(identityStorage), privateKeyStorage_(privateKeyStorage)
+: identityStorage_(identityStorage), privateKeyStorage_(privateKeyStorage),
+  signingThreadCount_(0)
 {
   // Don't call checkTpm() when using a custom PrivateKeyStorage.
 }
 
 IdentityManager::IdentityManager
   (const ptr_lib::shared_ptr<IdentityStorage>& identityStorage)
-: identityStorage_(identityStorage)
+: identityStorage_(identityStorage), signingThreadCount_(0)
 {
   ConfigFile config;
   string canonicalTpmLocator;
@@ -67,6 +73,7 @@ IdentityManager::IdentityManager
 }
 
 IdentityManager::IdentityManager()
+: signingThreadCount_(0)
 {
   ConfigFile config;
   identityStorage_ = getDefaultIdentityStorage(config);
@@ -454,17 +461,204 @@ IdentityManager::signByCertificate(Data &data, const Name &certificateName, Wire
   ptr_lib::shared_ptr<Signature> signature = makeSignatureByCertificate
     (certificateName, digestAlgorithm);
 
+  Name keyName = IdentityCertificate::certificateNameToPublicKeyName
+    (certificateName);
+
+  // Reserve the length of the previous signature with this key, which is the
+  // same for RSA and at most a few bytes different for ECDSA. The first time,
+  // wireEncodeWithSignature encodes again.
+  string keyUri = keyName.toUri();
+  map<string, size_t>::iterator reservedLength = signatureLengths_.find(keyUri);
+
   data.setSignature(*signature);
-  // Encode once to get the signed portion.
-  SignedBlob encoding = data.wireEncode(wireFormat);
+  data.wireEncodeWithSignature
+    (bind(&IdentityManager::signSignedPortion, this, _1, _2, keyName,
+          digestAlgorithm),
+     reservedLength != signatureLengths_.end() ? reservedLength->second : 0,
+     wireFormat);
+
+  size_t signatureLength = data.getSignature()->getSignature().size();
+  if (reservedLength == signatureLengths_.end())
+    signatureLengths_[keyUri] = signatureLength;
+  else if (signatureLength > reservedLength->second)
+    reservedLength->second = signatureLength;
+}
 
-  data.getSignature()->setSignature
-    (privateKeyStorage_->sign(encoding.signedBuf(), encoding.signedSize(),
-     IdentityCertificate::certificateNameToPublicKeyName(certificateName),
-     digestAlgorithm));
+void
+IdentityManager::signByCertificate
+  (const vector<Data*>& dataList, const Name& certificateName,
+   WireFormat& wireFormat)
+{
+  vector<ThreadPool::Task> tasks;
+  vector<string> errors;
+  makeSignDataListTasks(dataList, certificateName, wireFormat, tasks, errors);
+  getSigningThreadPool().runAll(tasks);
+
+  for (size_t i = 0; i < errors.size(); ++i) {
+    if (errors[i] != "")
+      throw SecurityException(errors[i]);
+  }
+
+  // Update the length to reserve if a signature was longer.
+  map<string, size_t>::iterator reservedLength = signatureLengths_.find
+    (IdentityCertificate::certificateNameToPublicKeyName(certificateName)
+     .toUri());
+  if (reservedLength != signatureLengths_.end()) {
+    for (size_t i = 0; i < dataList.size(); ++i)
+      reservedLength->second = max
+        (reservedLength->second, dataList[i]->getSignature()->getSignature().size());
+  }
+}
+
+/**
+ * This is the ThreadPool onAllDone for signByCertificateAsync. The bound
+ * dataPointers and errors are used by the tasks, so binding them here keeps them
+ * until the tasks are done.
+ */
+static void
+onDataListSignDone
+  (const ptr_lib::shared_ptr<vector<ptr_lib::shared_ptr<Data> > >& dataList,
+   const ptr_lib::shared_ptr<vector<Data*> >& dataPointers,
+   const ptr_lib::shared_ptr<vector<string> >& errors,
+   const OnDataListSigned& onSigned, const OnDataListSignFailed& onFailed)
+{
+  for (size_t i = 0; i < errors->size(); ++i) {
+    if ((*errors)[i] != "") {
+      try {
+        onFailed(*dataList, (*errors)[i]);
+      } catch (const std::exception& ex) {
+        _LOG_ERROR("IdentityManager::signByCertificateAsync: Error in onFailed: " << ex.what());
+      } catch (...) {
+        _LOG_ERROR("IdentityManager::signByCertificateAsync: Error in onFailed.");
+      }
+      return;
+    }
+  }
+
+  try {
+    onSigned(*dataList);
+  } catch (const std::exception& ex) {
+    _LOG_ERROR("IdentityManager::signByCertificateAsync: Error in onSigned: " << ex.what());
+  } catch (...) {
+    _LOG_ERROR("IdentityManager::signByCertificateAsync: Error in onSigned.");
+  }
+}
+
+void
+IdentityManager::signByCertificateAsync
+  (const vector<ptr_lib::shared_ptr<Data> >& dataList,
+   const Name& certificateName, const OnDataListSigned& onSigned,
+   const OnDataListSignFailed& onFailed, WireFormat& wireFormat)
+{
+  // Copy the list so that the shared_ptrs are held until the tasks are done.
+  ptr_lib::shared_ptr<vector<ptr_lib::shared_ptr<Data> > > dataListCopy
+    (new vector<ptr_lib::shared_ptr<Data> >(dataList));
+  ptr_lib::shared_ptr<vector<Data*> > dataPointers(new vector<Data*>());
+  for (size_t i = 0; i < dataList.size(); ++i)
+    dataPointers->push_back(dataList[i].get());
+
+  vector<ThreadPool::Task> tasks;
+  ptr_lib::shared_ptr<vector<string> > errors(new vector<string>());
+  try {
+    makeSignDataListTasks
+      (*dataPointers, certificateName, wireFormat, tasks, *errors);
+  } catch (const std::exception& ex) {
+    // Finding the key or signing the first packet failed. With no tasks,
+    // submitAll calls onDataListSignDone now which reports the error.
+    tasks.clear();
+    errors->assign(1, ex.what());
+  } catch (...) {
+    tasks.clear();
+    errors->assign(1, "IdentityManager: Unknown error signing a Data packet");
+  }
+  getSigningThreadPool().submitAll
+    (tasks, bind(&onDataListSignDone, dataListCopy, dataPointers, errors,
+                 onSigned, onFailed));
+}
+
+void
+IdentityManager::setSigningThreadCount(size_t nThreads)
+{
+  if (nThreads != signingThreadCount_) {
+    signingThreadCount_ = nThreads;
+    // getSigningThreadPool() will create a pool with the new thread count.
+    signingThreadPool_.reset();
+  }
+}
 
-  // Encode again to include the signature.
-  data.wireEncode(wireFormat);
+ThreadPool&
+IdentityManager::getSigningThreadPool()
+{
+  if (!signingThreadPool_)
+    signingThreadPool_.reset(new ThreadPool(signingThreadCount_));
+
+  return *signingThreadPool_;
+}
+
+void
+IdentityManager::makeSignDataListTasks
+  (const vector<Data*>& dataList, const Name& certificateName,
+   WireFormat& wireFormat, vector<ThreadPool::Task>& tasks,
+   vector<string>& errors)
+{
+  if (dataList.size() == 0)
+    return;
+
+  DigestAlgorithm digestAlgorithm;
+  ptr_lib::shared_ptr<Signature> signature = makeSignatureByCertificate
+    (certificateName, digestAlgorithm);
+  Name keyName = IdentityCertificate::certificateNameToPublicKeyName
+    (certificateName);
+
+  size_t iFirst = 0;
+  map<string, size_t>::iterator reservedLength = signatureLengths_.find
+    (keyName.toUri());
+  if (reservedLength == signatureLengths_.end()) {
+    // Sign the first packet here to learn the signature length. This also
+    // lets the PrivateKeyStorage load the key before the threads use it.
+    signByCertificate(*dataList[0], certificateName, wireFormat);
+    reservedLength = signatureLengths_.find(keyName.toUri());
+    iFirst = 1;
+  }
+
+  // Set the signature objects here so that the tasks don't copy the shared
+  // signature object at the same time.
+  for (size_t i = iFirst; i < dataList.size(); ++i)
+    dataList[i]->setSignature(*signature);
+
+  // Make one task for each thread, each with a contiguous part of the list so
+  // that the packets stay in order.
+  size_t nData = dataList.size() - iFirst;
+  size_t nTasks = min(getSigningThreadPool().getThreadCount(), nData);
+  errors.resize(nTasks);
+  size_t begin = iFirst;
+  for (size_t i = 0; i < nTasks; ++i) {
+    size_t end = begin + nData / nTasks + (i < nData % nTasks ? 1 : 0);
+    tasks.push_back(bind
+      (&IdentityManager::signDataListPart, this, &dataList[begin], end - begin,
+       keyName, digestAlgorithm, reservedLength->second, &wireFormat,
+       &errors[i]));
+    begin = end;
+  }
+}
+
+void
+IdentityManager::signDataListPart
+  (Data* const* dataList, size_t nData, const Name& keyName,
+   DigestAlgorithm digestAlgorithm, size_t reservedLength,
+   WireFormat* wireFormat, string* error)
+{
+  try {
+    for (size_t i = 0; i < nData; ++i)
+      dataList[i]->wireEncodeWithSignature
+        (bind(&IdentityManager::signSignedPortion, this, _1, _2, keyName,
+              digestAlgorithm),
+         reservedLength, *wireFormat);
+  } catch (const std::exception& ex) {
+    *error = ex.what();
+  } catch (...) {
+    *error = "IdentityManager: Unknown error signing a Data packet";
+  }
 }
 
 void
@@ -496,19 +690,8 @@ void
 IdentityManager::signWithSha256(Data &data, WireFormat& wireFormat)
 {
   data.setSignature(DigestSha256Signature());
-
-  // Encode once to get the signed portion.
-  SignedBlob encoding = data.wireEncode(wireFormat);
-
-  // Digest and set the signature.
-  uint8_t signedPortionDigest[ndn_SHA256_DIGEST_SIZE];
-  CryptoLite::digestSha256
-    (encoding.getSignedPortionBlobLite(), signedPortionDigest);
-  data.getSignature()->setSignature
-    (Blob(signedPortionDigest, sizeof(signedPortionDigest)));
-
-  // Encode again to include the signature.
-  data.wireEncode(wireFormat);
+  data.wireEncodeWithSignature
+    (&digestSignedPortion, ndn_SHA256_DIGEST_SIZE, wireFormat);
 }
 
 void
@@ -595,6 +778,25 @@ IdentityManager::getKeyNameFromCertificatePrefix(const Name & certificatePrefix)
   return result;
 }
 
+Blob
+IdentityManager::signSignedPortion
+  (const uint8_t* signedPortion, size_t signedPortionLength,
+   const Name& keyName, DigestAlgorithm digestAlgorithm)
+{
+  return privateKeyStorage_->sign
+    (signedPortion, signedPortionLength, keyName, digestAlgorithm);
+}
+
+Blob
+IdentityManager::digestSignedPortion
+  (const uint8_t* signedPortion, size_t signedPortionLength)
+{
+  ptr_lib::shared_ptr<vector<uint8_t> > digest
+    (new vector<uint8_t>(ndn_SHA256_DIGEST_SIZE));
+  CryptoLite::digestSha256(signedPortion, signedPortionLength, &digest->front());
+  return Blob(digest, false);
+}
+
 ptr_lib::shared_ptr<Signature>
 IdentityManager::makeSignatureByCertificate
   (const Name& certificateName, DigestAlgorithm& digestAlgorithm)
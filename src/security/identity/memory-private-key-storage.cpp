@@ -22,6 +22,7 @@
 #include <stdexcept>
 #include "../../c/util/crypto.h"
 #include "../../encoding/der/der-node.hpp"
+#include "private-key-signer.hpp"
 #include <ndn-cpp/security/security-exception.hpp>
 #include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
 
@@ -191,14 +192,9 @@ MemoryPrivateKeyStorage::sign(const uint8_t* data, size_t dataLength, const Name
   if (privateKey == privateKeyStore_.end())
     throw SecurityException(string("MemoryPrivateKeyStorage: Cannot find private key ") + keyName.toUri());
 #if NDN_CPP_HAVE_LIBCRYPTO
-  if (privateKey->second->getKeyType() == KEY_TYPE_RSA) {
-    if ((error =  privateKey->second->getRsaPrivateKey().signWithSha256
-         (data, dataLength, signatureBits, signatureBitsLength)))
-      throw SecurityException
-        (string("MemoryPrivateKeyStorage::sign: ") + ndn_getErrorString(error));
-  }
-  else if (privateKey->second->getKeyType() == KEY_TYPE_ECDSA) {
-    if ((error =  privateKey->second->getEcPrivateKey().signWithSha256
+  if (privateKey->second->getKeyType() == KEY_TYPE_RSA ||
+      privateKey->second->getKeyType() == KEY_TYPE_ECDSA) {
+    if ((error = privateKey->second->getSigner().signWithSha256
          (data, dataLength, signatureBits, signatureBitsLength)))
       throw SecurityException
         (string("MemoryPrivateKeyStorage::sign: ") + ndn_getErrorString(error));
@@ -249,14 +245,18 @@ MemoryPrivateKeyStorage::PrivateKey::PrivateKey
 
 #if NDN_CPP_HAVE_LIBCRYPTO
   if (keyType == KEY_TYPE_RSA) {
-    if ((error = rsaPrivateKey_.decode(keyDer, keyDerLength)))
+    RsaPrivateKeyLite rsaPrivateKey;
+    if ((error = rsaPrivateKey.decode(keyDer, keyDerLength)))
       throw SecurityException
         (string("PrivateKey constructor: ") + ndn_getErrorString(error));
+    signer_.reset(new PrivateKeySigner(rsaPrivateKey));
   }
   else if (keyType == KEY_TYPE_ECDSA) {
-    if ((error = ecPrivateKey_.decode(keyDer, keyDerLength)))
+    EcPrivateKeyLite ecPrivateKey;
+    if ((error = ecPrivateKey.decode(keyDer, keyDerLength)))
       throw SecurityException
         (string("PrivateKey constructor: ") + ndn_getErrorString(error));
+    signer_.reset(new PrivateKeySigner(ecPrivateKey));
   }
   else
 #endif
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include <ndn-cpp/security/security-exception.hpp>
+#include "../../c/util/crypto.h"
+#include "../../c/util/ndn_memory.h"
+#include "private-key-signer.hpp"
+
+using namespace std;
+
+namespace ndn {
+
+#if NDN_CPP_HAVE_LIBCRYPTO
+
+#if __cplusplus >= 201103L
+#define LOCK_FREE_KEYS lock_guard<mutex> lock(mutex_)
+#else
+#define LOCK_FREE_KEYS
+#endif
+
+PrivateKeySigner::PrivateKeySigner(const RsaPrivateKeyLite& privateKey)
+: keyType_(KEY_TYPE_RSA)
+{
+  ndn_Error error;
+  size_t encodingLength;
+  if ((error = privateKey.encodePrivateKey(0, encodingLength)))
+    throw SecurityException
+      (string("PrivateKeySigner: ") + ndn_getErrorString(error));
+  privateKeyDer_.resize(encodingLength);
+  if ((error = privateKey.encodePrivateKey(&privateKeyDer_[0], encodingLength)))
+    throw SecurityException
+      (string("PrivateKeySigner: ") + ndn_getErrorString(error));
+}
+
+PrivateKeySigner::PrivateKeySigner(const EcPrivateKeyLite& privateKey)
+: keyType_(KEY_TYPE_ECDSA)
+{
+  // Include the parameters so that EcPrivateKeyLite::decode can find the curve.
+  ndn_Error error;
+  size_t encodingLength;
+  if ((error = privateKey.encodePrivateKey(true, 0, encodingLength)))
+    throw SecurityException
+      (string("PrivateKeySigner: ") + ndn_getErrorString(error));
+  privateKeyDer_.resize(encodingLength);
+  if ((error = privateKey.encodePrivateKey
+       (true, &privateKeyDer_[0], encodingLength)))
+    throw SecurityException
+      (string("PrivateKeySigner: ") + ndn_getErrorString(error));
+}
+
+PrivateKeySigner::~PrivateKeySigner()
+{
+  if (privateKeyDer_.size() > 0)
+    ndn_memzero(&privateKeyDer_[0], privateKeyDer_.size());
+}
+
+ndn_Error
+PrivateKeySigner::signWithSha256
+  (const uint8_t* data, size_t dataLength, uint8_t* signature,
+   size_t& signatureLength)
+{
+  if (keyType_ == KEY_TYPE_RSA)
+    return signWithFreeKey
+      (freeRsaKeys_, data, dataLength, signature, signatureLength);
+  else
+    return signWithFreeKey
+      (freeEcKeys_, data, dataLength, signature, signatureLength);
+}
+
+template<class KeyLite> ndn_Error
+PrivateKeySigner::signWithFreeKey
+  (vector<ptr_lib::shared_ptr<KeyLite> >& freeKeys, const uint8_t* data,
+   size_t dataLength, uint8_t* signature, size_t& signatureLength)
+{
+  ptr_lib::shared_ptr<KeyLite> privateKey;
+  {
+    LOCK_FREE_KEYS;
+    if (!freeKeys.empty()) {
+      privateKey = freeKeys.back();
+      freeKeys.pop_back();
+    }
+  }
+
+  ndn_Error error;
+  if (!privateKey) {
+    // All the copies are in use by other threads, so make a new one.
+    privateKey.reset(new KeyLite());
+    if ((error = privateKey->decode(&privateKeyDer_[0], privateKeyDer_.size())))
+      return error;
+  }
+
+  error = privateKey->signWithSha256
+    (data, dataLength, signature, signatureLength);
+
+  LOCK_FREE_KEYS;
+  freeKeys.push_back(privateKey);
+  return error;
+}
+
+#endif // NDN_CPP_HAVE_LIBCRYPTO
+
+}
@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_PRIVATE_KEY_SIGNER_HPP
+#define NDN_PRIVATE_KEY_SIGNER_HPP
+
+#include <vector>
+#if __cplusplus >= 201103L
+#include <mutex>
+#endif
+#include <ndn-cpp/common.hpp>
+#include <ndn-cpp/security/security-common.hpp>
+#include <ndn-cpp/lite/security/ec-private-key-lite.hpp>
+#include <ndn-cpp/lite/security/rsa-private-key-lite.hpp>
+
+namespace ndn {
+
+/**
+ * A PrivateKeySigner signs with an RSA or EC private key from multiple threads
+ * at once. An OpenSSL key object must not be used by two threads at the same
+ * time, since signing updates its RSA blinding and Montgomery caches. So each
+ * call to signWithSha256 takes a copy of the key which no other thread is
+ * using, and returns it to a free list when done. If all the copies are in use,
+ * this decodes a new copy from the saved private key DER, so there are no more
+ * copies than threads which have signed at once.
+ */
+class PrivateKeySigner {
+public:
+  /**
+   * Create a PrivateKeySigner for the RSA private key. This saves the encoding
+   * of the key to make copies of it.
+   * @param privateKey The decoded RSA private key. This does not keep a
+   * reference to it.
+   * @throws SecurityException if the key can't be encoded.
+   */
+  PrivateKeySigner(const RsaPrivateKeyLite& privateKey);
+
+  /**
+   * Create a PrivateKeySigner for the EC private key. This saves the encoding
+   * of the key (with the EC parameters) to make copies of it.
+   * @param privateKey The decoded EC private key. This does not keep a
+   * reference to it.
+   * @throws SecurityException if the key can't be encoded.
+   */
+  PrivateKeySigner(const EcPrivateKeyLite& privateKey);
+
+  /**
+   * Clear the saved private key DER. Freeing the copies of the key clears their
+   * private values.
+   */
+  ~PrivateKeySigner();
+
+  /**
+   * Get the type of the private key.
+   * @return KEY_TYPE_RSA or KEY_TYPE_ECDSA.
+   */
+  KeyType
+  getKeyType() const { return keyType_; }
+
+  /**
+   * Sign the data with RsaWithSha256 or EcdsaWithSha256, using a copy of the
+   * private key which no other thread is using.
+   * @param data A pointer to the input byte array to sign.
+   * @param dataLength The length of data.
+   * @param signature A pointer to the signature output buffer. The caller must
+   * provide a buffer large enough to receive the signature bytes.
+   * @param signatureLength Set signatureLength to the number of bytes placed in
+   * the signature buffer.
+   * @return 0 for success, else NDN_ERROR_Error_decoding_key if can't make a
+   * copy of the key, or NDN_ERROR_Error_in_sign_operation if can't complete
+   * the sign operation.
+   */
+  ndn_Error
+  signWithSha256
+    (const uint8_t* data, size_t dataLength, uint8_t* signature,
+     size_t& signatureLength);
+
+private:
+  // Don't allow copying.
+  PrivateKeySigner(const PrivateKeySigner& other);
+  PrivateKeySigner& operator=(const PrivateKeySigner& other);
+
+  /**
+   * Take a key from freeKeys, or decode a new one from privateKeyDer_, sign
+   * with it and return it to freeKeys.
+   */
+  template<class KeyLite> ndn_Error
+  signWithFreeKey
+    (std::vector<ptr_lib::shared_ptr<KeyLite> >& freeKeys, const uint8_t* data,
+     size_t dataLength, uint8_t* signature, size_t& signatureLength);
+
+  KeyType keyType_;
+  std::vector<uint8_t> privateKeyDer_;
+  std::vector<ptr_lib::shared_ptr<RsaPrivateKeyLite> > freeRsaKeys_;
+  std::vector<ptr_lib::shared_ptr<EcPrivateKeyLite> > freeEcKeys_;
+#if __cplusplus >= 201103L
+  // This guards the free lists.
+  std::mutex mutex_;
+#endif
+};
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "../../encoding/der/der-node.hpp"
 #include "../../c/util/crypto.h"
+#include "../../c/util/ndn_memory.h"
 #include <ndn-cpp/security/security-exception.hpp>
 #include <ndn-cpp/security/identity/private-key-storage.hpp>
 
@@ -91,13 +92,19 @@ PrivateKeyStorage::decodeEcPrivateKey
   ptr_lib::shared_ptr<DerNode> parsedNode = DerNode::parse(privateKeyDer.buf(), 0);
   DerNode::DerOctetString* octetString = dynamic_cast<DerNode::DerOctetString*>
     (parsedNode->getChildren()[1].get());
-  if (!octetString)
+  if (!octetString) {
+    parsedNode->zeroizePayload();
     throw SecurityException
       ("FilePrivateKeyStorage::decodeEcPrivateKey: Can't get the private key octet string");
+  }
   Blob octetStringValue = octetString->toVal();
 
-  ndn_Error error;
-  if ((error = privateKey.setByCurve(curveId, octetStringValue)))
+  ndn_Error error = privateKey.setByCurve(curveId, octetStringValue);
+  // The parsed nodes and octetStringValue are copies of the private key, so
+  // clear them.
+  parsedNode->zeroizePayload();
+  ndn_memzero((uint8_t*)octetStringValue.buf(), octetStringValue.size());
+  if (error)
     throw SecurityException
       (string("PrivateKeyStorage::decodeEcPrivateKey ") + ndn_getErrorString(error));
 }
@@ -39,6 +39,17 @@ namespace ndn {
 
 const RsaKeyParams KeyChain::DEFAULT_KEY_PARAMS;
 
+/**
+ * A PendingCertificateFetch holds the ValidationRequests which are waiting for
+ * the same certificate Interest, and the function to call for each if the
+ * fetch fails.
+ */
+class KeyChain::PendingCertificateFetch {
+public:
+  std::vector<ptr_lib::shared_ptr<ValidationRequest> > nextSteps_;
+  std::vector<OnCertificateFetchFailed> onFetchFailed_;
+};
+
 KeyChain::KeyChain
   (const ptr_lib::shared_ptr<IdentityManager>& identityManager,
    const ptr_lib::shared_ptr<PolicyManager>& policyManager)
@@ -96,6 +107,40 @@ KeyChain::signByIdentity(const uint8_t* buffer, size_t bufferLength, const Name&
   return identityManager_->signByCertificate(buffer, bufferLength, signingCertificateName);
 }
 
+/**
+ * This is the OnCertificateFetchFailed for verifyData.
+ */
+static void
+onDataCertificateFetchFailed
+  (const string& reason, const OnDataValidationFailed& onValidationFailed,
+   const ptr_lib::shared_ptr<Data>& data)
+{
+  try {
+    onValidationFailed(data, reason);
+  } catch (const std::exception& ex) {
+    _LOG_ERROR("KeyChain::onCertificateInterestTimeout: Error in onValidationFailed: " << ex.what());
+  } catch (...) {
+    _LOG_ERROR("KeyChain::onCertificateInterestTimeout: Error in onValidationFailed.");
+  }
+}
+
+/**
+ * This is the OnCertificateFetchFailed for verifyInterest.
+ */
+static void
+onInterestCertificateFetchFailed
+  (const string& reason, const OnInterestValidationFailed& onValidationFailed,
+   const ptr_lib::shared_ptr<Interest>& interest)
+{
+  try {
+    onValidationFailed(interest, reason);
+  } catch (const std::exception& ex) {
+    _LOG_ERROR("KeyChain::onCertificateInterestTimeout: Error in onValidationFailed: " << ex.what());
+  } catch (...) {
+    _LOG_ERROR("KeyChain::onCertificateInterestTimeout: Error in onValidationFailed.");
+  }
+}
+
 void
 KeyChain::verifyData
   (const ptr_lib::shared_ptr<Data>& data, const OnVerified& onVerified,
@@ -107,11 +152,8 @@ KeyChain::verifyData
     ptr_lib::shared_ptr<ValidationRequest> nextStep = policyManager_->checkVerificationPolicy
       (data, stepCount, onVerified, onValidationFailed);
     if (nextStep)
-      face_->expressInterest
-        (*nextStep->interest_,
-         bind(&KeyChain::onCertificateData, this, _1, _2, nextStep),
-         bind(&KeyChain::onCertificateInterestTimeout, this, _1, 
-              nextStep->retry_, onValidationFailed, data, nextStep));
+      fetchCertificate
+        (nextStep, bind(&onDataCertificateFetchFailed, _1, onValidationFailed, data));
   }
   else if (policyManager_->skipVerifyAndTrust(*data)) {
     try {
@@ -169,11 +211,9 @@ KeyChain::verifyInterest
       policyManager_->checkVerificationPolicy
         (interest, stepCount, onVerified, onValidationFailed, wireFormat);
     if (nextStep)
-      face_->expressInterest
-        (*nextStep->interest_,
-         bind(&KeyChain::onCertificateData, this, _1, _2, nextStep),
-         bind(&KeyChain::onCertificateInterestTimeoutForVerifyInterest, this,
-              _1, nextStep->retry_, onValidationFailed, interest, nextStep));
+      fetchCertificate
+        (nextStep, bind
+         (&onInterestCertificateFetchFailed, _1, onValidationFailed, interest));
   }
   else if (policyManager_->skipVerifyAndTrust(*interest)) {
     try {
@@ -221,21 +261,29 @@ KeyChain::verifyInterest
 }
 
 #if NDN_CPP_HAVE_LIBCRYPTO
-void
-KeyChain::signWithHmacWithSha256
-  (Data& data, const Blob& key, WireFormat& wireFormat)
+/**
+ * Return the HmacWithSha256 of the signed portion. This is the
+ * Data::ComputeSignature callback for signWithHmacWithSha256.
+ */
+static Blob
+computeHmacOfSignedPortion
+  (const uint8_t* signedPortion, size_t signedPortionLength, const Blob& key)
 {
-  // Encode once to get the signed portion.
-  SignedBlob encoding = data.wireEncode(wireFormat);
-
   ptr_lib::shared_ptr<vector<uint8_t>> signatureBits
     (new vector<uint8_t>(ndn_SHA256_DIGEST_SIZE));
   CryptoLite::computeHmacWithSha256
-    (key, encoding.getSignedPortionBlobLite(), &signatureBits->front());
-  data.getSignature()->setSignature(Blob(signatureBits, false));
+    (key.buf(), key.size(), signedPortion, signedPortionLength,
+     &signatureBits->front());
+  return Blob(signatureBits, false);
+}
 
-  // Encode again to include the signature.
-  data.wireEncode(wireFormat);
+void
+KeyChain::signWithHmacWithSha256
+  (Data& data, const Blob& key, WireFormat& wireFormat)
+{
+  data.wireEncodeWithSignature
+    (bind(&computeHmacOfSignedPortion, _1, _2, key), ndn_SHA256_DIGEST_SIZE,
+     wireFormat);
 }
 
 void
@@ -304,70 +352,133 @@ KeyChain::verifyInterestWithHmacWithSha256
 #endif
 
 void
-KeyChain::onCertificateData(const ptr_lib::shared_ptr<const Interest> &interest, const ptr_lib::shared_ptr<Data> &data, ptr_lib::shared_ptr<ValidationRequest> nextStep)
+KeyChain::fetchCertificate
+  (const ptr_lib::shared_ptr<ValidationRequest>& nextStep,
+   const OnCertificateFetchFailed& onFetchFailed)
 {
-  // Try to verify the certificate (data) according to the parameters in nextStep.
-  verifyData
-    (data, nextStep->onVerified_, nextStep->onValidationFailed_,
-     nextStep->stepCount_);
+  const Name& certificateName = nextStep->interest_->getName();
+  map<Name, ptr_lib::shared_ptr<PendingCertificateFetch> >::iterator found =
+    pendingCertificateFetches_.find(certificateName);
+  if (found != pendingCertificateFetches_.end()) {
+    // Wait for the Interest which was already sent.
+    found->second->nextSteps_.push_back(nextStep);
+    found->second->onFetchFailed_.push_back(onFetchFailed);
+    return;
+  }
+
+  ptr_lib::shared_ptr<PendingCertificateFetch> pending
+    (new PendingCertificateFetch());
+  pending->nextSteps_.push_back(nextStep);
+  pending->onFetchFailed_.push_back(onFetchFailed);
+  pendingCertificateFetches_[certificateName] = pending;
+
+  face_->expressInterest
+    (*nextStep->interest_, bind(&KeyChain::onCertificateData, this, _1, _2),
+     bind(&KeyChain::onCertificateInterestTimeout, this, _1, nextStep->retry_));
 }
 
-void
-KeyChain::onCertificateInterestTimeout
-  (const ptr_lib::shared_ptr<const Interest> &interest, int retry,
-   const OnDataValidationFailed& onValidationFailed,
-   const ptr_lib::shared_ptr<Data> &data,
-   ptr_lib::shared_ptr<ValidationRequest> nextStep)
+/**
+ * Call the onVerified_ of each ValidationRequest which waited for the
+ * certificate.
+ */
+static void
+onSharedCertificateVerified
+  (const ptr_lib::shared_ptr<Data>& certificate,
+   const vector<ptr_lib::shared_ptr<ValidationRequest> >& nextSteps)
 {
-  if (retry > 0)
-    // Issue the same expressInterest as in verifyData except decrement retry.
-    face_->expressInterest
-      (*interest,
-       bind(&KeyChain::onCertificateData, this, _1, _2, nextStep),
-       bind(&KeyChain::onCertificateInterestTimeout, this, _1, retry - 1, 
-            onValidationFailed, data, nextStep));
-  else {
+  for (size_t i = 0; i < nextSteps.size(); ++i) {
     try {
-      onValidationFailed
-        (data,
-         "The retry count is zero after timeout for fetching " +
-         interest->getName().toUri());
+      nextSteps[i]->onVerified_(certificate);
     } catch (const std::exception& ex) {
-      _LOG_ERROR("KeyChain::onCertificateInterestTimeout: Error in onValidationFailed: " << ex.what());
+      _LOG_ERROR("KeyChain::onCertificateData: Error in onVerified: " << ex.what());
     } catch (...) {
-      _LOG_ERROR("KeyChain::onCertificateInterestTimeout: Error in onValidationFailed.");
+      _LOG_ERROR("KeyChain::onCertificateData: Error in onVerified.");
     }
   }
 }
 
-void
-KeyChain::onCertificateInterestTimeoutForVerifyInterest
-  (const ptr_lib::shared_ptr<const Interest> &interest, int retry,
-   const OnInterestValidationFailed& onValidationFailed,
-   const ptr_lib::shared_ptr<Interest>& originalInterest,
-   ptr_lib::shared_ptr<ValidationRequest> nextStep)
+/**
+ * Call the onValidationFailed_ of each ValidationRequest which waited for the
+ * certificate.
+ */
+static void
+onSharedCertificateValidationFailed
+  (const ptr_lib::shared_ptr<Data>& certificate, const string& reason,
+   const vector<ptr_lib::shared_ptr<ValidationRequest> >& nextSteps)
 {
-  if (retry > 0)
-    // Issue the same expressInterest as in verifyInterest except decrement retry.
-    face_->expressInterest
-      (*interest,
-       bind(&KeyChain::onCertificateData, this, _1, _2, nextStep),
-       bind(&KeyChain::onCertificateInterestTimeoutForVerifyInterest, this,
-            _1, retry - 1, onValidationFailed, originalInterest, nextStep));
-  else {
+  for (size_t i = 0; i < nextSteps.size(); ++i) {
     try {
-      onValidationFailed
-        (originalInterest,
-         "The retry count is zero after timeout for fetching " +
-         interest->getName().toUri());
+      nextSteps[i]->onValidationFailed_(certificate, reason);
     } catch (const std::exception& ex) {
-      _LOG_ERROR("KeyChain::onCertificateInterestTimeoutForVerifyInterest: Error in onValidationFailed: " << ex.what());
+      _LOG_ERROR("KeyChain::onCertificateData: Error in onValidationFailed: " << ex.what());
     } catch (...) {
-      _LOG_ERROR("KeyChain::onCertificateInterestTimeoutForVerifyInterest: Error in onValidationFailed.");
+      _LOG_ERROR("KeyChain::onCertificateData: Error in onValidationFailed.");
     }
   }
 }
 
+void
+KeyChain::onCertificateData(const ptr_lib::shared_ptr<const Interest> &interest, const ptr_lib::shared_ptr<Data> &data)
+{
+  map<Name, ptr_lib::shared_ptr<PendingCertificateFetch> >::iterator found =
+    pendingCertificateFetches_.find(interest->getName());
+  if (found == pendingCertificateFetches_.end())
+    // We don't expect this to happen.
+    return;
+  // Erase before verifying since a callback may fetch the same name again.
+  ptr_lib::shared_ptr<PendingCertificateFetch> pending = found->second;
+  pendingCertificateFetches_.erase(found);
+
+  if (pending->nextSteps_.size() == 1) {
+    // Try to verify the certificate (data) according to the parameters in nextStep.
+    const ValidationRequest& nextStep = *pending->nextSteps_[0];
+    verifyData
+      (data, nextStep.onVerified_, nextStep.onValidationFailed_,
+       nextStep.stepCount_);
+    return;
+  }
+
+  // Verify the certificate once for each stepCount of the waiting requests,
+  // and release all the requests with that stepCount.
+  map<int, vector<ptr_lib::shared_ptr<ValidationRequest> > > byStepCount;
+  for (size_t i = 0; i < pending->nextSteps_.size(); ++i)
+    byStepCount[pending->nextSteps_[i]->stepCount_].push_back
+      (pending->nextSteps_[i]);
+
+  for (map<int, vector<ptr_lib::shared_ptr<ValidationRequest> > >::iterator
+         it = byStepCount.begin(); it != byStepCount.end(); ++it)
+    verifyData
+      (data, bind(&onSharedCertificateVerified, _1, it->second),
+       (const OnDataValidationFailed)bind
+         (&onSharedCertificateValidationFailed, _1, _2, it->second),
+       it->first);
+}
+
+void
+KeyChain::onCertificateInterestTimeout
+  (const ptr_lib::shared_ptr<const Interest> &interest, int retry)
+{
+  if (retry > 0) {
+    // Issue the same expressInterest as in fetchCertificate except decrement retry.
+    face_->expressInterest
+      (*interest, bind(&KeyChain::onCertificateData, this, _1, _2),
+       bind(&KeyChain::onCertificateInterestTimeout, this, _1, retry - 1));
+    return;
+  }
+
+  map<Name, ptr_lib::shared_ptr<PendingCertificateFetch> >::iterator found =
+    pendingCertificateFetches_.find(interest->getName());
+  if (found == pendingCertificateFetches_.end())
+    return;
+  ptr_lib::shared_ptr<PendingCertificateFetch> pending = found->second;
+  pendingCertificateFetches_.erase(found);
+
+  string reason = "The retry count is zero after timeout for fetching " +
+    interest->getName().toUri();
+  for (size_t i = 0; i < pending->onFetchFailed_.size(); ++i)
+    pending->onFetchFailed_[i](reason);
+}
+
 Name
 KeyChain::prepareDefaultCertificateName()
 {
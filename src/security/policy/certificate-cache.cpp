@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2014-2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ * From PyNDN certificate_cache.py by Adeola Bannis.
+ * Originally from Yingdi Yu <http://irl.cs.ucla.edu/~yingdi/>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include "../../c/util/time.h"
+#include <ndn-cpp/security/policy/certificate-cache.hpp>
+
+using namespace std;
+
+namespace ndn {
+
+bool
+CertificateCache::insertCertificate(const IdentityCertificate& certificate)
+{
+  Name certName = certificate.getName().getPrefix(-1);
+
+  map<Name, Entry>::iterator existing = cache_.find(certName);
+  if (existing != cache_.end())
+    erase(existing);
+
+  if (checkNotAfter_ && certificate.getNotAfter() < ndn_getNowMilliseconds())
+    return false;
+
+  Entry& entry = cache_[certName];
+  entry.certificate_.reset(new IdentityCertificate(certificate));
+  entry.encoding_ = certificate.wireEncode();
+  entry.notAfter_ = certificate.getNotAfter();
+  entry.lruPosition_ = lruList_.insert(lruList_.begin(), certName);
+  nBytes_ += entry.encoding_.size();
+
+  if (maxBytes_ > 0) {
+    // Remove the least recently used, but keep the new certificate.
+    while (nBytes_ > maxBytes_ && lruList_.size() > 1)
+      erase(cache_.find(lruList_.back()));
+  }
+
+  return true;
+}
+
+void
+CertificateCache::deleteCertificate(const Name& certificateName)
+{
+  map<Name, Entry>::iterator entry = cache_.find(certificateName);
+  if (entry != cache_.end())
+    erase(entry);
+}
+
+ptr_lib::shared_ptr<IdentityCertificate>
+CertificateCache::getCertificate(const Name& certificateName) const
+{
+  const Entry* entry = find(certificateName);
+  if (!entry)
+    return ptr_lib::shared_ptr<IdentityCertificate>();
+
+  // Copying keeps the decoded fields and the wire encoding.
+  return ptr_lib::make_shared<IdentityCertificate>(*entry->certificate_);
+}
+
+Blob
+CertificateCache::getCertificateEncoding(const Name& certificateName) const
+{
+  const Entry* entry = find(certificateName);
+  if (!entry)
+    return Blob();
+
+  return entry->encoding_;
+}
+
+Blob
+CertificateCache::getPublicKeyDer(const Name& certificateName) const
+{
+  const Entry* entry = find(certificateName);
+  if (!entry)
+    return Blob();
+
+  return entry->certificate_->getPublicKeyInfo().getKeyDer();
+}
+
+void
+CertificateCache::reset()
+{
+  cache_.clear();
+  lruList_.clear();
+  nBytes_ = 0;
+}
+
+const CertificateCache::Entry*
+CertificateCache::find(const Name& certificateName) const
+{
+  map<Name, Entry>::const_iterator entry = cache_.find(certificateName);
+  if (entry == cache_.end())
+    return 0;
+
+  // An expired entry is not moved to the front, so it is removed from the end
+  // of lruList_ when the cache is full.
+  if (checkNotAfter_ && entry->second.notAfter_ < ndn_getNowMilliseconds())
+    return 0;
+
+  lruList_.splice(lruList_.begin(), lruList_, entry->second.lruPosition_);
+  return &entry->second;
+}
+
+void
+CertificateCache::erase(map<Name, Entry>::iterator entry)
+{
+  nBytes_ -= entry->second.encoding_.size();
+  lruList_.erase(entry->second.lruPosition_);
+  cache_.erase(entry);
+}
+
+}
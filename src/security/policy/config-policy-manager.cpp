@@ -37,6 +37,7 @@
 #include "../../util/boost-info-parser.hpp"
 #include "../../c/util/time.h"
 #include "../../encoding/base64.hpp"
+#include <ndn-cpp/lite/util/crypto-lite.hpp>
 #include <ndn-cpp/util/logging.hpp>
 #include <ndn-cpp/security/policy/config-policy-manager.hpp>
 
@@ -68,6 +69,198 @@ onInterestValidationFailedWrapper
   }
 }
 
+/**
+ * Get the failure reason for a certificate which is past its NotAfter time.
+ * @param certificate The expired certificate.
+ * @return The failure reason.
+ */
+static string
+getExpiredReason(const Certificate& certificate)
+{
+  string notAfter;
+  char isoString[23];
+  if (ndn_toIsoString(certificate.getNotAfter(), 0, isoString))
+    notAfter = "(unknown)";
+  else
+    notAfter = isoString;
+
+  return "The certificate " + certificate.getName().toUri() +
+    " expired at NotAfter " + notAfter;
+}
+
+/**
+ * A CompiledRule holds a rule from the configuration with the values of its
+ * filters and checker. The names are parsed and the regular expressions are
+ * compiled once, so that matching a packet doesn't do either.
+ */
+class ConfigPolicyManager::CompiledRule {
+public:
+  /**
+   * Create a CompiledRule from the rule in the configuration.
+   * @param rule The rule BoostInfoTree. This keeps a pointer to it.
+   * @throws NdnRegexMatcherBase::Error for a bad regular expression.
+   */
+  CompiledRule(const BoostInfoTree& rule);
+
+  /**
+   * Check if the name passes all the filters of the rule. A rule with no
+   * filters passes any name.
+   * @param objName The name to check.
+   * @return True if the name passes.
+   */
+  bool
+  matchesFilters(const Name& objName);
+
+  /**
+   * A Filter has a regular expression or a relation to a name.
+   */
+  class Filter {
+  public:
+    // If regex_ is null, use relation_ and name_.
+    ptr_lib::shared_ptr<NdnRegexTopMatcher> regex_;
+    std::string relation_;
+    Name name_;
+  };
+
+  const BoostInfoTree& rule_;
+  std::vector<Filter> filters_;
+  std::string checkerType_;
+  // isSha256_ is true for a customized checker with sig-type sha256.
+  bool isSha256_;
+
+  // For the fixed-signer checker.
+  std::string signerType_;
+  // The file name or the base64 string, depending on signerType_.
+  std::string signerId_;
+
+  // For the hierarchical checker.
+  ptr_lib::shared_ptr<NdnRegexTopMatcher> identityRegex_;
+
+  // For the customized checker, keyLocatorRelation_ is not empty for a simple
+  //   relation. Otherwise keyLocatorRegex_ is not null for a simple regex.
+  //   Otherwise hyperKeyRegex_ is not null for a hyper-relation.
+  std::string keyLocatorRelation_;
+  Name keyLocatorName_;
+  ptr_lib::shared_ptr<NdnRegexTopMatcher> keyLocatorRegex_;
+  std::string keyLocatorRegexString_;
+  ptr_lib::shared_ptr<NdnRegexTopMatcher> hyperKeyRegex_;
+  std::string hyperKeyRegexString_;
+  std::string hyperKeyExpansion_;
+  ptr_lib::shared_ptr<NdnRegexTopMatcher> hyperNameRegex_;
+  std::string hyperNameRegexString_;
+  std::string hyperNameExpansion_;
+  std::string hyperRelation_;
+
+  static const char* HIERARCHICAL_IDENTITY_REGEX;
+};
+
+// Everything before "ksk-?" in the key name is the signing identity.
+const char* ConfigPolicyManager::CompiledRule::HIERARCHICAL_IDENTITY_REGEX =
+  "^([^<KEY>]*)<KEY>(<>*)<ksk-.+><ID-CERT>";
+
+ConfigPolicyManager::CompiledRule::CompiledRule(const BoostInfoTree& rule)
+: rule_(rule), isSha256_(false)
+{
+  vector<const BoostInfoTree*> filters = rule["filter"];
+  for (size_t iFilter = 0; iFilter < filters.size(); ++iFilter) {
+    const BoostInfoTree& f = *filters[iFilter];
+    Filter filter;
+
+    // Don't check the type - it can only be name for now.
+    // We need to see if this is a regex or a relation.
+    const string* regexPattern = f.getFirstValue("regex");
+    if (!regexPattern) {
+      filter.relation_ = f["relation"][0]->getValue();
+      filter.name_ = Name(f["name"][0]->getValue());
+    }
+    else
+      filter.regex_.reset(new NdnRegexTopMatcher(*regexPattern));
+
+    filters_.push_back(filter);
+  }
+
+  const BoostInfoTree& checker = *rule["checker"][0];
+  checkerType_ = checker["type"][0]->getValue();
+  if (checkerType_ == "fixed-signer") {
+    const BoostInfoTree& signerInfo = *checker["signer"][0];
+    signerType_ = signerInfo["type"][0]->getValue();
+    if (signerType_ == "file")
+      signerId_ = signerInfo["file-name"][0]->getValue();
+    else if (signerType_ == "base64")
+      signerId_ = signerInfo["base64-string"][0]->getValue();
+  }
+  else if (checkerType_ == "hierarchical")
+    identityRegex_.reset(new NdnRegexTopMatcher(HIERARCHICAL_IDENTITY_REGEX));
+  else if (checkerType_ == "customized") {
+    const string* sigType = checker.getFirstValue("sig-type");
+    isSha256_ = (sigType && *sigType == "sha256");
+
+    vector<const BoostInfoTree*> keyLocatorList = checker["key-locator"];
+    if (keyLocatorList.size() >= 1) {
+      const BoostInfoTree& keyLocatorInfo = *keyLocatorList[0];
+      // Not checking type - only name is supported.
+
+      // Is this a simple relation?
+      const string* relationType = keyLocatorInfo.getFirstValue("relation");
+      if (relationType) {
+        keyLocatorRelation_ = *relationType;
+        keyLocatorName_ = Name(keyLocatorInfo["name"][0]->getValue());
+        return;
+      }
+
+      // Is this a simple regex?
+      const string* keyRegex = keyLocatorInfo.getFirstValue("regex");
+      if (keyRegex) {
+        keyLocatorRegex_.reset(new NdnRegexTopMatcher(*keyRegex));
+        keyLocatorRegexString_ = *keyRegex;
+        return;
+      }
+
+      // Is this a hyper-relation?
+      vector<const BoostInfoTree*> hyperRelationList =
+        keyLocatorInfo["hyper-relation"];
+      if (hyperRelationList.size() >= 1) {
+        const BoostInfoTree& hyperRelation = *hyperRelationList[0];
+
+        const string* keyRegex = hyperRelation.getFirstValue("k-regex");
+        const string* keyExpansion = hyperRelation.getFirstValue("k-expand");
+        const string* nameRegex = hyperRelation.getFirstValue("p-regex");
+        const string* nameExpansion = hyperRelation.getFirstValue("p-expand");
+        const string* relationType = hyperRelation.getFirstValue("h-relation");
+        if (keyRegex && keyExpansion && nameRegex && nameExpansion &&
+            relationType) {
+          hyperKeyRegex_.reset(new NdnRegexTopMatcher(*keyRegex));
+          hyperKeyRegexString_ = *keyRegex;
+          hyperKeyExpansion_ = *keyExpansion;
+          hyperNameRegex_.reset(new NdnRegexTopMatcher(*nameRegex));
+          hyperNameRegexString_ = *nameRegex;
+          hyperNameExpansion_ = *nameExpansion;
+          hyperRelation_ = *relationType;
+        }
+      }
+    }
+  }
+}
+
+bool
+ConfigPolicyManager::CompiledRule::matchesFilters(const Name& objName)
+{
+  for (size_t i = 0; i < filters_.size(); ++i) {
+    Filter& filter = filters_[i];
+
+    bool passed;
+    if (filter.regex_)
+      passed = filter.regex_->match(objName);
+    else
+      passed = matchesRelation(objName, filter.name_, filter.relation_);
+
+    if (!passed)
+      return false;
+  }
+
+  return true;
+}
+
 ConfigPolicyManager::ConfigPolicyManager
   (const string& configFileName,
    const ptr_lib::shared_ptr<CertificateCache>& certificateCache,
@@ -76,7 +269,9 @@ ConfigPolicyManager::ConfigPolicyManager
   : maxDepth_(searchDepth),
     keyGraceInterval_(graceInterval),
     keyTimestampTtl_(keyTimestampTtl),
-    maxTrackedKeys_(maxTrackedKeys)
+    maxTrackedKeys_(maxTrackedKeys),
+    validatedCertificateTtl_(3600000.0),
+    failedPacketTtl_(60000.0)
 {
   if (!certificateCache)
     certificateCache_.reset(new CertificateCache());
@@ -99,8 +294,12 @@ ConfigPolicyManager::reset()
   certificateCache_->reset();
   fixedCertificateCache_.clear();
   keyTimestamps_.clear();
+  validatedCertificates_.clear();
+  failedPackets_.clear();
+  failedPacketOrder_.clear();
   requiresVerification_ = true;
   config_.reset(new BoostInfoParser());
+  compiledRules_.clear();
   refreshManager_.reset(new TrustAnchorRefreshManager());
 }
 
@@ -110,6 +309,7 @@ ConfigPolicyManager::load(const std::string& configFileName)
   reset();
   config_->read(configFileName);
   loadTrustAnchorCertificates();
+  compileRules();
 }
 
 void
@@ -118,6 +318,7 @@ ConfigPolicyManager::load(const std::string& input, const std::string& inputName
   reset();
   config_->read(input, inputName);
   loadTrustAnchorCertificates();
+  compileRules();
 }
 
 bool
@@ -151,8 +352,14 @@ ConfigPolicyManager::checkVerificationPolicy
    const OnDataValidationFailed& onValidationFailed)
 {
   string failureReason = "unknown";
-  ptr_lib::shared_ptr<Interest> certificateInterest = getCertificateInterest
-    (stepCount, "data", data->getName(), data->getSignature(), failureReason);
+  ptr_lib::shared_ptr<Interest> certificateInterest;
+  // wireEncode returns the cached encoding if available.
+  if (!isFailedPacket(data->wireEncode(), failureReason)) {
+    certificateInterest = getCertificateInterest
+      (stepCount, "data", data->getName(), data->getSignature(), failureReason);
+    if (!certificateInterest && stepCount <= maxDepth_)
+      addFailedPacket(data->wireEncode(), failureReason);
+  }
   if (!certificateInterest) {
     try {
       onValidationFailed(data, failureReason);
@@ -183,6 +390,7 @@ ConfigPolicyManager::checkVerificationPolicy
       }
     }
     else {
+      addFailedPacket(data->wireEncode(), failureReason);
       try {
         onValidationFailed(data, failureReason);
       } catch (const std::exception& ex) {
@@ -204,10 +412,17 @@ ConfigPolicyManager::checkVerificationPolicy
    WireFormat& wireFormat)
 {
   string failureReason = "unknown";
-  ptr_lib::shared_ptr<Signature> signature = extractSignature
-    (*interest, wireFormat, failureReason);
+  ptr_lib::shared_ptr<Signature> signature;
+  // Remember a failed Interest by its name, which has the signature. The
+  // Interest encoding also has the Nonce which is different when re-expressed.
+  Blob failedKeyEncoding = interest->getName().wireEncode(wireFormat);
+  if (!isFailedPacket(failedKeyEncoding, failureReason)) {
+    signature = extractSignature(*interest, wireFormat, failureReason);
+    if (!signature)
+      addFailedPacket(failedKeyEncoding, failureReason);
+  }
   if (!signature) {
-    // Can't get the signature from the interest name.
+    // Can't get the signature from the interest name, or it already failed.
     try {
       onValidationFailed(interest, failureReason);
     } catch (const std::exception& ex) {
@@ -224,6 +439,8 @@ ConfigPolicyManager::checkVerificationPolicy
     (stepCount, "interest", interest->getName().getPrefix(-4), 
      signature.get(), failureReason);
   if (!certificateInterest) {
+    if (stepCount <= maxDepth_)
+      addFailedPacket(failedKeyEncoding, failureReason);
     try {
       onValidationFailed(interest, failureReason);
     } catch (const std::exception& ex) {
@@ -250,6 +467,7 @@ ConfigPolicyManager::checkVerificationPolicy
     MillisecondsSince1970 timestamp = interest->getName().get(-4).toNumber();
 
     if (!interestTimestampIsFresh(keyName, timestamp, failureReason)) {
+      addFailedPacket(failedKeyEncoding, failureReason);
       try {
         onValidationFailed(interest, failureReason);
       } catch (const std::exception& ex) {
@@ -273,6 +491,7 @@ ConfigPolicyManager::checkVerificationPolicy
       updateTimestampForKey(keyName, timestamp);
     }
     else {
+      addFailedPacket(failedKeyEncoding, failureReason);
       try {
         onValidationFailed(interest, failureReason);
       } catch (const std::exception& ex) {
@@ -300,7 +519,7 @@ ConfigPolicyManager::getCertificateInterest
   }
 
   // first see if we can find a rule to match this packet
-  const BoostInfoTree* matchedRule = findMatchingRule(objectName, matchType);
+  CompiledRule* matchedRule = findMatchingCompiledRule(objectName, matchType);
 
   // No matching rule -> fail.
   if (!matchedRule) {
@@ -309,10 +528,7 @@ ConfigPolicyManager::getCertificateInterest
   }
 
   // Do a quick check if this is sig-type sha256.
-  const BoostInfoTree& checker = *(*matchedRule)["checker"][0];
-  const string& checkerType = checker["type"][0]->getValue();
-  if (checkerType == "customized" &&
-      checker["sig-type"][0]->getValue() == "sha256")
+  if (matchedRule->isSha256_)
     // The signature is a simple DigestSha256 so we don't fetch certificates.
     return ptr_lib::make_shared<Interest>();
 
@@ -337,15 +553,14 @@ ConfigPolicyManager::getCertificateInterest
     return ptr_lib::shared_ptr<Interest>();
 
   // Before we look up keys, refresh any certificate directories.
-  refreshManager_->refreshAnchors();
+  if (refreshManager_->refreshAnchors())
+    // The saved public keys may be from removed certificates.
+    validatedCertificates_.clear();
 
   // If we don't actually have the certificate yet, return a certificateInterest
   //   for it.
-  ptr_lib::shared_ptr<IdentityCertificate> foundCert =
-    refreshManager_->getCertificate(signatureName);
-  if (!foundCert)
-    foundCert = certificateCache_->getCertificate(signatureName);
-  if (!foundCert)
+  Blob publicKeyDer;
+  if (!getCertificatePublicKey(signatureName, publicKeyDer))
     return ptr_lib::make_shared<Interest>(signatureName);
   else
     return ptr_lib::make_shared<Interest>();
@@ -359,7 +574,19 @@ ConfigPolicyManager::onCertificateDownloadComplete
    const OnDataValidationFailed& onValidationFailed)
 {
   IdentityCertificate certificate(*data);
-  certificateCache_->insertCertificate(certificate);
+  if (!certificateCache_->insertCertificate(certificate)) {
+    // The certificate is expired. Fail now instead of fetching it again.
+    string failureReason = getExpiredReason(certificate);
+    addFailedPacket(originalData->wireEncode(), failureReason);
+    try {
+      onValidationFailed(originalData, failureReason);
+    } catch (const std::exception& ex) {
+      _LOG_ERROR("ConfigPolicyManager::onCertificateDownloadComplete: Error in onValidationFailed: " << ex.what());
+    } catch (...) {
+      _LOG_ERROR("ConfigPolicyManager::onCertificateDownloadComplete: Error in onValidationFailed.");
+    }
+    return;
+  }
 
   // Now that we stored the needed certificate, increment stepCount and try again
   //   to verify the originalData.
@@ -375,7 +602,20 @@ ConfigPolicyManager::onCertificateDownloadCompleteForInterest
    const OnInterestValidationFailed& onValidationFailed, WireFormat& wireFormat)
 {
   IdentityCertificate certificate(*data);
-  certificateCache_->insertCertificate(certificate);
+  if (!certificateCache_->insertCertificate(certificate)) {
+    // The certificate is expired. Fail now instead of fetching it again.
+    string failureReason = getExpiredReason(certificate);
+    addFailedPacket
+      (originalInterest->getName().wireEncode(wireFormat), failureReason);
+    try {
+      onValidationFailed(originalInterest, failureReason);
+    } catch (const std::exception& ex) {
+      _LOG_ERROR("ConfigPolicyManager::onCertificateDownloadCompleteForInterest: Error in onValidationFailed: " << ex.what());
+    } catch (...) {
+      _LOG_ERROR("ConfigPolicyManager::onCertificateDownloadCompleteForInterest: Error in onValidationFailed.");
+    }
+    return;
+  }
 
   // Now that we stored the needed certificate, increment stepCount and try again
   //   to verify the originalData.
@@ -454,39 +694,42 @@ ConfigPolicyManager::loadTrustAnchorCertificates()
 
 bool
 ConfigPolicyManager::checkSignatureMatch
-  (const Name& signatureName, const Name& objectName, const BoostInfoTree& rule,
+  (const Name& signatureName, const Name& objectName, CompiledRule& rule,
    string& failureReason)
 {
-  const BoostInfoTree& checker = *rule["checker"][0];
-  const string& checkerType = checker["type"][0]->getValue();
+  const string& checkerType = rule.checkerType_;
   if (checkerType == "fixed-signer") {
-    const BoostInfoTree& signerInfo = *checker["signer"][0];
-    const string& signerType = signerInfo["type"][0]->getValue();
-
     ptr_lib::shared_ptr<Certificate> cert;
-    if (signerType == "file") {
-      cert = lookupCertificate(signerInfo["file-name"][0]->getValue(), true);
+    if (rule.signerType_ == "file") {
+      cert = lookupCertificate(rule.signerId_, true);
       if (!cert) {
         failureReason = "Can't find fixed-signer certificate file: " +
-          signerInfo["file-name"][0]->getValue();
+          rule.signerId_;
         return false;
       }
     }
-    else if (signerType == "base64") {
-      cert = lookupCertificate(signerInfo["base64-string"][0]->getValue(), false);
+    else if (rule.signerType_ == "base64") {
+      cert = lookupCertificate(rule.signerId_, false);
       if (!cert) {
         failureReason = "Can't find fixed-signer certificate base64: " +
-          signerInfo["base64-string"][0]->getValue();
+          rule.signerId_;
         return false;
       }
     }
     else {
-      failureReason = "Unrecognized fixed-signer signerType: " + signerType;
+      failureReason = "Unrecognized fixed-signer signerType: " +
+        rule.signerType_;
       return false;
     }
 
-    if (cert->getName().equals(signatureName))
+    if (cert->getName().equals(signatureName)) {
+      if (cert->getNotAfter() < ndn_getNowMilliseconds()) {
+        failureReason = "fixed-signer: " + getExpiredReason(*cert);
+        return false;
+      }
+
       return true;
+    }
     else {
       failureReason = "fixed-signer cert name \"" + cert->getName().toUri() +
         "\" does not equal signatureName \"" + signatureName.toUri() + "\"";
@@ -496,8 +739,7 @@ ConfigPolicyManager::checkSignatureMatch
   else if (checkerType == "hierarchical") {
     // This just means the data/interest name has the signing identity as a prefix.
     // That means everything before "ksk-?" in the key name.
-    string identityRegex = "^([^<KEY>]*)<KEY>(<>*)<ksk-.+><ID-CERT>";
-    NdnRegexTopMatcher identityMatch(identityRegex);
+    NdnRegexTopMatcher& identityMatch = *rule.identityRegex_;
     if (identityMatch.match(signatureName)) {
       Name identityPrefix = identityMatch.expand("\\1")
         .append(identityMatch.expand("\\2"));
@@ -510,78 +752,65 @@ ConfigPolicyManager::checkSignatureMatch
       }
     }
     else {
-      failureReason = "The hierarchical identityRegex \"" + identityRegex +
+      failureReason = string("The hierarchical identityRegex \"") +
+        CompiledRule::HIERARCHICAL_IDENTITY_REGEX +
         "\" does not match signatureName \"" + signatureName.toUri() + "\"";
       return false;
     }
   }
   else if (checkerType == "customized") {
-    const BoostInfoTree& keyLocatorInfo = *checker["key-locator"][0];
-    // Not checking type - only name is supported.
-
     // Is this a simple relation?
-    const string* relationType = keyLocatorInfo.getFirstValue("relation");
-    if (relationType) {
-      Name matchName(keyLocatorInfo["name"][0]->getValue());
-      if (matchesRelation(signatureName, matchName, *relationType))
+    if (!rule.keyLocatorRelation_.empty()) {
+      if (matchesRelation
+          (signatureName, rule.keyLocatorName_, rule.keyLocatorRelation_))
         return true;
       else {
         failureReason = "The custom signatureName \"" + signatureName.toUri() +
-          "\" does not match matchName \"" + matchName.toUri() +
-          "\" using relation " + *relationType;
+          "\" does not match matchName \"" + rule.keyLocatorName_.toUri() +
+          "\" using relation " + rule.keyLocatorRelation_;
         return false;
       }
     }
 
     // Is this a simple regex?
-    const string* keyRegex = keyLocatorInfo.getFirstValue("regex");
-    if (keyRegex) {
-      if (NdnRegexTopMatcher(*keyRegex).match(signatureName))
+    if (rule.keyLocatorRegex_) {
+      if (rule.keyLocatorRegex_->match(signatureName))
         return true;
       else {
         failureReason = "The custom signatureName \"" + signatureName.toUri() +
-          "\" does not regex match keyRegex \"" + *keyRegex + "\"";
+          "\" does not regex match keyRegex \"" + rule.keyLocatorRegexString_ +
+          "\"";
         return false;
       }
     }
 
     // Is this a hyper-relation?
-    vector<const BoostInfoTree*> hyperRelationList = keyLocatorInfo["hyper-relation"];
-    if (hyperRelationList.size() >= 1) {
-      const BoostInfoTree& hyperRelation = *hyperRelationList[0];
-
-      const string* keyRegex = hyperRelation.getFirstValue("k-regex");
-      const string* keyExpansion = hyperRelation.getFirstValue("k-expand");
-      const string* nameRegex = hyperRelation.getFirstValue("p-regex");
-      const string* nameExpansion = hyperRelation.getFirstValue("p-expand");
-      const string* relationType = hyperRelation.getFirstValue("h-relation");
-      if (keyRegex && keyExpansion && nameRegex && nameExpansion && relationType) {
-        NdnRegexTopMatcher keyMatch(*keyRegex);
-        if (!keyMatch.match(signatureName)) {
-          failureReason = "The custom hyper-relation signatureName \"" +
-            signatureName.toUri() + "\" does not match the keyRegex \"" +
-            *keyRegex + "\"";
-          return false;
-        }
-        Name keyMatchPrefix = keyMatch.expand(*keyExpansion);
-
-        NdnRegexTopMatcher nameMatch(*nameRegex);
-        if (!nameMatch.match(objectName)) {
-          failureReason = "The custom hyper-relation objectName \"" +
-            objectName.toUri() + "\" does not match the nameRegex \"" +
-            *nameRegex + "\"";
-          return false;
-        }
-        Name nameMatchExpansion = nameMatch.expand(*nameExpansion);
+    if (rule.hyperKeyRegex_) {
+      NdnRegexTopMatcher& keyMatch = *rule.hyperKeyRegex_;
+      if (!keyMatch.match(signatureName)) {
+        failureReason = "The custom hyper-relation signatureName \"" +
+          signatureName.toUri() + "\" does not match the keyRegex \"" +
+          rule.hyperKeyRegexString_ + "\"";
+        return false;
+      }
+      Name keyMatchPrefix = keyMatch.expand(rule.hyperKeyExpansion_);
 
-        if (matchesRelation(nameMatchExpansion, keyMatchPrefix, *relationType))
-          return true;
-        else {
-          failureReason = "The custom hyper-relation nameMatch \"" +
-            nameMatchExpansion.toUri() + "\" does not match the keyMatchPrefix \"" +
-            keyMatchPrefix.toUri() + "\" using relation " + *relationType;
-          return false;
-        }
+      NdnRegexTopMatcher& nameMatch = *rule.hyperNameRegex_;
+      if (!nameMatch.match(objectName)) {
+        failureReason = "The custom hyper-relation objectName \"" +
+          objectName.toUri() + "\" does not match the nameRegex \"" +
+          rule.hyperNameRegexString_ + "\"";
+        return false;
+      }
+      Name nameMatchExpansion = nameMatch.expand(rule.hyperNameExpansion_);
+
+      if (matchesRelation(nameMatchExpansion, keyMatchPrefix, rule.hyperRelation_))
+        return true;
+      else {
+        failureReason = "The custom hyper-relation nameMatch \"" +
+          nameMatchExpansion.toUri() + "\" does not match the keyMatchPrefix \"" +
+          keyMatchPrefix.toUri() + "\" using relation " + rule.hyperRelation_;
+        return false;
       }
     }
   }
@@ -590,76 +819,100 @@ ConfigPolicyManager::checkSignatureMatch
   return false;
 }
 
+bool
+ConfigPolicyManager::checkSignatureMatch
+  (const Name& signatureName, const Name& objectName, const BoostInfoTree& rule,
+   string& failureReason)
+{
+  for (map<string, vector<ptr_lib::shared_ptr<CompiledRule> > >::iterator
+         rules = compiledRules_.begin();
+       rules != compiledRules_.end(); ++rules) {
+    for (size_t i = 0; i < rules->second.size(); ++i) {
+      if (&rules->second[i]->rule_ == &rule)
+        return checkSignatureMatch
+          (signatureName, objectName, *rules->second[i], failureReason);
+    }
+  }
+
+  failureReason = "The rule is not in the loaded configuration";
+  return false;
+}
+
+void
+ConfigPolicyManager::compileRules()
+{
+  vector<const BoostInfoTree*> rules = config_->getRoot()["validator/rule"];
+  for (size_t iRule = 0; iRule < rules.size(); ++iRule) {
+    const BoostInfoTree& rule = *rules[iRule];
+    const string* forType = rule.getFirstValue("for");
+    if (!forType)
+      continue;
+
+    compiledRules_[*forType].push_back
+      (ptr_lib::make_shared<CompiledRule>(rule));
+  }
+}
+
 ptr_lib::shared_ptr<IdentityCertificate>
 ConfigPolicyManager::lookupCertificate(const string& certID, bool isPath)
 {
   ptr_lib::shared_ptr<IdentityCertificate> cert;
 
-  map<string, string>::iterator iCertUri = fixedCertificateCache_.find(certID);
-  if (iCertUri == fixedCertificateCache_.end()) {
-    if (isPath)
-      // Load the certificate data (base64 encoded IdentityCertificate)
-      cert = TrustAnchorRefreshManager::loadIdentityCertificateFromFile(certID);
-    else {
-      vector<uint8_t> certData;
-      fromBase64(certID.c_str(), certData);
-      cert.reset(new IdentityCertificate());
-      cert->wireDecode(certData);
-    }
+  map<string, ptr_lib::shared_ptr<IdentityCertificate> >::iterator iCert =
+    fixedCertificateCache_.find(certID);
+  if (iCert != fixedCertificateCache_.end()) {
+    cert = iCert->second;
+    // Restore the certificate if it was removed from the bounded cache. This
+    // does nothing if it is expired.
+    if (certificateCache_->getPublicKeyDer
+        (cert->getName().getPrefix(-1)).isNull())
+      certificateCache_->insertCertificate(*cert);
+    return cert;
+  }
 
-    string certUri = cert->getName().getPrefix(-1).toUri();
-    fixedCertificateCache_[certID] = certUri;
-    certificateCache_->insertCertificate(*cert);
+  if (isPath)
+    // Load the certificate data (base64 encoded IdentityCertificate)
+    cert = TrustAnchorRefreshManager::loadIdentityCertificateFromFile(certID);
+  else {
+    vector<uint8_t> certData;
+    fromBase64(certID.c_str(), certData);
+    cert.reset(new IdentityCertificate());
+    cert->wireDecode(certData);
   }
-  else
-    cert = certificateCache_->getCertificate(Name(iCertUri->second));
+
+  // Keep the certificate, even if expired, so that we don't load it again.
+  fixedCertificateCache_[certID] = cert;
+  certificateCache_->insertCertificate(*cert);
 
   return cert;
 }
 
-const BoostInfoTree*
-ConfigPolicyManager::findMatchingRule
+ConfigPolicyManager::CompiledRule*
+ConfigPolicyManager::findMatchingCompiledRule
   (const Name& objName, const string& matchType) const
 {
-  vector<const BoostInfoTree*> rules = config_->getRoot()["validator/rule"];
-  for (size_t iRule = 0; iRule < rules.size(); ++iRule) {
-    const BoostInfoTree& r = *rules[iRule];
-
-    if (r["for"][0]->getValue() == matchType) {
-      bool passed = true;
-      vector<const BoostInfoTree*> filters = r["filter"];
-      if (filters.size() == 0)
-        // no filters means we pass!
-        return &r;
-      else {
-        for (size_t iFilter = 0; iFilter < filters.size(); ++iFilter) {
-          const BoostInfoTree& f = *filters[iFilter];
-
-          // Don't check the type - it can only be name for now.
-          // We need to see if this is a regex or a relation.
-          const string* regexPattern = f.getFirstValue("regex");
-          if (!regexPattern) {
-            const string& matchRelation = f["relation"][0]->getValue();
-            const string& matchUri = f["name"][0]->getValue();
-            Name matchName(matchUri);
-            passed = matchesRelation(objName, matchName, matchRelation);
-          }
-          else
-            passed = NdnRegexTopMatcher(*regexPattern).match(objName);
-
-          if (!passed)
-            break;
-        }
-
-        if (passed)
-          return &r;
-      }
-    }
+  map<string, vector<ptr_lib::shared_ptr<CompiledRule> > >::const_iterator
+    rules = compiledRules_.find(matchType);
+  if (rules == compiledRules_.end())
+    return 0;
+
+  for (size_t iRule = 0; iRule < rules->second.size(); ++iRule) {
+    CompiledRule& rule = *rules->second[iRule];
+    if (rule.matchesFilters(objName))
+      return &rule;
   }
 
   return 0;
 }
 
+const BoostInfoTree*
+ConfigPolicyManager::findMatchingRule
+  (const Name& objName, const string& matchType) const
+{
+  CompiledRule* rule = findMatchingCompiledRule(objName, matchType);
+  return rule ? &rule->rule_ : 0;
+}
+
 bool
 ConfigPolicyManager::matchesRelation
   (const Name& name, const Name& matchName, const string& matchRelation)
@@ -777,7 +1030,7 @@ ConfigPolicyManager::updateTimestampForKey
 bool
 ConfigPolicyManager::verify
   (const Signature* signatureInfo, const SignedBlob& signedBlob,
-   string& failureReason) const
+   string& failureReason)
 {
   // We have already checked once if there should be a key locator.
   if (!KeyLocator::canGetFromSignature(signatureInfo)) {
@@ -794,22 +1047,18 @@ ConfigPolicyManager::verify
 
   if (keyLocator.getType() == ndn_KeyLocatorType_KEYNAME) {
     // Assume the key name is a certificate name.
-    Name signatureName = keyLocator.getKeyName();
-    ptr_lib::shared_ptr<IdentityCertificate> certificate =
-      refreshManager_->getCertificate(signatureName);
-    if (!certificate)
-      certificate = certificateCache_->getCertificate(signatureName);
-    if (!certificate) {
+    const Name& signatureName = keyLocator.getKeyName();
+    Blob publicKeyDer;
+    if (!getCertificatePublicKey(signatureName, publicKeyDer)) {
       failureReason = "Cannot find a certificate with name " +
         signatureName.toUri();
       return false;
     }
 
-    Blob publicKeyDer = certificate->getPublicKeyInfo().getKeyDer();
     if (publicKeyDer.isNull()) {
       // We don't expect this to happen.
       failureReason = "There is no public key in the certificate with name " +
-        certificate->getName().toUri();
+        signatureName.toUri();
       return false;
     }
 
@@ -826,6 +1075,132 @@ ConfigPolicyManager::verify
   }
 }
 
+bool
+ConfigPolicyManager::getCertificatePublicKey
+  (const Name& certificateName, Blob& publicKeyDer)
+{
+  Blob encoding = refreshManager_->getCertificateEncoding(certificateName);
+  if (encoding.isNull())
+    encoding = certificateCache_->getCertificateEncoding(certificateName);
+  if (encoding.isNull())
+    return false;
+
+  string certificateUri = certificateName.toUri();
+  MillisecondsSince1970 now = ndn_getNowMilliseconds();
+  map<string, ValidatedCertificate>::iterator validated =
+    validatedCertificates_.find(certificateUri);
+  if (validated != validatedCertificates_.end()) {
+    if (validated->second.expirationTime_ > now &&
+        validated->second.certificateEncoding_.equals(encoding)) {
+      publicKeyDer = validated->second.publicKeyDer_;
+      return true;
+    }
+
+    // The entry is expired or the cache has a different certificate.
+    validatedCertificates_.erase(validated);
+  }
+
+  IdentityCertificate certificate;
+  certificate.wireDecode(encoding);
+  publicKeyDer = certificate.getPublicKeyInfo().getKeyDer();
+
+  MillisecondsSince1970 expirationTime = now + validatedCertificateTtl_;
+  if (certificate.getNotAfter() < expirationTime)
+    expirationTime = certificate.getNotAfter();
+  if (publicKeyDer.isNull() || expirationTime <= now)
+    return true;
+
+  if (validatedCertificates_.size() >= MAX_VALIDATED_CERTIFICATES) {
+    // Erase the expired entries. If none, erase an arbitrary entry.
+    for (map<string, ValidatedCertificate>::iterator entry =
+           validatedCertificates_.begin();
+         entry != validatedCertificates_.end(); ) {
+      if (entry->second.expirationTime_ <= now)
+        validatedCertificates_.erase(entry++);
+      else
+        ++entry;
+    }
+    if (validatedCertificates_.size() >= MAX_VALIDATED_CERTIFICATES)
+      validatedCertificates_.erase(validatedCertificates_.begin());
+  }
+
+  validatedCertificates_.insert(make_pair
+    (certificateUri,
+     ValidatedCertificate(encoding, publicKeyDer, expirationTime)));
+  return true;
+}
+
+/**
+ * Get the SHA-256 digest of the encoding as a string to use as a map key.
+ */
+static string
+getDigestKey(const Blob& encoding)
+{
+  uint8_t digest[ndn_SHA256_DIGEST_SIZE];
+  CryptoLite::digestSha256(encoding.buf(), encoding.size(), digest);
+  return string((const char*)digest, sizeof(digest));
+}
+
+bool
+ConfigPolicyManager::isFailedPacket(const Blob& encoding, string& failureReason)
+{
+  if (failedPackets_.empty())
+    return false;
+
+  map<string, FailedPacket>::iterator failedPacket =
+    failedPackets_.find(getDigestKey(encoding));
+  if (failedPacket == failedPackets_.end())
+    return false;
+
+  if (failedPacket->second.expirationTime_ <= ndn_getNowMilliseconds()) {
+    failedPacketOrder_.erase(failedPacket->second.orderPosition_);
+    failedPackets_.erase(failedPacket);
+    return false;
+  }
+
+  failureReason = failedPacket->second.failureReason_;
+  return true;
+}
+
+void
+ConfigPolicyManager::addFailedPacket
+  (const Blob& encoding, const string& failureReason)
+{
+  if (failedPacketTtl_ <= 0)
+    return;
+
+  MillisecondsSince1970 now = ndn_getNowMilliseconds();
+  string key = getDigestKey(encoding);
+  eraseFailedPacket(key);
+
+  if (failedPackets_.size() >= MAX_FAILED_PACKETS) {
+    // All entries have the same TTL, so the oldest expires soonest. Erase the
+    // expired entries. If none, erase the oldest.
+    while (!failedPacketOrder_.empty() &&
+           failedPackets_.find(failedPacketOrder_.front())->second
+             .expirationTime_ <= now)
+      eraseFailedPacket(failedPacketOrder_.front());
+    if (failedPackets_.size() >= MAX_FAILED_PACKETS)
+      eraseFailedPacket(failedPacketOrder_.front());
+  }
+
+  failedPacketOrder_.push_back(key);
+  failedPackets_.insert(make_pair
+    (key, FailedPacket
+     (failureReason, now + failedPacketTtl_, --failedPacketOrder_.end())));
+}
+
+void
+ConfigPolicyManager::eraseFailedPacket(const string& key)
+{
+  map<string, FailedPacket>::iterator failedPacket = failedPackets_.find(key);
+  if (failedPacket == failedPackets_.end())
+    return;
+
+  failedPacketOrder_.erase(failedPacket->second.orderPosition_);
+  failedPackets_.erase(failedPacket);
+}
+
 ptr_lib::shared_ptr<IdentityCertificate>
 ConfigPolicyManager::TrustAnchorRefreshManager::loadIdentityCertificateFromFile
   (const string& filename)
@@ -887,7 +1262,7 @@ ConfigPolicyManager::TrustAnchorRefreshManager::addDirectory
      refreshPeriod);
 }
 
-void
+bool
 ConfigPolicyManager::TrustAnchorRefreshManager::refreshAnchors()
 {
   MillisecondsSince1970 refreshTime = ndn_getNowMilliseconds();
@@ -919,6 +1294,8 @@ ConfigPolicyManager::TrustAnchorRefreshManager::refreshAnchors()
   // Now that we are done with the iterator, add to refreshDirectories_.
   for (size_t i = 0; i < directoriesToAdd.size(); ++i)
     addDirectory(directoriesToAdd[i], refreshPeriodsToAdd[i]);
+
+  return directoriesToAdd.size() > 0;
 }
 
 }
@@ -19,6 +19,8 @@
  * A copy of the GNU Lesser General Public License is in the file COPYING.
  */
 
+#include <list>
+#include <map>
 #include "../../c/util/crypto.h"
 #include "../../c/util/ndn_memory.h"
 #include <ndn-cpp/security/security-exception.hpp>
@@ -34,6 +36,81 @@ using namespace std;
 
 namespace ndn {
 
+#if NDN_CPP_HAVE_LIBCRYPTO && __cplusplus >= 201103L
+
+/**
+ * A VerificationKeyCache holds public keys which are already decoded into
+ * PublicKeyLite objects (RsaPublicKeyLite or EcPublicKeyLite), keyed by the
+ * SHA-256 digest of the public key DER, so that verifying many signatures by
+ * the same key doesn't decode the DER each time. It keeps the most recently
+ * used MAX_KEYS keys. Each thread has its own cache (see getInstance()), so the
+ * OpenSSL key objects are never shared between threads.
+ */
+template<class PublicKeyLite> class VerificationKeyCache {
+public:
+  /**
+   * Get the calling thread's cache.
+   * @return The cache for PublicKeyLite keys.
+   */
+  static VerificationKeyCache&
+  getInstance()
+  {
+    static thread_local VerificationKeyCache instance;
+    return instance;
+  }
+
+  /**
+   * Get the decoded key for publicKeyDer from the cache, or decode it and add
+   * it to the cache.
+   * @param publicKeyDer The DER-encoded public key.
+   * @param error Set error to 0 for success, or the error from decoding the
+   * key.
+   * @return A pointer to the decoded key, or 0 if it can't be decoded.
+   */
+  const PublicKeyLite*
+  get(const Blob& publicKeyDer, ndn_Error& error)
+  {
+    uint8_t digest[ndn_SHA256_DIGEST_SIZE];
+    CryptoLite::digestSha256(publicKeyDer, digest);
+    std::string digestKey((const char*)digest, sizeof(digest));
+    error = NDN_ERROR_success;
+
+    typename std::map<std::string, typename EntryList::iterator>::iterator
+      found = index_.find(digestKey);
+    if (found != index_.end()) {
+      // Move the entry to the front as the most recently used.
+      entries_.splice(entries_.begin(), entries_, found->second);
+      return entries_.front().second.get();
+    }
+
+    ptr_lib::shared_ptr<PublicKeyLite> key(new PublicKeyLite());
+    if ((error = key->decode(publicKeyDer)))
+      return 0;
+
+    if (entries_.size() >= MAX_KEYS) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.push_front(std::make_pair(digestKey, key));
+    index_[digestKey] = entries_.begin();
+
+    return key.get();
+  }
+
+  static const size_t MAX_KEYS = 100;
+
+private:
+  typedef std::list<std::pair<std::string, ptr_lib::shared_ptr<PublicKeyLite> > >
+    EntryList;
+
+  VerificationKeyCache() {}
+
+  EntryList entries_;
+  std::map<std::string, typename EntryList::iterator> index_;
+};
+
+#endif
+
 bool
 PolicyManager::verifySignature
   (const Signature* signature, const SignedBlob& signedBlob,
@@ -49,9 +126,19 @@ PolicyManager::verifySignature
   else if (dynamic_cast<const Sha256WithRsaSignature *>(signature)) {
     if (publicKeyDer.isNull())
       return false;
-    if ((error = RsaPublicKeyLite::verifySha256WithRsaSignature
-         (signature->getSignature(), signedBlob.getSignedPortionBlobLite(),
-          publicKeyDer, verified)) != 0) {
+#if __cplusplus >= 201103L
+    const RsaPublicKeyLite* publicKey =
+      VerificationKeyCache<RsaPublicKeyLite>::getInstance().get
+        (publicKeyDer, error);
+    if (publicKey)
+      verified = publicKey->verifyWithSha256
+        (signature->getSignature(), signedBlob.getSignedPortionBlobLite());
+#else
+    error = RsaPublicKeyLite::verifySha256WithRsaSignature
+      (signature->getSignature(), signedBlob.getSignedPortionBlobLite(),
+       publicKeyDer, verified);
+#endif
+    if (error != 0) {
       if (error == NDN_ERROR_Error_decoding_key)
         throw UnrecognizedKeyFormatException("Error decoding public key");
       else
@@ -62,9 +149,19 @@ PolicyManager::verifySignature
   else if (dynamic_cast<const Sha256WithEcdsaSignature *>(signature)) {
     if (publicKeyDer.isNull())
       return false;
-    if ((error = EcPublicKeyLite::verifySha256WithEcdsaSignature
-         (signature->getSignature(), signedBlob.getSignedPortionBlobLite(),
-          publicKeyDer, verified)) != 0) {
+#if __cplusplus >= 201103L
+    const EcPublicKeyLite* publicKey =
+      VerificationKeyCache<EcPublicKeyLite>::getInstance().get
+        (publicKeyDer, error);
+    if (publicKey)
+      verified = publicKey->verifyWithSha256
+        (signature->getSignature(), signedBlob.getSignedPortionBlobLite());
+#else
+    error = EcPublicKeyLite::verifySha256WithEcdsaSignature
+      (signature->getSignature(), signedBlob.getSignedPortionBlobLite(),
+       publicKeyDer, verified);
+#endif
+    if (error != 0) {
       if (error == NDN_ERROR_Error_decoding_key)
         throw UnrecognizedKeyFormatException("Error decoding public key");
       else
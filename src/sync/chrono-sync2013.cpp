@@ -29,6 +29,8 @@
 #include "sync-state.pb.h"
 #include "../c/util/time.h"
 #include "digest-tree.hpp"
+#include "digest-log.hpp"
+#include "compact-sync-state.hpp"
 #include <ndn-cpp/sync/chrono-sync2013.hpp>
 
 INIT_LOGGER("ndn.ChronoSync2013");
@@ -49,17 +51,17 @@ ChronoSync2013::Impl::Impl
   applicationBroadcastPrefix_(applicationBroadcastPrefix), sessionNo_(sessionNo),
   face_(face), keyChain_(keyChain), certificateName_(certificateName),
   syncLifetime_(syncLifetime), initialPreviousSequenceNo_(previousSequenceNumber),
-  sequenceNo_(previousSequenceNumber), digestTree_(new DigestTree()),
-  contentCache_(&face), enabled_(true)
+  sequenceNo_(previousSequenceNumber), digestLog_(new DigestLog()),
+  digestTree_(new DigestTree()),
+  contentCache_(&face), enabled_(true), publishWindow_(0),
+  useCompactEncoding_(false), isFlushScheduled_(false)
 {
 }
 
 void
 ChronoSync2013::Impl::initialize(const OnRegisterFailed& onRegisterFailed)
 {
-  Sync::SyncStateMsg emptyContent;
-  digestLog_.push_back(ptr_lib::make_shared<DigestLogEntry>
-    ("00", emptyContent.ss()));
+  digestLog_->add("00");
 
   // Register the prefix with the contentCache_ and use our own onInterest
   //   as the onDataNotFound fallback.
@@ -77,17 +79,6 @@ ChronoSync2013::Impl::initialize(const OnRegisterFailed& onRegisterFailed)
   _LOG_DEBUG(interest.getName().toUri());
 }
 
-int
-ChronoSync2013::Impl::logFind(const std::string& digest) const
-{
-  for (size_t i = 0; i < digestLog_.size(); ++i) {
-    if (digest == digestLog_[i]->getDigest())
-      return i;
-  }
-
-  return -1;
-};
-
 bool
 ChronoSync2013::Impl::update
   (const google::protobuf::RepeatedPtrField<Sync::SyncState >& content)
@@ -104,9 +95,14 @@ ChronoSync2013::Impl::update
     }
   }
 
-  if (logFind(digestTree_->getRoot()) == -1) {
-    digestLog_.push_back(ptr_lib::make_shared<DigestLogEntry>
-      (digestTree_->getRoot(), content));
+  if (digestLog_->find(digestTree_->getRoot()) == -1) {
+    digestLog_->add(digestTree_->getRoot());
+    for (size_t i = 0; i < content.size(); ++i) {
+      if (content.Get(i).type() == Sync::SyncState_ActionType_UPDATE)
+        digestLog_->updateProducer
+          (content.Get(i).name(), content.Get(i).seqno().session(),
+           content.Get(i).seqno().seq());
+    }
     return true;
   }
   else
@@ -141,6 +137,37 @@ ChronoSync2013::Impl::publishNextSequenceNo(const Blob& applicationInfo)
 {
   ++sequenceNo_;
 
+  if (publishWindow_ > 0) {
+    // Send one sync message with the latest sequence number after the window.
+    pendingApplicationInfo_ = applicationInfo;
+    if (!isFlushScheduled_) {
+      isFlushScheduled_ = true;
+      face_.callLater
+        (publishWindow_,
+         bind(&ChronoSync2013::Impl::flushPublish, shared_from_this()));
+    }
+    return;
+  }
+
+  publishSequenceNo(applicationInfo);
+}
+
+void
+ChronoSync2013::Impl::flushPublish()
+{
+  isFlushScheduled_ = false;
+  Blob applicationInfo = pendingApplicationInfo_;
+  pendingApplicationInfo_ = Blob();
+  if (!enabled_)
+    // Ignore callbacks after the application calls shutdown().
+    return;
+
+  publishSequenceNo(applicationInfo);
+}
+
+void
+ChronoSync2013::Impl::publishSequenceNo(const Blob& applicationInfo)
+{
   Sync::SyncStateMsg syncMessage;
   Sync::SyncState* content = syncMessage.add_ss();
   content->set_name(applicationDataPrefixUri_);
@@ -161,12 +188,7 @@ ChronoSync2013::Impl::publishNextSequenceNo(const Blob& applicationInfo)
 
   // TODO: Should we have an option to not express an interest if this is the
   //   final publish of the session?
-  Interest interest(applicationBroadcastPrefix_);
-  interest.getName().append(digestTree_->getRoot());
-  interest.setInterestLifetimeMilliseconds(syncLifetime_);
-  face_.expressInterest
-    (interest, bind(&ChronoSync2013::Impl::onData, shared_from_this(), _1, _2),
-     bind(&ChronoSync2013::Impl::syncTimeout, shared_from_this(), _1));
+  expressSyncInterest();
 }
 
 void
@@ -199,7 +221,7 @@ ChronoSync2013::Impl::onInterest
     contentCache_.storePendingInterest(interest, face);
 
     if (syncDigest != digestTree_->getRoot()) {
-      size_t index = logFind(syncDigest);
+      int index = digestLog_->find(syncDigest);
       if (index == -1) {
         // To see whether there is any data packet coming back, wait 2 seconds
         // using the Interest timeout mechanism.
@@ -230,8 +252,12 @@ ChronoSync2013::Impl::onData
 
   _LOG_DEBUG("Sync ContentObject received in callback");
   _LOG_DEBUG("name: " + data->getName().toUri());
+  removePendingSyncDigest(*interest);
   Sync::SyncStateMsg tempContent;
-  tempContent.ParseFromArray(data->getContent().buf(), data->getContent().size());
+  if (!decodeSyncStateMsg(data->getContent(), tempContent)) {
+    _LOG_DEBUG("Cannot decode the sync state message");
+    return;
+  }
 
   const google::protobuf::RepeatedPtrField<Sync::SyncState >&content = tempContent.ss();
   bool isRecovery;
@@ -274,15 +300,7 @@ ChronoSync2013::Impl::onData
     _LOG_ERROR("ChronoSync2013::Impl::onData: Error in onReceivedSyncState.");
   }
 
-  Name name(applicationBroadcastPrefix_);
-  name.append(digestTree_->getRoot());
-  Interest syncInterest(name);
-  syncInterest.setInterestLifetimeMilliseconds(syncLifetime_);
-  face_.expressInterest
-    (syncInterest, bind(&ChronoSync2013::Impl::onData, shared_from_this(), _1, _2),
-     bind(&ChronoSync2013::Impl::syncTimeout, shared_from_this(), _1));
-  _LOG_DEBUG("Syncinterest expressed:");
-  _LOG_DEBUG(name.toUri());
+  expressSyncInterest();
 }
 
 void
@@ -290,7 +308,9 @@ ChronoSync2013::Impl::processRecoveryInterest
   (const Interest& interest, const string& syncDigest, Face& face)
 {
   _LOG_DEBUG("processRecoveryInst");
-  if (logFind(syncDigest) != -1) {
+  // The first entry "00" may have been removed from the bounded log, but we
+  // can always reply to a newcomer.
+  if (syncDigest == "00" || digestLog_->find(syncDigest) != -1) {
     Sync::SyncStateMsg tempContent;
     for (size_t i = 0; i < digestTree_->size(); ++i) {
       Sync::SyncState* content = tempContent.add_ss();
@@ -301,10 +321,8 @@ ChronoSync2013::Impl::processRecoveryInterest
     }
 
     if (tempContent.ss_size() != 0) {
-      ptr_lib::shared_ptr<vector<uint8_t> > array(new vector<uint8_t>(tempContent.ByteSize()));
-      tempContent.SerializeToArray(&array->front(), array->size());
       Data data(interest.getName());
-      data.setContent(Blob(array, false));
+      data.setContent(encodeSyncStateMsg(tempContent));
       if (interest.getName().get(-1).toEscapedString() == "00")
         // Limit the lifetime of replies to interest for "00" since they can be different.
         data.getMetaInfo().setFreshnessPeriod(1000);
@@ -326,54 +344,28 @@ bool
 ChronoSync2013::Impl::processSyncInterest
   (int index, const string& syncDigest, Face& face)
 {
-  vector<string> nameList;
-  vector<int> sequenceNoList;
-  vector<int> sessionNoList;
-  for (size_t j = index + 1; j < digestLog_.size(); ++j) {
-    const google::protobuf::RepeatedPtrField<Sync::SyncState>& temp =
-      digestLog_[j]->getData();
-    for (size_t i = 0; i < temp.size(); ++i) {
-      if (temp.Get(i).type() != Sync::SyncState_ActionType_UPDATE)
-        continue;
-
-      if (digestTree_->find(temp.Get(i).name(), temp.Get(i).seqno().session()) != -1) {
-        int n = -1;
-        for (size_t k = 0; k < nameList.size(); ++k) {
-          if (nameList[k] == temp.Get(i).name()) {
-            n = k;
-            break;
-          }
-        }
-        if (n == -1) {
-          nameList.push_back(temp.Get(i).name());
-          sequenceNoList.push_back(temp.Get(i).seqno().seq());
-          sessionNoList.push_back(temp.Get(i).seqno().session());
-        }
-        else {
-          sequenceNoList[n] = temp.Get(i).seqno().seq();
-          sessionNoList[n] = temp.Get(i).seqno().session();
-        }
-      }
-    }
-  }
+  vector<DigestLog::ProducerState> changes;
+  digestLog_->getChangesSince(index, changes);
 
   Sync::SyncStateMsg tempContent;
-  for (size_t i = 0; i < nameList.size(); ++i) {
+  for (size_t i = 0; i < changes.size(); ++i) {
+    if (digestTree_->find
+        (changes[i].getDataPrefix(), changes[i].getSessionNo()) == -1)
+      continue;
+
     Sync::SyncState* content = tempContent.add_ss();
-    content->set_name(nameList[i]);
+    content->set_name(changes[i].getDataPrefix());
     content->set_type(Sync::SyncState_ActionType_UPDATE);
-    content->mutable_seqno()->set_seq(sequenceNoList[i]);
-    content->mutable_seqno()->set_session(sessionNoList[i]);
+    content->mutable_seqno()->set_seq(changes[i].getSequenceNo());
+    content->mutable_seqno()->set_session(changes[i].getSessionNo());
   }
 
   bool sent = false;
   if (tempContent.ss_size() != 0) {
     Name name(applicationBroadcastPrefix_);
     name.append(syncDigest);
-    ptr_lib::shared_ptr<vector<uint8_t> > array(new vector<uint8_t>(tempContent.ByteSize()));
-    tempContent.SerializeToArray(&array->front(), array->size());
     Data data(name);
-    data.setContent(Blob(array, false));
+    data.setContent(encodeSyncStateMsg(tempContent));
     keyChain_.sign(data, certificateName_);
     try {
       face.putData(data);
@@ -412,7 +404,7 @@ ChronoSync2013::Impl::judgeRecovery
     // Ignore callbacks after the application calls shutdown().
     return;
 
-  int index2 = logFind(syncDigest);
+  int index2 = digestLog_->find(syncDigest);
   if (index2 != -1) {
     if (syncDigest != digestTree_->getRoot())
       processSyncInterest(index2, syncDigest, *face);
@@ -430,18 +422,11 @@ ChronoSync2013::Impl::syncTimeout(const ptr_lib::shared_ptr<const Interest>& int
 
    _LOG_DEBUG("Sync Interest time out.");
    _LOG_DEBUG("Sync Interest name: " + interest->getName().toUri());
+  removePendingSyncDigest(*interest);
   string component = interest->getName().get
     (applicationBroadcastPrefix_.size()).toEscapedString();
-  if (component == digestTree_->getRoot()) {
-    Name name(interest->getName());
-    Interest retryInterest(interest->getName());
-    retryInterest.setInterestLifetimeMilliseconds(syncLifetime_);
-    face_.expressInterest
-      (retryInterest, bind(&ChronoSync2013::Impl::onData, shared_from_this(), _1, _2),
-       bind(&ChronoSync2013::Impl::syncTimeout, shared_from_this(), _1));
-     _LOG_DEBUG("Syncinterest expressed:");
-     _LOG_DEBUG(name.toUri());
-  }
+  if (component == digestTree_->getRoot())
+    expressSyncInterest();
 }
 
 void
@@ -548,36 +533,75 @@ ChronoSync2013::Impl::initialTimeOut(const ptr_lib::shared_ptr<const Interest>&
     _LOG_ERROR("ChronoSync2013::Impl::initialTimeOut: Error in onInitialized.");
   }
 
+  expressSyncInterest();
+}
+
+void
+ChronoSync2013::Impl::expressSyncInterest()
+{
+  const string& root = digestTree_->getRoot();
+  if (pendingSyncDigests_.find(root) != pendingSyncDigests_.end())
+    return;
+
   Name name(applicationBroadcastPrefix_);
-  name.append(digestTree_->getRoot());
-  Interest retryInterest(name);
-  retryInterest.setInterestLifetimeMilliseconds(syncLifetime_);
+  name.append(root);
+  Interest syncInterest(name);
+  syncInterest.setInterestLifetimeMilliseconds(syncLifetime_);
   face_.expressInterest
-    (retryInterest, bind(&ChronoSync2013::Impl::onData, shared_from_this(), _1, _2),
+    (syncInterest, bind(&ChronoSync2013::Impl::onData, shared_from_this(), _1, _2),
      bind(&ChronoSync2013::Impl::syncTimeout, shared_from_this(), _1));
+  pendingSyncDigests_.insert(root);
   _LOG_DEBUG("Syncinterest expressed:");
   _LOG_DEBUG(name.toUri());
 }
 
+void
+ChronoSync2013::Impl::removePendingSyncDigest(const Interest& interest)
+{
+  // A recovery interest has an extra "recovery" component.
+  if (interest.getName().size() == applicationBroadcastPrefix_.size() + 1)
+    pendingSyncDigests_.erase
+      (interest.getName().get(applicationBroadcastPrefix_.size()).toEscapedString());
+}
+
 void
 ChronoSync2013::Impl::broadcastSyncState
   (const string& digest, const Sync::SyncStateMsg& syncMessage)
 {
-  ptr_lib::shared_ptr<vector<uint8_t> > array(new vector<uint8_t>(syncMessage.ByteSize()));
-  syncMessage.SerializeToArray(&array->front(), array->size());
   Data data(applicationBroadcastPrefix_);
   data.getName().append(digest);
-  data.setContent(Blob(array, false));
+  data.setContent(encodeSyncStateMsg(syncMessage));
   keyChain_.sign(data, certificateName_);
   contentCache_.add(data);
 }
 
-ChronoSync2013::DigestLogEntry::DigestLogEntry
-  (const std::string& digest,
-   const google::protobuf::RepeatedPtrField<Sync::SyncState>& data)
-  : digest_(digest),
-   data_(new google::protobuf::RepeatedPtrField<Sync::SyncState>(data))
+Blob
+ChronoSync2013::Impl::encodeSyncStateMsg
+  (const Sync::SyncStateMsg& syncMessage) const
+{
+  if (useCompactEncoding_)
+    return CompactSyncState::encode(syncMessage);
+
+  ptr_lib::shared_ptr<vector<uint8_t> > array(new vector<uint8_t>(syncMessage.ByteSize()));
+  syncMessage.SerializeToArray(&array->front(), array->size());
+  return Blob(array, false);
+}
+
+bool
+ChronoSync2013::Impl::decodeSyncStateMsg
+  (const Blob& encoding, Sync::SyncStateMsg& syncMessage)
 {
+  if (CompactSyncState::isCompact(encoding.buf(), encoding.size())) {
+    try {
+      CompactSyncState::decode(encoding.buf(), encoding.size(), syncMessage);
+      return true;
+    } catch (const std::exception& ex) {
+      _LOG_DEBUG(ex.what());
+      return false;
+    }
+  }
+  else
+    return syncMessage.ParseFromArray(encoding.buf(), encoding.size());
 }
 
 void
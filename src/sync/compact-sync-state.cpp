@@ -0,0 +1,194 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+// Only compile if ndn-cpp-config.h defines NDN_CPP_HAVE_PROTOBUF = 1.
+#include <ndn-cpp/ndn-cpp-config.h>
+#if NDN_CPP_HAVE_PROTOBUF
+
+#include <map>
+#include <stdexcept>
+#include "sync-state.pb.h"
+#include "compact-sync-state.hpp"
+
+using namespace std;
+
+namespace ndn {
+
+static void
+writeVarint(uint64_t value, vector<uint8_t>& output)
+{
+  while (value >= 0x80) {
+    output.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  output.push_back((uint8_t)value);
+}
+
+static uint64_t
+zigZagEncode(int64_t value)
+{
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t
+zigZagDecode(uint64_t value)
+{
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * A CompactReader reads varints and byte strings from the input, checking
+ * for the end of the input.
+ */
+class CompactReader {
+public:
+  CompactReader(const uint8_t* input, size_t inputLength)
+  : input_(input), inputLength_(inputLength), offset_(0)
+  {
+  }
+
+  uint64_t
+  readVarint()
+  {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (offset_ >= inputLength_)
+        throw runtime_error("CompactSyncState::decode: Read past the end of the input");
+      uint8_t b = input_[offset_++];
+      value |= (uint64_t)(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return value;
+    }
+
+    throw runtime_error("CompactSyncState::decode: The varint is too long");
+  }
+
+  string
+  readString()
+  {
+    uint64_t length = readVarint();
+    if (length > inputLength_ - offset_)
+      throw runtime_error("CompactSyncState::decode: Read past the end of the input");
+    string result((const char*)input_ + offset_, length);
+    offset_ += length;
+    return result;
+  }
+
+private:
+  const uint8_t* input_;
+  size_t inputLength_;
+  size_t offset_;
+};
+
+Blob
+CompactSyncState::encode(const Sync::SyncStateMsg& message)
+{
+  // Make the name table.
+  vector<const string*> names;
+  map<string, size_t> nameIndex;
+  for (int i = 0; i < message.ss_size(); ++i) {
+    const string& name = message.ss(i).name();
+    if (nameIndex.find(name) == nameIndex.end()) {
+      nameIndex[name] = names.size();
+      names.push_back(&name);
+    }
+  }
+
+  ptr_lib::shared_ptr<vector<uint8_t> > output(new vector<uint8_t>());
+  output->push_back(0);
+  writeVarint(names.size(), *output);
+  for (size_t i = 0; i < names.size(); ++i) {
+    writeVarint(names[i]->size(), *output);
+    output->insert(output->end(), names[i]->begin(), names[i]->end());
+  }
+
+  writeVarint(message.ss_size(), *output);
+  // Compute the differences in uint64_t where they wrap instead of overflow.
+  uint64_t previousSessionNo = 0;
+  uint64_t previousSequenceNo = 0;
+  for (int i = 0; i < message.ss_size(); ++i) {
+    const Sync::SyncState& state = message.ss(i);
+    uint64_t sessionNo = state.seqno().session();
+    uint64_t sequenceNo = state.seqno().seq();
+
+    writeVarint(nameIndex[state.name()], *output);
+    writeVarint(state.type(), *output);
+    writeVarint
+      (zigZagEncode((int64_t)(sessionNo - previousSessionNo)), *output);
+    writeVarint
+      (zigZagEncode((int64_t)(sequenceNo - previousSequenceNo)), *output);
+    writeVarint(state.application_info().size(), *output);
+    output->insert
+      (output->end(), state.application_info().begin(),
+       state.application_info().end());
+
+    previousSessionNo = sessionNo;
+    previousSequenceNo = sequenceNo;
+  }
+
+  return Blob(output, false);
+}
+
+void
+CompactSyncState::decode
+  (const uint8_t* input, size_t inputLength, Sync::SyncStateMsg& message)
+{
+  if (!isCompact(input, inputLength))
+    throw runtime_error("CompactSyncState::decode: The input is not the compact format");
+  CompactReader reader(input + 1, inputLength - 1);
+
+  // Each name needs at least one byte, so don't allocate for a bad count.
+  uint64_t nNames = reader.readVarint();
+  if (nNames > inputLength)
+    throw runtime_error("CompactSyncState::decode: The name count is too large");
+  vector<string> names(nNames);
+  for (size_t i = 0; i < names.size(); ++i)
+    names[i] = reader.readString();
+
+  uint64_t nStates = reader.readVarint();
+  // The deltas are from the network, so add in uint64_t where a crafted delta
+  // wraps instead of overflowing.
+  uint64_t sessionNo = 0;
+  uint64_t sequenceNo = 0;
+  for (uint64_t i = 0; i < nStates; ++i) {
+    uint64_t nameIndex = reader.readVarint();
+    if (nameIndex >= names.size())
+      throw runtime_error("CompactSyncState::decode: The name index is out of range");
+    uint64_t type = reader.readVarint();
+    if (!Sync::SyncState_ActionType_IsValid((int)type))
+      throw runtime_error("CompactSyncState::decode: Unrecognized action type");
+    sessionNo += (uint64_t)zigZagDecode(reader.readVarint());
+    sequenceNo += (uint64_t)zigZagDecode(reader.readVarint());
+    string applicationInfo = reader.readString();
+
+    Sync::SyncState* state = message.add_ss();
+    state->set_name(names[nameIndex]);
+    state->set_type((Sync::SyncState_ActionType)type);
+    state->mutable_seqno()->set_session(sessionNo);
+    state->mutable_seqno()->set_seq(sequenceNo);
+    if (applicationInfo.size() > 0)
+      state->set_application_info(applicationInfo);
+  }
+}
+
+}
+
+#endif // NDN_CPP_HAVE_PROTOBUF
@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_COMPACT_SYNC_STATE_HPP
+#define NDN_COMPACT_SYNC_STATE_HPP
+
+// Only compile if ndn-cpp-config.h defines NDN_CPP_HAVE_PROTOBUF = 1.
+#include <ndn-cpp/ndn-cpp-config.h>
+#if NDN_CPP_HAVE_PROTOBUF
+
+#include <ndn-cpp/util/blob.hpp>
+
+namespace Sync { class SyncStateMsg; }
+
+namespace ndn {
+
+/**
+ * CompactSyncState has static methods to encode a ChronoSync SyncStateMsg in a
+ * compact binary format and decode it. The encoding is a zero byte (which
+ * can't start a Protobuf SyncStateMsg), a table of the distinct names, then
+ * for each sync state the name index, the type, the session and sequence
+ * numbers as zig-zag varint deltas from the previous sync state, and the
+ * application info. All numbers are unsigned LEB128 varints.
+ */
+class CompactSyncState {
+public:
+  /**
+   * Encode the message in the compact format.
+   * @param message The SyncStateMsg to encode.
+   * @return The encoding.
+   */
+  static Blob
+  encode(const Sync::SyncStateMsg& message);
+
+  /**
+   * Check if the input is in the compact format, as opposed to a Protobuf
+   * encoding.
+   * @param input The input buffer.
+   * @param inputLength The number of bytes in input.
+   * @return True if input has the compact format.
+   */
+  static bool
+  isCompact(const uint8_t* input, size_t inputLength)
+  {
+    return inputLength > 0 && input[0] == 0;
+  }
+
+  /**
+   * Decode the compact format and add each sync state to the message.
+   * @param input The input buffer.
+   * @param inputLength The number of bytes in input.
+   * @param message The SyncStateMsg to update.
+   * @throws runtime_error if the input is not a valid compact encoding.
+   */
+  static void
+  decode
+    (const uint8_t* input, size_t inputLength, Sync::SyncStateMsg& message);
+};
+
+}
+
+#endif // NDN_CPP_HAVE_PROTOBUF
+
+#endif
@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include <algorithm>
+#include "digest-log.hpp"
+
+using namespace std;
+
+namespace ndn {
+
+DigestLog::DigestLog(size_t maxEntries)
+: maxEntries_(maxEntries), nextIndex_(0)
+{
+  if (maxEntries_ == 0)
+    maxEntries_ = 1;
+}
+
+int
+DigestLog::add(const string& digest)
+{
+  int index = nextIndex_;
+  ++nextIndex_;
+
+  if (entries_.size() < maxEntries_)
+    entries_.push_back(digest);
+  else {
+    // Remove the oldest entry, which is in the place of the new one.
+    string& entry = entries_[index % maxEntries_];
+    DigestIndex::iterator oldest = digestIndex_.find(entry);
+    if (oldest != digestIndex_.end() && oldest->second == index - (int)maxEntries_)
+      digestIndex_.erase(oldest);
+    entry = digest;
+  }
+
+  digestIndex_[digest] = index;
+  return index;
+}
+
+void
+DigestLog::updateProducer
+  (const string& dataPrefix, int sessionNo, int sequenceNo)
+{
+  int index = nextIndex_ - 1;
+  ProducerIndex::iterator found = producerIndex_.find(dataPrefix);
+  if (found == producerIndex_.end())
+    producerIndex_[dataPrefix] = producers_.insert
+      (producers_.end(), ProducerState(dataPrefix, sessionNo, sequenceNo, index));
+  else {
+    // Move the producer to the end, keeping the producers in update order.
+    ProducerState& state = *found->second;
+    state.sessionNo_ = sessionNo;
+    state.sequenceNo_ = sequenceNo;
+    state.entryIndex_ = index;
+    producers_.splice(producers_.end(), producers_, found->second);
+  }
+}
+
+int
+DigestLog::find(const string& digest) const
+{
+  DigestIndex::const_iterator found = digestIndex_.find(digest);
+  if (found == digestIndex_.end())
+    return -1;
+  else
+    return found->second;
+}
+
+void
+DigestLog::getChangesSince(int index, vector<ProducerState>& states) const
+{
+  states.clear();
+
+  // Producers are in update order, so stop at the first one not after index.
+  list<ProducerState>::const_reverse_iterator producer = producers_.rbegin();
+  for (; producer != producers_.rend() && producer->entryIndex_ > index;
+       ++producer)
+    states.push_back(*producer);
+
+  reverse(states.begin(), states.end());
+}
+
+}
@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_DIGEST_LOG_HPP
+#define NDN_DIGEST_LOG_HPP
+
+#include <ndn-cpp/common.hpp>
+#include <string>
+#include <vector>
+#include <list>
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#else
+#include <map>
+#endif
+
+namespace ndn {
+
+/**
+ * A DigestLog holds the recent root digests of a ChronoSync digest tree and,
+ * for each producer, the latest sync state and the log entry where it was
+ * updated. The log is a ring of at most maxEntries digests with a hash index
+ * from digest to entry, so that a long session uses bounded memory and
+ * getChangesSince() takes time proportional to the number of producers which
+ * changed.
+ */
+class DigestLog {
+public:
+  /**
+   * A ProducerState has the sequence number of a producer's data prefix and
+   * session.
+   */
+  class ProducerState {
+  public:
+    ProducerState
+      (const std::string& dataPrefix, int sessionNo, int sequenceNo,
+       int entryIndex)
+    : dataPrefix_(dataPrefix), sessionNo_(sessionNo), sequenceNo_(sequenceNo),
+      entryIndex_(entryIndex)
+    {
+    }
+
+    const std::string&
+    getDataPrefix() const { return dataPrefix_; }
+
+    int
+    getSessionNo() const { return sessionNo_; }
+
+    int
+    getSequenceNo() const { return sequenceNo_; }
+
+  private:
+    friend class DigestLog;
+
+    std::string dataPrefix_;
+    int sessionNo_;
+    int sequenceNo_;
+    // The index of the log entry where this was last updated.
+    int entryIndex_;
+  };
+
+  /**
+   * Create a DigestLog.
+   * @param maxEntries (optional) The maximum number of digests to keep. When
+   * an entry is added to a full log, the oldest entry is removed. If omitted,
+   * use DEFAULT_MAX_ENTRIES.
+   */
+  DigestLog(size_t maxEntries = DEFAULT_MAX_ENTRIES);
+
+  /**
+   * Add a log entry for the digest. Then call updateProducer for each sync
+   * state of the entry.
+   * @param digest The root digest as a hex string.
+   * @return The index of the new entry.
+   */
+  int
+  add(const std::string& digest);
+
+  /**
+   * Set the producer's sync state in the last entry added.
+   * @param dataPrefix The producer's data prefix.
+   * @param sessionNo The session number.
+   * @param sequenceNo The sequence number.
+   */
+  void
+  updateProducer(const std::string& dataPrefix, int sessionNo, int sequenceNo);
+
+  /**
+   * Find the log entry for the digest.
+   * @param digest The root digest as a hex string.
+   * @return The index of the entry, or -1 if not found (or removed from the
+   * log).
+   */
+  int
+  find(const std::string& digest) const;
+
+  /**
+   * Get the latest sync state of each producer which was updated in an entry
+   * after the given index.
+   * @param index The index of an entry from find().
+   * @param states This clears the vector and adds the states, oldest first.
+   */
+  void
+  getChangesSince(int index, std::vector<ProducerState>& states) const;
+
+  /**
+   * Get the number of entries in the log.
+   */
+  size_t
+  size() const { return entries_.size(); }
+
+  static const size_t DEFAULT_MAX_ENTRIES = 1000;
+
+private:
+  // The key is the digest or data prefix.
+#if __cplusplus >= 201103L
+  typedef std::unordered_map<std::string, int> DigestIndex;
+  typedef std::unordered_map
+    <std::string, std::list<ProducerState>::iterator> ProducerIndex;
+#else
+  typedef std::map<std::string, int> DigestIndex;
+  typedef std::map
+    <std::string, std::list<ProducerState>::iterator> ProducerIndex;
+#endif
+
+  size_t maxEntries_;
+  // The digest of entry i is at entries_[i % maxEntries_].
+  std::vector<std::string> entries_;
+  int nextIndex_;
+  DigestIndex digestIndex_;
+  // The producers in the order they were updated, oldest first.
+  std::list<ProducerState> producers_;
+  ProducerIndex producerIndex_;
+};
+
+}
+
+#endif
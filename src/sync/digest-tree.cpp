@@ -20,13 +20,8 @@
  * A copy of the GNU Lesser General Public License is in the file COPYING.
  */
 
-#include <algorithm>
+#include <string.h>
 #include <ndn-cpp/util/logging.hpp>
-#if NDN_CPP_HAVE_LIBCRYPTO
-#include <openssl/ssl.h>
-#else
-#include "../../contrib/openssl/sha.h"
-#endif
 #include "digest-tree.hpp"
 
 INIT_LOGGER("ndn.DigestTree");
@@ -35,40 +30,6 @@ using namespace std;
 
 namespace ndn {
 
-/**
- * Convert the hex character to an integer from 0 to 15, or -1 if not a hex character.
- * @param c
- * @return
- */
-static int
-fromHexChar(uint8_t c)
-{
-  if (c >= '0' && c <= '9')
-    return (int)c - (int)'0';
-  else if (c >= 'A' && c <= 'F')
-    return (int)c - (int)'A' + 10;
-  else if (c >= 'a' && c <= 'f')
-    return (int)c - (int)'a' + 10;
-  else
-    return -1;
-}
-
-/**
- * Convert the hex string to bytes and call SHA256_Update.
- * @param context The SHA256_CTX to update.
- * @param hex The hex string.
- * @return The result from SHA256_Update.
- */
-static int
-SHA256_UpdateHex(SHA256_CTX *context, const string& hex)
-{
-  vector<uint8_t> data(hex.size() / 2);
-  for (size_t i = 0; i < data.size(); ++i)
-    data[i] = (uint8_t)(16 * fromHexChar(hex[2 * i]) + fromHexChar(hex[2 * i + 1]));
-
-  return SHA256_Update(context, &data[0], data.size());
-}
-
 bool
 DigestTree::update(const std::string& dataPrefix, int sessionNo, int sequenceNo)
 {
@@ -85,38 +46,113 @@ DigestTree::update(const std::string& dataPrefix, int sessionNo, int sequenceNo)
   else {
     _LOG_DEBUG("new comer " << dataPrefix << ", session " << sessionNo <<
                ", sequence " << sequenceNo);
-    // Insert into digestnode_ sorted.
-    ptr_lib::shared_ptr<Node> temp(new Node(dataPrefix, sessionNo, sequenceNo));
-    digestNode_.insert
-      (std::lower_bound(digestNode_.begin(), digestNode_.end(), temp, nodeCompare_),
-       temp);
+    // Append to digestNode_ so that the index of other nodes does not change.
+    index = digestNode_.size();
+    digestNode_.push_back(ptr_lib::make_shared<Node>
+      (dataPrefix, sessionNo, sequenceNo));
+    nodeIndex_[dataPrefix].push_back(index);
+  }
+
+  const Node* node = digestNode_[index].get();
+  if (sortedBlocks_.empty())
+    sortedBlocks_.push_back(ptr_lib::make_shared<SortedBlock>());
+  size_t blockIndex;
+  vector<SortedEntry>::iterator entry = findSorted(node, blockIndex);
+  if (entry == sortedBlocks_[blockIndex]->entries_.end() ||
+      entry->node_ != node) {
+    SortedEntry newEntry;
+    newEntry.node_ = node;
+    entry = sortedBlocks_[blockIndex]->entries_.insert(entry, newEntry);
+  }
+  memcpy(entry->digest_, node->getDigest(), ndn_SHA256_DIGEST_SIZE);
+
+  // The saved contexts up to the block of the first changed node are still
+  // valid.
+  if (isRootValid_ || nodeCompare_(node, firstChanged_))
+    firstChanged_ = node;
+  isRootValid_ = false;
+
+  vector<SortedEntry>& entries = sortedBlocks_[blockIndex]->entries_;
+  if (entries.size() > MAX_BLOCK_SIZE) {
+    // Split the block. The new block doesn't have a saved context, so rehash
+    // from the start of this block.
+    ptr_lib::shared_ptr<SortedBlock> newBlock =
+      ptr_lib::make_shared<SortedBlock>();
+    newBlock->entries_.assign(entries.begin() + entries.size() / 2, entries.end());
+    entries.erase(entries.begin() + entries.size() / 2, entries.end());
+    sortedBlocks_.insert(sortedBlocks_.begin() + blockIndex + 1, newBlock);
+    if (nodeCompare_(entries.front().node_, firstChanged_))
+      firstChanged_ = entries.front().node_;
   }
 
-  recomputeRoot();
   return true;
 }
 
+vector<DigestTree::SortedEntry>::iterator
+DigestTree::findSorted(const Node* node, size_t& blockIndex) const
+{
+  // Find the first block whose last node is not less than the node.
+  size_t low = 0;
+  size_t high = sortedBlocks_.size() - 1;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (nodeCompare_(sortedBlocks_[middle]->entries_.back().node_, node))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  blockIndex = low;
+
+  vector<SortedEntry>& entries = sortedBlocks_[blockIndex]->entries_;
+  low = 0;
+  high = entries.size();
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (nodeCompare_(entries[middle].node_, node))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return entries.begin() + low;
+}
+
 void
-DigestTree::recomputeRoot()
+DigestTree::recomputeRoot() const
 {
-  SHA256_CTX sha256;
+  size_t blockIndex;
+  findSorted(firstChanged_, blockIndex);
+  if (blockIndex == 0)
+    SHA256_Init(&sortedBlocks_[0]->sha256_);
+
+  // Hash the blocks from the one with the first changed node, saving the
+  // context before each block.
+  SHA256_CTX sha256 = sortedBlocks_[blockIndex]->sha256_;
+  for (size_t i = blockIndex; i < sortedBlocks_.size(); ++i) {
+    SortedBlock& block = *sortedBlocks_[i];
+    block.sha256_ = sha256;
+    for (size_t j = 0; j < block.entries_.size(); ++j)
+      SHA256_Update(&sha256, block.entries_[j].digest_, ndn_SHA256_DIGEST_SIZE);
+  }
 
-  SHA256_Init(&sha256);
-  for (size_t i = 0; i < digestNode_.size(); ++i)
-    SHA256_UpdateHex(&sha256, digestNode_[i]->getDigest());
   uint8_t digestRoot[ndn_SHA256_DIGEST_SIZE];
   SHA256_Final(&digestRoot[0], &sha256);
   root_ = toHex(digestRoot, sizeof(digestRoot));
+  isRootValid_ = true;
   _LOG_DEBUG("update root to: " + root_);
 }
 
 int
 DigestTree::find(const string& dataPrefix, int sessionNo) const
 {
-  for (size_t i = 0; i < digestNode_.size(); ++i) {
-    if (digestNode_[i]->getDataPrefix() == dataPrefix &&
-        digestNode_[i]->getSessionNo() == sessionNo)
-      return i;
+  NodeIndex::const_iterator found = nodeIndex_.find(dataPrefix);
+  if (found == nodeIndex_.end())
+    return -1;
+
+  // There is usually one session for a data prefix.
+  const vector<size_t>& indexes = found->second;
+  for (size_t i = 0; i < indexes.size(); ++i) {
+    if (digestNode_[indexes[i]]->getSessionNo() == sessionNo)
+      return indexes[i];
   }
 
   return -1;
@@ -144,9 +180,7 @@ DigestTree::Node::recomputeDigest()
   SHA256_Init(&sha256);
   SHA256_Update(&sha256, nameDigest, sizeof(nameDigest));
   SHA256_Update(&sha256, sequenceDigest, sizeof(sequenceDigest));
-  uint8_t nodeDigest[ndn_SHA256_DIGEST_SIZE];
-  SHA256_Final(nodeDigest, &sha256);
-  digest_ = toHex(nodeDigest, sizeof(nodeDigest));
+  SHA256_Final(digest_, &sha256);
 }
 
 void
@@ -25,13 +25,34 @@
 
 #include <ndn-cpp/common.hpp>
 #include <string>
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#else
+#include <map>
+#endif
+#if NDN_CPP_HAVE_LIBCRYPTO
+#include <openssl/sha.h>
+#else
+#include "../../contrib/openssl/sha.h"
+#endif
 
 namespace ndn {
 
+/**
+ * A DigestTree holds the nodes of a ChronoSync state. The nodes are kept in
+ * the order they were added with a hash index by data prefix, and in blocks
+ * sorted by data prefix and session number. The root digest is the SHA-256 of
+ * the concatenated node digests in sorted order, which must be the same as
+ * other ChronoSync2013 implementations. To avoid rehashing every node, each
+ * sorted block keeps the SHA-256 context before its first digest, so that a
+ * change to a node only rehashes the nodes from its block to the end. The
+ * root is recomputed when getRoot() is called, so that a batch of updates is
+ * hashed once.
+ */
 class DigestTree {
 public:
   DigestTree()
-  : root_("00")
+  : firstChanged_(0), root_("00"), isRootValid_(true)
   {}
 
   class Node {
@@ -61,9 +82,9 @@ public:
 
     /**
      * Get the digest.
-     * @return The digest as a hex string.
+     * @return A pointer to the ndn_SHA256_DIGEST_SIZE bytes of the digest.
      */
-    const std::string&
+    const uint8_t*
     getDigest() const { return digest_; }
 
     /**
@@ -78,14 +99,12 @@ public:
     }
 
     /**
-     * Compare shared_ptrs to Node based on dataPrefix_ and seqno_session_.
+     * Compare pointers to Node based on dataPrefix_ and sessionNo_.
      */
     class Compare {
     public:
       bool
-      operator()
-        (const ptr_lib::shared_ptr<const Node>& node1,
-         const ptr_lib::shared_ptr<const Node>& node2) const
+      operator()(const Node* node1, const Node* node2) const
       {
         int nameComparison = node1->dataPrefix_.compare(node2->dataPrefix_);
         if (nameComparison != 0)
@@ -97,7 +116,7 @@ public:
 
   private:
     /**
-     * Digest the fields and set digest_ to the hex digest.
+     * Digest the fields and set digest_.
      */
     void
     recomputeDigest();
@@ -108,7 +127,7 @@ public:
     std::string dataPrefix_;
     int sessionNo_;
     int sequenceNo_;
-    std::string digest_;
+    uint8_t digest_[ndn_SHA256_DIGEST_SIZE];
   };
 
   /**
@@ -124,12 +143,24 @@ public:
   bool
   update(const std::string& dataPrefix, int sessionNo, int sequenceNo);
 
+  /**
+   * Find the node with the data prefix and session number.
+   * @param dataPrefix The name prefix.
+   * @param sessionNo The session number.
+   * @return The index of the node for get(), or -1 if not found.
+   */
   int
   find(const std::string& dataPrefix, int sessionNo) const;
 
   size_t
   size() const { return digestNode_.size(); }
 
+  /**
+   * Get the node at the index. Nodes are in the order they were added, and a
+   * node's index does not change.
+   * @param i The index from 0 to size() - 1.
+   * @return The node.
+   */
   const DigestTree::Node&
   get(size_t i) const { return *digestNode_[i]; }
 
@@ -138,19 +169,73 @@ public:
    * @return The root digest as a hex string.
    */
   const std::string&
-  getRoot() const { return root_; }
+  getRoot() const
+  {
+    if (!isRootValid_)
+      recomputeRoot();
+    return root_;
+  }
 
 private:
+  // The key is the data prefix. The value has the index in digestNode_ of
+  // the node for each session number.
+#if __cplusplus >= 201103L
+  typedef std::unordered_map<std::string, std::vector<size_t> > NodeIndex;
+#else
+  typedef std::map<std::string, std::vector<size_t> > NodeIndex;
+#endif
+
+  /**
+   * A SortedEntry has a node and a copy of its digest, so that recomputeRoot()
+   * reads the digests in order from contiguous memory.
+   */
+  class SortedEntry {
+  public:
+    const Node* node_;
+    uint8_t digest_[ndn_SHA256_DIGEST_SIZE];
+  };
+
+  /**
+   * A SortedBlock has up to MAX_BLOCK_SIZE consecutive entries in sorted
+   * order. An insert only shifts the entries of one block.
+   */
+  class SortedBlock {
+  public:
+    std::vector<SortedEntry> entries_;
+    // The SHA-256 context after the digests of all the blocks before this one.
+    SHA256_CTX sha256_;
+  };
+
+  static const size_t MAX_BLOCK_SIZE = 128;
+
+  /**
+   * Find the block and entry where the node is or should be inserted.
+   * @param node The node to find.
+   * @param blockIndex Set this to the index in sortedBlocks_.
+   * @return The entry, which is end() of the block's entries_ if the node is
+   * after all nodes.
+   */
+  std::vector<SortedEntry>::iterator
+  findSorted(const Node* node, size_t& blockIndex) const;
+
   /**
-   * Set root_ to the digest of all digests in digestNode_. This sets root_
-   * to the hex value of the digest.
+   * Set root_ to the hex digest of all digests in sortedBlocks_, starting from
+   * the saved SHA-256 context of the block with firstChanged_.
    */
   void
-  recomputeRoot();
+  recomputeRoot() const;
 
+  // The nodes in the order they were added. A node is never moved.
   std::vector<ptr_lib::shared_ptr<DigestTree::Node> > digestNode_;
-  std::string root_;
+  NodeIndex nodeIndex_;
+  // The nodes sorted by Node::Compare. A block is never empty.
+  std::vector<ptr_lib::shared_ptr<SortedBlock> > sortedBlocks_;
   Node::Compare nodeCompare_;
+  // The first node in sorted order which changed since the root was computed.
+  // This is only valid if isRootValid_ is false.
+  mutable const Node* firstChanged_;
+  mutable std::string root_;
+  mutable bool isRootValid_;
 };
 
 }
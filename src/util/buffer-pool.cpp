@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include "buffer-pool.hpp"
+
+using namespace std;
+
+namespace ndn {
+
+#if __cplusplus >= 201103L
+
+// The size classes are MIN_SIZE_CLASS, 2 * MIN_SIZE_CLASS, ..., MAX_SIZE_CLASS.
+static const int N_SIZE_CLASSES = 11;
+
+/**
+ * FreeLists holds a thread's free vectors for each size class. The vectors in
+ * lists_[i] have a capacity of at least MIN_SIZE_CLASS << i.
+ */
+class FreeLists {
+public:
+  FreeLists() {}
+
+  ~FreeLists()
+  {
+    for (int i = 0; i < N_SIZE_CLASSES; ++i) {
+      for (size_t j = 0; j < lists_[i].size(); ++j)
+        delete lists_[i][j];
+    }
+
+    // A Blob could be released after this during thread exit.
+    isDestroyed_ = true;
+  }
+
+  vector<vector<uint8_t>*> lists_[N_SIZE_CLASSES];
+
+  static thread_local bool isDestroyed_;
+
+private:
+  // Don't allow copying.
+  FreeLists(const FreeLists& other);
+  FreeLists& operator=(const FreeLists& other);
+};
+
+thread_local bool FreeLists::isDestroyed_ = false;
+
+/**
+ * Get the calling thread's FreeLists.
+ * @return A pointer to the FreeLists, or 0 if it was already destroyed because
+ * the thread is exiting.
+ */
+static FreeLists*
+getFreeLists()
+{
+  if (FreeLists::isDestroyed_)
+    return 0;
+
+  static thread_local FreeLists freeLists;
+  return &freeLists;
+}
+
+ptr_lib::shared_ptr<vector<uint8_t> >
+BufferPool::allocate(size_t length)
+{
+  vector<uint8_t>* buffer = 0;
+
+  if (length <= MAX_SIZE_CLASS) {
+    // Find the smallest size class which fits length.
+    int sizeClass = 0;
+    size_t classSize = MIN_SIZE_CLASS;
+    while (classSize < length) {
+      ++sizeClass;
+      classSize <<= 1;
+    }
+
+    FreeLists* freeLists = getFreeLists();
+    if (freeLists && !freeLists->lists_[sizeClass].empty()) {
+      buffer = freeLists->lists_[sizeClass].back();
+      freeLists->lists_[sizeClass].pop_back();
+    }
+    else {
+      buffer = new vector<uint8_t>();
+      buffer->reserve(classSize);
+    }
+  }
+  else
+    buffer = new vector<uint8_t>();
+
+  // A reused buffer already has the capacity, so this doesn't allocate.
+  buffer->resize(length);
+  return ptr_lib::shared_ptr<vector<uint8_t> >(buffer, &BufferPool::release);
+}
+
+void
+BufferPool::release(vector<uint8_t>* buffer)
+{
+  size_t capacity = buffer->capacity();
+  FreeLists* freeLists = getFreeLists();
+  if (freeLists && capacity >= MIN_SIZE_CLASS && capacity <= 2 * MAX_SIZE_CLASS) {
+    // Find the largest size class which the capacity can serve.
+    int sizeClass = 0;
+    size_t classSize = MIN_SIZE_CLASS;
+    while (sizeClass < N_SIZE_CLASSES - 1 && (classSize << 1) <= capacity) {
+      ++sizeClass;
+      classSize <<= 1;
+    }
+
+    vector<vector<uint8_t>*>& list = freeLists->lists_[sizeClass];
+    if (list.size() < MAX_FREE_PER_SIZE_CLASS) {
+      // The buffer may hold a signed portion or a decrypted key encoding, and an
+      // encoder may resize it to its full capacity, so zero all of the capacity
+      // before another encoder can reuse it. This doesn't reallocate.
+      buffer->assign(capacity, 0);
+      list.push_back(buffer);
+      return;
+    }
+  }
+
+  delete buffer;
+}
+
+size_t
+BufferPool::getFreeCount()
+{
+  FreeLists* freeLists = getFreeLists();
+  if (!freeLists)
+    return 0;
+
+  size_t count = 0;
+  for (int i = 0; i < N_SIZE_CLASSES; ++i)
+    count += freeLists->lists_[i].size();
+  return count;
+}
+
+#else
+
+// Without thread_local, don't pool.
+
+ptr_lib::shared_ptr<vector<uint8_t> >
+BufferPool::allocate(size_t length)
+{
+  return ptr_lib::shared_ptr<vector<uint8_t> >(new vector<uint8_t>(length));
+}
+
+void
+BufferPool::release(vector<uint8_t>* buffer)
+{
+  delete buffer;
+}
+
+size_t
+BufferPool::getFreeCount() { return 0; }
+
+#endif
+
+}
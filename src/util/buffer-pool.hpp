@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_BUFFER_POOL_HPP
+#define NDN_BUFFER_POOL_HPP
+
+#include <vector>
+#include <ndn-cpp/common.hpp>
+
+namespace ndn {
+
+/**
+ * The BufferPool class has static methods to allocate the vectors which the
+ * encoders use for their output. Each thread keeps free lists of vectors in
+ * size classes which are powers of two. When the last shared_ptr (usually held
+ * by a Blob) to a vector from allocate() is released, the vector is returned to
+ * the free list of the releasing thread instead of being deleted, so that
+ * encoding at a high packet rate reuses the same memory. A vector is zeroed
+ * when it is returned to a free list, so that an encoding (which may hold
+ * private data) is not visible to the next user. If the compiler does not
+ * support C++11 thread_local, this simply allocates a new vector.
+ */
+class BufferPool {
+public:
+  /**
+   * Get a vector from the calling thread's free list, or allocate a new one.
+   * @param length The size() of the returned vector. Its capacity is rounded
+   * up to the size class so that it can be reused for a similar length. If
+   * length is larger than the largest size class, the vector is not pooled.
+   * @return A shared_ptr to the vector, whose deleter returns the vector to the
+   * pool.
+   */
+  static ptr_lib::shared_ptr<std::vector<uint8_t> >
+  allocate(size_t length);
+
+  /**
+   * Get the number of vectors in the calling thread's free lists. This is
+   * mainly for testing.
+   * @return The number of free vectors.
+   */
+  static size_t
+  getFreeCount();
+
+  /**
+   * The smallest size class. A vector with a smaller capacity is not pooled.
+   */
+  static const size_t MIN_SIZE_CLASS = 64;
+
+  /**
+   * The largest size class. A vector for a larger length is not pooled.
+   */
+  static const size_t MAX_SIZE_CLASS = 65536;
+
+  /**
+   * The maximum number of free vectors kept in each size class for each
+   * thread.
+   */
+  static const size_t MAX_FREE_PER_SIZE_CLASS = 16;
+
+private:
+  /**
+   * Zero the vector and return it to the calling thread's free list, or delete
+   * it if the free list is full. This is the shared_ptr deleter for vectors from
+   * allocate().
+   * @param buffer The vector to release.
+   */
+  static void
+  release(std::vector<uint8_t>* buffer);
+};
+
+}
+
+#endif
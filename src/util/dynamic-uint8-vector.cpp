@@ -19,6 +19,7 @@
  * A copy of the GNU Lesser General Public License is in the file COPYING.
  */
 
+#include "buffer-pool.hpp"
 #include "dynamic-uint8-vector.hpp"
 
 using namespace std;
@@ -26,12 +27,8 @@ using namespace std;
 namespace ndn {
 
 DynamicUInt8Vector::DynamicUInt8Vector(size_t initialLength)
-: vector_(new vector<uint8_t>())
+: vector_(BufferPool::allocate(initialLength))
 {
-  // Note: Don't know why, but it is much faster to set the initial length with
-  // resize() than in the constructor.
-  vector_->resize(initialLength);
-
   ndn_DynamicUInt8Array_initialize(this, &vector_->front(), initialLength, DynamicUInt8Vector::realloc);
 }
 
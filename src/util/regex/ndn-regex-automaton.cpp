@@ -0,0 +1,299 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include "ndn-regex-matcher-base.hpp"
+// Only compile if we set NDN_CPP_HAVE_REGEX_LIB in ndn-regex-matcher-base.hpp.
+#if NDN_CPP_HAVE_REGEX_LIB
+
+#include <algorithm>
+#include "ndn-regex-component-set-matcher.hpp"
+#include "ndn-regex-repeat-matcher.hpp"
+#include "ndn-regex-automaton.hpp"
+
+using namespace std;
+
+namespace ndn {
+
+// NdnRegexRepeatMatcher uses this for the maximum of '*', '+' and "{n,}".
+static const size_t MAX_REPETITIONS = 32767;
+
+/**
+ * A Predicate checks if a name component matches a component set. It has a
+ * copy of the regex of each component in the set.
+ */
+class NdnRegexAutomaton::Predicate {
+public:
+  Predicate(const NdnRegexComponentSetMatcher& componentSet)
+  : isInclusion_(componentSet.isInclusion_), hasAny_(false)
+  {
+    for (set<ptr_lib::shared_ptr<NdnRegexComponentMatcher> >::const_iterator it =
+           componentSet.components_.begin();
+         it != componentSet.components_.end(); ++it) {
+      const string& expr = (*it)->getExpr();
+      if (expr.empty() || expr == ".*")
+        // <> and <.*> match any component.
+        hasAny_ = true;
+      else
+        regexes_.push_back((*it)->componentRegex_);
+    }
+  }
+
+  /**
+   * Check if the predicate needs the escaped component string.
+   */
+  bool
+  needsString() const { return !hasAny_; }
+
+  /**
+   * Check if the component matches.
+   * @param escapedComponent The component's toEscapedString(). This is not
+   * used if needsString() is false.
+   */
+  bool
+  matches(const string& escapedComponent) const
+  {
+    bool isMatched = hasAny_;
+    for (size_t i = 0; i < regexes_.size() && !isMatched; ++i) {
+      if (regex_lib::regex_match(escapedComponent, regexes_[i]))
+        isMatched = true;
+    }
+
+    return isInclusion_ ? isMatched : !isMatched;
+  }
+
+private:
+  bool isInclusion_;
+  bool hasAny_;
+  vector<regex_lib::regex> regexes_;
+};
+
+ptr_lib::shared_ptr<NdnRegexAutomaton>
+NdnRegexAutomaton::compile(const NdnRegexMatcherBase& matcher)
+{
+  ptr_lib::shared_ptr<NdnRegexAutomaton> automaton(new NdnRegexAutomaton());
+
+  try {
+    int matchState = automaton->addNfaState(MATCH, -1, -1);
+    automaton->nfaStart_ = automaton->build(matcher, matchState);
+  } catch (const NdnRegexMatcherBase::Error& ex) {
+    return ptr_lib::shared_ptr<NdnRegexAutomaton>();
+  }
+
+  // match() keeps a 64-bit mask of the predicates in a DFA state.
+  if (automaton->predicates_.size() > 64)
+    return ptr_lib::shared_ptr<NdnRegexAutomaton>();
+
+  return automaton;
+}
+
+int
+NdnRegexAutomaton::build(const NdnRegexMatcherBase& matcher, int next)
+{
+  switch (matcher.type_) {
+  case NdnRegexMatcherBase::NDN_REGEX_EXPR_PATTERN_LIST:
+  case NdnRegexMatcherBase::NDN_REGEX_EXPR_BACKREF:
+    // Build the sequence from the end so that each part knows its next state.
+    for (size_t i = matcher.matchers_.size(); i > 0; --i)
+      next = build(*matcher.matchers_[i - 1], next);
+    return next;
+
+  case NdnRegexMatcherBase::NDN_REGEX_EXPR_REPEAT_PATTERN:
+    {
+      const NdnRegexRepeatMatcher& repeat =
+        static_cast<const NdnRegexRepeatMatcher&>(matcher);
+      const NdnRegexMatcherBase& inner = *matcher.matchers_[0];
+
+      int start;
+      if (repeat.repeatMax_ >= MAX_REPETITIONS) {
+        // Loop on the inner matcher. (A name has fewer than MAX_REPETITIONS
+        // components, so this is the same as the limit.)
+        int loop = addNfaState(SPLIT, -1, next);
+        nfaStates_[loop].next_ = build(inner, loop);
+        start = loop;
+      }
+      else {
+        // Each optional repetition can skip to next.
+        start = next;
+        for (size_t i = repeat.repeatMin_; i < repeat.repeatMax_; ++i) {
+          int body = build(inner, start);
+          start = addNfaState(SPLIT, body, next);
+        }
+      }
+
+      for (size_t i = 0; i < repeat.repeatMin_; ++i)
+        start = build(inner, start);
+
+      return start;
+    }
+
+  case NdnRegexMatcherBase::NDN_REGEX_EXPR_COMPONENT_SET:
+    return addNfaState
+      (getPredicate(static_cast<const NdnRegexComponentSetMatcher&>(matcher)),
+       next, -1);
+
+  default:
+    throw NdnRegexMatcherBase::Error
+      ("NdnRegexAutomaton: Unsupported matcher " + matcher.getExpr());
+  }
+}
+
+int
+NdnRegexAutomaton::addNfaState(int predicate, int next, int next2)
+{
+  if (nfaStates_.size() >= MAX_NFA_STATES)
+    throw NdnRegexMatcherBase::Error("NdnRegexAutomaton: Too many states");
+
+  nfaStates_.push_back(NfaState(predicate, next, next2));
+  return nfaStates_.size() - 1;
+}
+
+int
+NdnRegexAutomaton::getPredicate(const NdnRegexComponentSetMatcher& componentSet)
+{
+  map<string, int>::iterator found = predicateIndex_.find(componentSet.getExpr());
+  if (found != predicateIndex_.end())
+    return found->second;
+
+  predicates_.push_back(ptr_lib::make_shared<Predicate>(componentSet));
+  int index = predicates_.size() - 1;
+  predicateIndex_[componentSet.getExpr()] = index;
+  return index;
+}
+
+void
+NdnRegexAutomaton::addClosure
+  (int nfaState, vector<bool>& visited, vector<int>& result)
+{
+  if (visited[nfaState])
+    return;
+  visited[nfaState] = true;
+
+  const NfaState& state = nfaStates_[nfaState];
+  if (state.predicate_ == SPLIT) {
+    addClosure(state.next_, visited, result);
+    addClosure(state.next2_, visited, result);
+  }
+  else
+    result.push_back(nfaState);
+}
+
+int
+NdnRegexAutomaton::getDfaState(const vector<int>& nfaStates)
+{
+  map<vector<int>, int>::iterator found = dfaIndex_.find(nfaStates);
+  if (found != dfaIndex_.end())
+    return found->second;
+
+  DfaState dfaState;
+  dfaState.nfaStates_ = nfaStates;
+  dfaState.isAccepting_ = false;
+  for (size_t i = 0; i < nfaStates.size(); ++i) {
+    int predicate = nfaStates_[nfaStates[i]].predicate_;
+    if (predicate == MATCH)
+      dfaState.isAccepting_ = true;
+    else
+      dfaState.predicates_.push_back(predicate);
+  }
+  sort(dfaState.predicates_.begin(), dfaState.predicates_.end());
+  dfaState.predicates_.erase
+    (unique(dfaState.predicates_.begin(), dfaState.predicates_.end()),
+     dfaState.predicates_.end());
+
+  dfaStates_.push_back(dfaState);
+  int index = dfaStates_.size() - 1;
+  dfaIndex_[nfaStates] = index;
+  return index;
+}
+
+bool
+NdnRegexAutomaton::match(const Name& name)
+{
+  if (dfaStates_.size() >= MAX_DFA_STATES) {
+    dfaStates_.clear();
+    dfaIndex_.clear();
+  }
+  if (dfaStates_.empty()) {
+    // The first DFA state is the start.
+    vector<bool> visited(nfaStates_.size(), false);
+    vector<int> closure;
+    addClosure(nfaStart_, visited, closure);
+    sort(closure.begin(), closure.end());
+    getDfaState(closure);
+  }
+
+  int state = 0;
+  for (size_t i = 0; i < name.size(); ++i) {
+    if (dfaStates_[state].predicates_.empty())
+      // No NFA state can consume another component.
+      return false;
+
+    // Check each predicate once, and only get the escaped string if needed.
+    const vector<int>& predicates = dfaStates_[state].predicates_;
+    string escapedComponent;
+    bool haveEscapedComponent = false;
+    uint64_t mask = 0;
+    for (size_t j = 0; j < predicates.size(); ++j) {
+      const Predicate& predicate = *predicates_[predicates[j]];
+      if (predicate.needsString() && !haveEscapedComponent) {
+        escapedComponent = name.get(i).toEscapedString();
+        haveEscapedComponent = true;
+      }
+
+      if (predicate.matches(escapedComponent))
+        mask |= ((uint64_t)1 << j);
+    }
+
+    map<uint64_t, int>::iterator transition =
+      dfaStates_[state].transitions_.find(mask);
+    if (transition != dfaStates_[state].transitions_.end()) {
+      state = transition->second;
+      continue;
+    }
+
+    // Follow each NFA state whose predicate matched.
+    vector<bool> visited(nfaStates_.size(), false);
+    vector<int> closure;
+    const vector<int>& nfaStates = dfaStates_[state].nfaStates_;
+    for (size_t j = 0; j < nfaStates.size(); ++j) {
+      const NfaState& nfaState = nfaStates_[nfaStates[j]];
+      if (nfaState.predicate_ < 0)
+        continue;
+
+      size_t bit = lower_bound
+        (predicates.begin(), predicates.end(), nfaState.predicate_) -
+        predicates.begin();
+      if (mask & ((uint64_t)1 << bit))
+        addClosure(nfaState.next_, visited, closure);
+    }
+    sort(closure.begin(), closure.end());
+
+    // getDfaState can reallocate dfaStates_, so get the index first.
+    int nextState = getDfaState(closure);
+    dfaStates_[state].transitions_[mask] = nextState;
+    state = nextState;
+  }
+
+  return dfaStates_[state].isAccepting_;
+}
+
+}
+
+#endif // NDN_CPP_HAVE_REGEX_LIB
@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_NDN_REGEX_AUTOMATON_HPP
+#define NDN_NDN_REGEX_AUTOMATON_HPP
+
+#include <map>
+#include "ndn-regex-matcher-base.hpp"
+
+// Only compile if we set NDN_CPP_HAVE_REGEX_LIB in ndn-regex-matcher-base.hpp.
+#if NDN_CPP_HAVE_REGEX_LIB
+
+namespace ndn {
+
+class NdnRegexComponentSetMatcher;
+
+/**
+ * An NdnRegexAutomaton is compiled from the tree of matchers of an NDN regex.
+ * It is an NFA where each transition consumes one name component which
+ * matches a component set such as <a> or [^<b><c>]. match() steps through the
+ * name one component at a time and saves each set of NFA states that it
+ * reaches as a DFA state with its transitions, so that matching is linear in
+ * the number of name components, without backtracking. Each component set is
+ * checked at most once per name component. The automaton only answers whether
+ * the name matches. It does not find back references.
+ */
+class NdnRegexAutomaton {
+public:
+  /**
+   * Compile an automaton from the matcher of a whole expression.
+   * @param matcher The NdnRegexPatternListMatcher of the whole expression.
+   * @return The new automaton, or null if the expression is not supported or
+   * needs more than MAX_NFA_STATES.
+   */
+  static ptr_lib::shared_ptr<NdnRegexAutomaton>
+  compile(const NdnRegexMatcherBase& matcher);
+
+  /**
+   * Check if the expression matches all the components of the name.
+   * @param name The name to match.
+   * @return True if the name matches.
+   */
+  bool
+  match(const Name& name);
+
+  /**
+   * The maximum number of NFA states. A bigger expression uses the
+   * backtracking matchers.
+   */
+  static const size_t MAX_NFA_STATES = 4000;
+
+  /**
+   * The maximum number of saved DFA states. If match() needs more, the saved
+   * states are cleared.
+   */
+  static const size_t MAX_DFA_STATES = 1000;
+
+private:
+  NdnRegexAutomaton() {}
+
+  class Predicate;
+
+  /**
+   * An NfaState consumes a component if predicate_ matches and goes to next_,
+   * or (if predicate_ is SPLIT) goes to next_ and next2_ without consuming a
+   * component, or (if predicate_ is MATCH) accepts the name.
+   */
+  class NfaState {
+  public:
+    NfaState(int predicate, int next, int next2)
+    : predicate_(predicate), next_(next), next2_(next2)
+    {
+    }
+
+    int predicate_;
+    int next_;
+    int next2_;
+  };
+
+  class DfaState {
+  public:
+    // The sorted component and MATCH NFA states.
+    std::vector<int> nfaStates_;
+    // The sorted indexes of the predicates of the component states.
+    std::vector<int> predicates_;
+    bool isAccepting_;
+    // The key is the bit mask of which predicates_ matched the component.
+    std::map<uint64_t, int> transitions_;
+  };
+
+  static const int SPLIT = -1;
+  static const int MATCH = -2;
+
+  /**
+   * Add the NFA states which match the matcher and then go to next.
+   * @return The start state.
+   * @throws NdnRegexMatcherBase::Error if the matcher is not supported or
+   * there are too many states.
+   */
+  int
+  build(const NdnRegexMatcherBase& matcher, int next);
+
+  int
+  addNfaState(int predicate, int next, int next2);
+
+  int
+  getPredicate(const NdnRegexComponentSetMatcher& componentSet);
+
+  /**
+   * Get the DFA state for the epsilon closure of nfaStates, adding it if
+   * needed.
+   */
+  int
+  getDfaState(const std::vector<int>& nfaStates);
+
+  void
+  addClosure(int nfaState, std::vector<bool>& visited, std::vector<int>& result);
+
+  std::vector<NfaState> nfaStates_;
+  int nfaStart_;
+  std::vector<ptr_lib::shared_ptr<Predicate> > predicates_;
+  // The key is the expression of the component set.
+  std::map<std::string, int> predicateIndex_;
+  std::vector<DfaState> dfaStates_;
+  std::map<std::vector<int>, int> dfaIndex_;
+};
+
+}
+
+#endif // NDN_CPP_HAVE_REGEX_LIB
+
+#endif
@@ -60,6 +60,8 @@ protected:
   compile();
 
 private:
+  friend class NdnRegexAutomaton;
+
   bool isExactMatch_;
   regex_lib::regex componentRegex_;
   std::vector<ptr_lib::shared_ptr<NdnRegexPseudoMatcher> > pseudoMatchers_;
@@ -59,6 +59,8 @@ protected:
   compile();
 
 private:
+  friend class NdnRegexAutomaton;
+
   size_t
   extractComponent(size_t index);
 
@@ -126,6 +126,8 @@ protected:
   compile() = 0;
 
 private:
+  friend class NdnRegexAutomaton;
+
   bool
   recursiveMatch(size_t matcherNo, const Name& name, size_t offset, size_t len);
 
@@ -53,6 +53,8 @@ protected:
   compile();
 
 private:
+  friend class NdnRegexAutomaton;
+
   bool
   parseRepetition();
 
@@ -27,15 +27,17 @@
 #include <stdlib.h>
 #include "ndn-regex-backref-manager.hpp"
 #include "ndn-regex-pattern-list-matcher.hpp"
+#include "ndn-regex-automaton.hpp"
 #include "ndn-regex-top-matcher.hpp"
 
 using namespace std;
 
 namespace ndn {
 
-NdnRegexTopMatcher::NdnRegexTopMatcher(const string& expr, const string& expand)
+NdnRegexTopMatcher::NdnRegexTopMatcher
+  (const string& expr, const string& expand, bool useAutomaton)
 : NdnRegexMatcherBase(expr, NDN_REGEX_EXPR_TOP), expand_(expand),
-  isSecondaryUsed_(false)
+  isSecondaryUsed_(false), useAutomaton_(useAutomaton)
 {
   primaryBackrefManager_ = ptr_lib::make_shared<NdnRegexBackrefManager>();
   secondaryBackrefManager_ = ptr_lib::make_shared<NdnRegexBackrefManager>();
@@ -66,6 +68,12 @@ NdnRegexTopMatcher::compile()
 
   primaryMatcher_ = ptr_lib::make_shared<NdnRegexPatternListMatcher>
     (expr, primaryBackrefManager_);
+
+  if (useAutomaton_)
+    // The secondary matcher matches every name that the primary matches, so
+    // the automaton only needs to check it. This is null if not supported.
+    automaton_ = NdnRegexAutomaton::compile
+      (secondaryMatcher_ ? *secondaryMatcher_ : *primaryMatcher_);
 }
 
 bool
@@ -75,6 +83,21 @@ NdnRegexTopMatcher::match(const Name& name)
 
   matchResult_.clear();
 
+  if (automaton_) {
+    if (!automaton_->match(name))
+      return false;
+
+    if (primaryBackrefManager_->size() == 0 &&
+        secondaryBackrefManager_->size() == 0) {
+      // There are no back references to find, so the match result is the
+      // whole name.
+      for (size_t i = 0; i < name.size(); ++i)
+        matchResult_.push_back(name.get(i));
+      return true;
+    }
+    // Otherwise, use the backtracking matchers to find the back references.
+  }
+
   if (primaryMatcher_->match(name, 0, name.size())) {
     matchResult_ = primaryMatcher_->getMatchResult();
     return true;
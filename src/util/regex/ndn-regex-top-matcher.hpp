@@ -32,10 +32,23 @@ namespace ndn {
 
 class NdnRegexPatternListMatcher;
 class NdnRegexBackrefManager;
+class NdnRegexAutomaton;
 
 class NdnRegexTopMatcher: public NdnRegexMatcherBase {
 public:
-  NdnRegexTopMatcher(const std::string& expr, const std::string& expand = "");
+  /**
+   * Create an NdnRegexTopMatcher for the expression.
+   * @param expr The NDN regex expression.
+   * @param expand (optional) The default expand string for expand().
+   * @param useAutomaton (optional) If true (the default) and the expression
+   * can be compiled to an NdnRegexAutomaton, use it to decide if a name
+   * matches in linear time, and only use the backtracking matchers to find the
+   * back references of a matching name. If false, always use the backtracking
+   * matchers.
+   */
+  NdnRegexTopMatcher
+    (const std::string& expr, const std::string& expand = "",
+     bool useAutomaton = true);
 
   virtual
   ~NdnRegexTopMatcher();
@@ -70,6 +83,8 @@ private:
   ptr_lib::shared_ptr<NdnRegexBackrefManager> primaryBackrefManager_;
   ptr_lib::shared_ptr<NdnRegexBackrefManager> secondaryBackrefManager_;
   bool isSecondaryUsed_;
+  bool useAutomaton_;
+  ptr_lib::shared_ptr<NdnRegexAutomaton> automaton_;
 };
 
 }
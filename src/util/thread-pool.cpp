@@ -0,0 +1,235 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include "../c/util/crypto.h"
+#include "thread-pool.hpp"
+#if __cplusplus >= 201103L
+#include <atomic>
+#include <future>
+#endif
+
+using namespace std;
+
+namespace ndn {
+
+#if __cplusplus >= 201103L
+
+// The number of mutexes for the OpenSSL 1.0 locking callback. OpenSSL 1.0
+// needs CRYPTO_NUM_LOCKS which is 41.
+static const size_t N_CRYPTO_LOCKS = 128;
+static mutex cryptoLocks[N_CRYPTO_LOCKS];
+
+static void
+lockCrypto(int isLock, int lockIndex)
+{
+  if (isLock)
+    cryptoLocks[lockIndex].lock();
+  else
+    cryptoLocks[lockIndex].unlock();
+}
+
+static bool isCryptoThreadSafeResult = false;
+static once_flag isCryptoThreadSafeFlag;
+
+static void
+initCryptoThreadSafe()
+{
+  isCryptoThreadSafeResult =
+    (ndn_makeCryptoThreadSafe(&lockCrypto, N_CRYPTO_LOCKS) != 0);
+}
+
+bool
+ThreadPool::isCryptoThreadSafe()
+{
+  call_once(isCryptoThreadSafeFlag, &initCryptoThreadSafe);
+  return isCryptoThreadSafeResult;
+}
+
+ThreadPool::ThreadPool(size_t nThreads)
+: isStopping_(false)
+{
+  if (!isCryptoThreadSafe())
+    // The tasks call the crypto library, so run them in the calling thread.
+    return;
+
+  if (nThreads == 0) {
+    nThreads = thread::hardware_concurrency();
+    if (nThreads == 0)
+      nThreads = 1;
+  }
+
+  for (size_t i = 0; i < nThreads; ++i)
+    threads_.push_back(thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  taskAvailable_.notify_all();
+
+  for (size_t i = 0; i < threads_.size(); ++i)
+    threads_[i].join();
+}
+
+size_t
+ThreadPool::getThreadCount() const
+{
+  return threads_.empty() ? 1 : threads_.size();
+}
+
+void
+ThreadPool::submit(const Task& task)
+{
+  if (threads_.empty()) {
+    task();
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    tasks_.push_back(task);
+  }
+  taskAvailable_.notify_one();
+}
+
+/**
+ * Run the task, then decrement the shared count of remaining tasks and call
+ * onAllDone if this was the last one.
+ */
+static void
+runAndCountDown
+  (const ThreadPool::Task& task,
+   const ptr_lib::shared_ptr<atomic<size_t> >& nRemaining,
+   const ThreadPool::Task& onAllDone)
+{
+  task();
+  if (--(*nRemaining) == 0)
+    onAllDone();
+}
+
+void
+ThreadPool::submitAll(const vector<Task>& tasks, const Task& onAllDone)
+{
+  if (tasks.size() == 0) {
+    onAllDone();
+    return;
+  }
+  if (threads_.empty()) {
+    for (size_t i = 0; i < tasks.size(); ++i)
+      tasks[i]();
+    onAllDone();
+    return;
+  }
+
+  ptr_lib::shared_ptr<atomic<size_t> > nRemaining
+    (new atomic<size_t>(tasks.size()));
+  {
+    lock_guard<mutex> lock(mutex_);
+    for (size_t i = 0; i < tasks.size(); ++i)
+      tasks_.push_back(func_lib::bind
+        (&runAndCountDown, tasks[i], nRemaining, onAllDone));
+  }
+  taskAvailable_.notify_all();
+}
+
+/**
+ * Set the promise value. This is the onAllDone for runAll.
+ */
+static void
+setPromise(const ptr_lib::shared_ptr<promise<void> >& allDone)
+{
+  allDone->set_value();
+}
+
+void
+ThreadPool::runAll(const vector<Task>& tasks)
+{
+  if (threads_.empty()) {
+    for (size_t i = 0; i < tasks.size(); ++i)
+      tasks[i]();
+    return;
+  }
+
+  ptr_lib::shared_ptr<promise<void> > allDone(new promise<void>());
+  future<void> allDoneFuture = allDone->get_future();
+  submitAll(tasks, func_lib::bind(&setPromise, allDone));
+  allDoneFuture.wait();
+}
+
+void
+ThreadPool::workerLoop()
+{
+  while (true) {
+    Task task;
+    {
+      unique_lock<mutex> lock(mutex_);
+      while (!isStopping_ && tasks_.empty())
+        taskAvailable_.wait(lock);
+      if (tasks_.empty())
+        // isStopping_ is true and all the tasks are done.
+        return;
+
+      task = tasks_.front();
+      tasks_.pop_front();
+    }
+
+    task();
+  }
+}
+
+#else
+
+// Without C++11 threads, run each task in the calling thread.
+
+bool
+ThreadPool::isCryptoThreadSafe() { return false; }
+
+ThreadPool::ThreadPool(size_t nThreads) {}
+
+ThreadPool::~ThreadPool() {}
+
+size_t
+ThreadPool::getThreadCount() const { return 1; }
+
+void
+ThreadPool::submit(const Task& task) { task(); }
+
+void
+ThreadPool::submitAll(const vector<Task>& tasks, const Task& onAllDone)
+{
+  for (size_t i = 0; i < tasks.size(); ++i)
+    tasks[i]();
+  onAllDone();
+}
+
+void
+ThreadPool::runAll(const vector<Task>& tasks)
+{
+  for (size_t i = 0; i < tasks.size(); ++i)
+    tasks[i]();
+}
+
+#endif
+
+}
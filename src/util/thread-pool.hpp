@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil -*- */
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#ifndef NDN_THREAD_POOL_HPP
+#define NDN_THREAD_POOL_HPP
+
+#include <vector>
+#include <ndn-cpp/common.hpp>
+#if __cplusplus >= 201103L
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#endif
+
+namespace ndn {
+
+/**
+ * A ThreadPool runs tasks on a fixed number of worker threads. The worker
+ * threads are started in the constructor and joined in the destructor, after
+ * they finish the queued tasks. The tasks may call the crypto library, so the
+ * first ThreadPool installs the OpenSSL 1.0 locking callbacks if needed. If the
+ * compiler does not support C++11 threads, or the crypto library can't be made
+ * thread safe, there are no worker threads and each task runs in the calling
+ * thread.
+ */
+class ThreadPool {
+public:
+  typedef func_lib::function<void()> Task;
+
+  /**
+   * Create a ThreadPool and start the worker threads, unless
+   * isCryptoThreadSafe() is false.
+   * @param nThreads The number of worker threads. If 0, use the number of
+   * hardware threads.
+   */
+  ThreadPool(size_t nThreads);
+
+  /**
+   * Finish the queued tasks and join the worker threads. This must not be
+   * called from a task.
+   */
+  ~ThreadPool();
+
+  /**
+   * Get the number of worker threads.
+   * @return The number of worker threads, or 1 if tasks run in the calling
+   * thread.
+   */
+  size_t
+  getThreadCount() const;
+
+  /**
+   * Queue the task to run on a worker thread.
+   * @param task The task to run. It should not throw an exception.
+   */
+  void
+  submit(const Task& task);
+
+  /**
+   * Queue the tasks to run on the worker threads and return immediately. After
+   * all the tasks finish, call onAllDone on the worker thread which finished
+   * last.
+   * @param tasks The tasks to run. They should not throw an exception.
+   * @param onAllDone This calls onAllDone() when all the tasks are done.
+   */
+  void
+  submitAll(const std::vector<Task>& tasks, const Task& onAllDone);
+
+  /**
+   * Run the tasks on the worker threads and wait until all are done.
+   * @param tasks The tasks to run. They should not throw an exception.
+   */
+  void
+  runAll(const std::vector<Task>& tasks);
+
+  /**
+   * Check if the crypto library can be called from multiple threads. The first
+   * call installs the OpenSSL 1.0 locking callbacks if the application has not
+   * already set them.
+   * @return True if the crypto library is thread safe, false if not or if the
+   * compiler does not support C++11 threads.
+   */
+  static bool
+  isCryptoThreadSafe();
+
+private:
+  // Don't allow copying.
+  ThreadPool(const ThreadPool& other);
+  ThreadPool& operator=(const ThreadPool& other);
+
+#if __cplusplus >= 201103L
+  void
+  workerLoop();
+
+  std::vector<std::thread> threads_;
+  std::deque<Task> tasks_;
+  std::mutex mutex_;
+  std::condition_variable taskAvailable_;
+  bool isStopping_;
+#endif
+};
+
+}
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "gtest/gtest.h"
 #include <ndn-cpp/encrypt/algo/aes-algorithm.hpp>
+#include <ndn-cpp/lite/encrypt/algo/aes-cbc-encryptor-lite.hpp>
 
 using namespace std;
 using namespace ndn;
@@ -104,6 +105,47 @@ TEST_F(TestAesAlgorithm, EncryptionDecryption)
   ASSERT_TRUE(receivedBlob.equals(plainBlob));
 }
 
+TEST_F(TestAesAlgorithm, CbcEncryptor)
+{
+  Blob key(KEY, sizeof(KEY));
+  Blob plainBlob(PLAINTEXT, sizeof(PLAINTEXT));
+  Blob initialVector(INITIAL_VECTOR, sizeof(INITIAL_VECTOR));
+  uint8_t encrypted[sizeof(PLAINTEXT) + AesAlgorithm::BLOCK_SIZE];
+  size_t encryptedLength;
+
+  AesCbcEncryptorLite encryptor;
+  // Encrypting without a key is an error.
+  ASSERT_EQ(NDN_ERROR_Error_in_encrypt_operation, encryptor.encrypt
+    (initialVector, plainBlob, encrypted, encryptedLength));
+  ASSERT_EQ(NDN_ERROR_Incorrect_key_size, encryptor.setKey(KEY, 8));
+  ASSERT_EQ(NDN_ERROR_success, encryptor.setKey(key));
+  ASSERT_EQ(NDN_ERROR_Incorrect_initial_vector_size, encryptor.encrypt
+    (INITIAL_VECTOR, 8, PLAINTEXT, sizeof(PLAINTEXT), encrypted,
+     encryptedLength));
+
+  // Encrypt twice with the same key schedule.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(NDN_ERROR_success, encryptor.encrypt
+      (initialVector, plainBlob, encrypted, encryptedLength));
+    ASSERT_TRUE(Blob(encrypted, encryptedLength).equals
+      (Blob(CIPHERTEXT_CBC_IV, sizeof(CIPHERTEXT_CBC_IV))));
+  }
+
+  // Check a different IV and a plaintext which is not a multiple of the block
+  // size against AesAlgorithm::encrypt.
+  uint8_t initialVector2[AesAlgorithm::BLOCK_SIZE];
+  for (size_t i = 0; i < sizeof(initialVector2); ++i)
+    initialVector2[i] = i;
+  EncryptParams encryptParams(ndn_EncryptAlgorithmType_AesCbc);
+  encryptParams.setInitialVector
+    (Blob(initialVector2, sizeof(initialVector2)));
+  ASSERT_EQ(NDN_ERROR_success, encryptor.encrypt
+    (initialVector2, sizeof(initialVector2), PLAINTEXT, 11, encrypted,
+     encryptedLength));
+  ASSERT_TRUE(Blob(encrypted, encryptedLength).equals(AesAlgorithm::encrypt
+    (key, Blob(PLAINTEXT, 11), encryptParams)));
+}
+
 TEST_F(TestAesAlgorithm, KeyGeneration)
 {
   AesKeyParams keyParams(128);
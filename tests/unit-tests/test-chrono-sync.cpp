@@ -0,0 +1,401 @@
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <ndn-cpp/lite/util/crypto-lite.hpp>
+#include <ndn-cpp/security/identity/memory-identity-storage.hpp>
+#include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
+#include <ndn-cpp/security/policy/no-verify-policy-manager.hpp>
+#include <ndn-cpp/sync/chrono-sync2013.hpp>
+#include "../../src/sync/digest-tree.hpp"
+#include "../../src/sync/digest-log.hpp"
+#include "../../src/sync/compact-sync-state.hpp"
+#if NDN_CPP_HAVE_PROTOBUF
+#include "../../src/sync/sync-state.pb.h"
+#endif
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace ndn;
+
+/**
+ * Get the hex SHA-256 of the concatenated node digests in sorted order, the
+ * same as the root without the saved contexts.
+ */
+static string
+getFullRoot(const DigestTree& tree)
+{
+  vector<const DigestTree::Node*> nodes;
+  for (size_t i = 0; i < tree.size(); ++i)
+    nodes.push_back(&tree.get(i));
+  sort(nodes.begin(), nodes.end(), DigestTree::Node::Compare());
+
+  vector<uint8_t> digests;
+  for (size_t i = 0; i < nodes.size(); ++i)
+    digests.insert
+      (digests.end(), nodes[i]->getDigest(),
+       nodes[i]->getDigest() + ndn_SHA256_DIGEST_SIZE);
+
+  uint8_t root[ndn_SHA256_DIGEST_SIZE];
+  CryptoLite::digestSha256(&digests[0], digests.size(), root);
+  return toHex(root, sizeof(root));
+}
+
+class TestDigestTree : public ::testing::Test {
+};
+
+TEST_F(TestDigestTree, Root)
+{
+  DigestTree tree;
+  ASSERT_EQ("00", tree.getRoot());
+
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/alice", 1, 5));
+  ASSERT_EQ("aa2247e0f510ba4941a5ee16e90543049630f98db3b65f90f7ba0882ce313c8f",
+            tree.getRoot());
+
+  // Insert out of order. The root is the same as other implementations.
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/carol", 7, 0));
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/bob", 2, 3));
+  ASSERT_EQ("83d09a6a3f6d3e431e0c14f660727688c6a95b9fdb6f65e39d1afda28cd3f828",
+            tree.getRoot());
+
+  // An older sequence number doesn't change the tree.
+  ASSERT_FALSE(tree.update("/ndn/ucla.edu/bob", 2, 1));
+  ASSERT_EQ(2, tree.find("/ndn/ucla.edu/bob", 2));
+  ASSERT_EQ(-1, tree.find("/ndn/ucla.edu/bob", 3));
+}
+
+TEST_F(TestDigestTree, FindAndGet)
+{
+  DigestTree tree;
+  ASSERT_EQ(-1, tree.find("/ndn/ucla.edu/alice", 1));
+
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/carol", 7, 0));
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/alice", 2, 4));
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/alice", 1, 5));
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/bob", 2, 3));
+  ASSERT_EQ(4, tree.size());
+
+  // The index of a node doesn't change when a node sorts before it.
+  ASSERT_EQ(0, tree.find("/ndn/ucla.edu/carol", 7));
+  ASSERT_EQ(1, tree.find("/ndn/ucla.edu/alice", 2));
+  ASSERT_EQ(2, tree.find("/ndn/ucla.edu/alice", 1));
+  ASSERT_EQ(3, tree.find("/ndn/ucla.edu/bob", 2));
+  ASSERT_EQ(-1, tree.find("/ndn/ucla.edu/alice", 3));
+  ASSERT_EQ(-1, tree.find("/ndn/ucla.edu/dave", 2));
+
+  ASSERT_TRUE(tree.update("/ndn/ucla.edu/alice", 1, 6));
+  ASSERT_EQ(2, tree.find("/ndn/ucla.edu/alice", 1));
+  const DigestTree::Node& node = tree.get(2);
+  ASSERT_EQ("/ndn/ucla.edu/alice", node.getDataPrefix());
+  ASSERT_EQ(1, node.getSessionNo());
+  ASSERT_EQ(6, node.getSequenceNo());
+  ASSERT_EQ(getFullRoot(tree), tree.getRoot());
+}
+
+TEST_F(TestDigestTree, IncrementalRoot)
+{
+  DigestTree tree;
+  srand(1);
+
+  for (int i = 0; i < 2000; ++i) {
+    ostringstream prefix;
+    prefix << "/ndn/participant" << (rand() % 300);
+    tree.update(prefix.str(), rand() % 2, i);
+
+    // Sometimes do a batch of updates before getting the root.
+    if (rand() % 4 != 0)
+      ASSERT_EQ(getFullRoot(tree), tree.getRoot()) <<
+        "The incremental root is wrong after update " << i;
+  }
+}
+
+class TestDigestLog : public ::testing::Test {
+};
+
+TEST_F(TestDigestLog, ChangesSince)
+{
+  DigestLog log;
+  ASSERT_EQ(0, log.add("00"));
+  ASSERT_EQ(1, log.add("d1"));
+  log.updateProducer("/ndn/ucla.edu/alice", 1, 1);
+  log.updateProducer("/ndn/ucla.edu/bob", 2, 1);
+  ASSERT_EQ(2, log.add("d2"));
+  log.updateProducer("/ndn/ucla.edu/alice", 1, 2);
+
+  ASSERT_EQ(0, log.find("00"));
+  ASSERT_EQ(1, log.find("d1"));
+  ASSERT_EQ(2, log.find("d2"));
+  ASSERT_EQ(-1, log.find("d3"));
+
+  vector<DigestLog::ProducerState> changes;
+  log.getChangesSince(0, changes);
+  ASSERT_EQ(2, changes.size());
+  ASSERT_EQ("/ndn/ucla.edu/bob", changes[0].getDataPrefix());
+  ASSERT_EQ(2, changes[0].getSessionNo());
+  ASSERT_EQ(1, changes[0].getSequenceNo());
+  ASSERT_EQ("/ndn/ucla.edu/alice", changes[1].getDataPrefix());
+  ASSERT_EQ(2, changes[1].getSequenceNo());
+
+  log.getChangesSince(1, changes);
+  ASSERT_EQ(1, changes.size());
+  ASSERT_EQ("/ndn/ucla.edu/alice", changes[0].getDataPrefix());
+
+  log.getChangesSince(2, changes);
+  ASSERT_EQ(0, changes.size());
+}
+
+TEST_F(TestDigestLog, LongSession)
+{
+  const size_t maxEntries = 100;
+  const int nProducers = 30;
+  const int nEntries = 200000;
+  DigestLog log(maxEntries);
+
+  for (int i = 0; i < nEntries; ++i) {
+    ostringstream digest;
+    digest << "digest" << i;
+    ASSERT_EQ(i, log.add(digest.str()));
+
+    ostringstream prefix;
+    prefix << "/ndn/participant" << (i % nProducers);
+    log.updateProducer(prefix.str(), 1, i);
+  }
+
+  // The log is bounded and only finds the recent digests.
+  ASSERT_EQ(maxEntries, log.size());
+  ASSERT_EQ(-1, log.find("digest0"));
+  ostringstream oldest;
+  oldest << "digest" << (nEntries - maxEntries);
+  ASSERT_EQ(nEntries - (int)maxEntries, log.find(oldest.str()));
+  ostringstream removed;
+  removed << "digest" << (nEntries - maxEntries - 1);
+  ASSERT_EQ(-1, log.find(removed.str()));
+
+  // Only the producers updated after the entry are in the changes, with their
+  // latest sequence number.
+  vector<DigestLog::ProducerState> changes;
+  log.getChangesSince(nEntries - 4, changes);
+  ASSERT_EQ(3, changes.size());
+  for (int i = 0; i < 3; ++i) {
+    int sequenceNo = nEntries - 3 + i;
+    ostringstream prefix;
+    prefix << "/ndn/participant" << (sequenceNo % nProducers);
+    ASSERT_EQ(prefix.str(), changes[i].getDataPrefix());
+    ASSERT_EQ(sequenceNo, changes[i].getSequenceNo());
+  }
+
+  log.getChangesSince(nEntries - maxEntries, changes);
+  ASSERT_EQ(nProducers, changes.size());
+}
+
+#if NDN_CPP_HAVE_PROTOBUF
+
+class TestCompactSyncState : public ::testing::Test {
+};
+
+static void
+addSyncState
+  (Sync::SyncStateMsg& message, const string& name, int sessionNo,
+   int sequenceNo, const string& applicationInfo = "")
+{
+  Sync::SyncState* state = message.add_ss();
+  state->set_name(name);
+  state->set_type(Sync::SyncState_ActionType_UPDATE);
+  state->mutable_seqno()->set_session(sessionNo);
+  state->mutable_seqno()->set_seq(sequenceNo);
+  if (applicationInfo.size() > 0)
+    state->set_application_info(applicationInfo);
+}
+
+TEST_F(TestCompactSyncState, EncodeDecode)
+{
+  Sync::SyncStateMsg message;
+  addSyncState(message, "/ndn/ucla.edu/alice", 1490000000, 1000, "info");
+  addSyncState(message, "/ndn/ucla.edu/bob", 1490000005, 998);
+  addSyncState(message, "/ndn/ucla.edu/alice", 1490000100, 0);
+  message.mutable_ss(2)->set_type(Sync::SyncState_ActionType_DELETE);
+
+  Blob encoding = CompactSyncState::encode(message);
+  ASSERT_TRUE(CompactSyncState::isCompact(encoding.buf(), encoding.size()));
+  ASSERT_LT(encoding.size(), message.SerializeAsString().size());
+
+  Sync::SyncStateMsg decoded;
+  CompactSyncState::decode(encoding.buf(), encoding.size(), decoded);
+  ASSERT_EQ(message.SerializeAsString(), decoded.SerializeAsString());
+
+  // A Protobuf encoding is not the compact format.
+  string protobufEncoding = message.SerializeAsString();
+  ASSERT_FALSE(CompactSyncState::isCompact
+    ((const uint8_t*)protobufEncoding.data(), protobufEncoding.size()));
+}
+
+TEST_F(TestCompactSyncState, DecodeTruncated)
+{
+  Sync::SyncStateMsg message;
+  addSyncState(message, "/ndn/ucla.edu/alice", 1, 2, "info");
+  Blob encoding = CompactSyncState::encode(message);
+
+  for (size_t length = 1; length < encoding.size(); ++length) {
+    Sync::SyncStateMsg decoded;
+    ASSERT_THROW
+      (CompactSyncState::decode(encoding.buf(), length, decoded),
+       runtime_error) << "Decoding " << length << " bytes should fail";
+  }
+}
+
+TEST_F(TestCompactSyncState, DecodeWrappingDeltas)
+{
+  // The deltas make the sums wrap past the largest uint64_t.
+  const uint8_t encoding[] = {
+    0,                  // The compact format marker.
+    1, 1, 'a',          // One name "a".
+    2,                  // Two states.
+    0, 0,               // Name index 0, UPDATE.
+    1,                  // Session delta -1.
+    0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01,
+                        // Sequence delta 0x7fffffffffffffff.
+    0,                  // No application info.
+    0, 0,               // Name index 0, UPDATE.
+    2,                  // Session delta 1.
+    0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01,
+                        // Sequence delta 0x7fffffffffffffff.
+    0                   // No application info.
+  };
+
+  Sync::SyncStateMsg decoded;
+  CompactSyncState::decode(encoding, sizeof(encoding), decoded);
+  ASSERT_EQ(2, decoded.ss_size());
+  ASSERT_EQ(0xffffffffffffffffULL, decoded.ss(0).seqno().session());
+  ASSERT_EQ(0x7fffffffffffffffULL, decoded.ss(0).seqno().seq());
+  ASSERT_EQ(0ULL, decoded.ss(1).seqno().session());
+  ASSERT_EQ(0xfffffffffffffffeULL, decoded.ss(1).seqno().seq());
+
+  // Encoding the values gets the same deltas.
+  Blob reencoding = CompactSyncState::encode(decoded);
+  ASSERT_TRUE(reencoding.equals(Blob(encoding, sizeof(encoding))));
+}
+
+class TestChronoSync2013 : public ::testing::Test {
+};
+
+/**
+ * A TestFace saves the callbacks of each expressInterest so that the test can
+ * answer or time out later, and ignores registerPrefix.
+ */
+class TestFace : public Face {
+public:
+  TestFace()
+  : Face("localhost")
+  {}
+
+  virtual uint64_t
+  expressInterest
+    (const Interest& interest, const OnData& onData,
+     const OnTimeout& onTimeout, const OnNetworkNack& onNetworkNack,
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+  {
+    interests_.push_back(ptr_lib::make_shared<Interest>(interest));
+    onData_.push_back(onData);
+    onTimeout_.push_back(onTimeout);
+    return 0;
+  }
+
+  virtual uint64_t
+  registerPrefix
+    (const Name& prefix, const OnInterestCallback& onInterest,
+     const OnRegisterFailed& onRegisterFailed,
+     const OnRegisterSuccess& onRegisterSuccess,
+     const ForwardingFlags& flags = ForwardingFlags(),
+     WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+  {
+    return 0;
+  }
+
+  vector<ptr_lib::shared_ptr<Interest> > interests_;
+  vector<OnData> onData_;
+  vector<OnTimeout> onTimeout_;
+};
+
+static void
+onReceivedSyncState
+  (const vector<ChronoSync2013::SyncState>& syncStates, bool isRecovery) {}
+
+static void
+onInitialized() {}
+
+static void
+onRegisterFailed(const ptr_lib::shared_ptr<const Name>& prefix) {}
+
+TEST_F(TestChronoSync2013, DuplicateSyncInterest)
+{
+  TestFace face;
+  KeyChain keyChain
+    (ptr_lib::make_shared<IdentityManager>
+       (ptr_lib::make_shared<MemoryIdentityStorage>(),
+        ptr_lib::make_shared<MemoryPrivateKeyStorage>()),
+     ptr_lib::make_shared<NoVerifyPolicyManager>());
+  Name broadcastPrefix("/ndn/broadcast/test-chrono-sync");
+  Name dataPrefix("/test/alice");
+  int sessionNo = 1;
+  ChronoSync2013 sync
+    (&onReceivedSyncState, &onInitialized, dataPrefix, broadcastPrefix,
+     sessionNo, face, keyChain, Name("/test/alice/KEY/ksk-1/ID-CERT"), 5000,
+     &onRegisterFailed);
+
+  // There are no other users, so the initial Interest times out and this
+  // expresses a sync Interest for the new root.
+  ASSERT_EQ(1, face.interests_.size());
+  face.onTimeout_[0](face.interests_[0]);
+  ASSERT_EQ(2, face.interests_.size());
+  Name syncInterestName = face.interests_[1]->getName();
+  ASSERT_EQ(broadcastPrefix.size() + 1, syncInterestName.size());
+
+  // A late answer to the initial Interest has no new state, so the root is the
+  // same and the sync Interest for it is still pending. It is not sent again.
+  Sync::SyncStateMsg message;
+  addSyncState(message, dataPrefix.toUri(), sessionNo, 0);
+  string encoding = message.SerializeAsString();
+  ptr_lib::shared_ptr<Data> data(new Data(face.interests_[0]->getName()));
+  data->setContent(Blob((const uint8_t*)encoding.data(), encoding.size()));
+  face.onData_[0](face.interests_[0], data);
+  ASSERT_EQ(2, face.interests_.size()) <<
+    "A duplicate sync Interest was expressed while one is pending";
+
+  // After the pending sync Interest times out, it is expressed again.
+  face.onTimeout_[1](face.interests_[1]);
+  ASSERT_EQ(3, face.interests_.size()) <<
+    "The sync Interest was not expressed again after the timeout";
+  ASSERT_TRUE(face.interests_[2]->getName().equals(syncInterestName));
+
+  sync.shutdown();
+}
+
+#endif // NDN_CPP_HAVE_PROTOBUF
+
+int
+main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -281,6 +281,13 @@ public:
     ASSERT_TRUE(result.equals(expectedResult));
   }
 
+  void
+  onCountedPlainText(const Blob& result, int* count)
+  {
+    ++(*count);
+    ASSERT_TRUE(result.equals(Blob(DATA_CONTENT, sizeof(DATA_CONTENT))));
+  }
+
   void
   onError(EncryptError::ErrorCode errorCode, const string& message)
   {
@@ -422,6 +429,119 @@ TEST_F(TestConsumer, Consume)
   ASSERT_EQ(1, finalCount);
 }
 
+TEST_F(TestConsumer, KeyCache)
+{
+  ptr_lib::shared_ptr<Data> cKeyData = createEncryptedCKey();
+  ptr_lib::shared_ptr<Data> dKeyData = createEncryptedDKey();
+
+  // Make content packets which use the same C-KEY.
+  vector<ptr_lib::shared_ptr<Data> > contentDataList;
+  for (int i = 0; i < 3; ++i) {
+    ptr_lib::shared_ptr<Data> contentData(new Data
+      (Name(contentName).appendSegment(i)));
+    EncryptParams encryptParams(ndn_EncryptAlgorithmType_AesCbc);
+    encryptParams.setInitialVector(Blob(INITIAL_VECTOR, sizeof(INITIAL_VECTOR)));
+    Encryptor::encryptData
+      (*contentData, Blob(DATA_CONTENT, sizeof(DATA_CONTENT)), cKeyName,
+       fixtureCKeyBlob, encryptParams);
+    keyChain->sign(*contentData, certificateName);
+    contentDataList.push_back(contentData);
+  }
+
+  // Prepare a TestFace which answers interests when processInterests is
+  // called, so that the consumer can have concurrent requests.
+  class TestFace : public Face {
+  public:
+    TestFace(const vector<ptr_lib::shared_ptr<Data> >& dataList)
+    : Face("localhost"),
+      dataList_(dataList),
+      cKeyCount_(0),
+      dKeyCount_(0)
+    {}
+
+    virtual uint64_t
+    expressInterest
+      (const Interest& interest, const OnData& onData,
+       const OnTimeout& onTimeout, const OnNetworkNack& onNetworkNack,
+       WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+    {
+      pendingInterests_.push_back(make_pair
+        (ptr_lib::make_shared<Interest>(interest), onData));
+      return 0;
+    }
+
+    void
+    processInterests()
+    {
+      while (pendingInterests_.size() > 0) {
+        ptr_lib::shared_ptr<Interest> interest = pendingInterests_[0].first;
+        OnData onData = pendingInterests_[0].second;
+        pendingInterests_.erase(pendingInterests_.begin());
+
+        for (size_t i = 0; i < dataList_.size(); ++i) {
+          if (interest->matchesName(dataList_[i]->getName())) {
+            if (i == 0)
+              ++cKeyCount_;
+            else if (i == 1)
+              ++dKeyCount_;
+            onData(interest, dataList_[i]);
+            break;
+          }
+        }
+      }
+    }
+
+    // The first two are the C-KEY and the D-KEY.
+    vector<ptr_lib::shared_ptr<Data> > dataList_;
+    vector<pair<ptr_lib::shared_ptr<Interest>, OnData> > pendingInterests_;
+    int cKeyCount_;
+    int dKeyCount_;
+  };
+
+  vector<ptr_lib::shared_ptr<Data> > dataList;
+  dataList.push_back(cKeyData);
+  dataList.push_back(dKeyData);
+  dataList.insert(dataList.end(), contentDataList.begin(), contentDataList.end());
+  TestFace face(dataList);
+
+  Consumer consumer
+    (&face, keyChain.get(), groupName, uName,
+     ptr_lib::make_shared<Sqlite3ConsumerDb>(databaseFilePath));
+  consumer.addDecryptionKey(uKeyName, fixtureUDKeyBlob);
+
+  // The requests are concurrent, so they wait for one C-KEY fetch.
+  int plainTextCount = 0;
+  for (size_t i = 0; i < contentDataList.size(); ++i)
+    consumer.decryptContent
+      (*contentDataList[i],
+       bind(&TestConsumer::onCountedPlainText, this, _1, &plainTextCount),
+       bind(&TestConsumer::onError, this, _1, _2));
+  face.processInterests();
+  ASSERT_EQ(3, plainTextCount);
+  ASSERT_EQ(1, face.cKeyCount_);
+  ASSERT_EQ(1, face.dKeyCount_);
+
+  // Later requests for the same time slot use the cached C-KEY.
+  for (size_t i = 0; i < contentDataList.size(); ++i)
+    consumer.decryptContent
+      (*contentDataList[i],
+       bind(&TestConsumer::onCountedPlainText, this, _1, &plainTextCount),
+       bind(&TestConsumer::onError, this, _1, _2));
+  ASSERT_EQ(6, plainTextCount);
+  ASSERT_EQ(0, face.pendingInterests_.size());
+
+  // Without the key cache, a request fetches the C-KEY and D-KEY again.
+  consumer.setMaxCachedKeys(0);
+  consumer.decryptContent
+    (*contentDataList[0],
+     bind(&TestConsumer::onCountedPlainText, this, _1, &plainTextCount),
+     bind(&TestConsumer::onError, this, _1, _2));
+  face.processInterests();
+  ASSERT_EQ(7, plainTextCount);
+  ASSERT_EQ(2, face.cKeyCount_);
+  ASSERT_EQ(2, face.dKeyCount_);
+}
+
 TEST_F(TestConsumer, ConsumerWithLink)
 {
   ptr_lib::shared_ptr<Data> contentData = createEncryptedContent();
@@ -21,6 +21,10 @@
 
 #include "gtest/gtest.h"
 #include "ndn-cpp/lite/util/crypto-lite.hpp"
+#include "../../src/util/buffer-pool.hpp"
+#include <unistd.h>
+#include <atomic>
+#include <thread>
 #include <sstream>
 #include <ndn-cpp/data.hpp>
 #include <ndn-cpp/security/identity/memory-identity-storage.hpp>
@@ -365,6 +369,12 @@ public:
   const Name&
   getEcdsaCertName() { return ecdsaCertName_; }
 
+  const Name&
+  getDefaultCertName() { return defaultCertName_; }
+
+  KeyChain&
+  getKeyChain() { return keyChain_; }
+
 private:
   ptr_lib::shared_ptr<MemoryIdentityStorage> identityStorage_;
   ptr_lib::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage_;
@@ -445,6 +455,277 @@ TEST_F(TestDataMethods, EncodeDecode)
   ASSERT_EQ(dumpData(reDecodedData), initialDump) << "Re-decoded data does not match original dump";
 }
 
+TEST_F(TestDataMethods, EncodeDecodeLongName)
+{
+  // Make names longer than any fixed-size component array in the encoder.
+  Name name;
+  Name keyName;
+  for (int i = 0; i < 300; ++i) {
+    name.appendSegment(i);
+    keyName.append("key").appendVersion(i);
+  }
+
+  Data data(name);
+  data.setContent(Blob((const uint8_t*)"abc", 3));
+  Sha256WithRsaSignature signature;
+  signature.getKeyLocator().setType(ndn_KeyLocatorType_KEYNAME);
+  signature.getKeyLocator().setKeyName(keyName);
+  signature.setSignature(Blob((const uint8_t*)"sig", 3));
+  data.setSignature(signature);
+  Blob encoding = data.wireEncode();
+
+  Data reDecodedData;
+  reDecodedData.wireDecode(encoding);
+  ASSERT_EQ(name, reDecodedData.getName());
+  const Sha256WithRsaSignature *reDecodedSignature =
+    dynamic_cast<const Sha256WithRsaSignature*>(reDecodedData.getSignature());
+  ASSERT_TRUE(reDecodedSignature != 0);
+  ASSERT_EQ(keyName, reDecodedSignature->getKeyLocator().getKeyName());
+  ASSERT_TRUE(reDecodedData.wireEncode().equals(encoding));
+}
+
+TEST_F(TestDataMethods, DecodeLazy)
+{
+  Blob input(codedData, sizeof(codedData));
+  Data data;
+  data.wireDecodeLazy(input);
+  ASSERT_EQ(dumpData(data), initialDump) << "Lazy decoded data does not match original dump";
+  // Decoding the fields on demand must not invalidate the wire encoding.
+  ASSERT_TRUE(data.getDefaultWireEncoding().equals(input));
+
+  // A copy shares the pending fields, and decodes them independently.
+  Data lazyData;
+  lazyData.wireDecodeLazy(input);
+  Data copy(lazyData);
+  ASSERT_EQ(Name("/ndn/abc"), copy.getName());
+  ASSERT_EQ(dumpData(lazyData), initialDump);
+
+  // Setting a field before decoding it uses the new value.
+  Data changedData;
+  changedData.wireDecodeLazy(input);
+  changedData.setContent(Blob((const uint8_t*)"xyz", 3));
+  ASSERT_TRUE(changedData.getDefaultWireEncoding().isNull());
+  ASSERT_EQ(3, changedData.getContent().size());
+  ASSERT_EQ(Name("/ndn/abc"), changedData.getName());
+  Data reDecodedData;
+  reDecodedData.wireDecode(changedData.wireEncode());
+  ASSERT_TRUE(reDecodedData.getContent().equals(changedData.getContent()));
+  ASSERT_TRUE(data.getSignature()->getSignature().equals
+              (reDecodedData.getSignature()->getSignature()));
+}
+
+TEST_F(TestDataMethods, DecodeLazyThreads)
+{
+  Blob input(codedData, sizeof(codedData));
+  for (int i = 0; i < 20; ++i) {
+    Data lazyData;
+    lazyData.wireDecodeLazy(input);
+    const Data& sharedData = lazyData;
+
+    // Each thread reads the const fields or copies the Data while the others
+    // may be decoding the same pending fields.
+    vector<vector<string> > dumps(4);
+    vector<thread> threads;
+    for (size_t j = 0; j < dumps.size(); ++j)
+      threads.push_back(thread([&sharedData, &dumps, j]() {
+        if (j % 2 == 0)
+          dumps[j] = dumpData(sharedData);
+        else
+          dumps[j] = dumpData(Data(sharedData));
+      }));
+    for (size_t j = 0; j < threads.size(); ++j)
+      threads[j].join();
+
+    for (size_t j = 0; j < dumps.size(); ++j)
+      ASSERT_EQ(initialDump, dumps[j]) <<
+        "Lazy decoded data read from multiple threads does not match";
+  }
+}
+
+TEST_F(TestDataMethods, EncodeReusedBuffer)
+{
+  Data data;
+  data.wireDecode(codedData, sizeof(codedData));
+  data.setContent(Blob(data.getContent()));
+  Blob expected(*data.wireEncode());
+
+  // Each encoding is released before the next, so the encoder reuses the
+  // buffer of the previous one. Modify the content to invalidate the cached
+  // encoding without changing the bytes.
+  for (int i = 0; i < 20; ++i) {
+    data.setContent(Blob(data.getContent()));
+    ASSERT_TRUE(data.wireEncode().equals(expected)) <<
+      "Encoding with a reused buffer does not match the original";
+  }
+
+  // A content larger than the largest pooled buffer.
+  vector<uint8_t> largeContent(100000);
+  for (size_t i = 0; i < largeContent.size(); ++i)
+    largeContent[i] = (uint8_t)i;
+  Data largeData(data);
+  largeData.setContent(largeContent);
+  Data reDecodedData;
+  reDecodedData.wireDecode(largeData.wireEncode());
+  ASSERT_TRUE(reDecodedData.getContent().equals(Blob(largeContent)));
+  ASSERT_EQ(data.getName(), reDecodedData.getName());
+}
+
+TEST_F(TestDataMethods, ReusedBufferIsCleared)
+{
+  ptr_lib::shared_ptr<vector<uint8_t> > buffer = BufferPool::allocate(100);
+  // Use the full capacity, as TlvPrependEncoder does.
+  buffer->resize(buffer->capacity());
+  for (size_t i = 0; i < buffer->size(); ++i)
+    (*buffer)[i] = 0xAA;
+  size_t capacity = buffer->capacity();
+  buffer.reset();
+
+  // The buffer is reused from the free list of this thread.
+  buffer = BufferPool::allocate(100);
+  buffer->resize(capacity);
+  for (size_t i = 0; i < buffer->size(); ++i)
+    ASSERT_EQ(0, (*buffer)[i]) << "A reused buffer has the previous contents";
+}
+
+static Blob
+makeSignatureBits
+  (const uint8_t* signedPortion, size_t signedPortionLength, size_t length)
+{
+  vector<uint8_t> signatureBits(length);
+  for (size_t i = 0; i < length; ++i)
+    signatureBits[i] = (uint8_t)(i + signedPortionLength);
+  return Blob(signatureBits);
+}
+
+TEST_F(TestDataMethods, EncodeWithSignature)
+{
+  // Each pair is the signature length and the reserved length. In the last
+  // two, trimming would change the number of bytes in the Data TLV length or
+  // the SignatureValue TLV length, so it must encode again.
+  const size_t lengths[][2] =
+    { { 32, 32 }, { 70, 72 }, { 80, 72 }, { 20, 0 }, { 0, 10 }, { 200, 252 },
+      { 240, 260 } };
+
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    Data data(*freshData);
+    SignedBlob encoding = data.wireEncodeWithSignature
+      (bind(&makeSignatureBits, _1, _2, lengths[i][0]), lengths[i][1]);
+
+    ASSERT_EQ(lengths[i][0], data.getSignature()->getSignature().size());
+    ASSERT_TRUE(encoding.equals(data.getDefaultWireEncoding()));
+    size_t signedPortionBeginOffset, signedPortionEndOffset;
+    Blob expected = WireFormat::getDefaultWireFormat()->encodeData
+      (data, &signedPortionBeginOffset, &signedPortionEndOffset);
+    ASSERT_TRUE(encoding.equals(expected)) <<
+      "The encoding with the signature does not match encoding again";
+    ASSERT_EQ(signedPortionBeginOffset, encoding.getSignedPortionBeginOffset());
+    ASSERT_EQ(signedPortionEndOffset, encoding.getSignedPortionEndOffset());
+    ASSERT_TRUE(data.getSignature()->getSignature().equals
+      (makeSignatureBits
+       (0, signedPortionEndOffset - signedPortionBeginOffset, lengths[i][0])));
+  }
+
+  // The DER-encoded ECDSA signature length varies, so sign several times with
+  // the same key.
+  for (int i = 0; i < 5; ++i) {
+    VerifyCounter counter;
+    freshData->setContent(Blob((const uint8_t*)&i, sizeof(i)));
+    credentials.signData(*freshData, credentials.getEcdsaCertName());
+
+    credentials.verifyData
+      (freshData, bind(&VerifyCounter::onVerified, &counter, _1),
+       bind(&VerifyCounter::onValidationFailed, &counter, _1, _2));
+    ASSERT_EQ(counter.onValidationFailedCallCount_, 0) << "Signature verification failed";
+    ASSERT_EQ(counter.onVerifiedCallCount_, 1) << "Verification callback was not used.";
+  }
+}
+
+/**
+ * Make a list of Data packets with different content.
+ */
+static vector<ptr_lib::shared_ptr<Data> >
+makeDataList(const Data& data, int nData)
+{
+  vector<ptr_lib::shared_ptr<Data> > dataList;
+  for (int i = 0; i < nData; ++i) {
+    ptr_lib::shared_ptr<Data> newData(new Data(data));
+    newData->setContent(Blob((const uint8_t*)&i, sizeof(i)));
+    dataList.push_back(newData);
+  }
+
+  return dataList;
+}
+
+static void
+onDataListSigned
+  (const vector<ptr_lib::shared_ptr<Data> >& dataList,
+   const vector<ptr_lib::shared_ptr<Data> >* expectedDataList,
+   atomic<int>* result)
+{
+  *result = (dataList == *expectedDataList ? 1 : -1);
+}
+
+static void
+onDataListSignFailed
+  (const vector<ptr_lib::shared_ptr<Data> >& dataList, const string& reason,
+   atomic<int>* result)
+{
+  *result = -2;
+}
+
+TEST_F(TestDataMethods, SignBatch)
+{
+  const int nData = 37;
+  credentials.getKeyChain().setSigningThreadCount(4);
+
+  // RSA signatures are deterministic, so each encoding must be the same as
+  // signing individually.
+  vector<ptr_lib::shared_ptr<Data> > expectedList = makeDataList(*freshData, nData);
+  vector<ptr_lib::shared_ptr<Data> > dataList = makeDataList(*freshData, nData);
+  vector<Data*> dataPointers;
+  for (int i = 0; i < nData; ++i) {
+    credentials.signData(*expectedList[i]);
+    dataPointers.push_back(dataList[i].get());
+  }
+  credentials.getKeyChain().signBatch
+    (dataPointers, credentials.getDefaultCertName());
+  for (int i = 0; i < nData; ++i)
+    ASSERT_TRUE(dataList[i]->wireEncode().equals(expectedList[i]->wireEncode()))
+      << "The batch signed encoding " << i << " does not match signing individually";
+
+  // Sign with ECDSA asynchronously and verify.
+  dataList = makeDataList(*freshData, nData);
+  atomic<int> result(0);
+  credentials.getKeyChain().signBatchAsync
+    (dataList, credentials.getEcdsaCertName(),
+     bind(&onDataListSigned, _1, &dataList, &result),
+     bind(&onDataListSignFailed, _1, _2, &result));
+  for (int i = 0; i < 1000 && result == 0; ++i)
+    usleep(10000);
+  ASSERT_EQ(1, result) << "signBatchAsync did not call onSigned with the list";
+
+  VerifyCounter counter;
+  for (int i = 0; i < nData; ++i) {
+    ASSERT_TRUE(dataList[i]->getContent().equals
+                (Blob((const uint8_t*)&i, sizeof(i))));
+    credentials.verifyData
+      (dataList[i], bind(&VerifyCounter::onVerified, &counter, _1),
+       bind(&VerifyCounter::onValidationFailed, &counter, _1, _2));
+  }
+  ASSERT_EQ(counter.onValidationFailedCallCount_, 0) << "Signature verification failed";
+  ASSERT_EQ(counter.onVerifiedCallCount_, nData) << "Verification callback was not used.";
+
+  // A missing key must be reported through onFailed, not thrown.
+  result = 0;
+  ASSERT_NO_THROW(credentials.getKeyChain().signBatchAsync
+    (dataList, Name("/no/such/KEY/ksk-1/ID-CERT/0"),
+     bind(&onDataListSigned, _1, &dataList, &result),
+     bind(&onDataListSignFailed, _1, _2, &result)));
+  for (int i = 0; i < 1000 && result == 0; ++i)
+    usleep(10000);
+  ASSERT_EQ(-2, result) << "signBatchAsync did not call onFailed for a missing key";
+}
+
 TEST_F(TestDataMethods, EmptySignature)
 {
   // make sure nothing is set in the signature of newly created data
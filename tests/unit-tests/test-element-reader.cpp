@@ -0,0 +1,208 @@
+/**
+ * Copyright (C) 2017 Regents of the University of California.
+ * @author: Jeff Thompson <jefft0@remap.ucla.edu>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version, with the additional exemption that
+ * compiling, linking, and/or using OpenSSL is allowed.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * A copy of the GNU Lesser General Public License is in the file COPYING.
+ */
+
+#include <stdlib.h>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../../src/c/encoding/element-reader.h"
+#include "../../src/util/dynamic-uint8-vector.hpp"
+
+using namespace std;
+using namespace ndn;
+
+/**
+ * An ElementCollector extends ndn_ElementListener to save a copy of each
+ * element passed to onReceivedElement.
+ */
+class ElementCollector : public ndn_ElementListener {
+public:
+  ElementCollector()
+  {
+    ndn_ElementListener_initialize(this, &onReceivedElementWrapper);
+  }
+
+  static void
+  onReceivedElementWrapper
+    (ndn_ElementListener *self, const uint8_t *element, size_t elementLength)
+  {
+    ((ElementCollector*)self)->elements_.push_back
+      (vector<uint8_t>(element, element + elementLength));
+  }
+
+  vector<vector<uint8_t> > elements_;
+};
+
+/**
+ * Append the VAR-NUMBER encoding of varNumber to output. If nBytes is 1, 3, 5
+ * or 9, then use that encoding even if it is not the shortest, which the
+ * decoder must still accept.
+ */
+static void
+appendVarNumber(vector<uint8_t>& output, uint64_t varNumber, int nBytes)
+{
+  if (nBytes == 1) {
+    output.push_back((uint8_t)varNumber);
+    return;
+  }
+
+  output.push_back(nBytes == 3 ? 253 : (nBytes == 5 ? 254 : 255));
+  for (int i = nBytes - 2; i >= 0; --i)
+    output.push_back((uint8_t)((varNumber >> (8 * i)) & 0xff));
+}
+
+/**
+ * Append a TLV element with a random type, random value and a random encoding
+ * of the type and length.
+ */
+static void
+appendRandomElement(vector<uint8_t>& output)
+{
+  static const int nBytesChoices[] = { 1, 3, 5, 9 };
+
+  uint64_t type = (uint64_t)(rand() % 253);
+  size_t valueLength;
+  int lengthChoice = rand() % 4;
+  if (lengthChoice == 0)
+    valueLength = 0;
+  else if (lengthChoice == 1)
+    valueLength = rand() % 253;
+  else
+    valueLength = rand() % 3000;
+
+  int typeNBytes = nBytesChoices[rand() % 4];
+  int lengthNBytes = valueLength < 253 ?
+    nBytesChoices[rand() % 4] : nBytesChoices[1 + rand() % 3];
+  appendVarNumber(output, type, typeNBytes);
+  appendVarNumber(output, valueLength, lengthNBytes);
+  for (size_t i = 0; i < valueLength; ++i)
+    output.push_back((uint8_t)rand());
+}
+
+/**
+ * Pass the input to a new ndn_ElementReader in chunks and return the elements.
+ * @param input The bytes of the elements.
+ * @param maxChunkSize If 0, pass the input in one call. If 1, pass one byte at
+ * a time so that each TLV header is split across calls. Otherwise, use random
+ * chunk sizes from 1 to maxChunkSize.
+ */
+static vector<vector<uint8_t> >
+readElements(const vector<uint8_t>& input, size_t maxChunkSize)
+{
+  ElementCollector collector;
+  DynamicUInt8Vector buffer(10);
+  ndn_ElementReader elementReader;
+  ndn_ElementReader_initialize(&elementReader, &collector, &buffer);
+
+  size_t offset = 0;
+  while (offset < input.size()) {
+    size_t chunkSize;
+    if (maxChunkSize == 0)
+      chunkSize = input.size();
+    else
+      chunkSize = 1 + rand() % maxChunkSize;
+    if (chunkSize > input.size() - offset)
+      chunkSize = input.size() - offset;
+
+    EXPECT_EQ(NDN_ERROR_success, ndn_ElementReader_onReceivedData
+      (&elementReader, &input[offset], chunkSize));
+    offset += chunkSize;
+  }
+
+  return collector.elements_;
+}
+
+class TestElementReader : public ::testing::Test {
+};
+
+TEST_F(TestElementReader, FindElementEnd)
+{
+  // Type 5, 3-byte length encoding of 3, then the value.
+  uint8_t input[] = { 5, 253, 0, 3, 1, 2, 3, 9 };
+  ndn_TlvStructureDecoder decoder;
+
+  ndn_TlvStructureDecoder_initialize(&decoder);
+  ASSERT_EQ(NDN_ERROR_success, ndn_TlvStructureDecoder_findElementEnd
+    (&decoder, input, sizeof(input)));
+  ASSERT_EQ(1, decoder.gotElementEnd);
+  ASSERT_EQ(7, decoder.offset);
+
+  // The header is complete but the value is not.
+  ndn_TlvStructureDecoder_initialize(&decoder);
+  ASSERT_EQ(NDN_ERROR_success, ndn_TlvStructureDecoder_findElementEnd
+    (&decoder, input, 5));
+  ASSERT_EQ(0, decoder.gotElementEnd);
+  ASSERT_EQ(NDN_ERROR_success, ndn_TlvStructureDecoder_findElementEnd
+    (&decoder, input, sizeof(input)));
+  ASSERT_EQ(1, decoder.gotElementEnd);
+  ASSERT_EQ(7, decoder.offset);
+
+  // The header is split.
+  ndn_TlvStructureDecoder_initialize(&decoder);
+  ASSERT_EQ(NDN_ERROR_success, ndn_TlvStructureDecoder_findElementEnd
+    (&decoder, input, 2));
+  ASSERT_EQ(0, decoder.gotElementEnd);
+  ASSERT_EQ(NDN_ERROR_success, ndn_TlvStructureDecoder_findElementEnd
+    (&decoder, input, sizeof(input)));
+  ASSERT_EQ(1, decoder.gotElementEnd);
+  ASSERT_EQ(7, decoder.offset);
+}
+
+TEST_F(TestElementReader, ChunkedEquivalence)
+{
+  srand(42);
+
+  for (int iteration = 0; iteration < 200; ++iteration) {
+    vector<uint8_t> input;
+    vector<size_t> elementEnds;
+    int nElements = 1 + rand() % 10;
+    for (int i = 0; i < nElements; ++i) {
+      appendRandomElement(input);
+      elementEnds.push_back(input.size());
+    }
+
+    // One byte at a time always splits the header, which exercises the state
+    // machine. Use its result as the reference for the other chunk sizes.
+    vector<vector<uint8_t> > expected = readElements(input, 1);
+    ASSERT_EQ(elementEnds.size(), expected.size());
+    size_t elementBegin = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(elementEnds[i] - elementBegin, expected[i].size());
+      ASSERT_TRUE(equal
+        (expected[i].begin(), expected[i].end(), input.begin() + elementBegin));
+      elementBegin = elementEnds[i];
+    }
+
+    ASSERT_TRUE(expected == readElements(input, 0)) <<
+      "Reading the whole input must match reading one byte at a time";
+    ASSERT_TRUE(expected == readElements(input, 2)) <<
+      "Reading random chunks must match reading one byte at a time";
+    ASSERT_TRUE(expected == readElements(input, 12)) <<
+      "Reading random chunks must match reading one byte at a time";
+    ASSERT_TRUE(expected == readElements(input, 500)) <<
+      "Reading random chunks must match reading one byte at a time";
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <fstream>
 #include <stdexcept>
+#include <unistd.h>
 #include <ndn-cpp/security/identity/memory-identity-storage.hpp>
 #include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
 #include <ndn-cpp/security/policy/no-verify-policy-manager.hpp>
@@ -35,6 +36,7 @@
 #include <ndn-cpp/encrypt/algo/rsa-algorithm.hpp>
 #include <ndn-cpp/encrypt/sqlite3-group-manager-db.hpp>
 #include <ndn-cpp/encrypt/group-manager.hpp>
+#include "../../src/encrypt/rsa-key-pair-pool.hpp"
 
 using namespace std;
 using namespace ndn;
@@ -430,6 +432,159 @@ TEST_F(TestGroupManager, GetGroupKey)
   ASSERT_EQ(0, tempResult.size());
 }
 
+TEST_F(TestGroupManager, GetGroupKeyInParallel)
+{
+  // Create the group manager.
+  GroupManager manager
+    (Name("Alice"), Name("data_type"),
+     ptr_lib::make_shared<Sqlite3GroupManagerDb>(groupKeyDatabaseFilePath),
+     1024, 1, keyChain.get());
+  manager.setThreadCount(2);
+  setManager(manager);
+
+  MillisecondsSince1970 timePoint1 = fromIsoString("20150825T093000");
+  vector<ptr_lib::shared_ptr<Data> > result;
+  manager.getGroupKey(timePoint1, result);
+
+  ASSERT_EQ(4, result.size());
+  ASSERT_EQ
+    ("/Alice/READ/data_type/E-KEY/20150825T090000/20150825T100000",
+     result[0]->getName().toUri());
+  EncryptKey groupEKey(result[0]->getContent());
+
+  // The D-KEY packets are in the same order as with one thread.
+  const char* members[] = { "memberA", "memberB", "memberC" };
+  for (size_t i = 1; i < result.size(); ++i) {
+    const Data& data = *result[i];
+    ASSERT_EQ
+      (string("/Alice/READ/data_type/D-KEY/20150825T090000/20150825T100000/FOR/ndn/") +
+       members[i - 1] + "/ksk-123",
+       data.getName().toUri());
+    ASSERT_TRUE(data.getSignature()->getSignature().size() > 0);
+
+    // Decrypt the nonce key, then the group D-KEY.
+    Blob dataContent = data.getContent();
+    EncryptedContent encryptedNonce;
+    encryptedNonce.wireDecode(dataContent);
+    EncryptParams decryptParams(ndn_EncryptAlgorithmType_RsaOaep);
+    Blob nonce = RsaAlgorithm::decrypt
+      (decryptKeyBlob, encryptedNonce.getPayload(), decryptParams);
+
+    size_t encryptedNonceSize = encryptedNonce.wireEncode().size();
+    EncryptedContent encryptedPayload;
+    encryptedPayload.wireDecode
+      (dataContent.buf() + encryptedNonceSize,
+       dataContent.size() - encryptedNonceSize);
+    decryptParams.setAlgorithmType(ndn_EncryptAlgorithmType_AesCbc);
+    decryptParams.setInitialVector(encryptedPayload.getInitialVector());
+    DecryptKey groupDKey(AesAlgorithm::decrypt
+      (nonce, encryptedPayload.getPayload(), decryptParams));
+
+    EncryptKey derivedGroupEKey = RsaAlgorithm::deriveEncryptKey
+      (groupDKey.getKeyBits());
+    ASSERT_TRUE(groupEKey.getKeyBits().equals(derivedGroupEKey.getKeyBits()));
+  }
+}
+
+TEST_F(TestGroupManager, GetGroupKeyCache)
+{
+  // Create the group manager.
+  GroupManager manager
+    (Name("Alice"), Name("data_type"),
+     ptr_lib::make_shared<Sqlite3GroupManagerDb>(groupKeyDatabaseFilePath),
+     1024, 1, keyChain.get());
+  setManager(manager);
+
+  MillisecondsSince1970 timePoint1 = fromIsoString("20150825T093000");
+  MillisecondsSince1970 timePoint2 = fromIsoString("20150825T094500");
+  vector<ptr_lib::shared_ptr<Data> > result1;
+  vector<ptr_lib::shared_ptr<Data> > result2;
+
+  // A time slot in the same interval gets the cached group key.
+  manager.getGroupKey(timePoint1, result1);
+  manager.getGroupKey(timePoint2, result2);
+  ASSERT_EQ(4, result2.size());
+  ASSERT_TRUE(result1[0]->getContent().equals(result2[0]->getContent()));
+
+  // Changing the members makes a new group key.
+  Data memberD;
+  memberD.wireDecode(certificate.wireEncode(), *TlvWireFormat::get());
+  memberD.setName(Name("/ndn/memberD/KEY/ksk-123/ID-CERT/123"));
+  manager.addMember("schedule1", memberD);
+  manager.getGroupKey(timePoint2, result2);
+  ASSERT_EQ(5, result2.size());
+  ASSERT_FALSE(result1[0]->getContent().equals(result2[0]->getContent()));
+
+  manager.removeMember(Name("/ndn/memberD"));
+  manager.getGroupKey(timePoint1, result1);
+  ASSERT_EQ(4, result1.size());
+  ASSERT_FALSE(result1[0]->getContent().equals(result2[0]->getContent()));
+
+  // Without the cache, each call makes a new group key.
+  manager.setMaxCachedGroupKeys(0);
+  manager.getGroupKey(timePoint2, result2);
+  ASSERT_EQ(4, result2.size());
+  ASSERT_FALSE(result1[0]->getContent().equals(result2[0]->getContent()));
+}
+
+TEST_F(TestGroupManager, GetGroupKeyFromKeyPairPool)
+{
+  // Create the group manager.
+  GroupManager manager
+    (Name("Alice"), Name("data_type"),
+     ptr_lib::make_shared<Sqlite3GroupManagerDb>(groupKeyDatabaseFilePath),
+     1024, 1, keyChain.get());
+  manager.setKeyPairPoolSize(2);
+  manager.setMaxCachedGroupKeys(0);
+  setManager(manager);
+  RsaKeyPairPool& pool = *manager.keyPairPool_;
+  ASSERT_LE(pool.getReadyCount(), 2);
+
+  // Take key pairs right away, so usually before the pool has them ready.
+  MillisecondsSince1970 timePoint1 = fromIsoString("20150825T093000");
+  vector<ptr_lib::shared_ptr<Data> > result1;
+  vector<ptr_lib::shared_ptr<Data> > result2;
+  manager.getGroupKey(timePoint1, result1);
+  manager.getGroupKey(timePoint1, result2);
+
+  if (ThreadPool::isCryptoThreadSafe()) {
+    // The pool fills to its size and no further, even if getKeyPair had to
+    // generate a key pair itself.
+    for (int i = 0; i < 3000 && pool.getReadyCount() < 2; ++i)
+      usleep(10000);
+    usleep(500000);
+    ASSERT_EQ(2, pool.getReadyCount()) << "The key pair pool did not stay at its size";
+  }
+  else
+    ASSERT_EQ(0, pool.getReadyCount());
+  manager.setKeyPairPoolSize(0);
+
+  ASSERT_EQ(4, result1.size());
+  ASSERT_EQ(4, result2.size());
+  // Each group key is a different key pair from the pool.
+  ASSERT_FALSE(result1[0]->getContent().equals(result2[0]->getContent()));
+
+  // Check that the D-KEY for memberA has the private key of the E-KEY.
+  Blob dataContent = result1[1]->getContent();
+  EncryptedContent encryptedNonce;
+  encryptedNonce.wireDecode(dataContent);
+  EncryptParams decryptParams(ndn_EncryptAlgorithmType_RsaOaep);
+  Blob nonce = RsaAlgorithm::decrypt
+    (decryptKeyBlob, encryptedNonce.getPayload(), decryptParams);
+
+  size_t encryptedNonceSize = encryptedNonce.wireEncode().size();
+  EncryptedContent encryptedPayload;
+  encryptedPayload.wireDecode
+    (dataContent.buf() + encryptedNonceSize,
+     dataContent.size() - encryptedNonceSize);
+  decryptParams.setAlgorithmType(ndn_EncryptAlgorithmType_AesCbc);
+  decryptParams.setInitialVector(encryptedPayload.getInitialVector());
+  Blob groupDKeyBits = AesAlgorithm::decrypt
+    (nonce, encryptedPayload.getPayload(), decryptParams);
+  ASSERT_TRUE(result1[0]->getContent().equals
+    (RsaAlgorithm::deriveEncryptKey(groupDKeyBits).getKeyBits()));
+}
+
 int
 main(int argc, char **argv)
 {
@@ -340,6 +340,73 @@ TEST_F(TestSqlIdentityStorage, EcdsaIdentity)
   ASSERT_FALSE(identityStorage->doesKeyExist(keyName));
 }
 
+TEST_F(TestSqlIdentityStorage, PrivateKeyCache)
+{
+  Name keyName = Name("/TestSqlIdentityStorage/PrivateKeyCache").appendVersion
+    ((uint64_t)getNowSeconds()).append("ksk-1");
+  uint8_t data[] = { 1, 2, 3, 4 };
+
+  FilePrivateKeyStorage storage;
+  storage.generateKeyPair(keyName, RsaKeyParams());
+  Blob signature = storage.sign(data, sizeof(data), keyName);
+  // Signing again uses the cached private key.
+  ASSERT_TRUE(signature.equals(storage.sign(data, sizeof(data), keyName)))
+    << "An RSA signature of the same data should be the same";
+  ASSERT_EQ(256, signature.size());
+
+  // Replace the key files using another storage object. The first storage
+  // object must notice that the private key file changed.
+  FilePrivateKeyStorage otherStorage;
+  otherStorage.deleteKeyPair(keyName);
+  otherStorage.generateKeyPair(keyName, EcdsaKeyParams());
+  ASSERT_TRUE(storage.sign(data, sizeof(data), keyName).size() < 256)
+    << "The cached RSA key was used after the key file was replaced";
+
+  storage.deleteKeyPair(keyName);
+  ASSERT_THROW(storage.sign(data, sizeof(data), keyName), SecurityException);
+}
+
+TEST_F(TestSqlIdentityStorage, LookupCache)
+{
+  Name identityName = Name("/TestSqlIdentityStorage/LookupCache").appendVersion
+    ((uint64_t)getNowSeconds());
+  Name keyName1 = Name(identityName).append("ksk-1");
+  Name keyName2 = Name(identityName).append("ksk-2");
+  vector<uint8_t> decodedKey;
+  fromBase64(RSA_DER, decodedKey);
+
+  identityStorage->addKey(keyName1, KEY_TYPE_RSA, Blob(decodedKey));
+  identityStorage->addKey(keyName2, KEY_TYPE_RSA, Blob(decodedKey));
+  identityStorage->setDefaultIdentity(identityName);
+  identityStorage->setDefaultKeyNameForIdentity(keyName1);
+
+  // Fill the cache, then change the defaults through the same object.
+  ASSERT_EQ(identityName, identityStorage->getDefaultIdentity());
+  ASSERT_EQ(keyName1, identityStorage->getDefaultKeyNameForIdentity(identityName));
+  ASSERT_TRUE(identityStorage->getKey(keyName1).equals(Blob(decodedKey)));
+  identityStorage->setDefaultKeyNameForIdentity(keyName2);
+  ASSERT_EQ(keyName2, identityStorage->getDefaultKeyNameForIdentity(identityName))
+    << "The cached default key was not updated";
+
+  // Change the database through another connection.
+  {
+    BasicIdentityStorage otherStorage(databaseFilePath);
+    otherStorage.setDefaultKeyNameForIdentity(keyName1);
+    otherStorage.deletePublicKeyInfo(keyName2);
+  }
+  ASSERT_EQ(keyName1, identityStorage->getDefaultKeyNameForIdentity(identityName))
+    << "The change by another connection was not noticed";
+  ASSERT_FALSE(identityStorage->doesKeyExist(keyName2));
+  ASSERT_THROW(identityStorage->getKey(keyName2), SecurityException);
+
+  identityStorage->deleteIdentityInfo(identityName);
+  ASSERT_FALSE(identityStorage->doesKeyExist(keyName1));
+  ASSERT_THROW(identityStorage->getKey(keyName1), SecurityException);
+  ASSERT_THROW
+    (identityStorage->getDefaultKeyNameForIdentity(identityName),
+     SecurityException);
+}
+
 int
 main(int argc, char **argv)
 {
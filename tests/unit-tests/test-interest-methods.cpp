@@ -277,6 +277,32 @@ TEST_F(TestInterestMethods, CopyConstructor)
     "Interest constructed as deep copy does not match original";
 }
 
+TEST_F(TestInterestMethods, DecodeLazy)
+{
+  Blob input(codedInterest, sizeof(codedInterest));
+  Interest interest;
+  interest.wireDecodeLazy(input);
+  // Decoding the Selectors on demand must not clear the nonce or invalidate
+  // the wire encoding.
+  ASSERT_EQ(initialDump, dumpInterest(interest)) <<
+    "Lazy decoded interest does not match original";
+  ASSERT_FALSE(interest.getNonce().isNull());
+  ASSERT_TRUE(interest.getDefaultWireEncoding().equals(input));
+
+  // Setting one selector must keep the others from the wire encoding.
+  Interest changedInterest;
+  changedInterest.wireDecodeLazy(input);
+  changedInterest.setChildSelector(0);
+  ASSERT_TRUE(changedInterest.getNonce().isNull());
+  ASSERT_EQ(0, changedInterest.getChildSelector());
+  ASSERT_EQ(referenceInterest.getMinSuffixComponents(),
+            changedInterest.getMinSuffixComponents());
+  ASSERT_EQ(referenceInterest.getExclude().toUri(),
+            changedInterest.getExclude().toUri());
+  ASSERT_TRUE(referenceInterest.getKeyLocator().equals
+              (changedInterest.getKeyLocator()));
+}
+
 TEST_F(TestInterestMethods, EmptyNonce)
 {
   // make sure a freshly created interest has no nonce
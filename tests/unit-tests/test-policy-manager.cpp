@@ -26,6 +26,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include <fstream>
+#include <sstream>
 #include <ndn-cpp/security/key-chain.hpp>
 #include <ndn-cpp/security/security-exception.hpp>
 #include <ndn-cpp/security/identity/memory-identity-storage.hpp>
@@ -211,6 +212,7 @@ public:
     (const ptr_lib::shared_ptr<Data>& data, const string& reason)
   {
     ++failureCount_;
+    failureReason_ = reason;
   }
 
   void onVerifiedInterest(const ptr_lib::shared_ptr<Interest>& interest)
@@ -222,11 +224,13 @@ public:
     (const ptr_lib::shared_ptr<Interest>& interest, const string& reason)
   {
     ++failureCount_;
+    failureReason_ = reason;
   }
 
   int successCount_;
   int failureCount_;
   bool hasFurtherSteps_;
+  string failureReason_;
 };
 
 static VerificationResult doVerify
@@ -369,6 +373,363 @@ TEST_F(TestConfigPolicyManager, SelfVerification)
     "Verification failure callback called " << vr.failureCount_ << " times instead of 1";
 }
 
+TEST_F(TestConfigPolicyManager, SelfVerificationManyKeys)
+{
+  ptr_lib::shared_ptr<SelfVerifyPolicyManager> policyManager
+    (new SelfVerifyPolicyManager(identityStorage_.get()));
+  KeyChain keyChain(identityManager_, policyManager);
+
+  // Use more keys than the cache of decoded verification keys holds, and
+  // verify each data packet twice so that the second pass checks evicted keys.
+  const int nKeys = 120;
+  vector<ptr_lib::shared_ptr<Data> > dataList;
+  for (int i = 0; i < nKeys; ++i) {
+    Name identityName = Name("TestValidator/ManyKeys").appendSegment(i);
+    keyChain.createIdentityAndCertificate(identityName, EcdsaKeyParams());
+
+    ptr_lib::shared_ptr<Data> data
+      (new Data(Name("/TestData/ManyKeys").appendSegment(i)));
+    keyChain.signByIdentity(*data, identityName);
+    dataList.push_back(data);
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < nKeys; ++i) {
+      VerificationResult vr = doVerify(*policyManager, dataList[i]);
+      ASSERT_EQ(vr.successCount_, 1) <<
+        "Verification of data signed by key " << i << " failed";
+    }
+  }
+
+  // Changing the content must fail verification with the cached key.
+  ptr_lib::shared_ptr<Data> changedData(new Data(*dataList[nKeys - 1]));
+  changedData->setContent(Blob((const uint8_t*)"changed", 7));
+  VerificationResult vr = doVerify(*policyManager, changedData);
+  ASSERT_EQ(vr.successCount_, 0) <<
+    "Verification of changed data succeeded";
+  ASSERT_EQ(vr.failureCount_, 1) <<
+    "Verification failure callback called " << vr.failureCount_ << " times instead of 1";
+}
+
+TEST_F(TestConfigPolicyManager, ValidationCache)
+{
+  ptr_lib::shared_ptr<CertificateCache> certificateCache(new CertificateCache());
+  ptr_lib::shared_ptr<ConfigPolicyManager> policyManager
+    (new ConfigPolicyManager("", certificateCache));
+  policyManager->load(
+    "validator                                  \n"
+    "{                                          \n"
+    "  rule                                     \n"
+    "  {                                        \n"
+    "    id \"Cache Rule\"                      \n"
+    "    for data                               \n"
+    "    checker                                \n"
+    "    {                                      \n"
+    "      type customized                      \n"
+    "      sig-type rsa-sha256                  \n"
+    "      key-locator                          \n"
+    "      {                                    \n"
+    "        type name                          \n"
+    "        name /TestValidationCache          \n"
+    "        relation is-strict-prefix-of       \n"
+    "      }                                    \n"
+    "    }                                      \n"
+    "  }                                        \n"
+    "}                                          \n", "cache-rules");
+  KeyChain keyChain(identityManager_, policyManager);
+
+  Name certificateName = keyChain.createIdentityAndCertificate
+    (Name("/TestValidationCache/signer"));
+  ptr_lib::shared_ptr<IdentityCertificate> certificate =
+    keyChain.getCertificate(certificateName);
+  certificateCache->insertCertificate(*certificate);
+
+  ptr_lib::shared_ptr<Data> data(new Data(Name("/TestValidationCache/data")));
+  keyChain.sign(*data, certificateName);
+
+  // The second verification uses the saved public key.
+  for (int i = 0; i < 2; ++i) {
+    VerificationResult vr = doVerify(*policyManager, data);
+    ASSERT_FALSE(vr.hasFurtherSteps_) <<
+      "ConfigPolicyManager returned ValidationRequest but certificate is known";
+    ASSERT_EQ(vr.successCount_, 1) <<
+      "Verification of valid data failed on try " << i;
+  }
+  ASSERT_EQ(1, policyManager->validatedCertificates_.size());
+
+  // A bad packet is rejected, and then rejected from the failed packet cache.
+  ptr_lib::shared_ptr<Data> badData(new Data(*data));
+  badData->setContent(Blob((const uint8_t*)"changed", 7));
+  for (int i = 0; i < 2; ++i) {
+    VerificationResult vr = doVerify(*policyManager, badData);
+    ASSERT_EQ(vr.successCount_, 0) << "Verification of changed data succeeded";
+    ASSERT_EQ(vr.failureCount_, 1) <<
+      "Verification failure callback called " << vr.failureCount_ <<
+      " times instead of 1";
+    ASSERT_EQ(1, policyManager->failedPackets_.size());
+  }
+  string badDataKey = policyManager->failedPacketOrder_.front();
+
+  // A failed signed Interest is remembered by its name, so it is rejected from
+  // the cache when expressed again with a new Nonce.
+  ptr_lib::shared_ptr<Interest> badInterest
+    (new Interest(Name("/TestValidationCache/interest")));
+  keyChain.sign(*badInterest, certificateName);
+  for (int i = 0; i < 2; ++i) {
+    badInterest->refreshNonce();
+    VerificationResult vr = doVerify(*policyManager, badInterest);
+    ASSERT_EQ(vr.successCount_, 0) << "Verification of the Interest succeeded";
+    ASSERT_EQ(vr.failureCount_, 1);
+    ASSERT_EQ(2, policyManager->failedPackets_.size()) <<
+      "A re-expressed Interest was not found in the failed packet cache";
+  }
+  string badInterestKey = policyManager->failedPacketOrder_.back();
+
+  // When full, the oldest failed packet is erased first.
+  size_t maxFailedPackets = ConfigPolicyManager::MAX_FAILED_PACKETS;
+  for (size_t i = 2; i <= maxFailedPackets; ++i) {
+    ptr_lib::shared_ptr<Interest> unsignedInterest
+      (new Interest(Name("/TestValidationCache/unsigned").appendSegment(i)));
+    doVerify(*policyManager, unsignedInterest);
+  }
+  ASSERT_EQ(maxFailedPackets, policyManager->failedPackets_.size());
+  ASSERT_EQ(maxFailedPackets, policyManager->failedPacketOrder_.size());
+  ASSERT_TRUE(policyManager->failedPackets_.find(badDataKey) ==
+              policyManager->failedPackets_.end()) <<
+    "The oldest failed packet was not erased";
+  ASSERT_TRUE(policyManager->failedPackets_.find(badInterestKey) !=
+              policyManager->failedPackets_.end()) <<
+    "A newer failed packet was erased instead of the oldest";
+
+  // Replace the certificate with one having a different key but the same name.
+  // The saved public key must not be used.
+  Name otherCertificateName = keyChain.createIdentityAndCertificate
+    (Name("/TestValidationCache/other"));
+  IdentityCertificate replacement(*certificate);
+  replacement.setPublicKeyInfo
+    (keyChain.getCertificate(otherCertificateName)->getPublicKeyInfo());
+  replacement.encode();
+  keyChain.sign(replacement, otherCertificateName);
+  certificateCache->insertCertificate(replacement);
+
+  VerificationResult vr = doVerify(*policyManager, data);
+  ASSERT_EQ(vr.successCount_, 0) <<
+    "Verification used the public key of a replaced certificate";
+  ASSERT_EQ(vr.failureCount_, 1);
+
+  // Restore the original certificate. The data was remembered as failed, so
+  // setting the TTL is needed to clear the failed packets.
+  certificateCache->insertCertificate(*certificate);
+  policyManager->setFailedPacketTtl(60000);
+  vr = doVerify(*policyManager, data);
+  ASSERT_EQ(vr.successCount_, 1) <<
+    "Verification failed after restoring the certificate";
+}
+
+TEST_F(TestConfigPolicyManager, CertificateCacheLimits)
+{
+  ptr_lib::shared_ptr<IdentityCertificate> certificate = keyChain_->getCertificate
+    (identityManager_->getDefaultCertificateNameForIdentity(identityName_));
+  size_t certificateSize = certificate->wireEncode().size();
+
+  // Make certificates with different names and room for three of them.
+  vector<IdentityCertificate> certificates;
+  vector<Name> names;
+  for (int i = 0; i < 4; ++i) {
+    ostringstream keyId;
+    keyId << "ksk-" << i;
+    Name name = Name("/TestCertificateCache/KEY").append(keyId.str())
+      .append("ID-CERT");
+    IdentityCertificate copy(*certificate);
+    copy.setName(Name(name).appendVersion(1));
+    certificates.push_back(copy);
+    names.push_back(name);
+  }
+  CertificateCache cache(3 * certificateSize + certificateSize / 2);
+
+  for (int i = 0; i < 3; ++i)
+    cache.insertCertificate(certificates[i]);
+  ASSERT_EQ(3, cache.size());
+  ptr_lib::shared_ptr<IdentityCertificate> cached = cache.getCertificate(names[0]);
+  ASSERT_TRUE(cached.get() != 0);
+  ASSERT_TRUE(cached->wireEncode().equals(certificates[0].wireEncode()));
+  ASSERT_TRUE(cache.getPublicKeyDer(names[0]).equals
+              (certificate->getPublicKeyInfo().getKeyDer()));
+
+  // names[0] was used, so inserting another removes names[1].
+  cache.insertCertificate(certificates[3]);
+  ASSERT_EQ(3, cache.size());
+  ASSERT_TRUE(cache.getByteCount() <= 3 * certificateSize + certificateSize / 2);
+  ASSERT_TRUE(cache.getCertificate(names[1]).get() == 0) <<
+    "The least recently used certificate was not removed";
+  ASSERT_TRUE(cache.getCertificate(names[0]).get() != 0);
+  ASSERT_FALSE(cache.getCertificateEncoding(names[3]).isNull());
+
+  // An expired certificate replaces the entry but is not returned.
+  IdentityCertificate expired(certificates[2]);
+  expired.setNotAfter(expired.getNotBefore());
+  expired.encode();
+  cache.insertCertificate(expired);
+  ASSERT_TRUE(cache.getCertificate(names[2]).get() == 0) <<
+    "An expired certificate was returned";
+  ASSERT_TRUE(cache.getCertificateEncoding(names[2]).isNull());
+  ASSERT_EQ(2, cache.size());
+
+  cache.deleteCertificate(names[0]);
+  ASSERT_TRUE(cache.getCertificate(names[0]).get() == 0);
+  cache.reset();
+  ASSERT_EQ(0, cache.size());
+  ASSERT_EQ(0, cache.getByteCount());
+}
+
+TEST_F(TestConfigPolicyManager, CertificateFetchCoalescing)
+{
+  // Prepare a TestFace which saves the callbacks of each expressInterest so
+  // that the test can answer later.
+  class TestFace : public Face {
+  public:
+    TestFace()
+    : Face("localhost")
+    {}
+
+    virtual uint64_t
+    expressInterest
+      (const Interest& interest, const OnData& onData,
+       const OnTimeout& onTimeout, const OnNetworkNack& onNetworkNack,
+       WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+    {
+      interests_.push_back(ptr_lib::make_shared<Interest>(interest));
+      onData_.push_back(onData);
+      onTimeout_.push_back(onTimeout);
+      return 0;
+    }
+
+    vector<ptr_lib::shared_ptr<Interest> > interests_;
+    vector<OnData> onData_;
+    vector<OnTimeout> onTimeout_;
+  };
+
+  ptr_lib::shared_ptr<CertificateCache> certificateCache(new CertificateCache());
+  ptr_lib::shared_ptr<ConfigPolicyManager> policyManager
+    (new ConfigPolicyManager("", certificateCache));
+  policyManager->load(
+    "validator                                  \n"
+    "{                                          \n"
+    "  rule                                     \n"
+    "  {                                        \n"
+    "    id \"Fetch Rule\"                      \n"
+    "    for data                               \n"
+    "    checker                                \n"
+    "    {                                      \n"
+    "      type customized                      \n"
+    "      sig-type rsa-sha256                  \n"
+    "      key-locator                          \n"
+    "      {                                    \n"
+    "        type name                          \n"
+    "        name /TestCertificateFetch         \n"
+    "        relation is-strict-prefix-of       \n"
+    "      }                                    \n"
+    "    }                                      \n"
+    "  }                                        \n"
+    "}                                          \n", "fetch-rules");
+  KeyChain keyChain(identityManager_, policyManager);
+  TestFace face;
+  keyChain.setFace(&face);
+
+  // The root certificate is known. The signer certificate must be fetched.
+  Name rootCertificateName = keyChain.createIdentityAndCertificate
+    (Name("/TestCertificateFetch/root"));
+  certificateCache->insertCertificate
+    (*keyChain.getCertificate(rootCertificateName));
+  Name signerCertificateName = keyChain.createIdentityAndCertificate
+    (Name("/TestCertificateFetch/signer"));
+  ptr_lib::shared_ptr<IdentityCertificate> signerCertificate
+    (new IdentityCertificate(*keyChain.getCertificate(signerCertificateName)));
+  keyChain.sign(*signerCertificate, rootCertificateName);
+
+  const int nPackets = 10;
+  VerificationResult result;
+  for (int i = 0; i < nPackets; ++i) {
+    ptr_lib::shared_ptr<Data> data
+      (new Data(Name("/TestCertificateFetch/data").appendSegment(i)));
+    keyChain.sign(*data, signerCertificateName);
+    keyChain.verifyData
+      (data, bind(&VerificationResult::onVerified, &result, _1),
+       (const OnDataValidationFailed)bind
+         (&VerificationResult::onValidationFailed, &result, _1, _2));
+  }
+
+  // All the packets wait for one Interest.
+  ASSERT_EQ(1, face.interests_.size());
+  ASSERT_EQ(0, result.successCount_ + result.failureCount_);
+  face.onData_[0](face.interests_[0], signerCertificate);
+  ASSERT_EQ(nPackets, result.successCount_);
+  ASSERT_EQ(0, result.failureCount_);
+
+  // The signer certificate is now in the cache, so no Interest is sent.
+  ptr_lib::shared_ptr<Data> data(new Data(Name("/TestCertificateFetch/more")));
+  keyChain.sign(*data, signerCertificateName);
+  keyChain.verifyData
+    (data, bind(&VerificationResult::onVerified, &result, _1),
+     (const OnDataValidationFailed)bind
+       (&VerificationResult::onValidationFailed, &result, _1, _2));
+  ASSERT_EQ(1, face.interests_.size());
+  ASSERT_EQ(nPackets + 1, result.successCount_);
+
+  // If the retries time out, all the waiting packets fail.
+  Name otherCertificateName = keyChain.createIdentityAndCertificate
+    (Name("/TestCertificateFetch/other"));
+  VerificationResult otherResult;
+  for (int i = 0; i < 3; ++i) {
+    ptr_lib::shared_ptr<Data> otherData
+      (new Data(Name("/TestCertificateFetch/other-data").appendSegment(i)));
+    keyChain.sign(*otherData, otherCertificateName);
+    keyChain.verifyData
+      (otherData, bind(&VerificationResult::onVerified, &otherResult, _1),
+       (const OnDataValidationFailed)bind
+         (&VerificationResult::onValidationFailed, &otherResult, _1, _2));
+  }
+  ASSERT_EQ(2, face.interests_.size());
+  // Time out the Interest and each retry.
+  for (size_t i = 1; i < face.interests_.size(); ++i)
+    face.onTimeout_[i](face.interests_[i]);
+  ASSERT_EQ(4, face.interests_.size());
+  ASSERT_EQ(0, otherResult.successCount_);
+  ASSERT_EQ(3, otherResult.failureCount_);
+
+  // A fetched certificate which is expired fails without fetching it again.
+  Name expiredCertificateName = keyChain.createIdentityAndCertificate
+    (Name("/TestCertificateFetch/expired"));
+  ptr_lib::shared_ptr<IdentityCertificate> expiredCertificate
+    (new IdentityCertificate(*keyChain.getCertificate(expiredCertificateName)));
+  expiredCertificate->setNotAfter(expiredCertificate->getNotBefore());
+  expiredCertificate->encode();
+  keyChain.sign(*expiredCertificate, rootCertificateName);
+  ptr_lib::shared_ptr<Data> expiredData
+    (new Data(Name("/TestCertificateFetch/expired-data")));
+  keyChain.sign(*expiredData, expiredCertificateName);
+  VerificationResult expiredResult;
+  keyChain.verifyData
+    (expiredData, bind(&VerificationResult::onVerified, &expiredResult, _1),
+     (const OnDataValidationFailed)bind
+       (&VerificationResult::onValidationFailed, &expiredResult, _1, _2));
+  ASSERT_EQ(5, face.interests_.size());
+  face.onData_[4](face.interests_[4], expiredCertificate);
+  ASSERT_EQ(5, face.interests_.size());
+  ASSERT_EQ(0, expiredResult.successCount_);
+  ASSERT_EQ(1, expiredResult.failureCount_);
+  ASSERT_NE(string::npos, expiredResult.failureReason_.find("expired"));
+
+  // The failure is cached, so verifying again doesn't send an Interest.
+  keyChain.verifyData
+    (expiredData, bind(&VerificationResult::onVerified, &expiredResult, _1),
+     (const OnDataValidationFailed)bind
+       (&VerificationResult::onValidationFailed, &expiredResult, _1, _2));
+  ASSERT_EQ(5, face.interests_.size());
+  ASSERT_EQ(2, expiredResult.failureCount_);
+  ASSERT_NE(string::npos, expiredResult.failureReason_.find("expired"));
+}
+
 TEST_F(TestConfigPolicyManager, InterestTimestamp)
 {
   Name interestName = Name("/ndn/ucla/edu/something");
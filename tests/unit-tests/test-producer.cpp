@@ -23,6 +23,8 @@
 #include "gtest/gtest.h"
 #include <algorithm>
 #include <fstream>
+#include <limits>
+#include <sstream>
 #include <stdexcept>
 #include <ndn-cpp/security/identity/memory-identity-storage.hpp>
 #include <ndn-cpp/security/identity/memory-private-key-storage.hpp>
@@ -187,6 +189,58 @@ public:
     ASSERT_EQ(0, result.size());
   }
 
+  static void
+  appendSegments
+    (const vector<ptr_lib::shared_ptr<Data> >& result,
+     vector<ptr_lib::shared_ptr<Data> >* segments)
+  {
+    segments->insert(segments->end(), result.begin(), result.end());
+  }
+
+  static void
+  countErrors
+    (EncryptError::ErrorCode errorCode, const string& message, int* errorCount)
+  {
+    ++(*errorCount);
+  }
+
+  /**
+   * Check that the segments have the expected names and FinalBlockId, and
+   * that they decrypt to the content.
+   */
+  static void
+  checkSegments
+    (const vector<ptr_lib::shared_ptr<Data> >& segments,
+     const Name& contentName, const Name& cKeyName, const Blob& contentKey,
+     const Blob& content)
+  {
+    vector<uint8_t> decrypted;
+    for (size_t i = 0; i < segments.size(); ++i) {
+      const Data& segment = *segments[i];
+      Name expectedName(contentName);
+      expectedName.appendSegment(i).append(Encryptor::getNAME_COMPONENT_FOR())
+        .append(cKeyName);
+      ASSERT_EQ(expectedName, segment.getName());
+      if (i == segments.size() - 1)
+        ASSERT_EQ(Name::Component::fromSegment(i),
+                  segment.getMetaInfo().getFinalBlockId());
+      else
+        ASSERT_EQ(0, segment.getMetaInfo().getFinalBlockId().getValue().size());
+      ASSERT_TRUE(segment.getSignature()->getSignature().size() > 0);
+
+      EncryptedContent dataContent;
+      dataContent.wireDecode(segment.getContent());
+      ASSERT_EQ(cKeyName, dataContent.getKeyLocator().getKeyName());
+      EncryptParams params(ndn_EncryptAlgorithmType_AesCbc);
+      params.setInitialVector(dataContent.getInitialVector());
+      Blob plain = AesAlgorithm::decrypt
+        (contentKey, dataContent.getPayload(), params);
+      decrypted.insert(decrypted.end(), plain.buf(), plain.buf() + plain.size());
+    }
+
+    ASSERT_TRUE(Blob(decrypted).equals(content));
+  }
+
   string databaseFilePath;
   ptr_lib::shared_ptr<KeyChain> keyChain;
   Name certificateName;
@@ -466,6 +520,190 @@ TEST_F(TestProducer, ContentKeyTimeout)
      bind(&TestProducer::keyTimeoutOnEncryptedKeys, this, _1, &timeoutCount));
 }
 
+TEST_F(TestProducer, ContentKeyCache)
+{
+  // A ProducerDb which counts the calls to a Sqlite3ProducerDb.
+  class CountingProducerDb : public Sqlite3ProducerDb {
+  public:
+    CountingProducerDb(const string& databaseFilePath)
+    : Sqlite3ProducerDb(databaseFilePath), callCount_(0)
+    {}
+
+    virtual bool
+    hasContentKey(MillisecondsSince1970 timeSlot)
+    {
+      ++callCount_;
+      return Sqlite3ProducerDb::hasContentKey(timeSlot);
+    }
+
+    virtual Blob
+    getContentKey(MillisecondsSince1970 timeSlot)
+    {
+      ++callCount_;
+      return Sqlite3ProducerDb::getContentKey(timeSlot);
+    }
+
+    virtual void
+    addContentKey(MillisecondsSince1970 timeSlot, const Blob& key)
+    {
+      ++callCount_;
+      Sqlite3ProducerDb::addContentKey(timeSlot, key);
+    }
+
+    int callCount_;
+  };
+
+  // Prepare a TestFace which does not answer key interests.
+  class TestFace : public Face {
+  public:
+    TestFace()
+    : Face("localhost")
+    {}
+
+    virtual uint64_t
+    expressInterest
+      (const Interest& interest, const OnData& onData,
+       const OnTimeout& onTimeout, const OnNetworkNack& onNetworkNack,
+       WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+    {
+      return 0;
+    }
+  };
+
+  TestFace face;
+  ptr_lib::shared_ptr<CountingProducerDb> testDb
+    (new CountingProducerDb(databaseFilePath));
+  Producer producer
+    (Name("/prefix"), Name("/suffix"), &face, keyChain.get(), testDb);
+
+  // The first packet in the hour creates the content key, then the other
+  // packets in the hour do not use the database.
+  Data data1;
+  producer.produce
+    (data1, fromIsoString("20150101T100001"),
+     Blob(DATA_CONTENT, sizeof(DATA_CONTENT)));
+  int firstCallCount = testDb->callCount_;
+  Data data2;
+  producer.produce
+    (data2, fromIsoString("20150101T105959"),
+     Blob(DATA_CONTENT, sizeof(DATA_CONTENT)));
+  ASSERT_EQ(firstCallCount, testDb->callCount_);
+
+  // The content key was written through to the database.
+  Blob contentKey = testDb->getContentKey(fromIsoString("20150101T100000"));
+  EncryptedContent dataContent;
+  dataContent.wireDecode(data2.getContent());
+  EncryptParams params(ndn_EncryptAlgorithmType_AesCbc, 16);
+  params.setInitialVector(dataContent.getInitialVector());
+  ASSERT_TRUE(AesAlgorithm::decrypt(contentKey, dataContent.getPayload(), params)
+              .equals(Blob(DATA_CONTENT, sizeof(DATA_CONTENT))));
+
+  // A new hour uses the database again.
+  int callCount = testDb->callCount_;
+  Data data3;
+  producer.produce
+    (data3, fromIsoString("20150101T110001"),
+     Blob(DATA_CONTENT, sizeof(DATA_CONTENT)));
+  ASSERT_TRUE(testDb->callCount_ > callCount);
+}
+
+TEST_F(TestProducer, ProduceSegments)
+{
+  // Prepare a TestFace which does not answer key interests.
+  class TestFace : public Face {
+  public:
+    TestFace()
+    : Face("localhost")
+    {}
+
+    virtual uint64_t
+    expressInterest
+      (const Interest& interest, const OnData& onData,
+       const OnTimeout& onTimeout, const OnNetworkNack& onNetworkNack,
+       WireFormat& wireFormat = *WireFormat::getDefaultWireFormat())
+    {
+      return 0;
+    }
+  };
+
+  TestFace face;
+  ptr_lib::shared_ptr<ProducerDb> testDb(new Sqlite3ProducerDb(databaseFilePath));
+  Producer producer
+    (Name("/prefix"), Name("/a/b/c"), &face, keyChain.get(), testDb);
+
+  MillisecondsSince1970 timeSlot = fromIsoString("20150101T100001");
+  Name contentName("/prefix/SAMPLE/a/b/c");
+  contentName.append(Schedule::toIsoString(timeSlot));
+  Name cKeyName("/prefix/SAMPLE/a/b/c");
+  cKeyName.append(Encryptor::getNAME_COMPONENT_C_KEY())
+    .append("20150101T100000");
+
+  // Use more segments than one batch, with a short last segment.
+  size_t segmentSize = 10;
+  vector<uint8_t> contentBuffer(200 * segmentSize + 5);
+  for (size_t i = 0; i < contentBuffer.size(); ++i)
+    contentBuffer[i] = i;
+  Blob content(contentBuffer);
+
+  vector<ptr_lib::shared_ptr<Data> > segments;
+  producer.produceSegments
+    (timeSlot, content, segmentSize, bind(&appendSegments, _1, &segments));
+  Blob contentKey = testDb->getContentKey(timeSlot);
+  ASSERT_EQ(201, segments.size());
+  checkSegments(segments, contentName, cKeyName, contentKey, content);
+
+  // Each segment has its own initial vector.
+  EncryptedContent content0, content1;
+  content0.wireDecode(segments[0]->getContent());
+  content1.wireDecode(segments[1]->getContent());
+  ASSERT_FALSE(content0.getInitialVector().equals(content1.getInitialVector()));
+
+  // Read from a stream with more than one thread.
+  producer.setThreadCount(3);
+  segments.clear();
+  istringstream stream(string(contentBuffer.begin(), contentBuffer.end()));
+  producer.produceSegments
+    (timeSlot, stream, segmentSize, bind(&appendSegments, _1, &segments));
+  ASSERT_EQ(201, segments.size());
+  checkSegments(segments, contentName, cKeyName, contentKey, content);
+
+  // A stream which ends exactly at the end of a batch.
+  segments.clear();
+  Blob batchContent(&contentBuffer[0], 64 * segmentSize);
+  istringstream batchStream(string(contentBuffer.begin(),
+                                   contentBuffer.begin() + 64 * segmentSize));
+  producer.produceSegments
+    (timeSlot, batchStream, segmentSize, bind(&appendSegments, _1, &segments));
+  ASSERT_EQ(64, segments.size());
+  checkSegments(segments, contentName, cKeyName, contentKey, batchContent);
+
+  // Empty content makes one empty segment.
+  segments.clear();
+  producer.produceSegments
+    (timeSlot, Blob(), segmentSize, bind(&appendSegments, _1, &segments));
+  ASSERT_EQ(1, segments.size());
+  checkSegments
+    (segments, contentName, cKeyName, contentKey, Blob(vector<uint8_t>()));
+
+  // A stream read error is reported to onError and makes no segments.
+  segments.clear();
+  istringstream badStream(string(contentBuffer.begin(), contentBuffer.end()));
+  badStream.setstate(ios::badbit);
+  int errorCount = 0;
+  producer.produceSegments
+    (timeSlot, badStream, segmentSize, bind(&appendSegments, _1, &segments),
+     bind(&countErrors, _1, _2, &errorCount));
+  ASSERT_EQ(1, errorCount);
+  ASSERT_EQ(0, segments.size());
+
+  // A segmentSize whose batch would overflow is rejected.
+  ASSERT_THROW
+    (producer.produceSegments
+       (timeSlot, content, numeric_limits<size_t>::max(),
+        bind(&appendSegments, _1, &segments)),
+     runtime_error);
+}
+
 TEST_F(TestProducer, ProducerWithLink)
 {
   Name prefix("/prefix");
@@ -26,6 +26,7 @@
 #include "../../src/util/regex/ndn-regex-repeat-matcher.hpp"
 #include "../../src/util/regex/ndn-regex-pattern-list-matcher.hpp"
 #include "../../src/util/regex/ndn-regex-top-matcher.hpp"
+#include "../../src/util/regex/ndn-regex-automaton.hpp"
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -449,6 +450,81 @@ TEST_F(TestRegex, TopMatcherAdvanced)
   ASSERT_EQ(Name("/ndn/edu/ucla/yingdi/mac/"), cm->expand());
 }
 
+TEST_F(TestRegex, Automaton)
+{
+  NdnRegexPatternListMatcher matcher
+    ("<a>?[<b><c>]{2,3}[^<a>]*<d.*>", ptr_lib::shared_ptr<NdnRegexBackrefManager>());
+  ptr_lib::shared_ptr<NdnRegexAutomaton> automaton =
+    NdnRegexAutomaton::compile(matcher);
+  ASSERT_TRUE(automaton.get() != 0);
+  ASSERT_TRUE(automaton->match(Name("/a/b/c/d")));
+  ASSERT_TRUE(automaton->match(Name("/b/c/c/x/y/dz")));
+  ASSERT_FALSE(automaton->match(Name("/a/b/d")));
+  ASSERT_FALSE(automaton->match(Name("/b/c/a/d")));
+  ASSERT_FALSE(automaton->match(Name("/b/c/d/x")));
+  // Check again with the saved DFA states.
+  ASSERT_TRUE(automaton->match(Name("/a/b/c/d")));
+  ASSERT_FALSE(automaton->match(Name("/a/b/d")));
+
+  // A big bounded repetition is left to the backtracking matchers.
+  NdnRegexPatternListMatcher bigMatcher
+    ("<a>{0,10000}", ptr_lib::shared_ptr<NdnRegexBackrefManager>());
+  ASSERT_TRUE(NdnRegexAutomaton::compile(bigMatcher).get() == 0);
+}
+
+TEST_F(TestRegex, AutomatonEquivalence)
+{
+  // Each expression has an expand string for its back references.
+  const char* patterns[][2] = {
+    { "^<a><b><c>", "\\0" },
+    { "<b><c><d>$", "\\0" },
+    { "^<a><b><c><d>$", "\\0" },
+    { "<a><b><c><d>", "\\0" },
+    { "<b><c>", "\\0" },
+    { "^(<.*>*)<.*>", "\\1" },
+    { "^(<.*>*)<.*><c>(<.*>)<.*>", "\\1\\2" },
+    { "(<.*>*)<.*>$", "\\1" },
+    { "<.*>(<.*>*)<.*>$", "\\1" },
+    { "<a>(<>*)<>$", "\\1" },
+    { "^<a>?<b>+<c>*$", "\\0" },
+    { "^<a>{2,3}[<b><c>]$", "\\0" },
+    { "[^<a>]{1,}<c>", "\\0" },
+    { "^(<a><b>)+<c>?$", "\\1" },
+    { "^([<a><b>]*)<c>(<.*>*)$", "\\2\\1" },
+    { "^<(a|b)>{1,2}<c>", "\\1" },
+    { "^<>*<>*<>*<>*<>*<>*<b>$", "\\0" },
+    { "^<a>{,2}<b>{2,}", "\\0" }
+  };
+
+  // Make every name of up to 5 components from a, b and c.
+  vector<Name> names;
+  names.push_back(Name());
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (names[i].size() >= 5)
+      continue;
+    names.push_back(Name(names[i]).append("a"));
+    names.push_back(Name(names[i]).append("b"));
+    names.push_back(Name(names[i]).append("c"));
+  }
+
+  for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); ++i) {
+    NdnRegexTopMatcher automatonMatcher(patterns[i][0], patterns[i][1], true);
+    NdnRegexTopMatcher backtrackingMatcher(patterns[i][0], patterns[i][1], false);
+
+    for (size_t j = 0; j < names.size(); ++j) {
+      bool isMatched = backtrackingMatcher.match(names[j]);
+      ASSERT_EQ(isMatched, automatonMatcher.match(names[j]))
+        << patterns[i][0] << " " << names[j].toUri();
+      if (isMatched) {
+        ASSERT_EQ(backtrackingMatcher.getMatchResult().size(),
+                  automatonMatcher.getMatchResult().size());
+        ASSERT_EQ(backtrackingMatcher.expand(), automatonMatcher.expand())
+          << patterns[i][0] << " " << names[j].toUri();
+      }
+    }
+  }
+}
+
 int
 main(int argc, char **argv)
 {
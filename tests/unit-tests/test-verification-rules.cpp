@@ -367,6 +367,68 @@ TEST_F(TestVerificationRules, HyperRelation)
     (signatureName2, dataName, *matchedRule, failureReason));
 }
 
+TEST_F(TestVerificationRules, RepeatedMatch)
+{
+  // The compiled regular expressions are reused for each packet, so alternate
+  // the names and check that each result is the same as the first time.
+  ConfigPolicyManager policyManager
+    (policyConfigDirectory + "/hyperrelation_ruleset.conf");
+
+  Name dataName1("/SecurityTestSecRule/Basic/Longer/Data2");
+  Name dataName2("/SecurityTestSecRule/Basic/Other/Data1");
+  Data data1(dataName1);
+  Data data2(dataName1);
+  keyChain.sign(data1, defaultCertName);
+  keyChain.sign(data2, shortCertName);
+  Name signatureName1 =
+    dynamic_cast<const Sha256WithRsaSignature*>(data1.getSignature())->getKeyLocator().getKeyName();
+  Name signatureName2 =
+    dynamic_cast<const Sha256WithRsaSignature*>(data2.getSignature())->getKeyLocator().getKeyName();
+
+  const BoostInfoTree* matchedRule1 =
+    policyManager.findMatchingRule(dataName1, "data");
+  const BoostInfoTree* matchedRule2 =
+    policyManager.findMatchingRule(dataName2, "data");
+  ASSERT_TRUE(matchedRule1);
+  ASSERT_TRUE(matchedRule2);
+
+  string failureReason = "unknown";
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(matchedRule1, policyManager.findMatchingRule(dataName1, "data"));
+    ASSERT_EQ(matchedRule2, policyManager.findMatchingRule(dataName2, "data"));
+
+    ASSERT_TRUE(policyManager.checkSignatureMatch
+      (signatureName1, dataName1, *matchedRule1, failureReason));
+    ASSERT_FALSE(policyManager.checkSignatureMatch
+      (signatureName1, dataName2, *matchedRule2, failureReason));
+    ASSERT_FALSE(policyManager.checkSignatureMatch
+      (signatureName2, dataName1, *matchedRule1, failureReason));
+    ASSERT_TRUE(policyManager.checkSignatureMatch
+      (signatureName2, dataName2, *matchedRule2, failureReason));
+  }
+
+  // A rule with a bad regular expression fails when loading.
+  ASSERT_THROW(policyManager.load(
+    "validator\n"
+    "{\n"
+    "  rule\n"
+    "  {\n"
+    "    id \"Bad Regex\"\n"
+    "    for data\n"
+    "    filter\n"
+    "    {\n"
+    "      type name\n"
+    "      regex ^<SecurityTestSecRule>(<>\n"
+    "    }\n"
+    "    checker\n"
+    "    {\n"
+    "      type hierarchical\n"
+    "      sig-type rsa-sha256\n"
+    "    }\n"
+    "  }\n"
+    "}\n", "bad-regex"), std::exception);
+}
+
 int
 main(int argc, char **argv)
 {